@@ -0,0 +1,119 @@
+/* ---------------------------------------------------------------------------
+ * AT script interpreter of the GPS tracker, see atscript.h
+ * compiled together with tracker.c
+ * ---------------------------------------------------------------------------
+ */
+
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+#ifdef HOST_BUILD
+#include "hal.h"     // native build on PC against SIM800L emulator, see sim/
+#endif
+
+#include "atscript.h"
+
+#if FEATURE_PREEMPT
+uint8_t at_armed = 0;
+uint8_t at_ring = 0;
+#endif
+
+// *********************************************************************************************************
+// wait at most 'sec' seconds for the first byte of SIM800L response, polled every 50 usec
+// with AT_TICK every 100 ms is counted like in delay_sec(), with FEATURE_PREEMPT RI/RING is sampled
+// then too and a call ends the wait
+// *********************************************************************************************************
+uint8_t wait_rx(uint8_t sec)
+{
+  uint16_t n;
+#if AT_TICK
+  static uint16_t slice = 0;   // a part of 100 ms left by the last wait goes on
+  uint8_t low = 0;
+#endif
+
+#if FEATURE_PREEMPT
+  if (at_armed && at_ring) return 0;   // call is waiting, scripts are being left
+#endif
+  while (sec > 0)
+  {
+    for (n = 0; n < 20000; n++)
+    {
+      if (uart_ready()) return 1;
+      _delay_us(50);
+#if AT_TICK
+      if (++slice == 2000)
+      {
+        slice = 0;
+        if (at_tick(&low)) return 0;
+      }
+#endif
+    }
+    sec--;
+  }
+  return 0;
+}
+
+// *********************************************************************************************************
+// run script until AT_RETURN and give its value back
+// *********************************************************************************************************
+uint8_t run_script(const atstep_t *script)
+{
+  const atstep_t *step = script;
+  const void *p;
+  uint8_t op, arg, heard = 0, retries = 0;
+
+  for (;;)
+  {
+    op = pgm_read_byte(&step->op);
+    arg = pgm_read_byte(&step->arg);
+    p = pgm_read_ptr(&step->p);
+    step++;
+
+    switch (op)
+    {
+      case AT_OP_SEND:
+        uart_puts_P((const char *)p);
+        delay_sec(arg);
+        break;
+      case AT_OP_PUTS:
+        uart_puts((const char *)p);
+        delay_sec(arg);
+        break;
+      case AT_OP_WAIT:
+        delay_sec(arg);
+        break;
+      case AT_OP_READ:
+        // no line at all after timeout - no AT_MATCH will jump
+        heard = (arg == 0 || wait_rx(arg)) ? readline() : 0;
+        break;
+      case AT_OP_MATCH:
+        if (heard && response_has_P((const char *)p)) step = script + arg;
+        break;
+      case AT_OP_GOTO:
+        step = script + arg;
+        break;
+      case AT_OP_RETRY:
+        if (++retries < (uint8_t)(uintptr_t)p) step = script + arg;
+        else retries = 0;
+        break;
+      case AT_OP_CALL:
+        if (((atfunc_t)p)() && arg != AT_NEXT) step = script + arg;
+        break;
+      case AT_OP_RUN:
+        if (run_script((const atstep_t *)p) && arg != AT_NEXT) step = script + arg;
+        break;
+      default:   // AT_OP_RETURN
+        return arg;
+    }
+#if FEATURE_PREEMPT
+    // call came during this step or a nested script, leave all scripts
+    if (at_armed && at_ring) return AT_RING;
+#endif
+  }
+}
@@ -0,0 +1,116 @@
+/* ---------------------------------------------------------------------------
+ * AT script interpreter of the GPS tracker
+ * sequences of AT commands are PROGMEM tables of 4 byte steps run by
+ * run_script() instead of open coded uart_puts_P(); delay_sec(); readline();
+ * memcpy_P(); is_in_rx_buffer() calls, so all timing of SIM800L dialogue
+ * is in one place and every sequence costs 4 bytes of flash per step -
+ * ATMEGA versions only, the ATTINY ones use wait_rx() and call plain C
+ * functions, the linker drops the interpreter
+ *
+ * labels are indexes of steps in the same script, one retry counter per
+ * script run, nested scripts (AT_RUN) have their own
+ *
+ * FEATURE_PREEMPT : while the firmware main loop sets at_armed, delay_sec()
+ * and wait_rx() watch RI/RING and a call sets at_ring and cuts the wait
+ * short. Every running script then returns AT_RING at once, so registration
+ * backoff, bearer retries, answers awaited up to 40 s (CIPGSMLOC) or long
+ * waits give way to the call within 300 ms
+ *
+ * AT_TICK : wait_rx() hands its 100 ms slices to the firmware like delay_sec()
+ * does, the seconds spent waiting for SIM800L answers go to the energy
+ * statistics, uptime() and TRACK INTERVAL
+ * ---------------------------------------------------------------------------
+ */
+#ifndef ATSCRIPT_H
+#define ATSCRIPT_H
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+
+typedef struct {
+  uint8_t op;       // AT_OP_xxx
+  uint8_t arg;      // seconds, label or return value
+  const void *p;    // PROGMEM string, RAM string, function or script
+} atstep_t;
+
+// function called by AT_CALL, nonzero result jumps to the label
+typedef uint8_t (*atfunc_t)(void);
+
+#define AT_OP_SEND    0
+#define AT_OP_PUTS    1
+#define AT_OP_WAIT    2
+#define AT_OP_READ    3
+#define AT_OP_MATCH   4
+#define AT_OP_GOTO    5
+#define AT_OP_RETRY   6
+#define AT_OP_CALL    7
+#define AT_OP_RUN     8
+#define AT_OP_RETURN  9
+
+// label of AT_CALL / AT_RUN when the result only goes on to the next step
+#define AT_NEXT 0xFF
+
+// a call needs the main loop of energy statistics to be handled, ATTINY versions have no preemption
+#ifndef FEATURE_PREEMPT
+#if defined(__AVR_ATmega328P__)
+#define FEATURE_PREEMPT 1
+#else
+#define FEATURE_PREEMPT 0
+#endif
+#endif
+
+// preemption samples RI/RING in the same slices, ATTINY versions keep no time in them
+#ifndef AT_TICK
+#if FEATURE_PREEMPT || defined(__AVR_ATmega328P__)
+#define AT_TICK 1
+#else
+#define AT_TICK 0
+#endif
+#endif
+#if FEATURE_PREEMPT && !AT_TICK
+#error "FEATURE_PREEMPT samples RI/RING in at_tick(), AT_TICK is needed"
+#endif
+
+#if FEATURE_PREEMPT
+// value of run_script() pre-empted by a call
+#define AT_RING 0xFE
+extern uint8_t at_armed;       // set by the main loop when a call may interrupt what it does
+extern uint8_t at_ring;        // set by delay_sec() or wait_rx(), cleared by the main loop when it takes the call
+                               // scripts run while at_armed is 0 are never cut short
+#endif
+
+// send PROGMEM string 's' (compressed by tools/atstrings) and wait 'sec' seconds
+#define AT_SEND(s, sec)        { AT_OP_SEND, (sec), (s) }
+// send RAM string 'ram' (phone number, coordinates...) and wait 'sec' seconds
+#define AT_PUTS(ram, sec)      { AT_OP_PUTS, (sec), (const void *)(ram) }
+#define AT_WAIT(sec)           { AT_OP_WAIT, (sec), 0 }
+// read a line to 'response', wait at most 'sec' seconds for it to start, 0 = forever
+#define AT_READ(sec)           { AT_OP_READ, (sec), 0 }
+// jump to 'label' if the line read contains PROGMEM string 's'
+#define AT_MATCH(s, label)     { AT_OP_MATCH, (label), (s) }
+#define AT_GOTO(label)         { AT_OP_GOTO, (label), 0 }
+// jump to 'label' n-1 times, then reset the counter and go on
+#define AT_RETRY(n, label)     { AT_OP_RETRY, (label), (const void *)(n) }
+// call uint8_t f(void) - parser or firmware hook, jump to 'label' if it returns nonzero
+#define AT_CALL(f, label)      { AT_OP_CALL, (label), (const void *)(f) }
+// run another script, jump to 'label' if it returns nonzero
+#define AT_RUN(script, label)  { AT_OP_RUN, (label), (script) }
+#define AT_RETURN(v)           { AT_OP_RETURN, (v), 0 }
+
+uint8_t run_script(const atstep_t *script);
+// wait at most 'sec' seconds for the first byte of SIM800L response, 1 when it came - 0 also when
+// a call cut the wait short (at_ring), parsers give up then like after a timeout
+uint8_t wait_rx(uint8_t sec);
+
+// provided by the firmware
+void uart_puts(const char *s);
+void uart_puts_P(const char *s);
+void delay_sec(uint8_t i);
+uint8_t readline(void);
+uint8_t response_has_P(const char *s);
+uint8_t uart_ready(void);      // byte from SIM800L waits to be read
+#if AT_TICK
+uint8_t at_tick(uint8_t *low); // 100 ms waited and counted, RI/RING sampled - 1 when a call set at_ring
+#endif
+
+#endif
@@ -0,0 +1,304 @@
+// ---------------------------------------------------------------------------
+// cycle benchmark of tracker firmware under simavr
+//   avrbench -m atmega328p -f 1000000 firmware.elf scenario.scn
+// the AVR ELF runs on simavr, its USART and RI/INT0 pin are connected to
+// the SIM800L model of sim/ driven by the scenario, one clock cycle is
+// 1/f of virtual time. Prints "metric value" lines :
+//   calls.<fn> cycles.<fn> cycles_per_call.<fn>  for readline, the parsers
+//       and is_in_rx_buffer, cycles spent waiting in receive_uart, send_uart
+//       and delay loops are not counted so only processing cost is left
+//   stack_max   stack high-water mark in bytes below RAMEND
+//   stack_free  bytes above _end still painted with STACK_CANARY, what the
+//       firmware's stack_free() reports, only when the firmware paints RAM
+//   sram flash_size   size of the MCU memories
+// functions inlined by the compiler have no symbol and are not reported,
+// so build the ELF with -fno-inline
+// ---------------------------------------------------------------------------
+extern "C" {
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_uart.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_cycle_timers.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+}
+
+#include <fcntl.h>
+#include <gelf.h>
+#include <libelf.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+#include "sim800l.h"
+#include "world.h"
+
+namespace {
+
+// functions whose cost per call is measured
+const char* const kProbes[] = {"readline",      "is_in_rx_buffer", "readcellgps",
+                               "readphonenumber", "readbattery",   "readsmssender"};
+// busy waits on UART flags and delay loops, time inside is I/O not processing
+const char* const kWaits[] = {"receive_uart", "send_uart", "delay_sec", "delay_50usec"};
+
+// USART status register (data space address) holding RXC in bit 7
+struct McuInfo {
+  const char* name;
+  uint16_t ucsra;
+};
+const McuInfo kMcus[] = {{"atmega328p", 0xC0}, {"attiny2313", 0x4B}};
+
+// free RAM is painted with this byte at boot by FEATURE_STACKMON, see tracker.c
+constexpr uint8_t kStackCanary = 0xC5;
+
+struct Range {
+  std::string name;
+  uint32_t start = 0;
+  uint32_t end = 0;
+  uint64_t calls = 0;
+  uint64_t cycles = 0;
+};
+
+struct Frame {
+  Range* probe;
+  uint16_t sp;
+};
+
+struct Bench {
+  avr_t* avr = nullptr;
+  sim::World* world = nullptr;
+  sim::Sim800l* modem = nullptr;
+  uint32_t frequency = 1000000;
+  uint16_t ucsra = 0;
+  std::vector<Range> probes;
+  std::vector<Range> waits;
+  std::vector<Frame> frames;
+  uint16_t min_sp = 0xFFFF;
+  uint16_t static_end = 0;  // _end, first byte after .bss
+  avr_cycle_count_t last_rx = 0;
+  int ri_level = 1;
+};
+
+Bench g;
+
+sim::vtime to_time(avr_cycle_count_t cycles) {
+  return static_cast<sim::vtime>(cycles * 1000000ULL / g.frequency);
+}
+
+avr_cycle_count_t to_cycles(sim::vtime t) { return t * g.frequency / 1000000ULL; }
+
+uint16_t stack_pointer() { return g.avr->data[R_SPL] | (g.avr->data[R_SPH] << 8); }
+
+// addresses and sizes of function symbols from the ELF symbol table, _end in data space
+bool read_functions(const char* path, std::vector<Range>& functions, uint16_t& static_end) {
+  if (elf_version(EV_CURRENT) == EV_NONE) return false;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  Elf* elf = elf_begin(fd, ELF_C_READ, nullptr);
+  Elf_Scn* scn = nullptr;
+  while (elf != nullptr && (scn = elf_nextscn(elf, scn)) != nullptr) {
+    GElf_Shdr shdr;
+    if (gelf_getshdr(scn, &shdr) == nullptr || shdr.sh_type != SHT_SYMTAB) continue;
+    Elf_Data* data = elf_getdata(scn, nullptr);
+    size_t count = shdr.sh_entsize ? shdr.sh_size / shdr.sh_entsize : 0;
+    for (size_t i = 0; i < count; i++) {
+      GElf_Sym sym;
+      if (gelf_getsym(data, static_cast<int>(i), &sym) == nullptr) continue;
+      if (std::strcmp(elf_strptr(elf, shdr.sh_link, sym.st_name), "_end") == 0)
+        static_end = static_cast<uint16_t>(sym.st_value & 0xFFFF);  // data space starts at 0x800000
+      if (GELF_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_size == 0) continue;
+      Range r;
+      r.name = elf_strptr(elf, shdr.sh_link, sym.st_name);
+      r.start = static_cast<uint32_t>(sym.st_value);
+      r.end = static_cast<uint32_t>(sym.st_value + sym.st_size);
+      functions.push_back(r);
+    }
+  }
+  if (elf != nullptr) elf_end(elf);
+  close(fd);
+  return elf != nullptr;
+}
+
+void select_functions(const std::vector<Range>& functions, const char* const* names, size_t n,
+                      std::vector<Range>& out) {
+  for (size_t i = 0; i < n; i++)
+    for (const Range& f : functions)
+      if (f.name == names[i]) out.push_back(f);
+}
+
+Range* find(std::vector<Range>& ranges, uint32_t pc) {
+  for (Range& r : ranges)
+    if (pc >= r.start && pc < r.end) return &r;
+  return nullptr;
+}
+
+// account cycles of one executed instruction and follow calls and returns
+void profile(uint32_t pc, avr_cycle_count_t cycles) {
+  if (find(g.waits, pc) == nullptr)
+    for (Frame& f : g.frames) f.probe->cycles += cycles;
+
+  uint16_t sp = stack_pointer();
+  if (sp < g.min_sp) g.min_sp = sp;
+  while (!g.frames.empty() && sp > g.frames.back().sp) {
+    g.frames.back().probe->calls++;
+    g.frames.pop_back();
+  }
+  for (Range& r : g.probes) {
+    if (g.avr->pc != r.start) continue;
+    // jump back to the first instruction of a loop is not a new call
+    if (g.frames.empty() || g.frames.back().probe != &r || sp < g.frames.back().sp)
+      g.frames.push_back(Frame{&r, sp});
+    break;
+  }
+}
+
+void uart_tx(struct avr_irq_t*, uint32_t value, void*) {
+  g.world->advance_to(to_time(g.avr->cycle));
+  g.modem->receive(static_cast<uint8_t>(value));
+}
+
+// pass bytes from the modelled wire to the simavr USART one at a time,
+// like the 2 byte AVR FIFO the rest is buffered (and overrun) by World
+void uart_rx() {
+  if (!g.world->rx_available()) return;
+  if (g.avr->data[g.ucsra] & 0x80) return;  // RXC still set, firmware did not read UDR
+  if (g.avr->cycle - g.last_rx < to_cycles(sim::kByteTime)) return;
+  avr_raise_irq(avr_io_getirq(g.avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT), g.world->rx_pop());
+  g.last_rx = g.avr->cycle;
+}
+
+void ri_pin() {
+  int level = g.modem->ri_low() ? 0 : 1;
+  if (level == g.ri_level) return;
+  g.ri_level = level;
+  avr_raise_irq(avr_io_getirq(g.avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 2), level);
+}
+
+// simavr sleeps in real time by default, virtual time is enough here
+void no_sleep(avr_t*, avr_cycle_count_t) {}
+
+avr_cycle_count_t wake(avr_t*, avr_cycle_count_t, void*) { return 0; }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* mcu = "atmega328p";
+  const char* elf = nullptr;
+  const char* scn = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) mcu = argv[++i];
+    else if (std::strcmp(argv[i], "-f") == 0 && i + 1 < argc) g.frequency = std::strtoul(argv[++i], nullptr, 10);
+    else if (elf == nullptr) elf = argv[i];
+    else scn = argv[i];
+  }
+  if (elf == nullptr || scn == nullptr || g.frequency == 0) {
+    std::fprintf(stderr, "usage: %s [-m mcu] [-f hz] firmware.elf scenario.scn\n", argv[0]);
+    return 2;
+  }
+  for (const McuInfo& m : kMcus)
+    if (std::strcmp(m.name, mcu) == 0) g.ucsra = m.ucsra;
+  if (g.ucsra == 0) {
+    std::fprintf(stderr, "unsupported mcu %s\n", mcu);
+    return 2;
+  }
+
+  sim::Scenario scenario;
+  std::string error;
+  if (!scenario.load(scn, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+
+  std::vector<Range> functions;
+  if (!read_functions(elf, functions, g.static_end)) {
+    std::fprintf(stderr, "cannot read symbols of %s\n", elf);
+    return 2;
+  }
+  select_functions(functions, kProbes, sizeof(kProbes) / sizeof(kProbes[0]), g.probes);
+  select_functions(functions, kWaits, sizeof(kWaits) / sizeof(kWaits[0]), g.waits);
+
+  elf_firmware_t firmware;
+  std::memset(&firmware, 0, sizeof(firmware));
+  if (elf_read_firmware(elf, &firmware) != 0) {
+    std::fprintf(stderr, "cannot load %s\n", elf);
+    return 2;
+  }
+  g.avr = avr_make_mcu_by_name(mcu);
+  if (g.avr == nullptr) {
+    std::fprintf(stderr, "simavr does not know %s\n", mcu);
+    return 2;
+  }
+  avr_init(g.avr);
+  avr_load_firmware(g.avr, &firmware);
+  g.avr->frequency = g.frequency;
+  g.avr->sleep = no_sleep;
+
+  uint32_t flags = 0;
+  avr_ioctl(g.avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+  flags &= ~AVR_UART_FLAG_STDIO;
+  avr_ioctl(g.avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+  avr_irq_register_notify(avr_io_getirq(g.avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_tx, nullptr);
+  avr_raise_irq(avr_io_getirq(g.avr, AVR_IOCTL_IOPORT_GETIRQ('D'), 2), 1);
+
+  sim::World world(scenario);
+  sim::Sim800l modem(world);
+  g.world = &world;
+  g.modem = &modem;
+  modem.start();
+
+  while (world.finished() == sim::Finish::kRunning) {
+    uint32_t pc = g.avr->pc;
+    avr_cycle_count_t before = g.avr->cycle;
+    int state = avr_run(g.avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+      world.finish(sim::Finish::kHang, "firmware stopped");
+      break;
+    }
+    profile(pc, g.avr->cycle - before);
+
+    world.advance_to(to_time(g.avr->cycle));
+    bool asleep = g.avr->state == cpu_Sleeping;
+    world.set_mcu_asleep(asleep);
+    uart_rx();
+    ri_pin();
+
+    // sleeping core jumps to its next timer, make the next modem activity one
+    sim::vtime t;
+    avr_cycle_timer_cancel(g.avr, wake, nullptr);
+    if (asleep && world.next_activity(t)) {
+      avr_cycle_count_t when = to_cycles(t);
+      avr_cycle_timer_register(g.avr, when > g.avr->cycle ? when - g.avr->cycle : 1, wake, nullptr);
+    }
+  }
+
+  std::printf("sim_seconds %llu\n", static_cast<unsigned long long>(world.now() / sim::kSec));
+  std::printf("sms_sent %zu\n", modem.sent_sms().size());
+  for (const Range& r : g.probes) {
+    std::printf("calls.%s %llu\n", r.name.c_str(), static_cast<unsigned long long>(r.calls));
+    std::printf("cycles.%s %llu\n", r.name.c_str(), static_cast<unsigned long long>(r.cycles));
+    std::printf("cycles_per_call.%s %llu\n", r.name.c_str(),
+                static_cast<unsigned long long>(r.calls ? r.cycles / r.calls : 0));
+  }
+  std::printf("stack_max %u\n", static_cast<unsigned>(g.avr->ramend - g.min_sp));
+  // painted bytes counted like stack_free() of the firmware, checked against the SP trace :
+  // the lowest byte written by push is min_sp + 1
+  if (g.static_end != 0) {
+    unsigned painted = 0, any = 0;
+    for (uint32_t a = g.static_end; a <= g.avr->ramend && g.avr->data[a] == kStackCanary; a++) painted++;
+    for (uint32_t a = g.static_end; a <= g.min_sp; a++) any += g.avr->data[a] == kStackCanary;
+    unsigned untouched = g.min_sp + 1u > g.static_end ? g.min_sp + 1u - g.static_end : 0;
+    if (any > 0 || untouched == 0) {
+      std::printf("stack_free %u\n", painted);
+      if (painted > untouched)
+        std::fprintf(stderr, "stack_free %u but SP went down to %u bytes above _end\n", painted, untouched);
+    }
+  }
+  std::printf("sram %u\n", static_cast<unsigned>(g.avr->ramend - g.avr->ioend));
+  std::printf("flash_size %u\n", static_cast<unsigned>(g.avr->flashend + 1));
+  return world.finished() == sim::Finish::kHang ? 1 : 0;
+}
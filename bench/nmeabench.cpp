@@ -0,0 +1,237 @@
+// ---------------------------------------------------------------------------
+// host benchmark of the streaming GNSS parser (../gnss.c)
+//   nmeabench [-g seconds] [-r repeats] [-o generated.nmea] [log.nmea...]
+// without files a receiver log of -g seconds is generated : GGA, GSA, 3 GSV
+// and RMC every second like SIM808 / u-blox output with AT+CGNSTST=1, a
+// +CGNSINF: answer every 10 seconds and every 997th sentence damaged. Every
+// fix the parser takes is compared with the generated values and damaged
+// sentences must be counted as errors, exit code 1 when anything differs.
+// Recorded logs given as files are only timed and counted.
+// Prints bytes, sentences, MB/s and ns per byte of gnss_feed() on this host.
+// ---------------------------------------------------------------------------
+extern "C" {
+#include "gnss.h"
+}
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Expected {
+  int type = GNSS_NONE;        // what gnss_feed() must commit, GNSS_NONE for damaged / other sentences
+  gnss_fix_t fix{};
+};
+
+struct Log {
+  std::string bytes;
+  std::vector<Expected> sentences;   // in order of the commits
+  unsigned damaged = 0;
+};
+
+// NMEA minutes with 4 decimal places, the same rounding as ddmm() of the parser
+int32_t e6_from_minutes(uint32_t deg, uint32_t min_e4) {
+  return static_cast<int32_t>(deg * 1000000UL + (min_e4 * 100UL + 30) / 60);
+}
+
+std::string checksum(const std::string& body) {
+  unsigned sum = 0;
+  for (char c : body) sum ^= static_cast<unsigned char>(c);
+  char text[8];
+  std::snprintf(text, sizeof(text), "*%02X\r\n", sum);
+  return "$" + body + text;
+}
+
+Log generate(unsigned seconds, uint32_t seed) {
+  Log log;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> step(-40, 40);   // 1e-4 minute steps of the track
+  std::uniform_int_distribution<int> knots(0, 6000);  // 0.01 knot
+  std::uniform_int_distribution<int> sats(4, 12);
+  std::uniform_int_distribution<int> hdop(6, 40);     // 0.1
+  // start near Krakow, south and west variants exercise the signs
+  int64_t lat_e4 = (50 * 60 + 3) * 10000LL + 8790, lon_e4 = (19 * 60 + 56) * 10000LL + 7294;
+  unsigned sentence = 0;
+  auto add = [&](const std::string& text, const Expected& e) {
+    if (++sentence % 997 == 0) {
+      // one character changed, checksum no longer matches
+      std::string bad = text;
+      bad[bad.size() / 2] = bad[bad.size() / 2] == '1' ? '2' : '1';
+      log.bytes += bad;
+      log.damaged++;
+      return;
+    }
+    log.bytes += text;
+    if (e.type != GNSS_NONE) log.sentences.push_back(e);
+  };
+
+  for (unsigned s = 0; s < seconds; s++) {
+    lat_e4 += step(rng);
+    lon_e4 += step(rng);
+    bool south = (s / 1000) % 4 == 2, west = (s / 1000) % 4 == 3;
+    uint32_t lat_deg = static_cast<uint32_t>(lat_e4 / 600000), lat_min = static_cast<uint32_t>(lat_e4 % 600000);
+    uint32_t lon_deg = static_cast<uint32_t>(lon_e4 / 600000), lon_min = static_cast<uint32_t>(lon_e4 % 600000);
+    int32_t lat = e6_from_minutes(lat_deg, lat_min), lon = e6_from_minutes(lon_deg, lon_min);
+    if (south) lat = -lat;
+    if (west) lon = -lon;
+    unsigned t = s % 86400, day = 1 + (s / 86400) % 28;
+    uint32_t hhmmss = (t / 3600) * 10000 + (t / 60 % 60) * 100 + t % 60;
+    uint32_t date = 20240300UL + day;
+    int kn = knots(rng), used = sats(rng), dop = hdop(rng);
+    bool valid = s % 50 != 7;      // now and then the receiver loses the fix
+    char body[160];
+
+    Expected gga;
+    gga.type = GNSS_GGA;
+    gga.fix.hdop = static_cast<uint8_t>(dop);
+    gga.fix.sats = static_cast<uint8_t>(used);
+    std::snprintf(body, sizeof(body), "GPGGA,%06u.00,%02u%02u.%04u,%c,%03u%02u.%04u,%c,%d,%02d,%d.%d,231.5,M,40.1,M,,",
+                  hhmmss, lat_deg, lat_min / 10000, lat_min % 10000, south ? 'S' : 'N', lon_deg, lon_min / 10000,
+                  lon_min % 10000, west ? 'W' : 'E', valid ? 1 : 0, used, dop / 10, dop % 10);
+    add(checksum(body), gga);
+    add(checksum("GPGSA,A,3,04,05,09,12,,,,,,,,,2.5,1.3,2.1"), Expected{});
+    for (int i = 1; i <= 3; i++) {
+      std::snprintf(body, sizeof(body), "GPGSV,3,%d,11,%02d,71,285,42,%02d,45,075,39,%02d,22,320,35,%02d,10,180,28", i,
+                    i * 4, i * 4 + 1, i * 4 + 2, i * 4 + 3);
+      add(checksum(body), Expected{});
+    }
+    Expected rmc;
+    rmc.type = GNSS_RMC;
+    rmc.fix.lat = lat;
+    rmc.fix.lon = lon;
+    rmc.fix.time = hhmmss;
+    rmc.fix.date = date;
+    rmc.fix.speed = static_cast<uint16_t>((static_cast<uint32_t>(kn) * 10 * 1852 / 10000 + 5) / 10);
+    rmc.fix.valid = valid;
+    std::snprintf(body, sizeof(body), "GPRMC,%06u.00,%c,%02u%02u.%04u,%c,%03u%02u.%04u,%c,%d.%02d,145.3,%02u%02u%02u,,,A",
+                  hhmmss, valid ? 'A' : 'V', lat_deg, lat_min / 10000, lat_min % 10000, south ? 'S' : 'N', lon_deg,
+                  lon_min / 10000, lon_min % 10000, west ? 'W' : 'E', kn / 100, kn % 100, day, 3u, 24u);
+    add(checksum(body), rmc);
+
+    if (s % 10 == 5) {
+      // answer to AT+CGNSINF polled meanwhile, decimal degrees and km/h
+      Expected inf;
+      inf.type = GNSS_CGNSINF;
+      inf.fix.lat = lat;
+      inf.fix.lon = lon;
+      inf.fix.date = date;
+      inf.fix.time = hhmmss;
+      inf.fix.speed = static_cast<uint16_t>(kn);      // 0.1 km/h from the same digits
+      inf.fix.hdop = static_cast<uint8_t>(dop);
+      inf.fix.sats = static_cast<uint8_t>(used);
+      inf.fix.valid = valid;
+      std::snprintf(body, sizeof(body),
+                    "\r\n+CGNSINF: 1,%d,%08u%06u.000,%s%d.%06d,%s%d.%06d,231.5,%d.%d,145.3,1,,%d.%d,1.2,0.8,,11,%d,,,39,,\r\n",
+                    valid ? 1 : 0, date, hhmmss, lat < 0 ? "-" : "", std::abs(lat) / 1000000, std::abs(lat) % 1000000,
+                    lon < 0 ? "-" : "", std::abs(lon) / 1000000, std::abs(lon) % 1000000, kn / 10, kn % 10, dop / 10,
+                    dop % 10, used);
+      log.bytes += body;
+      log.bytes += "\r\nOK\r\n";
+      log.sentences.push_back(inf);
+    }
+  }
+  return log;
+}
+
+bool same(const Expected& e, const gnss_fix_t& f) {
+  switch (e.type) {
+    case GNSS_GGA:
+      return f.hdop == e.fix.hdop && f.sats == e.fix.sats;
+    case GNSS_RMC:
+      return f.lat == e.fix.lat && f.lon == e.fix.lon && f.time == e.fix.time && f.date == e.fix.date &&
+             f.speed == e.fix.speed && f.valid == e.fix.valid;
+    default:
+      return f.lat == e.fix.lat && f.lon == e.fix.lon && f.time == e.fix.time && f.date == e.fix.date &&
+             f.speed == e.fix.speed && f.valid == e.fix.valid && f.hdop == e.fix.hdop && f.sats == e.fix.sats;
+  }
+}
+
+// every commit against the generated values, returns number of differences
+unsigned verify(const Log& log, gnss_t& g) {
+  gnss_init(&g);
+  size_t next = 0;
+  unsigned wrong = 0;
+  for (char c : log.bytes) {
+    if (!gnss_feed(&g, static_cast<uint8_t>(c))) continue;
+    if (next >= log.sentences.size() || !same(log.sentences[next], g.fix)) {
+      if (wrong++ < 5)
+        std::fprintf(stderr, "nmeabench: sentence %zu parsed as lat %ld lon %ld time %lu date %lu speed %u hdop %u sats %u valid %u\n",
+                     next, static_cast<long>(g.fix.lat), static_cast<long>(g.fix.lon),
+                     static_cast<unsigned long>(g.fix.time), static_cast<unsigned long>(g.fix.date), g.fix.speed,
+                     g.fix.hdop, g.fix.sats, g.fix.valid);
+    }
+    next++;
+  }
+  if (next != log.sentences.size()) wrong++;
+  return wrong;
+}
+
+void timed(const std::string& name, const std::string& bytes, unsigned repeats) {
+  gnss_t g;
+  double best = 1e30;
+  unsigned long taken = 0;   // counters of gnss_t are 16 bit like on the MCU
+  for (unsigned r = 0; r < repeats; r++) {
+    gnss_init(&g);
+    taken = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (char c : bytes) taken += gnss_feed(&g, static_cast<uint8_t>(c));
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (s < best) best = s;
+  }
+  std::printf("%s : %zu bytes, %lu sentences taken, best of %u : %.1f MB/s, %.2f ns/byte\n", name.c_str(),
+              bytes.size(), taken, repeats, bytes.size() / best / 1e6, best * 1e9 / bytes.size());
+  if (g.fix.valid)
+    std::printf("  last fix %08lu %06lu lat %.6f lon %.6f speed %.1f km/h hdop %.1f sats %u\n",
+                static_cast<unsigned long>(g.fix.date), static_cast<unsigned long>(g.fix.time), g.fix.lat / 1e6,
+                g.fix.lon / 1e6, g.fix.speed / 10.0, g.fix.hdop / 10.0, g.fix.sats);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned seconds = 100000, repeats = 5;
+  std::string out;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-g" && i + 1 < argc) seconds = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-r" && i + 1 < argc) repeats = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-o" && i + 1 < argc) out = argv[++i];
+    else if (!a.empty() && a[0] == '-') {
+      std::fprintf(stderr, "usage: %s [-g seconds] [-r repeats] [-o generated.nmea] [log.nmea...]\n", argv[0]);
+      return 2;
+    } else files.push_back(a);
+  }
+  if (repeats == 0) repeats = 1;
+
+  if (!files.empty()) {
+    for (const std::string& path : files) {
+      std::ifstream in(path, std::ios::binary);
+      if (!in) {
+        std::fprintf(stderr, "nmeabench: cannot open %s\n", path.c_str());
+        return 2;
+      }
+      std::stringstream data;
+      data << in.rdbuf();
+      timed(path, data.str(), repeats);
+    }
+    return 0;
+  }
+
+  Log log = generate(seconds, 1);
+  if (!out.empty()) std::ofstream(out, std::ios::binary) << log.bytes;
+  gnss_t g;
+  unsigned wrong = verify(log, g);
+  std::printf("generated %u s of receiver output : %zu sentences to take, %u damaged\n", seconds, log.sentences.size(),
+              log.damaged);
+  std::printf("verified : %u wrong, %u damaged found\n", wrong, g.errors);
+  timed("generated", log.bytes, repeats);
+  return wrong == 0 && g.errors == log.damaged ? 0 : 1;
+}
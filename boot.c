@@ -0,0 +1,219 @@
+/* ---------------------------------------------------------------------------
+ * bootloader of the tracker with firmware update over GPRS (FEATURE_OTA,
+ * ATMEGA328P) - layout, delta format and EEPROM record in ota.h
+ *
+ * at every reset : an update set pending by the application is checked (MAC
+ * of the staging area with OTA_KEY, CRC-32 of the application it was made
+ * for) and written page by page, an update cut short by a power loss is
+ * finished, then the application starts at address 0. It also gives the
+ * application the SPM service for the staging area, the application cannot
+ * write flash itself.
+ *
+ * no startup code (-nostartfiles) : SP is RAMEND after reset, r1 and SREG
+ * are cleared here, there are no variables outside the stack
+ * build : make boot.hex, flashed with the application by make flash-ota-main
+ * in the native build (sim/) it is linked with the firmware, flash and page
+ * buffer are emulated by sim/hal_host.cpp
+ * ---------------------------------------------------------------------------
+ */
+#if defined(__AVR_ATmega328P__)
+
+#include <inttypes.h>
+#include <avr/boot.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+
+#ifdef HOST_BUILD
+#include "hal.h"
+#endif
+
+#include "ota.h"
+
+#ifndef OTA_KEY
+#error "no OTA_KEY : make OTA=1 OTA_KEY=k0,k1,k2,k3 with your own key, the same as otadelta -k"
+#endif
+const uint32_t OTAKEY[4] PROGMEM = { OTA_KEY };
+
+#ifndef HOST_BUILD
+void boot_reset(void) __attribute__((naked, used, noreturn));
+
+// reset entry at OTA_BOOT (BOOTRST) and the SPM service right after it, both one word
+__asm__(".section .vectors,\"ax\",@progbits\n"
+        "  rjmp boot_reset\n"
+        "  rjmp boot_spm\n"
+        ".previous\n");
+#endif
+
+// one block of the MAC : XTEA of v, 32 cycles
+static void xtea(uint32_t *v)
+{
+  uint32_t v0 = v[0], v1 = v[1], sum = 0;
+  uint8_t i;
+   for (i = 0; i < 32; i++)
+      {
+        v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + pgm_read_dword(&OTAKEY[sum & 3]));
+        sum += 0x9E3779B9UL;
+        v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + pgm_read_dword(&OTAKEY[(sum >> 11) & 3]));
+      };
+   v[0] = v0;
+   v[1] = v1;
+}
+
+// CBC-MAC of the header without its MAC and the delta, 1 when it is the one in the header
+static uint8_t mac_ok(const ota_header_t *h)
+{
+  uint32_t v[2] = { 0, 0 };
+  uint16_t i, n = OTA_HEADER - 8 + h->size;
+  uint8_t b, *p = (uint8_t *)v;
+   for (i = 0; i < n || (i & 7); i++)
+      {
+        b = i < n ? ota_flash_byte(OTA_STAGE + i + (i < OTA_HEADER - 8 ? 0 : 8)) : 0;   // zeros pad the last block
+        p[i & 7] ^= b;
+        if ((i & 7) == 7) xtea(v);
+      };
+   for (i = 0; i < 8; i++)
+      if (p[i] != h->mac[i]) return 0;
+   return 1;
+}
+
+// CRC-32 of the application area
+static uint32_t app_crc(void)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  uint16_t a;
+   for (a = 0; a < OTA_STAGE; a++) crc = ota_crc32(crc, ota_flash_byte(a));
+   return ~crc;
+}
+
+// erase and write one page of 'buf'
+static void flash_page(uint16_t address, const uint8_t *buf)
+{
+  uint8_t i;
+   boot_page_erase(address);
+   boot_spm_busy_wait();
+   for (i = 0; i < OTA_PAGE; i += 2) boot_page_fill(address + i, buf[i] | (buf[i + 1] << 8));
+   boot_page_write(address);
+   boot_spm_busy_wait();
+   boot_rww_enable();
+}
+
+// tokens of page 'r->page' to 'buf', the flash read as it is now - 'r' goes on to the next page
+static void make_page(uint8_t *buf, ota_resume_t *r)
+{
+  uint16_t dst = (uint16_t)r->page * OTA_PAGE, src, stream = OTA_STAGE + OTA_HEADER;
+  uint8_t i = 0, t, n;
+   while (i < OTA_PAGE)
+      {
+        t = ota_flash_byte(stream + r->offset++);
+        n = (t & 0x3F) + 1;
+        if (t < 0x80)
+          { for (n = t + 1; n > 0 && i < OTA_PAGE; n--) buf[i++] = ota_flash_byte(stream + r->offset++);
+            continue;
+          };
+        if (t >= 0xC0)
+          { src = ota_flash_byte(stream + r->offset) | (ota_flash_byte(stream + r->offset + 1) << 8);
+            r->offset += 2;
+            r->shift = src - (dst + i);
+          };
+        src = dst + i + r->shift;
+        for (; n > 0 && i < OTA_PAGE; n--) buf[i++] = ota_flash_byte(src++);
+      };
+}
+
+static void finish(uint8_t result)
+{
+   eeprom_update_byte(&OTA_EEPROM->result, result);
+   eeprom_update_byte(&OTA_EEPROM->state, OTA_IDLE);
+}
+
+// -------------------------------------------------------------------------------
+// pending or unfinished update : every page is made in RAM, copied to the journal page,
+// then erased and written - 'state' selects the record valid after a power loss :
+// OTA_APPLY 'apply' (the page is still old, make it again), OTA_RESTORE 'journal'
+// (the page may be erased, write it from the journal)
+// -------------------------------------------------------------------------------
+void boot_update(void) __attribute__((noinline));
+void boot_update(void)
+{
+  ota_header_t h;
+  ota_resume_t r;
+  uint8_t buf[OTA_PAGE], state = eeprom_read_byte(&OTA_EEPROM->state), i, end;
+
+   if (state != OTA_PENDING && state != OTA_APPLY && state != OTA_RESTORE) return;
+   for (i = 0; i < OTA_HEADER; i++) ((uint8_t *)&h)[i] = ota_flash_byte(OTA_STAGE + i);
+   if (state == OTA_PENDING)
+      {
+        if (!mac_ok(&h))
+          { finish(OTA_EMAC);
+            return;
+          };
+        if (app_crc() != h.oldcrc)
+          { finish(OTA_EBASE);
+            return;
+          };
+        r.page = h.descending ? h.last : h.first;
+        r.offset = 0;
+        r.shift = 0;
+        eeprom_update_block(&r, &OTA_EEPROM->apply, sizeof(r));
+        eeprom_update_byte(&OTA_EEPROM->state, state = OTA_APPLY);
+      };
+   end = h.descending ? h.first : h.last;
+   for (;;)
+      {
+        if (state == OTA_RESTORE)
+          { eeprom_read_block(&r, &OTA_EEPROM->journal, sizeof(r));
+            for (i = 0; i < OTA_PAGE; i++) buf[i] = ota_flash_byte(OTA_JOURNAL + i);
+          }
+        else
+          { eeprom_read_block(&r, &OTA_EEPROM->apply, sizeof(r));
+            make_page(buf, &r);
+            flash_page(OTA_JOURNAL, buf);
+            eeprom_update_block(&r, &OTA_EEPROM->journal, sizeof(r));
+            eeprom_update_byte(&OTA_EEPROM->state, state = OTA_RESTORE);
+          };
+        flash_page((uint16_t)r.page * OTA_PAGE, buf);
+        if (r.page == end) break;
+        r.page += h.descending ? -1 : 1;
+        eeprom_update_block(&r, &OTA_EEPROM->apply, sizeof(r));
+        eeprom_update_byte(&OTA_EEPROM->state, state = OTA_APPLY);
+      };
+   finish(app_crc() == h.newcrc ? OTA_OK : OTA_EAPPLY);
+}
+
+// -------------------------------------------------------------------------------
+// SPM service of the application : page buffer fill, erase and write of a staging page,
+// interrupts are off while the application section cannot be read
+// -------------------------------------------------------------------------------
+void boot_spm(uint16_t address, uint8_t command, uint16_t data)
+{
+  uint8_t sreg = SREG;
+   if (command != OTA_SPM_FILL && (address < OTA_STAGE || address >= OTA_JOURNAL)) return;
+   cli();
+   if (command == OTA_SPM_FILL) boot_page_fill(address, data);
+   else
+      {
+        if (command == OTA_SPM_ERASE) boot_page_erase(address);
+        else boot_page_write(address);
+        boot_spm_busy_wait();
+        boot_rww_enable();
+      };
+   SREG = sreg;
+}
+
+#ifndef HOST_BUILD
+void boot_reset(void)
+{
+   __asm__ volatile ("clr __zero_reg__");
+   SREG = 0;
+   MCUSR = 0;                 // watchdog reset of the application leaves the watchdog on
+   wdt_disable();
+   boot_update();
+   ((void (*)(void))0)();
+   for (;;) ;
+}
+#endif
+
+#endif
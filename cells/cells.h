@@ -0,0 +1,16 @@
+// offline cell tower database for cellfix(), generated by tools/celldb
+// from cells/cells.csv - build it for your region and run the compile script again
+// 5 cells in 2 networks, 76 bytes of flash
+
+const celldb_network_t CELLDB_NETWORK[] PROGMEM = {
+  { 1, 1, 0, 4 },
+  { 1, 2, 4, 5 }
+};
+
+const celldb_cell_t CELLDB_CELL[] PROGMEM = {
+  { 0x0B54, 0x1CF4, 50064651, 19945490 },
+  { 0x0B54, 0x1CF5, 50061470, 19938120 },
+  { 0x0B54, 0x1CFC, 50071930, 19956210 },
+  { 0x0B55, 0x0CE5, 50048560, 19912830 },
+  { 0x01FE, 0x0058, 50057320, 19960040 }
+};
@@ -1,9 +1,9 @@
+rem version main of tracker.c (ATMEGA328P POWERDOWN), build target of Makefile
+rem usage : compileatmega.bat <PIN of SMS commands>
+rem strings\main.h is generated from strings\main.txt by tools\atstrings, after editing the txt run
+rem   g++ -O2 -o atstrings.exe tools\atstrings.cpp && atstrings strings\main.txt strings\main.h
 del main.elf
-del main.o
 del main.hex
-avr-gcc -mmcu=atmega328p -std=gnu99 -Wall -Os -o main.elf main.c -w
-avr-objcopy -j .text -j .data -O ihex main.elf main.hex
-avr-size --mcu=atmega328p --format=avr main.elf
-# fuse = 62 for internal 8Meg with div 8 = 1MHz
+make main SMS_PIN=%1
+rem fuse = 62 for internal 8Meg with div 8 = 1MHz
 avrdude -c usbasp -p m328p -U lfuse:w:0x62:m  -U flash:w:"main.hex":a
-
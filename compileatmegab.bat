@@ -1,9 +1,9 @@
+rem version mainb of tracker.c (ATMEGA328P polled), build target of Makefile
+rem usage : compileatmegab.bat <PIN of SMS commands>
+rem strings\mainb.h is generated from strings\mainb.txt by tools\atstrings, after editing the txt run
+rem   g++ -O2 -o atstrings.exe tools\atstrings.cpp && atstrings strings\mainb.txt strings\mainb.h
 del mainb.elf
-del mainb.o
 del mainb.hex
-avr-gcc -mmcu=atmega328p -std=gnu99 -Wall -Os -o mainb.elf mainb.c -w
-avr-objcopy -j .text -j .data -O ihex mainb.elf mainb.hex
-avr-size --mcu=atmega328p --format=avr mainb.elf
-# fuse = 62 for internal 8Meg with div 8 = 1MHz
+make mainb SMS_PIN=%1
+rem fuse = 62 for internal 8Meg with div 8 = 1MHz
 avrdude -c usbasp -p m328p -U lfuse:w:0x62:m  -U flash:w:"mainb.hex":a
-
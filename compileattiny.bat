@@ -1,8 +1,7 @@
+rem version main3 of tracker.c (ATTINY2313 POWERDOWN), build target of Makefile
+rem strings\main3.h is generated from strings\main3.txt by tools\atstrings, after editing the txt run
+rem   g++ -O2 -o atstrings.exe tools\atstrings.cpp && atstrings -p strings\main3.txt strings\main3.h
 del main3.elf
-del main3.o
 del main3.hex
-avr-gcc -mmcu=attiny2313 -std=gnu99 -Wall -Os -o main3.elf main3.c -w
-avr-objcopy -j .text -j .data -O ihex main3.elf main3.hex
-avr-size --mcu=attiny2313 --format=avr main3.elf
+make main3
 avrdude -c usbasp -p t2313 -U lfuse:w:0x64:m  -U flash:w:"main3.hex":a
-
@@ -1,8 +1,7 @@
+rem version main3b of tracker.c (ATTINY2313 polled), build target of Makefile
+rem strings\main3b.h is generated from strings\main3b.txt by tools\atstrings, after editing the txt run
+rem   g++ -O2 -o atstrings.exe tools\atstrings.cpp && atstrings -p strings\main3b.txt strings\main3b.h
 del main3b.elf
-del main3b.o
 del main3b.hex
-avr-gcc -mmcu=attiny2313 -std=gnu99 -Wall -Os -o main3b.elf main3b.c -w
-avr-objcopy -j .text -j .data -O ihex main3b.elf main3b.hex
-avr-size --mcu=attiny2313 --format=avr main3b.elf
+make main3b
 avrdude -c usbasp -p t2313 -U lfuse:w:0x64:m  -U flash:w:"main3b.hex":a
-
@@ -0,0 +1,235 @@
+// ---------------------------------------------------------------------------
+// cell tower index and position solver, see geoindex.h
+// ---------------------------------------------------------------------------
+#include "geoindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace geo {
+
+namespace {
+
+constexpr double kEarthRadius = 6371000.0;   // meters
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kMinDistance = 50.0;        // meters, no cell is closer than that
+constexpr double kDefaultRange = 3000.0;     // cell without range in the CSV
+
+// log distance path loss : RX level at 100 m from the mast and exponent of urban area
+constexpr double kRefDbm = -55.0;
+constexpr double kRefDistance = 100.0;
+constexpr double kPathLossExponent = 3.0;
+
+uint64_t mix(uint64_t k) {
+  // finalizer of MurmurHash3, keys differ mostly in low bits of CI
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+double distance_from_rxl(int rxl, double range) {
+  if (rxl < 0) return range / 2;
+  double dbm = rxl - 110.0;
+  double d = kRefDistance * std::pow(10.0, (kRefDbm - dbm) / (10.0 * kPathLossExponent));
+  return std::max(kMinDistance, std::min(d, range));
+}
+
+struct Point {
+  double x = 0, y = 0;   // meters east and north of the reference cell
+  double d = 0;          // estimated distance to the phone
+  double w = 0;          // weight
+};
+
+}  // namespace
+
+bool CellIndex::load_csv(const std::string& path, std::string& error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = path + ": cannot open";
+    return false;
+  }
+  std::string line;
+  long lineno = 0;
+  while (std::getline(in, line)) {
+    lineno++;
+    if (line.empty() || line.compare(0, 5, "radio") == 0) continue;
+    std::vector<std::string> v;
+    std::string field;
+    std::istringstream fields(line);
+    while (std::getline(fields, field, ',')) v.push_back(field);
+    if (v.size() < 8) {
+      error = path + ":" + std::to_string(lineno) + ": bad line";
+      return false;
+    }
+    Cell c;
+    c.key = cell_key(std::strtoul(v[1].c_str(), nullptr, 10), std::strtoul(v[2].c_str(), nullptr, 10),
+                     std::strtoul(v[3].c_str(), nullptr, 10), std::strtoul(v[4].c_str(), nullptr, 10));
+    c.lon = std::strtod(v[6].c_str(), nullptr);
+    c.lat = std::strtod(v[7].c_str(), nullptr);
+    c.range = v.size() > 8 ? std::strtof(v[8].c_str(), nullptr) : 0;
+    if (c.range <= 0) c.range = kDefaultRange;
+    cells_.push_back(c);
+  }
+  return true;
+}
+
+void CellIndex::load_synthetic(size_t n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> jitter(-0.002, 0.002);
+  size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n))));
+  for (size_t i = 0; i < n; i++) {
+    Cell c;
+    unsigned mnc = 1 + static_cast<unsigned>(i % 3);
+    c.key = cell_key(260, mnc, 1000 + static_cast<unsigned>(i / 60000), static_cast<unsigned>(i % 60000));
+    // about 700 m between masts
+    c.lat = 49.5 + static_cast<double>(i / side) * 0.0063 + jitter(rng);
+    c.lon = 19.0 + static_cast<double>(i % side) * 0.0098 + jitter(rng);
+    c.range = 1500;
+    cells_.push_back(c);
+  }
+}
+
+void CellIndex::build() {
+  // the same cell twice (joined exports) - the last one wins
+  std::stable_sort(cells_.begin(), cells_.end(), [](const Cell& a, const Cell& b) { return a.key < b.key; });
+  std::vector<Cell> unique;
+  for (const Cell& c : cells_) {
+    if (!unique.empty() && unique.back().key == c.key) unique.back() = c;
+    else unique.push_back(c);
+  }
+  cells_.swap(unique);
+
+  size_t size = 16;
+  while (size < cells_.size() * 2) size <<= 1;   // load factor at most 0.5
+  slots_.assign(size, 0);
+  mask_ = size - 1;
+  for (size_t i = 0; i < cells_.size(); i++) {
+    uint64_t s = mix(cells_[i].key) & mask_;
+    while (slots_[s] != 0) s = (s + 1) & mask_;
+    slots_[s] = static_cast<uint32_t>(i + 1);
+  }
+}
+
+const Cell* CellIndex::find(CellKey key) const {
+  if (slots_.empty()) return nullptr;
+  for (uint64_t s = mix(key) & mask_;; s = (s + 1) & mask_) {
+    uint32_t i = slots_[s];
+    if (i == 0) return nullptr;
+    if (cells_[i - 1].key == key) return &cells_[i - 1];
+  }
+}
+
+Fix locate(const CellIndex& index, const std::vector<Observation>& seen) {
+  Fix fix;
+  std::vector<const Cell*> cells;
+  std::vector<int> rxl;
+  for (const Observation& o : seen) {
+    const Cell* c = index.find(o.key);
+    if (c == nullptr || std::find(cells.begin(), cells.end(), c) != cells.end()) continue;
+    cells.push_back(c);
+    rxl.push_back(o.rxl);
+  }
+  if (cells.empty()) return fix;
+  fix.found = true;
+  fix.cells = static_cast<int>(cells.size());
+
+  // local plane around the first cell, good enough for the few km between neighbours
+  const double lat0 = cells[0]->lat, lon0 = cells[0]->lon;
+  const double mx = kPi / 180.0 * kEarthRadius * std::cos(lat0 * kPi / 180.0);
+  const double my = kPi / 180.0 * kEarthRadius;
+  std::vector<Point> p(cells.size());
+  double sw = 0, cx = 0, cy = 0, maxrange = 0;
+  for (size_t i = 0; i < cells.size(); i++) {
+    p[i].x = (cells[i]->lon - lon0) * mx;
+    p[i].y = (cells[i]->lat - lat0) * my;
+    p[i].d = distance_from_rxl(rxl[i], cells[i]->range);
+    p[i].w = 1.0 / (p[i].d * p[i].d);   // near cells tell more
+    sw += p[i].w;
+    cx += p[i].w * p[i].x;
+    cy += p[i].w * p[i].y;
+    maxrange = std::max(maxrange, static_cast<double>(cells[i]->range));
+  }
+  cx /= sw;
+  cy /= sw;
+
+  double x = cx, y = cy;
+  if (cells.size() >= 3) {
+    // Gauss-Newton on sum w * (|pos - p| - d)^2 from the weighted centroid
+    for (int iter = 0; iter < 20; iter++) {
+      double a11 = 0, a12 = 0, a22 = 0, b1 = 0, b2 = 0;
+      for (const Point& q : p) {
+        double dx = x - q.x, dy = y - q.y;
+        double r = std::max(1.0, std::sqrt(dx * dx + dy * dy));
+        double jx = dx / r, jy = dy / r, res = r - q.d;
+        a11 += q.w * jx * jx;
+        a12 += q.w * jx * jy;
+        a22 += q.w * jy * jy;
+        b1 += q.w * jx * res;
+        b2 += q.w * jy * res;
+      }
+      double det = a11 * a22 - a12 * a12;
+      if (std::fabs(det) < 1e-18) break;   // cells on a line, keep what we have
+      double sx = (a22 * b1 - a12 * b2) / det, sy = (a11 * b2 - a12 * b1) / det;
+      x -= sx;
+      y -= sy;
+      if (sx * sx + sy * sy < 0.01) break;
+    }
+    // a solution far from every cell is a bad guess of the distances
+    if (!std::isfinite(x) || !std::isfinite(y) || std::hypot(x - cx, y - cy) > maxrange) {
+      x = cx;
+      y = cy;
+    }
+  }
+
+  double err = 0;
+  for (const Point& q : p) {
+    double res = std::hypot(x - q.x, y - q.y) - q.d;
+    err += q.w * res * res;
+  }
+  fix.accuracy = cells.size() == 1 ? cells[0]->range : std::max(kMinDistance, std::sqrt(err / sw));
+  fix.lat = lat0 + y / my;
+  fix.lon = lon0 + x / mx;
+  return fix;
+}
+
+bool parse_cells(const char* query, size_t len, std::vector<Observation>& seen) {
+  seen.clear();
+  const char* end = query + len;
+  const char* p = query;
+  // find c= parameter
+  while (p < end) {
+    if (end - p >= 2 && p[0] == 'c' && p[1] == '=' && (p == query || p[-1] == '&' || p[-1] == '?')) break;
+    p++;
+  }
+  if (p >= end) return false;
+  p += 2;
+  while (p < end && *p != '&' && *p != ' ') {
+    unsigned long f[5] = {0, 0, 0, 0, 0};
+    int n = 0;
+    while (n < 5) {
+      char* next = nullptr;
+      f[n++] = std::strtoul(p, &next, 10);
+      if (next == p) return false;
+      p = next;
+      if (p >= end || *p != ',') break;
+      p++;
+    }
+    if (n < 4) return false;
+    Observation o;
+    o.key = cell_key(static_cast<unsigned>(f[0]), static_cast<unsigned>(f[1]), static_cast<unsigned>(f[2]),
+                     static_cast<unsigned>(f[3]));
+    o.rxl = n == 5 ? static_cast<int>(std::min(63UL, f[4])) : -1;
+    seen.push_back(o);
+    if (p < end && *p == ';') p++;
+  }
+  return !seen.empty();
+}
+
+}  // namespace geo
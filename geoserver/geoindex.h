@@ -0,0 +1,69 @@
+// ---------------------------------------------------------------------------
+// cell tower index and position solver of the geolocation server
+//   CellIndex  read only open addressing hash table MCC/MNC/LAC/CI -> cell,
+//              built once at startup, shared by all worker threads without locks
+//   locate()   position from serving and neighbour cells of AT+CENG :
+//              1 known cell - its position, 2 - centroid weighted by signal,
+//              3 and more - weighted least squares multilateration of the
+//              distances estimated from RX level (log distance path loss)
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace geo {
+
+// MCC 10 bits, MNC 10 bits, LAC 16 bits, CI 28 bits (UMTS cell ids are longer than GSM)
+using CellKey = uint64_t;
+
+inline CellKey cell_key(unsigned mcc, unsigned mnc, unsigned lac, unsigned ci) {
+  return (static_cast<uint64_t>(mcc & 0x3FF) << 54) | (static_cast<uint64_t>(mnc & 0x3FF) << 44) |
+         (static_cast<uint64_t>(lac & 0xFFFF) << 28) | (ci & 0xFFFFFFF);
+}
+
+struct Cell {
+  CellKey key = 0;
+  double lat = 0, lon = 0;   // degrees
+  float range = 0;           // meters, coverage radius of the CSV
+};
+
+class CellIndex {
+ public:
+  // OpenCellID style CSV radio,mcc,net,area,cell,unit,lon,lat,range,samples,... all radio types
+  bool load_csv(const std::string& path, std::string& error);
+  // n cells on a grid around Krakow, the same for the same seed - for benchmarks without a CSV
+  void load_synthetic(size_t n, uint32_t seed);
+  void build();   // after load, before find
+
+  const Cell* find(CellKey key) const;
+  size_t size() const { return cells_.size(); }
+  const std::vector<Cell>& cells() const { return cells_; }
+
+ private:
+  std::vector<Cell> cells_;
+  std::vector<uint32_t> slots_;   // index + 1 into cells_, 0 = empty, size power of 2
+  uint64_t mask_ = 0;
+};
+
+// one cell seen by the modem, rxl 0..63 of AT+CENG is -110..-47 dBm, -1 = not known
+struct Observation {
+  CellKey key = 0;
+  int rxl = -1;
+};
+
+struct Fix {
+  bool found = false;
+  double lat = 0, lon = 0;
+  double accuracy = 0;   // meters
+  int cells = 0;         // known cells used
+};
+
+Fix locate(const CellIndex& index, const std::vector<Observation>& seen);
+
+// c=260,1,2900,7412,40;260,1,2900,7413,22 - mcc,mnc,lac,ci[,rxl] per cell, decimal
+bool parse_cells(const char* query, size_t len, std::vector<Observation>& seen);
+
+}  // namespace geo
@@ -0,0 +1,294 @@
+// ---------------------------------------------------------------------------
+// self hosted cell geolocation server for the tracker, stand-in for CIPGSMLOC
+//   geoserver [-p port] [-t threads] [-s synthetic_cells] cells.csv...
+//   GET /loc?c=mcc,mnc,lac,ci,rxl;mcc,mnc,lac,ci,rxl...
+//     200  0,<longtitude>,<latitude>,<yyyy/mm/dd>,<hh:mm:ss>   like +CIPGSMLOC: so
+//          readcellgps() of the firmware reads it unchanged, header X-Accuracy
+//          gives estimated error in meters and X-Cells number of known cells
+//     404  none of the cells is in the database
+//   GET /stats   requests served, located and not found
+// one worker thread per core, each with its own SO_REUSEPORT listening
+// socket and epoll loop, so the kernel spreads connections over the cores
+// and no lock is taken : the cell index is read only after startup
+// HTTP/1.1 keep-alive and pipelined requests, GET only
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "geoindex.h"
+
+namespace {
+
+constexpr size_t kMaxRequest = 8192;   // bytes of headers, longer request is answered 431 and closed
+constexpr int kMaxEvents = 256;
+
+struct Counters {
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> located{0};
+  std::atomic<uint64_t> unknown{0};
+  std::atomic<uint64_t> bad{0};
+};
+
+Counters counters;
+geo::CellIndex cell_index;
+
+struct Connection {
+  std::string in;
+  std::string out;
+  size_t sent = 0;
+  bool close_after = false;
+};
+
+int listen_socket(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 1024) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void respond(Connection& c, int status, const char* reason, const std::string& body, const std::string& headers,
+             bool keep_alive) {
+  char head[256];
+  std::snprintf(head, sizeof(head),
+                "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n%s%s\r\n", status, reason,
+                body.size(), headers.c_str(), keep_alive ? "" : "Connection: close\r\n");
+  c.out += head;
+  c.out += body;
+  if (!keep_alive) c.close_after = true;
+}
+
+std::string utc_now() {
+  time_t t = time(nullptr);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  char text[32];
+  std::strftime(text, sizeof(text), "%Y/%m/%d,%H:%M:%S", &tm);
+  return text;
+}
+
+// one complete request 'req' of 'len' bytes (request line and headers)
+void handle_request(Connection& c, const char* req, size_t len, std::vector<geo::Observation>& seen) {
+  counters.requests.fetch_add(1, std::memory_order_relaxed);
+  const char* line_end = static_cast<const char*>(memchr(req, '\r', len));
+  if (line_end == nullptr) line_end = req + len;
+  std::string line(req, line_end);
+  // HTTP/1.0 closes unless asked, HTTP/1.1 keeps the connection unless asked
+  std::string headers(line_end, req + len);
+  for (char& ch : headers) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+  bool keep_alive = line.find("HTTP/1.1") != std::string::npos ? headers.find("connection: close") == std::string::npos
+                                                               : headers.find("connection: keep-alive") != std::string::npos;
+  if (line.compare(0, 4, "GET ") != 0) {
+    counters.bad.fetch_add(1, std::memory_order_relaxed);
+    respond(c, 405, "Method Not Allowed", "405\r\n", "", false);
+    return;
+  }
+  if (line.compare(4, 5, "/loc?") == 0) {
+    if (!geo::parse_cells(line.c_str() + 9, line.size() - 9, seen)) {
+      counters.bad.fetch_add(1, std::memory_order_relaxed);
+      respond(c, 400, "Bad Request", "400\r\n", "", keep_alive);
+      return;
+    }
+    geo::Fix fix = geo::locate(cell_index, seen);
+    if (!fix.found) {
+      counters.unknown.fetch_add(1, std::memory_order_relaxed);
+      respond(c, 404, "Not Found", "404\r\n", "", keep_alive);
+      return;
+    }
+    counters.located.fetch_add(1, std::memory_order_relaxed);
+    char body[96], extra[64];
+    std::snprintf(body, sizeof(body), "0,%.6f,%.6f,%s\r\n", fix.lon, fix.lat, utc_now().c_str());
+    std::snprintf(extra, sizeof(extra), "X-Accuracy: %.0f\r\nX-Cells: %d\r\n", fix.accuracy, fix.cells);
+    respond(c, 200, "OK", body, extra, keep_alive);
+    return;
+  }
+  if (line.compare(4, 7, "/stats ") == 0) {
+    char body[160];
+    std::snprintf(body, sizeof(body), "cells=%zu requests=%llu located=%llu unknown=%llu bad=%llu\r\n",
+                  cell_index.size(), static_cast<unsigned long long>(counters.requests.load()),
+                  static_cast<unsigned long long>(counters.located.load()),
+                  static_cast<unsigned long long>(counters.unknown.load()),
+                  static_cast<unsigned long long>(counters.bad.load()));
+    respond(c, 200, "OK", body, "", keep_alive);
+    return;
+  }
+  counters.bad.fetch_add(1, std::memory_order_relaxed);
+  respond(c, 404, "Not Found", "404\r\n", "", keep_alive);
+}
+
+// false when the connection is to be closed
+bool on_readable(int fd, Connection& c, std::vector<geo::Observation>& seen) {
+  char buf[16384];
+  bool eof = false;
+  for (;;) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      c.in.append(buf, static_cast<size_t>(n));
+      continue;
+    }
+    if (n == 0) {
+      eof = true;   // requests sent before closing are still answered
+      break;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+    if (errno == EINTR) continue;
+    return false;
+  }
+  size_t start = 0;
+  for (;;) {
+    size_t end = c.in.find("\r\n\r\n", start);
+    if (end == std::string::npos) break;
+    handle_request(c, c.in.data() + start, end - start, seen);
+    start = end + 4;
+    if (c.close_after) break;
+  }
+  c.in.erase(0, start);
+  if (c.in.size() > kMaxRequest) {
+    respond(c, 431, "Request Header Fields Too Large", "431\r\n", "", false);
+    c.in.clear();
+  }
+  return !eof;
+}
+
+// false when the connection is to be closed
+bool flush(int fd, Connection& c) {
+  while (c.sent < c.out.size()) {
+    ssize_t n = write(fd, c.out.data() + c.sent, c.out.size() - c.sent);
+    if (n > 0) {
+      c.sent += static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    return false;
+  }
+  c.out.clear();
+  c.sent = 0;
+  return !c.close_after;
+}
+
+void worker(int port, std::atomic<bool>* failed) {
+  int lfd = listen_socket(port);
+  if (lfd < 0) {
+    std::fprintf(stderr, "geoserver: cannot listen on port %d: %s\n", port, std::strerror(errno));
+    failed->store(true);
+    return;
+  }
+  int ep = epoll_create1(0);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = lfd;
+  epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+  std::unordered_map<int, Connection> conns;
+  std::vector<geo::Observation> seen;
+  epoll_event events[kMaxEvents];
+
+  auto drop = [&](int fd) {
+    epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns.erase(fd);
+  };
+
+  for (;;) {
+    int n = epoll_wait(ep, events, kMaxEvents, -1);
+    if (n < 0 && errno == EINTR) continue;
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == lfd) {
+        for (;;) {
+          int cfd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK);
+          if (cfd < 0) break;
+          int one = 1;
+          setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          epoll_event cev{};
+          cev.events = EPOLLIN | EPOLLRDHUP;
+          cev.data.fd = cfd;
+          epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &cev);
+          conns[cfd];
+        }
+        continue;
+      }
+      auto it = conns.find(fd);
+      if (it == conns.end()) continue;
+      Connection& c = it->second;
+      bool alive = true;
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) alive = false;
+      if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP))) alive = on_readable(fd, c, seen);
+      // answers of the requests read so far, the peer may have closed its side after sending
+      if (!c.out.empty()) alive = flush(fd, c) && alive;
+      if (!alive) {
+        drop(fd);
+        continue;
+      }
+      epoll_event cev{};
+      cev.events = EPOLLIN | EPOLLRDHUP | (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+      cev.data.fd = fd;
+      epoll_ctl(ep, EPOLL_CTL_MOD, fd, &cev);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int port = 8080;
+  unsigned threads = std::thread::hardware_concurrency();
+  size_t synthetic = 0;
+  std::vector<std::string> csv;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-p" && i + 1 < argc) port = std::atoi(argv[++i]);
+    else if (a == "-t" && i + 1 < argc) threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-s" && i + 1 < argc) synthetic = std::strtoul(argv[++i], nullptr, 10);
+    else csv.push_back(a);
+  }
+  if ((csv.empty() && synthetic == 0) || threads == 0) {
+    std::fprintf(stderr, "usage: %s [-p port] [-t threads] [-s synthetic_cells] cells.csv...\n", argv[0]);
+    return 2;
+  }
+  for (const std::string& path : csv) {
+    std::string error;
+    if (!cell_index.load_csv(path, error)) {
+      std::fprintf(stderr, "geoserver: %s\n", error.c_str());
+      return 2;
+    }
+  }
+  if (synthetic > 0) cell_index.load_synthetic(synthetic, 1);
+  cell_index.build();
+  signal(SIGPIPE, SIG_IGN);
+
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) workers.emplace_back(worker, port, &failed);
+  std::printf("geoserver: %zu cells, port %d, %u threads\n", cell_index.size(), port, threads);
+  std::fflush(stdout);
+  for (std::thread& w : workers) w.join();
+  return failed.load() ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+// ---------------------------------------------------------------------------
+// load generator of the geolocation server
+//   loadgen [-a address] [-p port] [-t threads] [-c connections] [-d seconds]
+//           [-n neighbours] [-s synthetic_cells] [cells.csv...]
+// loads the same cells as the server (same CSV or the same -s synthetic cells)
+// and sends GET /loc requests on -c keep-alive connections per thread, one
+// request in flight per connection : serving cell and -n neighbour cells with
+// random RX level, every 10th request one cell alone whose answer must be
+// the position of the cell, every 20th a cell that is not in the database
+// and must be answered 404. Prints requests per second and latency
+// percentiles, exits with 1 on errors or wrong answers.
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geoindex.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string address = "127.0.0.1";
+  int port = 8080;
+  unsigned threads = 4;
+  unsigned connections = 16;   // per thread
+  double seconds = 5;
+  unsigned neighbours = 3;
+};
+
+struct Result {
+  uint64_t requests = 0;
+  uint64_t errors = 0;
+  uint64_t wrong = 0;
+  std::vector<uint32_t> latency_us;
+};
+
+struct Connection {
+  int fd = -1;
+  std::string in;
+  Clock::time_point sent;
+  int expect = 0;             // 0 any position, 1 position of 'cell', 2 not found
+  const geo::Cell* cell = nullptr;
+};
+
+geo::CellIndex cell_index;
+Options opt;
+
+int connect_to(const Options& o) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(o.port));
+  if (inet_pton(AF_INET, o.address.c_str(), &addr.sin_addr) != 1 ||
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+void append_cell(std::string& q, geo::CellKey key, int rxl) {
+  char text[64];
+  std::snprintf(text, sizeof(text), "%s%u,%u,%u,%u,%d", q.back() == '=' ? "" : ";",
+                static_cast<unsigned>(key >> 54), static_cast<unsigned>((key >> 44) & 0x3FF),
+                static_cast<unsigned>((key >> 28) & 0xFFFF), static_cast<unsigned>(key & 0xFFFFFFF), rxl);
+  q += text;
+}
+
+bool send_request(Connection& c, std::mt19937& rng, uint64_t n) {
+  const auto& cells = cell_index.cells();
+  std::uniform_int_distribution<size_t> pick(0, cells.size() - 1);
+  std::uniform_int_distribution<int> rxl(5, 60);
+  std::string q = "GET /loc?c=";
+  size_t first = pick(rng);
+  c.cell = &cells[first];
+  if (n % 20 == 19) {
+    c.expect = 2;
+    append_cell(q, geo::cell_key(999, 99, 65535, 0xFFFFFFF), rxl(rng));
+  } else if (n % 10 == 9) {
+    c.expect = 1;
+    append_cell(q, c.cell->key, rxl(rng));
+  } else {
+    c.expect = 0;
+    // neighbours are cells near it among the next ones of the index (grid rows, CSV order)
+    append_cell(q, c.cell->key, rxl(rng));
+    unsigned added = 0;
+    for (size_t i = 1; i < 64 && added < opt.neighbours; i++) {
+      const geo::Cell& nb = cells[(first + i) % cells.size()];
+      if (std::fabs(nb.lat - c.cell->lat) > 0.03 || std::fabs(nb.lon - c.cell->lon) > 0.03) continue;
+      append_cell(q, nb.key, rxl(rng));
+      added++;
+    }
+  }
+  q += " HTTP/1.1\r\nHost: geoserver\r\n\r\n";
+  c.sent = Clock::now();
+  size_t off = 0;
+  while (off < q.size()) {
+    ssize_t w = write(c.fd, q.data() + off, q.size() - off);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return false;
+    off += static_cast<size_t>(w);
+  }
+  return true;
+}
+
+// complete response in c.in : status and body, bytes used, 0 when not complete yet
+size_t parse_response(const std::string& in, int& status, std::string& body) {
+  size_t end = in.find("\r\n\r\n");
+  if (end == std::string::npos) return 0;
+  status = std::atoi(in.c_str() + 9);
+  size_t len = 0;
+  size_t cl = in.find("Content-Length: ");
+  if (cl != std::string::npos && cl < end) len = std::strtoul(in.c_str() + cl + 16, nullptr, 10);
+  if (in.size() < end + 4 + len) return 0;
+  body = in.substr(end + 4, len);
+  return end + 4 + len;
+}
+
+bool check(const Connection& c, int status, const std::string& body) {
+  if (c.expect == 2) return status == 404;
+  if (status != 200) return false;
+  double lon = 0, lat = 0;
+  if (std::sscanf(body.c_str(), "0,%lf,%lf,", &lon, &lat) != 2) return false;
+  if (c.expect == 1) return std::fabs(lon - c.cell->lon) < 2e-6 && std::fabs(lat - c.cell->lat) < 2e-6;
+  // multilateration stays within some km of the serving cell
+  return std::fabs(lon - c.cell->lon) < 0.1 && std::fabs(lat - c.cell->lat) < 0.1;
+}
+
+void worker(unsigned id, Clock::time_point until, Result* result) {
+  std::mt19937 rng(1000 + id);
+  int ep = epoll_create1(0);
+  std::vector<Connection> conns(opt.connections);
+  uint64_t n = id;
+  for (size_t i = 0; i < conns.size(); i++) {
+    conns[i].fd = connect_to(opt);
+    if (conns[i].fd < 0) {
+      result->errors++;
+      continue;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = i;
+    epoll_ctl(ep, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    if (!send_request(conns[i], rng, n++)) result->errors++;
+  }
+  epoll_event events[64];
+  char buf[8192];
+  while (Clock::now() < until) {
+    int k = epoll_wait(ep, events, 64, 100);
+    for (int e = 0; e < k; e++) {
+      Connection& c = conns[events[e].data.u64];
+      ssize_t r = read(c.fd, buf, sizeof(buf));
+      if (r <= 0) {
+        if (r < 0 && errno == EINTR) continue;
+        result->errors++;
+        epoll_ctl(ep, EPOLL_CTL_DEL, c.fd, nullptr);
+        close(c.fd);
+        c.fd = -1;
+        continue;
+      }
+      c.in.append(buf, static_cast<size_t>(r));
+      int status = 0;
+      std::string body;
+      size_t used = parse_response(c.in, status, body);
+      if (used == 0) continue;
+      c.in.erase(0, used);
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - c.sent).count();
+      result->latency_us.push_back(static_cast<uint32_t>(us));
+      result->requests++;
+      if (!check(c, status, body)) result->wrong++;
+      if (Clock::now() < until && !send_request(c, rng, n++)) result->errors++;
+    }
+  }
+  for (Connection& c : conns)
+    if (c.fd >= 0) close(c.fd);
+  close(ep);
+}
+
+double percentile_ms(std::vector<uint32_t>& v, double p) {
+  if (v.empty()) return 0;
+  size_t i = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(v.size()))) - 1;
+  std::nth_element(v.begin(), v.begin() + static_cast<long>(i), v.end());
+  return v[i] / 1000.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t synthetic = 0;
+  std::vector<std::string> csv;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-a" && i + 1 < argc) opt.address = argv[++i];
+    else if (a == "-p" && i + 1 < argc) opt.port = std::atoi(argv[++i]);
+    else if (a == "-t" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-c" && i + 1 < argc) opt.connections = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-d" && i + 1 < argc) opt.seconds = std::atof(argv[++i]);
+    else if (a == "-n" && i + 1 < argc) opt.neighbours = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-s" && i + 1 < argc) synthetic = std::strtoul(argv[++i], nullptr, 10);
+    else csv.push_back(a);
+  }
+  if ((csv.empty() && synthetic == 0) || opt.threads == 0 || opt.connections == 0) {
+    std::fprintf(stderr,
+                 "usage: %s [-a address] [-p port] [-t threads] [-c connections] [-d seconds] [-n neighbours] "
+                 "[-s synthetic_cells] [cells.csv...]\n",
+                 argv[0]);
+    return 2;
+  }
+  for (const std::string& path : csv) {
+    std::string error;
+    if (!cell_index.load_csv(path, error)) {
+      std::fprintf(stderr, "loadgen: %s\n", error.c_str());
+      return 2;
+    }
+  }
+  if (synthetic > 0) cell_index.load_synthetic(synthetic, 1);
+  cell_index.build();
+  if (cell_index.size() == 0) {
+    std::fprintf(stderr, "loadgen: no cells\n");
+    return 2;
+  }
+
+  Clock::time_point start = Clock::now();
+  Clock::time_point until = start + std::chrono::microseconds(static_cast<long long>(opt.seconds * 1e6));
+  std::vector<Result> results(opt.threads);
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < opt.threads; t++) workers.emplace_back(worker, t, until, &results[t]);
+  for (std::thread& w : workers) w.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Result all;
+  for (Result& r : results) {
+    all.requests += r.requests;
+    all.errors += r.errors;
+    all.wrong += r.wrong;
+    all.latency_us.insert(all.latency_us.end(), r.latency_us.begin(), r.latency_us.end());
+  }
+  std::printf("%u threads x %u connections, %u neighbours, %zu cells\n", opt.threads, opt.connections,
+              opt.neighbours, cell_index.size());
+  std::printf("requests %llu in %.1f s : %.0f req/s\n", static_cast<unsigned long long>(all.requests), elapsed,
+              static_cast<double>(all.requests) / elapsed);
+  double p50 = percentile_ms(all.latency_us, 50), p99 = percentile_ms(all.latency_us, 99),
+         max = percentile_ms(all.latency_us, 100);
+  std::printf("latency [ms] p50 %.3f p99 %.3f max %.3f\n", p50, p99, max);
+  std::printf("errors %llu wrong answers %llu\n", static_cast<unsigned long long>(all.errors),
+              static_cast<unsigned long long>(all.wrong));
+  return all.errors == 0 && all.wrong == 0 && all.requests > 0 ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+/* ---------------------------------------------------------------------------
+ * streaming GNSS parser of the GPS tracker, see gnss.h
+ * compiled together with tracker.c, only FEATURE_GNSS versions call it
+ * ---------------------------------------------------------------------------
+ */
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+
+#include "gnss.h"
+
+#define S_IDLE    0     // waiting for $ or +
+#define S_PREFIX  1     // +CGNSINF: being matched
+#define S_NMEA    2     // fields of NMEA sentence
+#define S_SUM1    3     // first hex digit of checksum
+#define S_SUM2    4
+#define S_LINE    5     // fields of CGNSINF line
+
+#define NMEA_MAX  82    // $ to LF as NMEA 0183 allows
+#define LINE_MAX  120   // CGNSINF line of SIM808
+
+static const char CGNSINF[] PROGMEM = { "+CGNSINF: " };
+
+// NMEA names are the last 3 letters of field 0, talker GP GN GL is not checked
+#define NAME(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (c))
+
+void gnss_init(gnss_t *g)
+{
+  uint8_t *p = (uint8_t *)g;
+  uint8_t i;
+
+   for (i = 0; i < sizeof(gnss_t); i++) p[i] = 0;
+   g->fix.hdop = 255;
+}
+
+static void clear_field(gnss_t *g)
+{
+   g->ival = 0;
+   g->ihigh = 0;
+   g->fval = 0;
+   g->idigits = 0;
+   g->fdigits = 0;
+   g->flags = 0;
+   g->letter = 0;
+}
+
+static void start(gnss_t *g, uint8_t state)
+{
+  uint8_t *p = (uint8_t *)&g->work;
+  uint8_t i;
+
+   for (i = 0; i < sizeof(gnss_fix_t); i++) p[i] = 0;
+   g->work.hdop = 255;
+   g->state = state;
+   g->type = GNSS_NONE;
+   g->field = 0;
+   g->length = 1;
+   g->sum = 0;
+   clear_field(g);
+}
+
+static void accumulate(gnss_t *g, uint8_t c)
+{
+   if (g->state == S_NMEA && g->field == 0)
+      { // sentence name, last 3 letters are kept
+        g->ival = (g->ival << 8) | c;
+        return;
+      };
+   if (c >= '0' && c <= '9')
+      {
+        if (g->flags & GNSS_DOT)
+           {
+             if (g->fdigits < 6)
+                { g->fval = g->fval * 10 + (c - '0');
+                  g->fdigits++;
+                };
+           }
+        else
+           {
+             if (g->idigits == 8)
+                { g->ihigh = g->ival;
+                  g->ival = 0;
+                };
+             g->ival = g->ival * 10 + (c - '0');
+             g->idigits++;
+           };
+      }
+   else if (c == '.') g->flags |= GNSS_DOT;
+   else if (c == '-') g->flags |= GNSS_NEG;
+   else if (g->letter == 0) g->letter = c;
+}
+
+// ddmm.mmmmmm of NMEA to millionths of degree
+static int32_t ddmm(uint32_t i, uint32_t f)
+{
+   return (int32_t)((i / 100) * 1000000UL + ((i % 100) * 1000000UL + f + 30) / 60);
+}
+
+// field value with 'tenths' decimal places, HDOP and speed, limited to 'max'
+static uint16_t scaled(gnss_t *g, uint32_t f, uint16_t max)
+{
+  uint32_t v = g->ival * 10 + f / 100000;
+   return v > max ? max : (uint16_t)v;
+}
+
+static void store_field(gnss_t *g)
+{
+  gnss_fix_t *w = &g->work;
+  uint32_t f = g->fval, v;
+  uint8_t i, known = g->idigits | g->fdigits;
+
+   for (i = g->fdigits; i < 6; i++) f *= 10;      // fraction in millionths
+   if (g->field == 0 && g->state == S_NMEA)
+      {
+        v = g->ival & 0xFFFFFFUL;
+        g->type = v == NAME('R', 'M', 'C') ? GNSS_RMC : v == NAME('G', 'G', 'A') ? GNSS_GGA : GNSS_OTHER;
+        return;
+      };
+   switch (g->type)
+   {
+     case GNSS_RMC:
+       // $GPRMC,hhmmss.ss,A,ddmm.mmmm,N,dddmm.mmmm,E,knots,course,ddmmyy,...
+       switch (g->field)
+       {
+         case 1: w->time = g->ival; break;
+         case 2: w->valid = g->letter == 'A'; break;
+         case 3: w->lat = ddmm(g->ival, f); break;
+         case 4: if (g->letter == 'S') w->lat = -w->lat; break;
+         case 5: w->lon = ddmm(g->ival, f); break;
+         case 6: if (g->letter == 'W') w->lon = -w->lon; break;
+         case 7: // knots to 0.1 km/h
+                 v = (g->ival * 1000 + f / 1000) * 1852 / 10000 + 5;
+                 w->speed = v / 10 > 0xFFFF ? 0xFFFF : v / 10;
+                 break;
+         case 9: w->date = 20000000UL + (g->ival % 100) * 10000 + (g->ival / 100 % 100) * 100 + g->ival / 10000; break;
+       }
+       break;
+     case GNSS_GGA:
+       // $GPGGA,hhmmss.ss,ddmm.mmmm,N,dddmm.mmmm,E,quality,sats,hdop,...
+       switch (g->field)
+       {
+         case 1: w->time = g->ival; break;
+         case 2: w->lat = ddmm(g->ival, f); break;
+         case 3: if (g->letter == 'S') w->lat = -w->lat; break;
+         case 4: w->lon = ddmm(g->ival, f); break;
+         case 5: if (g->letter == 'W') w->lon = -w->lon; break;
+         case 6: w->valid = g->ival > 0; break;
+         case 7: w->sats = g->ival > 255 ? 255 : g->ival; break;
+         case 8: if (known) w->hdop = scaled(g, f, 254); break;
+       }
+       break;
+     case GNSS_CGNSINF:
+       // +CGNSINF: run,fix,yyyymmddhhmmss.sss,lat,lon,alt,km/h,course,mode,,hdop,pdop,vdop,,view,used,...
+       switch (g->field)
+       {
+         case 0: w->valid = g->ival == 1; break;
+         case 1: w->valid = w->valid && g->ival == 1; break;
+         case 2: w->date = g->ihigh; w->time = g->ival; break;
+         case 3:
+         case 4: v = g->ival * 1000000UL + f;
+                 if (g->flags & GNSS_NEG) v = -v;
+                 if (g->field == 3) w->lat = (int32_t)v; else w->lon = (int32_t)v;
+                 break;
+         case 6: w->speed = scaled(g, f, 0xFFFF); break;
+         case 10: if (known) w->hdop = scaled(g, f, 254); break;
+         case 15: w->sats = g->ival > 255 ? 255 : g->ival; break;
+       }
+       break;
+   }
+}
+
+// complete sentence with good checksum goes to 'fix', returns 1 when it was one we parse
+static uint8_t commit(gnss_t *g)
+{
+  gnss_fix_t *w = &g->work, *f = &g->fix;
+
+   g->state = S_IDLE;
+   switch (g->type)
+   {
+     case GNSS_RMC:
+       f->lat = w->lat;
+       f->lon = w->lon;
+       f->time = w->time;
+       f->date = w->date;
+       f->speed = w->speed;
+       f->valid = w->valid;
+       break;
+     case GNSS_GGA:
+       f->hdop = w->hdop;
+       f->sats = w->sats;
+       break;
+     case GNSS_CGNSINF:
+       // line of a receiver that is off or searching has only the first fields
+       if (g->field < 1) return 0;
+       *f = *w;
+       break;
+     default:
+       return 0;
+   }
+   g->sentences++;
+   return 1;
+}
+
+static uint8_t hexdigit(uint8_t c)
+{
+   if (c >= '0' && c <= '9') return c - '0';
+   if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+   if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+   return 0xFF;
+}
+
+uint8_t gnss_feed(gnss_t *g, uint8_t c)
+{
+  uint8_t h;
+
+   // start of a sentence cuts the one being parsed
+   if (c == '$')
+      {
+        if (g->state != S_IDLE && g->state != S_PREFIX) g->errors++;
+        start(g, S_NMEA);
+        return 0;
+      };
+   switch (g->state)
+   {
+     case S_IDLE:
+       if (c == '+')
+          { start(g, S_PREFIX);
+          };
+       return 0;
+
+     case S_PREFIX:
+       if (c != pgm_read_byte(&CGNSINF[g->length]))
+          { g->state = S_IDLE;
+            return 0;
+          };
+       if (pgm_read_byte(&CGNSINF[++g->length]) == 0)
+          { g->state = S_LINE;
+            g->type = GNSS_CGNSINF;
+            g->length = 0;
+          };
+       return 0;
+
+     case S_NMEA:
+       if (c == '\r' || c == '\n' || ++g->length > NMEA_MAX)
+          { g->errors++;
+            g->state = S_IDLE;
+            return 0;
+          };
+       if (c == '*')
+          { store_field(g);
+            g->state = S_SUM1;
+            return 0;
+          };
+       g->sum ^= c;
+       if (c == ',')
+          { store_field(g);
+            g->field++;
+            clear_field(g);
+          }
+       else accumulate(g, c);
+       return 0;
+
+     case S_SUM1:
+     case S_SUM2:
+       h = hexdigit(c);
+       if (h == 0xFF)
+          { g->errors++;
+            g->state = S_IDLE;
+            return 0;
+          };
+       g->given = (g->given << 4) | h;
+       if (g->state == S_SUM1)
+          { g->state = S_SUM2;
+            return 0;
+          };
+       if (g->given != g->sum)
+          { g->errors++;
+            g->state = S_IDLE;
+            return 0;
+          };
+       return commit(g);
+
+     case S_LINE:
+       if (c == '\r' || c == '\n')
+          { store_field(g);
+            return commit(g);
+          };
+       if (++g->length > LINE_MAX)
+          { g->errors++;
+            g->state = S_IDLE;
+            return 0;
+          };
+       if (c == ',')
+          { store_field(g);
+            g->field++;
+            clear_field(g);
+          }
+       else accumulate(g, c);
+       return 0;
+   }
+   return 0;
+}
@@ -0,0 +1,65 @@
+/* ---------------------------------------------------------------------------
+ * streaming GNSS parser of the GPS tracker (SIM808 and other NMEA receivers)
+ * gnss_feed() takes one byte at a time as it comes from UART, so no line
+ * buffer is needed : NMEA sentences $..RMC and $..GGA (checksum checked)
+ * and AT+CGNSINF answer lines of SIM808 are parsed field by field into
+ * fixed point numbers, other sentences are only checked and skipped
+ *
+ * a sentence changes 'fix' only when it was complete and its checksum was
+ * good, RMC gives position, time, date, speed and fix status, GGA adds HDOP
+ * and satellites, one CGNSINF line gives all of them
+ *
+ * plain C without the firmware, compiled natively by bench/nmeabench too
+ * ---------------------------------------------------------------------------
+ */
+#ifndef GNSS_H
+#define GNSS_H
+
+#include <inttypes.h>
+
+typedef struct {
+  int32_t lat;          // millionths of degree, south negative
+  int32_t lon;          // millionths of degree, west negative
+  uint32_t date;        // yyyymmdd UTC
+  uint32_t time;        // hhmmss UTC
+  uint16_t speed;       // 0.1 km/h
+  uint8_t hdop;         // 0.1, 255 when not known
+  uint8_t sats;         // satellites used for the fix
+  uint8_t valid;        // 1 when position is a fix
+} gnss_fix_t;
+
+typedef struct {
+  gnss_fix_t fix;       // from the last good sentences
+  gnss_fix_t work;      // sentence being parsed
+  uint32_t ival;        // integer part of the field (sentence name in field 0)
+  uint32_t ihigh;       // first 8 digits when the integer part is longer (CGNSINF date and time)
+  uint32_t fval;        // fraction, first 6 digits
+  uint8_t idigits;
+  uint8_t fdigits;
+  uint8_t flags;        // GNSS_DOT, GNSS_NEG
+  uint8_t letter;       // first letter of the field (A/V, N/S, E/W)
+  uint8_t state;
+  uint8_t type;         // GNSS_RMC ...
+  uint8_t field;
+  uint8_t length;       // chars of the sentence, NMEA allows 82
+  uint8_t sum;          // XOR of chars between $ and *
+  uint8_t given;        // checksum after *
+  uint16_t sentences;   // RMC, GGA and CGNSINF taken into 'fix'
+  uint16_t errors;      // bad checksum, sentence too long or cut short
+} gnss_t;
+
+// sentence types
+#define GNSS_NONE     0
+#define GNSS_RMC      1
+#define GNSS_GGA      2
+#define GNSS_CGNSINF  3
+#define GNSS_OTHER    4
+
+#define GNSS_DOT      1
+#define GNSS_NEG      2
+
+void gnss_init(gnss_t *g);
+// next byte from the receiver, returns 1 when a sentence was taken into g->fix
+uint8_t gnss_feed(gnss_t *g, uint8_t c);
+
+#endif
@@ -0,0 +1,372 @@
+// ---------------------------------------------------------------------------
+// load generator of the ingestion server
+//   ingestbench [-a address] [-p http_port] [-u udp_port] [-t threads]
+//               [-m http|sms|udp|mix] [-D devices] [-d seconds] [-b batch]
+// every thread sends batches of -b reports of its share of -D devices, one
+// batch in flight, for -d seconds :
+//   http  POST /reports with reports v1 on a keep-alive connection
+//   sms   POST /sms with location SMS texts of the firmware, one sender
+//         number per device
+//   udp   report v1 datagrams with the ack flag, a report without ack in
+//         250 ms is sent again with the retransmit flag, at most 8 times
+//   mix   the threads take http, sms and udp in turn
+// before that every device gets one report, the time it takes is printed
+// apart : the server creates the track files then. At the end it waits
+// until the server stored what it accepted (GET /stats) and prints reports
+// per second, the batch round trip p50 / p99 and the server counters.
+// Exit code 1 when a report was not accepted (HTTP) or never
+// acknowledged (UDP), or the server stored less than it acknowledged
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "report.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum Mode { kHttp, kSms, kUdp };
+const char* const kModeNames[] = {"http", "sms", "udp"};
+
+constexpr int kUdpWaitMs = 250;
+constexpr int kUdpTries = 8;
+constexpr uint64_t kFirstNumber = 48500000000ULL;   // sender number of device 0
+
+struct Options {
+  std::string address = "127.0.0.1";
+  int port = 8081;
+  int udp_port = 5005;
+  unsigned threads = 4;
+  std::string mode = "mix";
+  unsigned devices = 10000;
+  double seconds = 5;
+  unsigned batch = 100;
+};
+
+struct Result {
+  Mode mode = kHttp;
+  uint64_t sent = 0;         // reports
+  uint64_t accepted = 0;     // answered accepted (HTTP) or acknowledged (UDP)
+  uint64_t datagrams = 0;
+  uint64_t errors = 0;
+  std::vector<uint32_t> latency_us;   // of the batches
+  std::vector<uint16_t> seq;          // last sequence number of every device
+};
+
+Options opt;
+
+sockaddr_in address(int port) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  inet_pton(AF_INET, opt.address.c_str(), &addr.sin_addr);
+  return addr;
+}
+
+int connect_to(int type, int port) {
+  int fd = socket(AF_INET, type, 0);
+  if (fd < 0) return -1;
+  sockaddr_in addr = address(port);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  int one = 1;
+  if (type == SOCK_STREAM) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+// one request on a keep-alive connection, the body of the answer to 'body', false on errors
+bool exchange(int fd, const std::string& request, std::string& in, std::string& body) {
+  for (size_t off = 0; off < request.size();) {
+    ssize_t n = write(fd, request.data() + off, request.size() - off);
+    if (n <= 0) return false;
+    off += static_cast<size_t>(n);
+  }
+  in.clear();
+  for (;;) {
+    size_t end = in.find("\r\n\r\n");
+    if (end != std::string::npos) {
+      size_t at = in.find("Content-Length: ");
+      size_t length = at < end ? std::strtoul(in.c_str() + at + 16, nullptr, 10) : 0;
+      if (in.size() >= end + 4 + length) {
+        body = in.substr(end + 4, length);
+        return in.compare(0, 12, "HTTP/1.1 200") == 0;
+      }
+    }
+    char buf[4096];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) return false;
+    in.append(buf, static_cast<size_t>(n));
+  }
+}
+
+uint64_t counter(const std::string& text, const char* name) {
+  size_t at = text.find(name);
+  return at == std::string::npos ? 0 : std::strtoull(text.c_str() + at + std::strlen(name), nullptr, 10);
+}
+
+// report of device d walking east of Krakow, 'seq' its sequence number
+telemetry::Report report(unsigned d, uint16_t seq, uint32_t now) {
+  telemetry::Report r;
+  r.device = d + 1;
+  r.seq = seq;
+  r.lat = 50064651 + static_cast<int32_t>(d % 1000) * 100 + seq;
+  r.lon = 19945490 + static_cast<int32_t>(d / 1000) * 100 + seq * 2;
+  r.time = now;
+  r.accuracy = 550;
+  r.battery = 4100;
+  r.mcc = 260;
+  r.mnc = 1;
+  r.lac = 0x2A4B;
+  r.ci = static_cast<uint16_t>(d);
+  return r;
+}
+
+// the location SMS of the firmware for the same position
+std::string sms_text(const telemetry::Report& r) {
+  char text[256];
+  int n = std::snprintf(text, sizeof(text),
+                        "%s UTC\n LONGTITUDE=%d.%06d LATITUDE=%d.%06d ACCURACY[m]=%u\nBATTERY[mV]=%u\r\n "
+                        "http://maps.google.com/maps?q=%d.%06d,%d.%06d\r\n",
+                        telemetry::datetime(r.time).c_str(), r.lon / 1000000, r.lon % 1000000, r.lat / 1000000,
+                        r.lat % 1000000, r.accuracy, r.battery, r.lat / 1000000, r.lat % 1000000, r.lon / 1000000,
+                        r.lon % 1000000);
+  return std::string(text, static_cast<size_t>(n));
+}
+
+// until time 'until' or 'limit' reports
+void http_worker(unsigned t, Clock::time_point until, uint64_t limit, Result* res) {
+  int fd = connect_to(SOCK_STREAM, opt.port);
+  if (fd < 0) {
+    res->errors++;
+    return;
+  }
+  std::vector<uint16_t>& seq = res->seq;
+  std::string body, request, in, answer;
+  unsigned d = t;
+  while (Clock::now() < until && res->sent < limit) {
+    uint32_t now = static_cast<uint32_t>(std::time(nullptr) - telemetry::kEpoch2000);
+    body.clear();
+    unsigned body_reports = 0;
+    for (unsigned i = 0; i < opt.batch && res->sent + i < limit; i++) {
+      telemetry::Report r = report(d, ++seq[d], now);
+      if (res->mode == kHttp) {
+        uint8_t p[telemetry::kReportSize];
+        telemetry::encode(r, p);
+        body.append(reinterpret_cast<const char*>(p), sizeof(p));
+      } else {
+        std::string text = sms_text(r);
+        body += "+" + std::to_string(kFirstNumber + d) + " " + std::to_string(text.size()) + "\n" + text;
+      }
+      body_reports++;
+      d += opt.threads;
+      if (d >= opt.devices) d = t;
+    }
+    request = std::string(res->mode == kHttp ? "POST /reports" : "POST /sms") +
+              " HTTP/1.1\r\nHost: ingest\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    Clock::time_point sent = Clock::now();
+    if (!exchange(fd, request, in, answer)) {
+      res->errors++;
+      break;
+    }
+    res->latency_us.push_back(
+        static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent).count()));
+    res->sent += body_reports;
+    res->accepted += counter(answer, "accepted=");
+  }
+  close(fd);
+}
+
+void udp_worker(unsigned t, Clock::time_point until, uint64_t limit, Result* res) {
+  int fd = connect_to(SOCK_DGRAM, opt.udp_port);
+  if (fd < 0) {
+    res->errors++;
+    return;
+  }
+  std::vector<uint16_t>& seq = res->seq;
+  std::vector<telemetry::Report> batch;
+  std::vector<bool> acked;
+  unsigned d = t;
+  while (Clock::now() < until && res->sent < limit) {
+    uint32_t now = static_cast<uint32_t>(std::time(nullptr) - telemetry::kEpoch2000);
+    batch.clear();
+    for (unsigned i = 0; i < opt.batch && res->sent + i < limit; i++) {
+      batch.push_back(report(d, ++seq[d], now));
+      batch.back().flags = telemetry::kFlagAck;
+      d += opt.threads;
+      if (d >= opt.devices) d = t;
+    }
+    acked.assign(batch.size(), false);
+    size_t missing = batch.size();
+    Clock::time_point sent = Clock::now();
+    for (int attempt = 0; attempt < kUdpTries && missing > 0; attempt++) {
+      std::vector<uint8_t> wire(batch.size() * telemetry::kReportSize);
+      std::vector<mmsghdr> msgs;
+      std::vector<iovec> iov(batch.size());
+      for (size_t i = 0; i < batch.size(); i++) {
+        if (acked[i]) continue;
+        telemetry::encode(batch[i], &wire[i * telemetry::kReportSize]);
+        batch[i].flags |= telemetry::kFlagRetransmit;
+        iov[i] = {&wire[i * telemetry::kReportSize], telemetry::kReportSize};
+        mmsghdr m{};
+        m.msg_hdr.msg_iov = &iov[i];
+        m.msg_hdr.msg_iovlen = 1;
+        msgs.push_back(m);
+      }
+      for (size_t off = 0; off < msgs.size();) {
+        int n = sendmmsg(fd, msgs.data() + off, static_cast<unsigned>(msgs.size() - off), 0);
+        if (n <= 0) break;
+        off += static_cast<size_t>(n);
+      }
+      res->datagrams += msgs.size();
+      Clock::time_point wait_from = Clock::now();
+      while (missing > 0) {
+        int left = kUdpWaitMs - static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                     Clock::now() - wait_from).count());
+        pollfd p{fd, POLLIN, 0};
+        if (left <= 0 || poll(&p, 1, left) <= 0) break;
+        uint8_t a[64];
+        ssize_t n = recv(fd, a, sizeof(a), 0);
+        uint32_t device;
+        uint16_t s;
+        if (n <= 0 || !telemetry::decode_ack(a, static_cast<size_t>(n), device, s)) continue;
+        // the batch has every device of the thread at most once when -D is at least -b times -t
+        for (size_t i = 0; i < batch.size(); i++) {
+          if (!acked[i] && batch[i].device == device && batch[i].seq == s) {
+            acked[i] = true;
+            missing--;
+            break;
+          }
+        }
+      }
+    }
+    res->latency_us.push_back(
+        static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - sent).count()));
+    res->sent += batch.size();
+    res->accepted += batch.size() - missing;
+  }
+  close(fd);
+}
+
+std::string server_stats() {
+  int fd = connect_to(SOCK_STREAM, opt.port);
+  if (fd < 0) return "";
+  std::string in, body;
+  bool ok = exchange(fd, "GET /stats HTTP/1.1\r\nHost: ingest\r\n\r\n", in, body);
+  close(fd);
+  return ok ? body : "";
+}
+
+double percentile_ms(std::vector<uint32_t>& v, double p) {
+  if (v.empty()) return 0;
+  size_t i = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(v.size()))) - 1;
+  std::nth_element(v.begin(), v.begin() + static_cast<long>(i), v.end());
+  return v[i] / 1000.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-a" && i + 1 < argc) opt.address = argv[++i];
+    else if (a == "-p" && i + 1 < argc) opt.port = std::atoi(argv[++i]);
+    else if (a == "-u" && i + 1 < argc) opt.udp_port = std::atoi(argv[++i]);
+    else if (a == "-t" && i + 1 < argc) opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-m" && i + 1 < argc) opt.mode = argv[++i];
+    else if (a == "-D" && i + 1 < argc) opt.devices = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-d" && i + 1 < argc) opt.seconds = std::atof(argv[++i]);
+    else if (a == "-b" && i + 1 < argc) opt.batch = static_cast<unsigned>(std::atoi(argv[++i]));
+    else opt.threads = 0;
+  }
+  bool known = opt.mode == "mix" || opt.mode == "http" || opt.mode == "sms" || opt.mode == "udp";
+  if (opt.threads == 0 || opt.batch == 0 || opt.devices < opt.threads || !known) {
+    std::fprintf(stderr,
+                 "usage: %s [-a address] [-p http_port] [-u udp_port] [-t threads] [-m http|sms|udp|mix] "
+                 "[-D devices] [-d seconds] [-b batch]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  std::vector<Result> results(opt.threads);
+  for (unsigned t = 0; t < opt.threads; t++) {
+    if (opt.mode == "mix") results[t].mode = static_cast<Mode>(t % 3);
+    else results[t].mode = opt.mode == "http" ? kHttp : opt.mode == "sms" ? kSms : kUdp;
+    results[t].seq.assign(opt.devices, 0);
+  }
+  auto run = [&](Clock::time_point until, bool first) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < opt.threads; t++) {
+      uint64_t share = (opt.devices - t + opt.threads - 1) / opt.threads;   // devices of thread t
+      workers.emplace_back(results[t].mode == kUdp ? udp_worker : http_worker, t, until,
+                           first ? share : UINT64_MAX, &results[t]);
+    }
+    for (std::thread& w : workers) w.join();
+  };
+  Clock::time_point start = Clock::now();
+  run(Clock::time_point::max(), true);
+  double first = std::chrono::duration<double>(Clock::now() - start).count();
+  uint64_t errors = 0;
+  for (Result& r : results) {
+    errors += r.errors;
+    r.sent = r.accepted = r.datagrams = 0;
+    r.latency_us.clear();
+  }
+  start = Clock::now();
+  if (errors == 0) run(start + std::chrono::microseconds(static_cast<long long>(opt.seconds * 1e6)), false);
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Result all;
+  uint64_t by_mode[3] = {0, 0, 0};
+  for (Result& r : results) {
+    all.sent += r.sent;
+    all.accepted += r.accepted;
+    all.datagrams += r.datagrams;
+    all.errors += r.errors;
+    by_mode[r.mode] += r.accepted;
+    all.latency_us.insert(all.latency_us.end(), r.latency_us.begin(), r.latency_us.end());
+  }
+  std::printf("ingestbench: %s, %u threads, %u devices, batch %u\n", opt.mode.c_str(), opt.threads, opt.devices,
+              opt.batch);
+  std::printf("ingestbench: first report of every device in %.2f s\n", first);
+  std::printf("ingestbench: %llu reports accepted of %llu in %.1f s : %.0f reports/s",
+              static_cast<unsigned long long>(all.accepted), static_cast<unsigned long long>(all.sent), elapsed,
+              static_cast<double>(all.accepted) / elapsed);
+  for (int m = 0; m < 3; m++)
+    if (by_mode[m] > 0) std::printf(" %s %.0f", kModeNames[m], static_cast<double>(by_mode[m]) / elapsed);
+  std::printf("\n");
+  if (all.datagrams > 0) std::printf("ingestbench: %llu datagrams\n", static_cast<unsigned long long>(all.datagrams));
+  double p50 = percentile_ms(all.latency_us, 50), p99 = percentile_ms(all.latency_us, 99);
+  std::printf("ingestbench: batch round trip [ms] p50 %.3f p99 %.3f\n", p50, p99);
+
+  // the shards write behind the answers and acks, wait until they caught up
+  std::string stats;
+  for (int i = 0; i < 100; i++) {
+    stats = server_stats();
+    if (!stats.empty() && counter(stats, "stored=") + counter(stats, "duplicates=") + counter(stats, "failed=") ==
+                              counter(stats, "accepted="))
+      break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  std::printf("ingestbench: server %s", stats.empty() ? "not answering\n" : stats.c_str());
+  bool ok = all.errors == 0 && all.sent > 0 && all.accepted == all.sent && counter(stats, "failed=") == 0 &&
+            counter(stats, "stored=") >= all.accepted;
+  return ok ? 0 : 1;
+}
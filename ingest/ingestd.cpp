@@ -0,0 +1,586 @@
+// ---------------------------------------------------------------------------
+// ingestion server of tracker reports, the fleet side of the SMS and UDP
+// reports of the firmware
+//   ingestd [-p http_port] [-u udp_port] [-t io_threads] [-w shards] [-d store_dir]
+//   UDP      report v1 datagrams of FEATURE_UDP, acknowledged when they ask
+//   POST /reports              reports v1 back to back   200 accepted=n bad=n nolocation=n
+//   POST /sms                  "<number> <length>\n<text>" records of an SMS gateway
+//   POST /sms?from=<number>    one location SMS text     200 accepted=n bad=n nolocation=n
+//   GET /stats                 counters of all threads
+// every io thread has its own SO_REUSEPORT UDP and HTTP socket in one epoll
+// loop and parses in place, a point goes through a lock free single producer
+// single consumer ring to the shard that owns its device (hash of the device
+// key), so every track file has one writer and no lock is taken. A full ring
+// makes the io thread wait, that slows the senders down instead of dropping.
+// A UDP retransmit of a sequence number the shard already stored is counted
+// as duplicate and not stored again. SIGINT / SIGTERM stop the io threads,
+// the shards store what is in the rings, close the files and the summary is
+// printed
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "track.h"
+
+namespace {
+
+using ingest::Item;
+
+constexpr size_t kMaxHeaders = 8192;        // longer request head is answered 431 and closed
+constexpr size_t kMaxBody = 4 << 20;        // longer body is answered 413 and closed
+constexpr size_t kRingSize = 8192;          // points, power of two
+constexpr unsigned kDatagrams = 64;         // per recvmmsg
+constexpr size_t kDatagramMax = 512;        // larger datagrams are not reports
+constexpr int kMaxEvents = 256;
+
+volatile sig_atomic_t stop = 0;
+
+void on_signal(int) { stop = 1; }
+
+// points of one io thread for one shard
+class Ring {
+ public:
+  bool push(const Item& item) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_seen_ == kRingSize) {
+      tail_seen_ = tail_.load(std::memory_order_acquire);
+      if (head - tail_seen_ == kRingSize) return false;
+    }
+    items_[head & (kRingSize - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t pop(Item* out, size_t max) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_seen_) {
+      head_seen_ = head_.load(std::memory_order_acquire);
+      if (tail == head_seen_) return 0;
+    }
+    size_t n = 0;
+    while (n < max && tail != head_seen_) out[n++] = items_[tail++ & (kRingSize - 1)];
+    tail_.store(tail, std::memory_order_release);
+    return n;
+  }
+
+ private:
+  Item items_[kRingSize];
+  alignas(64) std::atomic<uint64_t> head_{0};   // written by the io thread
+  uint64_t tail_seen_ = 0;
+  alignas(64) std::atomic<uint64_t> tail_{0};   // written by the shard
+  uint64_t head_seen_ = 0;
+};
+
+struct alignas(64) IoCounters {
+  std::atomic<uint64_t> accepted{0};     // points handed to the shards
+  std::atomic<uint64_t> bad{0};          // datagrams, reports and SMS records that did not parse
+  std::atomic<uint64_t> nolocation{0};   // SMS without position (NO LOCATION ERROR=)
+  std::atomic<uint64_t> datagrams{0};
+  std::atomic<uint64_t> acks{0};
+  std::atomic<uint64_t> requests{0};     // HTTP
+  std::atomic<uint64_t> waits{0};        // times a ring was full
+};
+
+struct alignas(64) ShardCounters {
+  std::atomic<uint64_t> stored{0};
+  std::atomic<uint64_t> duplicates{0};
+  std::atomic<uint64_t> failed{0};       // points lost to a track file that cannot be written
+  std::atomic<uint64_t> devices{0};
+};
+
+unsigned io_threads = 1, shards = 1;
+std::string store_dir = "tracks";
+std::vector<std::unique_ptr<Ring>> rings;   // [io thread * shards + shard]
+std::unique_ptr<IoCounters[]> io_counters;
+std::unique_ptr<ShardCounters[]> shard_counters;
+std::atomic<bool> draining{false};
+
+unsigned shard_of(uint64_t device) {
+  device ^= device >> 33;
+  device *= 0xff51afd7ed558ccdULL;
+  device ^= device >> 33;
+  return static_cast<unsigned>(device % shards);
+}
+
+void push(unsigned io, const Item& item) {
+  Ring& ring = *rings[io * shards + shard_of(item.device)];
+  if (ring.push(item)) return;
+  io_counters[io].waits.fetch_add(1, std::memory_order_relaxed);
+  while (!ring.push(item)) std::this_thread::yield();
+}
+
+// ----- shards -----
+
+struct Track {
+  ingest::TrackStore store;
+  uint16_t last_seq = 0;     // highest sequence number seen
+  uint64_t window = 0;       // bit n : sequence number last_seq - n was seen
+};
+
+// a retransmit is a duplicate when its sequence number was seen, first datagrams never are : a device
+// that restarted counts from 1 again
+bool duplicate(Track& t, const ingest::Point& p) {
+  int16_t d = static_cast<int16_t>(p.seq - t.last_seq);
+  if (t.window == 0 || d > 0) {
+    t.window = (t.window == 0 || d >= 64) ? 1 : (t.window << d) | 1;
+    t.last_seq = p.seq;
+    return false;
+  }
+  if (-d >= 64) return false;
+  uint64_t bit = 1ULL << -d;
+  bool seen = (t.window & bit) != 0;
+  t.window |= bit;
+  return seen && (p.flags & telemetry::kFlagRetransmit);
+}
+
+void shard(unsigned id) {
+  std::unordered_map<uint64_t, std::unique_ptr<Track>> tracks;
+  ShardCounters& counters = shard_counters[id];
+  std::vector<Item> batch(256);
+  unsigned idle = 0;
+  for (;;) {
+    // the io threads are joined before draining is set : an empty pass started after it ends the shard
+    bool last = draining.load(std::memory_order_acquire);
+    size_t got = 0;
+    for (unsigned io = 0; io < io_threads; io++) {
+      Ring& ring = *rings[io * shards + id];
+      size_t n = ring.pop(batch.data(), batch.size());
+      got += n;
+      for (size_t i = 0; i < n; i++) {
+        const Item& item = batch[i];
+        std::unique_ptr<Track>& t = tracks[item.device];
+        if (!t) {
+          t = std::make_unique<Track>();
+          std::string error;
+          if (!t->store.open(store_dir, item.device, error)) std::fprintf(stderr, "ingestd: %s\n", error.c_str());
+          counters.devices.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (item.point.source != ingest::kSourceSms && duplicate(*t, item.point)) {
+          counters.duplicates.fetch_add(1, std::memory_order_relaxed);
+        } else if (!t->store.is_open() || !t->store.append(item.point)) {
+          counters.failed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          counters.stored.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    }
+    if (got > 0) {
+      idle = 0;
+      continue;
+    }
+    if (last) break;
+    if (++idle < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  // the track files are truncated to their points and closed with 'tracks'
+}
+
+// ----- io threads -----
+
+struct Connection {
+  std::string in;
+  std::string out;
+  size_t sent = 0;
+  bool close_after = false;
+};
+
+int bound_socket(int type, int port) {
+  int fd = socket(AF_INET, type | SOCK_NONBLOCK, 0);
+  if (fd < 0) return -1;
+  int one = 1, buffer = 4 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  if (type == SOCK_DGRAM) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      (type == SOCK_STREAM && listen(fd, 1024) < 0)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void on_datagrams(unsigned io, int fd) {
+  static thread_local uint8_t buf[kDatagrams][kDatagramMax];
+  static thread_local uint8_t ack[kDatagrams][telemetry::kAckSize];
+  static thread_local sockaddr_in from[kDatagrams];
+  mmsghdr in[kDatagrams], out[kDatagrams];
+  iovec iov[kDatagrams], ack_iov[kDatagrams];
+  IoCounters& counters = io_counters[io];
+  for (;;) {
+    for (unsigned i = 0; i < kDatagrams; i++) {
+      iov[i] = {buf[i], kDatagramMax};
+      in[i].msg_hdr = msghdr{};
+      in[i].msg_hdr.msg_name = &from[i];
+      in[i].msg_hdr.msg_namelen = sizeof(from[i]);
+      in[i].msg_hdr.msg_iov = &iov[i];
+      in[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(fd, in, kDatagrams, MSG_DONTWAIT, nullptr);
+    if (n <= 0) return;
+    uint32_t now = ingest::now2000();
+    unsigned acks = 0;
+    for (int i = 0; i < n; i++) {
+      Item item;
+      if ((in[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+          !ingest::parse_report(buf[i], in[i].msg_len, ingest::kSourceUdp, now, item)) {
+        counters.bad.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      push(io, item);
+      counters.accepted.fetch_add(1, std::memory_order_relaxed);
+      // retransmits are acknowledged too, the ack of the first datagram may be the one lost
+      if (item.point.flags & telemetry::kFlagAck) {
+        telemetry::encode_ack(static_cast<uint32_t>(item.device), item.point.seq, ack[acks]);
+        ack_iov[acks] = {ack[acks], telemetry::kAckSize};
+        out[acks].msg_hdr = msghdr{};
+        out[acks].msg_hdr.msg_name = &from[i];
+        out[acks].msg_hdr.msg_namelen = in[i].msg_hdr.msg_namelen;
+        out[acks].msg_hdr.msg_iov = &ack_iov[acks];
+        out[acks].msg_hdr.msg_iovlen = 1;
+        acks++;
+      }
+    }
+    counters.datagrams.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+    if (acks > 0) {
+      int sent = sendmmsg(fd, out, acks, MSG_DONTWAIT);
+      if (sent > 0) counters.acks.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+    }
+  }
+}
+
+bool same_lower(std::string_view a, std::string_view lower) {
+  if (a.size() != lower.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    char c = a[i];
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    if (c != lower[i]) return false;
+  }
+  return true;
+}
+
+// value of header 'name' (lower case) in the request head, empty when it is not there
+std::string_view header(std::string_view head, std::string_view name) {
+  size_t pos = head.find("\r\n");
+  while (pos != std::string_view::npos) {
+    size_t start = pos + 2, end = head.find("\r\n", start);
+    std::string_view line = head.substr(start, end == std::string_view::npos ? end : end - start);
+    size_t colon = line.find(':');
+    if (colon != std::string_view::npos && same_lower(line.substr(0, colon), name)) {
+      std::string_view v = line.substr(colon + 1);
+      while (!v.empty() && v.front() == ' ') v.remove_prefix(1);
+      return v;
+    }
+    pos = end;
+  }
+  return {};
+}
+
+void respond(Connection& c, int status, const char* reason, const char* body, bool keep_alive) {
+  char head[160];
+  std::snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n%s\r\n",
+                status, reason, std::strlen(body), keep_alive ? "" : "Connection: close\r\n");
+  c.out += head;
+  c.out += body;
+  if (!keep_alive) c.close_after = true;
+}
+
+std::string stats() {
+  uint64_t accepted = 0, bad = 0, nolocation = 0, datagrams = 0, acks = 0, requests = 0, waits = 0;
+  uint64_t stored = 0, duplicates = 0, failed = 0, devices = 0;
+  for (unsigned i = 0; i < io_threads; i++) {
+    accepted += io_counters[i].accepted.load(std::memory_order_relaxed);
+    bad += io_counters[i].bad.load(std::memory_order_relaxed);
+    nolocation += io_counters[i].nolocation.load(std::memory_order_relaxed);
+    datagrams += io_counters[i].datagrams.load(std::memory_order_relaxed);
+    acks += io_counters[i].acks.load(std::memory_order_relaxed);
+    requests += io_counters[i].requests.load(std::memory_order_relaxed);
+    waits += io_counters[i].waits.load(std::memory_order_relaxed);
+  }
+  for (unsigned i = 0; i < shards; i++) {
+    stored += shard_counters[i].stored.load(std::memory_order_relaxed);
+    duplicates += shard_counters[i].duplicates.load(std::memory_order_relaxed);
+    failed += shard_counters[i].failed.load(std::memory_order_relaxed);
+    devices += shard_counters[i].devices.load(std::memory_order_relaxed);
+  }
+  char text[320];
+  std::snprintf(text, sizeof(text),
+                "accepted=%llu stored=%llu duplicates=%llu failed=%llu devices=%llu bad=%llu nolocation=%llu "
+                "datagrams=%llu acks=%llu requests=%llu waits=%llu\r\n",
+                static_cast<unsigned long long>(accepted), static_cast<unsigned long long>(stored),
+                static_cast<unsigned long long>(duplicates), static_cast<unsigned long long>(failed),
+                static_cast<unsigned long long>(devices), static_cast<unsigned long long>(bad),
+                static_cast<unsigned long long>(nolocation), static_cast<unsigned long long>(datagrams),
+                static_cast<unsigned long long>(acks), static_cast<unsigned long long>(requests),
+                static_cast<unsigned long long>(waits));
+  return text;
+}
+
+// one SMS text of sender 'from', true when it had a position
+bool take_sms(unsigned io, std::string_view from, std::string_view text, uint32_t now, unsigned& bad,
+              unsigned& nolocation) {
+  uint64_t device;
+  Item item;
+  if (!ingest::phone_key(from, device)) {
+    bad++;
+    return false;
+  }
+  if (!ingest::parse_sms(text, device, now, item)) {
+    nolocation++;
+    return false;
+  }
+  push(io, item);
+  return true;
+}
+
+// request line and headers 'head', 'body' of its Content-Length, both in c.in
+void handle_request(unsigned io, Connection& c, std::string_view head, std::string_view body) {
+  IoCounters& counters = io_counters[io];
+  counters.requests.fetch_add(1, std::memory_order_relaxed);
+  std::string_view line = head.substr(0, head.find("\r\n"));
+  std::string_view connection = header(head, "connection");
+  bool keep_alive = line.find("HTTP/1.1") != std::string_view::npos ? !same_lower(connection, "close")
+                                                                     : same_lower(connection, "keep-alive");
+  uint32_t now = ingest::now2000();
+  unsigned accepted = 0, bad = 0, nolocation = 0;
+  char answer[96];
+  if (line.compare(0, 14, "POST /reports ") == 0) {
+    if (body.size() % telemetry::kReportSize != 0) {
+      counters.bad.fetch_add(1, std::memory_order_relaxed);
+      respond(c, 400, "Bad Request", "400 body is not whole reports\r\n", keep_alive);
+      return;
+    }
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(body.data());
+    for (size_t off = 0; off < body.size(); off += telemetry::kReportSize) {
+      Item item;
+      if (!ingest::parse_report(p + off, telemetry::kReportSize, ingest::kSourceHttp, now, item)) {
+        bad++;
+        continue;
+      }
+      push(io, item);
+      accepted++;
+    }
+  } else if (line.compare(0, 15, "POST /sms?from=") == 0) {
+    std::string_view from = line.substr(15, line.find(' ', 15) - 15);
+    from = from.substr(0, from.find('&'));
+    if (from.compare(0, 3, "%2B") == 0) from.remove_prefix(3);
+    accepted += take_sms(io, from, body, now, bad, nolocation);
+  } else if (line.compare(0, 10, "POST /sms ") == 0) {
+    std::string_view from, text;
+    bool malformed;
+    while (ingest::next_sms(body, from, text, malformed)) accepted += take_sms(io, from, text, now, bad, nolocation);
+    bad += malformed;
+  } else if (line.compare(0, 11, "GET /stats ") == 0) {
+    respond(c, 200, "OK", stats().c_str(), keep_alive);
+    return;
+  } else {
+    counters.bad.fetch_add(1, std::memory_order_relaxed);
+    respond(c, 404, "Not Found", "404\r\n", keep_alive);
+    return;
+  }
+  counters.accepted.fetch_add(accepted, std::memory_order_relaxed);
+  counters.bad.fetch_add(bad, std::memory_order_relaxed);
+  counters.nolocation.fetch_add(nolocation, std::memory_order_relaxed);
+  std::snprintf(answer, sizeof(answer), "accepted=%u bad=%u nolocation=%u\r\n", accepted, bad, nolocation);
+  respond(c, 200, "OK", answer, keep_alive);
+}
+
+// false when the connection is to be closed
+bool on_readable(unsigned io, int fd, Connection& c) {
+  char buf[65536];
+  bool eof = false;
+  for (;;) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      c.in.append(buf, static_cast<size_t>(n));
+      continue;
+    }
+    if (n == 0) {
+      eof = true;   // requests sent before closing are still answered
+      break;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+    if (errno == EINTR) continue;
+    return false;
+  }
+  std::string_view in(c.in);
+  size_t start = 0;
+  while (!c.close_after) {
+    size_t end = in.find("\r\n\r\n", start);
+    if (end == std::string_view::npos) {
+      if (in.size() - start > kMaxHeaders) respond(c, 431, "Request Header Fields Too Large", "431\r\n", false);
+      break;
+    }
+    std::string_view head = in.substr(start, end - start);
+    std::string_view length = header(head, "content-length");
+    size_t body = std::strtoul(std::string(length).c_str(), nullptr, 10);
+    if (body > kMaxBody) {
+      respond(c, 413, "Payload Too Large", "413\r\n", false);
+      break;
+    }
+    if (in.size() - end - 4 < body) break;   // the rest of the body is still on its way
+    handle_request(io, c, head, in.substr(end + 4, body));
+    start = end + 4 + body;
+  }
+  c.in.erase(0, start);
+  return !eof;
+}
+
+// false when the connection is to be closed
+bool flush(int fd, Connection& c) {
+  while (c.sent < c.out.size()) {
+    ssize_t n = write(fd, c.out.data() + c.sent, c.out.size() - c.sent);
+    if (n > 0) {
+      c.sent += static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    return false;
+  }
+  c.out.clear();
+  c.sent = 0;
+  return !c.close_after;
+}
+
+void io_thread(unsigned io, int http_port, int udp_port, std::atomic<bool>* failed) {
+  int lfd = bound_socket(SOCK_STREAM, http_port);
+  int ufd = bound_socket(SOCK_DGRAM, udp_port);
+  if (lfd < 0 || ufd < 0) {
+    std::fprintf(stderr, "ingestd: cannot listen on port %d / udp %d: %s\n", http_port, udp_port,
+                 std::strerror(errno));
+    failed->store(true);
+    stop = 1;
+    if (lfd >= 0) close(lfd);
+    if (ufd >= 0) close(ufd);
+    return;
+  }
+  int ep = epoll_create1(0);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = lfd;
+  epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+  ev.data.fd = ufd;
+  epoll_ctl(ep, EPOLL_CTL_ADD, ufd, &ev);
+  std::unordered_map<int, Connection> conns;
+  epoll_event events[kMaxEvents];
+
+  auto drop = [&](int fd) {
+    epoll_ctl(ep, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns.erase(fd);
+  };
+
+  while (!stop) {
+    int n = epoll_wait(ep, events, kMaxEvents, 100);
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      if (fd == ufd) {
+        on_datagrams(io, ufd);
+        continue;
+      }
+      if (fd == lfd) {
+        for (;;) {
+          int cfd = accept4(lfd, nullptr, nullptr, SOCK_NONBLOCK);
+          if (cfd < 0) break;
+          int one = 1;
+          setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          epoll_event cev{};
+          cev.events = EPOLLIN | EPOLLRDHUP;
+          cev.data.fd = cfd;
+          epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &cev);
+          conns[cfd];
+        }
+        continue;
+      }
+      auto it = conns.find(fd);
+      if (it == conns.end()) continue;
+      Connection& c = it->second;
+      bool alive = true;
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) alive = false;
+      if (alive && (events[i].events & (EPOLLIN | EPOLLRDHUP))) alive = on_readable(io, fd, c);
+      if (!c.out.empty()) alive = flush(fd, c) && alive;
+      if (!alive) {
+        drop(fd);
+        continue;
+      }
+      epoll_event cev{};
+      cev.events = EPOLLIN | EPOLLRDHUP | (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+      cev.data.fd = fd;
+      epoll_ctl(ep, EPOLL_CTL_MOD, fd, &cev);
+    }
+  }
+  for (auto& conn : conns) close(conn.first);
+  close(lfd);
+  close(ufd);
+  close(ep);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int http_port = 8081, udp_port = 5005;
+  unsigned cores = std::thread::hardware_concurrency();
+  if (cores == 0) cores = 2;
+  io_threads = cores > 1 ? cores / 2 : 1;
+  shards = cores > 1 ? cores - io_threads : 1;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-p" && i + 1 < argc) http_port = std::atoi(argv[++i]);
+    else if (a == "-u" && i + 1 < argc) udp_port = std::atoi(argv[++i]);
+    else if (a == "-t" && i + 1 < argc) io_threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-w" && i + 1 < argc) shards = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-d" && i + 1 < argc) store_dir = argv[++i];
+    else io_threads = 0;
+  }
+  if (io_threads == 0 || shards == 0) {
+    std::fprintf(stderr, "usage: %s [-p http_port] [-u udp_port] [-t io_threads] [-w shards] [-d store_dir]\n",
+                 argv[0]);
+    return 2;
+  }
+  if (mkdir(store_dir.c_str(), 0755) < 0 && errno != EEXIST) {
+    std::fprintf(stderr, "ingestd: %s: %s\n", store_dir.c_str(), std::strerror(errno));
+    return 2;
+  }
+  for (unsigned i = 0; i < io_threads * shards; i++) rings.push_back(std::make_unique<Ring>());
+  io_counters = std::make_unique<IoCounters[]>(io_threads);
+  shard_counters = std::make_unique<ShardCounters[]>(shards);
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> writers, readers;
+  for (unsigned s = 0; s < shards; s++) writers.emplace_back(shard, s);
+  for (unsigned t = 0; t < io_threads; t++) readers.emplace_back(io_thread, t, http_port, udp_port, &failed);
+  std::printf("ingestd: port %d, udp %d, %u io threads, %u shards, store %s\n", http_port, udp_port, io_threads,
+              shards, store_dir.c_str());
+  std::fflush(stdout);
+  for (std::thread& r : readers) r.join();
+  draining.store(true, std::memory_order_release);
+  for (std::thread& w : writers) w.join();
+  std::printf("ingestd: %s", stats().c_str());
+  return failed.load() ? 1 : 0;
+}
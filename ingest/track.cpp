@@ -0,0 +1,278 @@
+// ---------------------------------------------------------------------------
+// track points of the ingestion server : parsers and track store, see track.h
+// ---------------------------------------------------------------------------
+#include "track.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace ingest {
+
+namespace {
+
+constexpr char kMagic[8] = {'T', 'R', 'A', 'C', 'K', 'v', '1', 0};
+constexpr size_t kHeader = 64;
+constexpr size_t kFirstCapacity = 256;   // points of a new file, doubled when full
+
+struct Header {
+  char magic[8];
+  uint64_t device;
+  uint64_t count;      // points written, updated after each point
+  uint32_t record;     // sizeof(Point)
+  uint8_t reserved[36];
+};
+static_assert(sizeof(Header) == kHeader, "track store header");
+
+bool is_space(char c) { return c == ' ' || c == '\r' || c == '\n' || c == '\t'; }
+
+bool digits(std::string_view s, uint32_t& v) {
+  if (s.empty() || s.size() > 9) return false;
+  v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') return false;
+    v = v * 10 + static_cast<uint32_t>(c - '0');
+  }
+  return true;
+}
+
+// decimal degrees to millionths, digits after the 6th decimal place are cut like in the firmware
+bool degrees(std::string_view s, int32_t& out) {
+  bool neg = !s.empty() && s[0] == '-';
+  if (neg) s.remove_prefix(1);
+  uint64_t v = 0;
+  int places = -1, seen = 0;      // decimal places taken, -1 before the dot
+  for (char c : s) {
+    if (c == '.' && places < 0) {
+      places = 0;
+    } else if (c >= '0' && c <= '9') {
+      if (places >= 6) continue;
+      v = v * 10 + static_cast<uint64_t>(c - '0');
+      if (places >= 0) places++;
+      seen++;
+    } else {
+      return false;
+    }
+    if (v > 180000000ULL * 10) return false;
+  }
+  if (seen == 0) return false;
+  for (int i = places < 0 ? 0 : places; i < 6; i++) v *= 10;
+  if (v > 180000000ULL) return false;
+  out = neg ? -static_cast<int32_t>(v) : static_cast<int32_t>(v);
+  return true;
+}
+
+const uint16_t kMonthDays[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+// 2019/01/01,12:00:00 to seconds since 2000, false when it is not that
+bool datetime(std::string_view s, uint32_t& t) {
+  uint32_t y, mo, d, h, mi, se;
+  if (s.size() != 19 || s[4] != '/' || s[7] != '/' || s[10] != ',' || s[13] != ':' || s[16] != ':') return false;
+  if (!digits(s.substr(0, 4), y) || !digits(s.substr(5, 2), mo) || !digits(s.substr(8, 2), d) ||
+      !digits(s.substr(11, 2), h) || !digits(s.substr(14, 2), mi) || !digits(s.substr(17, 2), se))
+    return false;
+  if (y < 2000 || y > 2135 || mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || se > 60) return false;
+  y -= 2000;
+  uint32_t days = y * 365 + (y + 3) / 4 + kMonthDays[mo - 1] + d - 1;
+  if (mo > 2 && y % 4 == 0) days++;
+  t = days * 86400 + h * 3600 + mi * 60 + se;
+  return true;
+}
+
+}  // namespace
+
+bool phone_key(std::string_view number, uint64_t& key) {
+  uint64_t v = 0;
+  int n = 0;
+  for (char c : number) {
+    if (c >= '0' && c <= '9') {
+      if (++n > 15) return false;       // E.164 numbers have at most 15 digits
+      v = v * 10 + static_cast<uint64_t>(c - '0');
+    } else if (c != '+' && c != ' ' && c != '-') {
+      return false;
+    }
+  }
+  if (n == 0) return false;
+  key = kPhoneKey | v;
+  return true;
+}
+
+std::string device_name(uint64_t key) {
+  char text[32];
+  if (key & kPhoneKey)
+    std::snprintf(text, sizeof(text), "sms:+%llu", static_cast<unsigned long long>(key & ~kPhoneKey));
+  else
+    std::snprintf(text, sizeof(text), "dev:%llu", static_cast<unsigned long long>(key));
+  return text;
+}
+
+bool parse_sms(std::string_view text, uint64_t device, uint32_t received, Item& item) {
+  Point& p = item.point;
+  p = Point{};
+  bool lat = false, lon = false;
+  size_t i = 0;
+  while (i < text.size()) {
+    while (i < text.size() && is_space(text[i])) i++;
+    size_t start = i;
+    while (i < text.size() && !is_space(text[i])) i++;
+    std::string_view token = text.substr(start, i - start);
+    if (token.empty()) break;
+    size_t eq = token.find('=');
+    if (eq == std::string_view::npos) {
+      uint32_t t;
+      if (datetime(token, t)) p.time = t;
+      continue;
+    }
+    std::string_view key = token.substr(0, eq), value = token.substr(eq + 1);
+    uint32_t v;
+    if (key == "LONGTITUDE" || key == "LONGITUDE" || key == "LONG") {
+      lon = degrees(value, p.lon);
+    } else if (key == "LATITUDE" || key == "LATT" || key == "LAT") {
+      lat = degrees(value, p.lat);
+    } else if (key == "ACCURACY[m]") {
+      if (digits(value, v)) p.accuracy = v > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(v);
+    } else if (key == "BATTERY[mV]") {
+      if (digits(value, v)) p.battery = v > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(v);
+    } else if (key == "AGE[min]") {
+      p.flags |= telemetry::kFlagStale;   // LAST KNOWN AGE[min]=n
+    }
+  }
+  if (!lat || !lon) return false;
+  item.device = device;
+  p.received = received;
+  p.source = kSourceSms;
+  return true;
+}
+
+bool parse_report(const uint8_t* data, size_t n, uint8_t source, uint32_t received, Item& item) {
+  telemetry::Report r;
+  if (!telemetry::decode(data, n, r)) return false;
+  item.device = r.device;
+  Point& p = item.point;
+  p.time = r.time;
+  p.received = received;
+  p.lat = r.lat;
+  p.lon = r.lon;
+  p.accuracy = r.accuracy;
+  p.battery = r.battery;
+  p.seq = r.seq;
+  p.source = source;
+  p.flags = r.flags;
+  p.mcc = r.mcc;
+  p.mnc = r.mnc;
+  p.lac = r.lac;
+  p.ci = r.ci;
+  return true;
+}
+
+bool next_sms(std::string_view& body, std::string_view& from, std::string_view& text, bool& bad) {
+  bad = false;
+  while (!body.empty() && (body[0] == '\r' || body[0] == '\n')) body.remove_prefix(1);
+  if (body.empty()) return false;
+  size_t nl = body.find('\n'), sp = body.find(' ');
+  uint32_t length;
+  if (nl == std::string_view::npos || sp == std::string_view::npos || sp > nl) {
+    bad = true;
+    return false;
+  }
+  std::string_view count = body.substr(sp + 1, nl - sp - 1);
+  if (!count.empty() && count.back() == '\r') count.remove_suffix(1);
+  if (!digits(count, length) || length > body.size() - nl - 1) {
+    bad = true;
+    return false;
+  }
+  from = body.substr(0, sp);
+  text = body.substr(nl + 1, length);
+  body.remove_prefix(nl + 1 + length);
+  return true;
+}
+
+uint32_t now2000() { return static_cast<uint32_t>(std::time(nullptr) - telemetry::kEpoch2000); }
+
+std::string TrackStore::path(const std::string& dir, uint64_t device) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%016llx.trk", static_cast<unsigned long long>(device));
+  return dir + name;
+}
+
+bool TrackStore::open(const std::string& dir, uint64_t device, std::string& error) {
+  std::string file = path(dir, device);
+  fd_ = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    error = file + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  fstat(fd_, &st);
+  size_t capacity = kFirstCapacity;
+  bool fresh = static_cast<size_t>(st.st_size) < kHeader;
+  if (!fresh) {
+    Header h;
+    if (pread(fd_, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)) || std::memcmp(h.magic, kMagic, 8) != 0 ||
+        h.device != device || h.record != sizeof(Point)) {
+      error = file + ": not a track store file of this device";
+      close();
+      return false;
+    }
+    while (capacity < h.count + 1) capacity *= 2;
+  }
+  if (!map(capacity)) {
+    error = file + ": " + std::strerror(errno);
+    close();
+    return false;
+  }
+  if (fresh) {
+    Header* h = reinterpret_cast<Header*>(base_);
+    std::memcpy(h->magic, kMagic, 8);
+    h->device = device;
+    h->count = 0;
+    h->record = sizeof(Point);
+  }
+  return true;
+}
+
+bool TrackStore::map(size_t capacity) {
+  size_t bytes = kHeader + capacity * sizeof(Point);
+  if (ftruncate(fd_, static_cast<off_t>(bytes)) < 0) return false;
+  void* m = base_ == nullptr
+                ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0)
+                : mremap(base_, kHeader + capacity_ * sizeof(Point), bytes, MREMAP_MAYMOVE);
+  if (m == MAP_FAILED) return false;
+  base_ = static_cast<uint8_t*>(m);
+  capacity_ = capacity;
+  return true;
+}
+
+bool TrackStore::append(const Point& p) {
+  Header* h = reinterpret_cast<Header*>(base_);
+  if (h->count == capacity_ && !map(capacity_ * 2)) return false;
+  h = reinterpret_cast<Header*>(base_);
+  std::memcpy(base_ + kHeader + h->count * sizeof(Point), &p, sizeof(Point));
+  h->count++;
+  return true;
+}
+
+uint64_t TrackStore::size() const { return base_ ? reinterpret_cast<const Header*>(base_)->count : 0; }
+
+const Point* TrackStore::points() const { return reinterpret_cast<const Point*>(base_ + kHeader); }
+
+void TrackStore::close() {
+  if (base_ != nullptr) {
+    // the file keeps the points written, not the room mapped for the next ones
+    size_t used = kHeader + size() * sizeof(Point);
+    munmap(base_, kHeader + capacity_ * sizeof(Point));
+    if (ftruncate(fd_, static_cast<off_t>(used)) < 0) std::perror("trackstore");
+    base_ = nullptr;
+  }
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  capacity_ = 0;
+}
+
+}  // namespace ingest
@@ -0,0 +1,103 @@
+// ---------------------------------------------------------------------------
+// tracker reports of the ingestion server : one track point per position,
+// parsers of the report formats and the per-device track store
+//
+// formats, all parsed in place (std::string_view into the receive buffer) :
+//   location SMS text of the firmware, every version and age :
+//     [LAST KNOWN AGE[min]=n ...]2019/01/01,12:00:00 UTC LONGTITUDE=19.945490
+//     LATITUDE=50.064651 [ACCURACY[m]=550] BATTERY[mV]=4100 http://maps...
+//     (main3 versions write LONG= and LATT=), device is the sender number
+//   UDP report v1 of FEATURE_UDP, 34 bytes (../telemetry/report.h), device
+//     is its device id
+//   HTTP batches : POST /reports with reports v1 back to back, POST /sms
+//     with records "<sender number> <length>\n<length bytes of SMS text>",
+//     POST /sms?from=<number> with the text of one SMS
+//
+// track store : directory with one file <device key in hex>.trk per device,
+// 64 byte header and 32 byte points appended through a shared mapping that
+// grows by doubling - only the shard that owns the device writes it
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "report.h"
+
+namespace ingest {
+
+constexpr uint8_t kSourceSms = 1;
+constexpr uint8_t kSourceUdp = 2;
+constexpr uint8_t kSourceHttp = 3;       // reports v1 in an HTTP batch
+constexpr uint64_t kPhoneKey = 1ULL << 62;   // device key of an SMS sender, its number in the low bits
+
+struct Point {           // one record of the track store, 32 bytes
+  uint32_t time;         // of the position, seconds since 2000-01-01 UTC, 0 when not known
+  uint32_t received;     // by the server, same epoch
+  int32_t lat;           // millionths of degree
+  int32_t lon;
+  uint16_t accuracy;     // [m], 0 when not known
+  uint16_t battery;      // [mV]
+  uint16_t seq;          // of the UDP report, 0 for SMS
+  uint8_t source;        // kSource...
+  uint8_t flags;         // telemetry::kFlag..., kFlagStale for LAST KNOWN SMS too
+  uint16_t mcc;
+  uint16_t mnc;
+  uint16_t lac;
+  uint16_t ci;
+};
+static_assert(sizeof(Point) == 32, "track store record");
+
+// what the parsers hand to the shard of the device
+struct Item {
+  uint64_t device;
+  Point point;
+};
+
+// "+48500600700" to kPhoneKey | 48500600700, false when there are no digits
+bool phone_key(std::string_view number, uint64_t& key);
+// "sms:+48500600700" or "dev:17" (device id of reports v1) of a device key
+std::string device_name(uint64_t key);
+
+// location SMS text, false when it has no position (NO LOCATION ERROR=...)
+bool parse_sms(std::string_view text, uint64_t device, uint32_t received, Item& item);
+// report v1 datagram, false when size, type or CRC is wrong
+bool parse_report(const uint8_t* p, size_t n, uint8_t source, uint32_t received, Item& item);
+
+// records of an SMS batch one by one : 'body' is advanced past the record, false at its end,
+// 'bad' set when the record was malformed (the rest of the batch is skipped)
+bool next_sms(std::string_view& body, std::string_view& from, std::string_view& text, bool& bad);
+
+// seconds since 2000-01-01 UTC now
+uint32_t now2000();
+
+// points of one device in <dir>/<key>.trk, not thread safe - one owner
+class TrackStore {
+ public:
+  TrackStore() = default;
+  TrackStore(const TrackStore&) = delete;
+  TrackStore& operator=(const TrackStore&) = delete;
+  ~TrackStore() { close(); }
+
+  // opens or creates the file, points already in it are kept
+  bool open(const std::string& dir, uint64_t device, std::string& error);
+  bool append(const Point& p);
+  void close();
+  bool is_open() const { return base_ != nullptr; }
+  uint64_t size() const;
+  const Point* points() const;
+
+  // file of a device in the store directory
+  static std::string path(const std::string& dir, uint64_t device);
+
+ private:
+  bool map(size_t capacity);
+
+  int fd_ = -1;
+  uint8_t* base_ = nullptr;
+  size_t capacity_ = 0;        // points the mapping has room for
+};
+
+}  // namespace ingest
@@ -0,0 +1,102 @@
+// ---------------------------------------------------------------------------
+// prints track store files of the ingestion server
+//   trackcat [-s] dir|file.trk...
+// one line per point : device, time of the position, received, position,
+// accuracy, battery, source, sequence number, cell and flags. -s prints only
+// the points of every file and the total
+// ---------------------------------------------------------------------------
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "track.h"
+
+namespace {
+
+const char* const kSources[] = {"?", "sms", "udp", "http"};
+
+// false when 'path' is not a track store file
+bool cat(const std::string& path, bool summary, uint64_t& total) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < 64) {
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  void* m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED) return false;
+  const uint8_t* base = static_cast<const uint8_t*>(m);
+  uint64_t device, count;
+  uint32_t record;
+  std::memcpy(&device, base + 8, 8);
+  std::memcpy(&count, base + 16, 8);
+  std::memcpy(&record, base + 24, 4);
+  bool ok = std::memcmp(base, "TRACKv1", 8) == 0 && record == sizeof(ingest::Point) &&
+            64 + count * sizeof(ingest::Point) <= static_cast<uint64_t>(st.st_size);
+  if (ok) {
+    std::string name = ingest::device_name(device);
+    if (summary) std::printf("%s %llu points\n", name.c_str(), static_cast<unsigned long long>(count));
+    const ingest::Point* points = reinterpret_cast<const ingest::Point*>(base + 64);
+    for (uint64_t i = 0; !summary && i < count; i++) {
+      const ingest::Point& p = points[i];
+      std::printf("%s %s received=%s lat=%.6f lon=%.6f acc=%u batt=%u %s seq=%u cell=%u,%u,%X,%X%s%s\n",
+                  name.c_str(), telemetry::datetime(p.time).c_str(), telemetry::datetime(p.received).c_str(),
+                  p.lat / 1e6, p.lon / 1e6, p.accuracy, p.battery, kSources[p.source < 4 ? p.source : 0], p.seq,
+                  p.mcc, p.mnc, p.lac, p.ci, (p.flags & telemetry::kFlagStale) ? " stale" : "",
+                  (p.flags & telemetry::kFlagRetransmit) ? " retransmit" : "");
+    }
+    total += count;
+  }
+  munmap(m, static_cast<size_t>(st.st_size));
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool summary = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-s") {
+      summary = true;
+      continue;
+    }
+    DIR* dir = opendir(a.c_str());
+    if (dir == nullptr) {
+      files.push_back(a);
+      continue;
+    }
+    std::vector<std::string> names;
+    while (dirent* e = readdir(dir)) {
+      std::string name = e->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".trk") == 0) names.push_back(a + "/" + name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    files.insert(files.end(), names.begin(), names.end());
+  }
+  if (argc < 2 || (summary && argc < 3)) {
+    std::fprintf(stderr, "usage: %s [-s] dir|file.trk...\n", argv[0]);
+    return 2;
+  }
+  uint64_t total = 0;
+  int status = 0;
+  for (const std::string& f : files) {
+    if (!cat(f, summary, total)) {
+      std::fprintf(stderr, "trackcat: %s is not a track store file\n", f.c_str());
+      status = 1;
+    }
+  }
+  if (summary) std::printf("trackcat: %zu files, %llu points\n", files.size(), static_cast<unsigned long long>(total));
+  return status;
+}
@@ -0,0 +1,126 @@
+/* ---------------------------------------------------------------------------
+ * firmware update over GPRS (FEATURE_OTA, ATMEGA328P) - what the bootloader
+ * boot.c, the downloader in tracker.c and the delta generator tools/otadelta
+ * share
+ *
+ * flash of ATMEGA328P :
+ *   0x0000 - OTA_STAGE     application, the update is patched into it in place
+ *   OTA_STAGE - OTA_JOURNAL  staging area : header and delta as downloaded
+ *   OTA_JOURNAL            one page, copy of the page being written by the bootloader
+ *   OTA_BOOT - 0x7FFF      bootloader (BOOTSZ 1024 words, BOOTRST), word 0 its reset
+ *                          entry, word 1 the SPM service of the application
+ *
+ * the application downloads the delta to the staging area page by page with
+ * the SPM service (it cannot write flash itself), checks its CRC and that it
+ * was made for the firmware it is running, sets OTA_PENDING in EEPROM and
+ * resets by the watchdog. The bootloader checks the MAC with the key only it
+ * has (lock bits BLB1 = 00 : the application can neither read nor write the
+ * boot section), then writes the new pages in the order of the header. The
+ * progress is in EEPROM and each page is copied to the journal page before
+ * it is erased, so a power cut in the middle is finished at the next reset.
+ *
+ * delta : the tokens of every written page in order, 128 bytes of the new
+ * page each, copies read the flash as it is at that moment - old content of
+ * pages not yet written (the page being written too), new content of pages
+ * already written :
+ *   0x00-0x7F           literal, n = t + 1 bytes follow
+ *   0x80-0xBF           copy n = (t & 0x3F) + 1 bytes from the address of the
+ *                       byte being made plus 'shift' (0 at the start)
+ *   0xC0-0xFF lo hi     copy n = (t & 0x3F) + 1 bytes from address hi:lo,
+ *                       shift becomes that address minus the byte being made
+ * code moved by an insertion keeps its shift, so most of it is one byte per
+ * 64 bytes, only absolute addresses (CALL / JMP / LDS) that changed go as
+ * literals
+ * ---------------------------------------------------------------------------
+ */
+#ifndef OTA_H
+#define OTA_H
+
+#include <inttypes.h>
+
+#define OTA_PAGE     128                   // SPM_PAGESIZE of ATMEGA328P
+#define OTA_BOOT     0x7800                // BOOTSZ = 01, hfuse 0xDA
+#define OTA_JOURNAL  (OTA_BOOT - OTA_PAGE)
+#ifndef OTA_STAGE
+#define OTA_STAGE    0x5800                // end of the application, it is linked to fit below it
+#endif
+#define OTA_PAGES    (OTA_STAGE / OTA_PAGE)
+
+// 128 bit XTEA key of the MAC is OTA_KEY of the bootloader (make OTA=1 OTA_KEY=k0,k1,k2,k3) and
+// tools/otadelta -k k0,k1,k2,k3 - there is no default, a key known to everybody signs any update
+
+typedef struct {
+  uint8_t magic[4];      // "OTA1"
+  uint16_t size;         // bytes of the delta after the header
+  uint8_t first;         // pages written, OTA_PAGE bytes each from address 0
+  uint8_t last;
+  uint8_t descending;    // from 'last' down to 'first', else up
+  uint8_t reserved[3];
+  uint32_t oldcrc;       // CRC-32 of the application area [0, OTA_STAGE) the delta is made for
+  uint32_t newcrc;       // the same after the update
+  uint32_t deltacrc;     // of the delta, checked by the downloader
+  uint8_t mac[8];        // XTEA CBC-MAC of the header up to here and the delta
+} ota_header_t;
+
+#define OTA_HEADER 32
+#define OTA_MAXDELTA (OTA_JOURNAL - OTA_STAGE - OTA_HEADER)
+
+// result of the last update in EEPROM, STATUS SMS shows it
+#define OTA_OK       0
+#define OTA_EHTTP    1                     // no bearer or the server did not answer 200
+#define OTA_ESIZE    2                     // delta does not fit the staging area
+#define OTA_ECRC     3                     // download is not what the server sent
+#define OTA_EBASE    4                     // delta was made for another firmware
+#define OTA_EMAC     5                     // MAC is wrong, nothing was written
+#define OTA_EAPPLY   6                     // new application has a wrong CRC
+#define OTA_NONE     0xFF                  // erased EEPROM, no update yet
+
+// state of the update, 'state' is written last and alone so it commits the record it selects
+#define OTA_IDLE     0xFF
+#define OTA_PENDING  1                     // set by the application : check and apply the delta
+#define OTA_APPLY    2                     // page 'apply.page' is the next to make
+#define OTA_RESTORE  3                     // journal holds page 'journal.page', write it again
+
+typedef struct {
+  uint8_t page;
+  uint16_t offset;                         // of its first token in the delta
+  int16_t shift;
+} ota_resume_t;
+
+typedef struct {
+  ota_resume_t apply;
+  ota_resume_t journal;                    // continuation after the page in the journal
+  uint8_t result;
+  uint8_t state;
+} ota_eeprom_t;
+
+// SPM service of the bootloader at word OTA_BOOT / 2 + 1, erase and write only in the staging area
+#define OTA_SPM_FILL  0                    // word 'data' to the page buffer at 'address'
+#define OTA_SPM_ERASE 1
+#define OTA_SPM_WRITE 2                    // page buffer to the page of 'address'
+typedef void (*ota_spm_t)(uint16_t address, uint8_t command, uint16_t data);
+
+#ifdef HOST_BUILD
+// the emulated flash and EEPROM record of sim/hal_host.cpp, the bootloader is linked in
+extern ota_eeprom_t sim_ota_eeprom;
+uint8_t hal_flash_read(uint16_t address);
+void boot_spm(uint16_t address, uint8_t command, uint16_t data);
+#define OTA_EEPROM (&sim_ota_eeprom)
+#define ota_flash_byte(a) hal_flash_read(a)
+#define ota_spm boot_spm
+#else
+#define OTA_EEPROM ((ota_eeprom_t *)(E2END + 1 - sizeof(ota_eeprom_t)))
+#define ota_flash_byte(a) pgm_read_byte((const uint8_t *)(a))
+#define ota_spm ((ota_spm_t)(OTA_BOOT / 2 + 1))
+#endif
+
+// CRC-32 (IEEE, reflected) of one more byte, start with 0xFFFFFFFF and invert the end
+static inline uint32_t ota_crc32(uint32_t crc, uint8_t b)
+{
+  uint8_t i;
+   crc ^= b;
+   for (i = 0; i < 8; i++) crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+   return crc;
+}
+
+#endif
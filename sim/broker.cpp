@@ -0,0 +1,107 @@
+// ---------------------------------------------------------------------------
+// MQTT 3.1.1 broker stand-in of the SIM800L model
+// ---------------------------------------------------------------------------
+#include "broker.h"
+
+namespace sim {
+
+namespace {
+
+// MQTT remaining length, 1-4 bytes of 7 bits, false when 'in' has not all of them yet
+bool remaining_length(const std::string& in, size_t& header, size_t& length) {
+  length = 0;
+  for (size_t i = 1; i < 5; i++) {
+    if (i >= in.size()) return false;
+    uint8_t b = static_cast<uint8_t>(in[i]);
+    length |= static_cast<size_t>(b & 0x7F) << (7 * (i - 1));
+    if ((b & 0x80) == 0) {
+      header = i + 1;
+      return true;
+    }
+  }
+  header = 5;
+  return true;
+}
+
+}  // namespace
+
+void Broker::open() {
+  open_ = true;
+  session_ = false;
+  in_.clear();
+}
+
+void Broker::close() {
+  open_ = false;
+  session_ = false;
+  timing_ = false;
+  pending_ = false;
+  in_.clear();
+}
+
+std::string Broker::receive(const std::string& bytes, bool refuse) {
+  std::string answer;
+  bytes_ += bytes.size();
+  in_ += bytes;
+  for (;;) {
+    size_t header = 0, length = 0;
+    if (in_.empty() || !remaining_length(in_, header, length) || in_.size() < header + length) break;
+    std::string packet = in_.substr(0, header + length);
+    in_.erase(0, header + length);
+    uint8_t type = static_cast<uint8_t>(packet[0]) >> 4;
+    std::string body = packet.substr(header);
+    if (type == 1) {
+      // CONNECT : protocol name "MQTT" and level 4
+      if (body.size() < 10 || body.compare(0, 7, std::string("\0\4MQTT\4", 7)) != 0) {
+        bad_++;
+        answer += std::string("\x20\x02\x00\x01", 4);   // unacceptable protocol version
+        continue;
+      }
+      connects_++;
+      session_ = !refuse;
+      timing_ = false;
+      answer += std::string("\x20\x02\x00", 3) + static_cast<char>(refuse ? 5 : 0);
+    } else if (!session_) {
+      bad_++;
+    } else if (type == 3) {
+      // PUBLISH QoS 0 : topic and payload, no packet identifier
+      if (body.size() < 2) {
+        bad_++;
+        continue;
+      }
+      size_t t = (static_cast<uint8_t>(body[0]) << 8) | static_cast<uint8_t>(body[1]);
+      if (2 + t > body.size()) {
+        bad_++;
+        continue;
+      }
+      publishes_.push_back(Publish{0, body.substr(2, t), body.substr(2 + t), packet.size(), 0});
+      pending_ = true;
+    } else if (type == 12) {
+      pings_++;
+      timing_ = false;
+      answer += std::string("\xD0\x00", 2);
+    } else if (type == 14) {
+      disconnects_++;
+      session_ = false;
+    } else {
+      bad_++;
+    }
+  }
+  return answer;
+}
+
+void Broker::command(vtime now) {
+  if (!session_ || timing_) return;
+  update_start_ = now;
+  timing_ = true;
+}
+
+void Broker::sent(vtime now) {
+  if (!pending_) return;
+  pending_ = false;
+  publishes_.back().at = now;
+  publishes_.back().update = timing_ ? now - update_start_ : 0;
+  timing_ = false;
+}
+
+}  // namespace sim
@@ -0,0 +1,64 @@
+// ---------------------------------------------------------------------------
+// MQTT 3.1.1 broker stand-in behind AT+CIPSTART of the SIM800L model
+// takes the bytes the tracker sends by AT+CIPSEND, answers CONNECT with
+// CONNACK and PINGREQ with PINGRESP, records every PUBLISH (QoS 0) with
+// its size and the time the update took : from the first AT command after
+// the previous position (or CONNACK) to SEND OK of this one
+// only MQTT bytes are counted, TCP/IP and GPRS headers are not modelled
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+
+namespace sim {
+
+class Broker {
+ public:
+  struct Publish {
+    vtime at;            // SEND OK
+    std::string topic;
+    std::string payload;
+    size_t bytes;        // whole MQTT packet
+    vtime update;        // time the update took
+  };
+
+  // new TCP connection, a session starts with CONNECT
+  void open();
+  void close();
+  bool connected() const { return open_; }
+
+  // bytes of one AT+CIPSEND, returns the packets the broker answers with
+  // 'refuse' answers CONNECT with CONNACK code 5 (not authorized)
+  std::string receive(const std::string& bytes, bool refuse);
+
+  // AT command from the MCU at 'now' and SEND OK of the data at 'now'
+  void command(vtime now);
+  void sent(vtime now);
+
+  const std::vector<Publish>& publishes() const { return publishes_; }
+  uint64_t connects() const { return connects_; }
+  uint64_t pings() const { return pings_; }
+  uint64_t disconnects() const { return disconnects_; }
+  uint64_t bytes() const { return bytes_; }
+  uint64_t bad() const { return bad_; }
+
+ private:
+  bool open_ = false;
+  bool session_ = false;       // CONNECT accepted on this connection
+  std::string in_;             // packet split over AT+CIPSEND calls
+  vtime update_start_ = 0;
+  bool timing_ = false;        // update_start_ is set
+  bool pending_ = false;       // PUBLISH waits for its SEND OK
+  std::vector<Publish> publishes_;
+  uint64_t connects_ = 0;
+  uint64_t pings_ = 0;
+  uint64_t disconnects_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t bad_ = 0;           // malformed packets, packets before CONNECT
+};
+
+}  // namespace sim
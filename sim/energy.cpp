@@ -0,0 +1,222 @@
+// ---------------------------------------------------------------------------
+// energy model and battery life estimate of the tracker
+//   energy [-p profile.txt] [-v] trace.txt ...
+//   energy [-p profile.txt] --stats <variant> "SLEEP=86000 AWAKE=300 GPRS=60 SMS=12 NOCOV=0"
+// a trace is written by sim_<variant> --trace, every line "<time> <component>
+// <state>" starts a state that lasts until the next line of the component,
+// "<time> end" closes the trace. --stats takes the seconds per state from the
+// STATS SMS of the firmware instead (versions main / mainb).
+// Current of every component state comes from the profile, the result is
+// mAh per day and days of work on the battery of the profile.
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Variant {
+  std::string mcu;
+  std::string waiting;  // MCU state while waiting for RING
+};
+
+struct Profile {
+  std::map<std::string, double> current;  // "<component> <state>" -> mA
+  std::map<std::string, Variant> variants;
+  double battery = 2500;
+  double usable = 0.8;
+};
+
+// seconds spent in each "<component> <state>"
+using Durations = std::map<std::string, double>;
+
+bool load_profile(const std::string& path, Profile& profile) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::string line;
+  int number = 0;
+  while (std::getline(in, line)) {
+    number++;
+    std::istringstream words(line.substr(0, line.find('#')));
+    std::string key;
+    if (!(words >> key)) continue;
+    bool ok = true;
+    if (key == "current") {
+      std::string component, state;
+      double ma = 0;
+      ok = static_cast<bool>(words >> component >> state >> ma);
+      profile.current[component + " " + state] = ma;
+    } else if (key == "variant") {
+      std::string name;
+      Variant v;
+      ok = static_cast<bool>(words >> name >> v.mcu >> v.waiting);
+      profile.variants[name] = v;
+    } else if (key == "battery") {
+      ok = static_cast<bool>(words >> profile.battery);
+    } else if (key == "usable") {
+      ok = static_cast<bool>(words >> profile.usable);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "%s:%d: bad line\n", path.c_str(), number);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool load_trace(const std::string& path, const Profile& profile, std::string& variant, double& seconds,
+                Durations& durations) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::map<std::string, std::pair<double, std::string>> open;  // component -> start, state
+  std::string line;
+  bool ended = false;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    if (line.compare(0, 2, "# ") == 0) {
+      words.ignore(2);
+      words >> variant;
+      continue;
+    }
+    double t;
+    std::string component, state;
+    if (!(words >> t >> component)) continue;
+    auto mcu = profile.variants.find(variant);
+    if (component == "mcu" && mcu != profile.variants.end()) component = mcu->second.mcu;
+    if (component == "end") {
+      for (const auto& o : open) durations[o.first + " " + o.second.second] += t - o.second.first;
+      seconds = t;
+      ended = true;
+      break;
+    }
+    words >> state;
+    auto it = open.find(component);
+    if (it != open.end()) durations[component + " " + it->second.second] += t - it->second.first;
+    open[component] = std::make_pair(t, state);
+  }
+  if (!ended) {
+    std::fprintf(stderr, "%s: trace has no end line\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// STATS SMS counters as durations, each firmware state is a pair of MCU and SIM800L states
+bool stats_durations(const std::string& text, const Variant& v, double& seconds, Durations& durations) {
+  static const char* const kStates[][3] = {
+      {"SLEEP", nullptr, "sleep"},      {"AWAKE", "active", "idle"}, {"GPRS", "active", "gprs"},
+      {"SMS", "active", "sms"},         {"NOCOV", "active", "radiooff"},
+  };
+  seconds = 0;
+  for (const auto& s : kStates) {
+    std::string key = std::string(" ") + s[0] + "=";
+    size_t p = (" " + text).find(key);
+    if (p == std::string::npos) {
+      std::fprintf(stderr, "STATS text has no %s=\n", s[0]);
+      return false;
+    }
+    double value = std::strtod(text.c_str() + p + key.size() - 1, nullptr);
+    durations[v.mcu + " " + (s[1] ? s[1] : v.waiting)] += value;
+    durations[std::string("sim800l ") + s[2]] += value;
+    seconds += value;
+  }
+  return true;
+}
+
+bool report(const std::string& name, const std::string& variant, double seconds, const Durations& durations,
+            const Profile& profile, bool verbose) {
+  if (seconds <= 0) {
+    std::fprintf(stderr, "%s: empty trace\n", name.c_str());
+    return false;
+  }
+  double mah = 0;
+  bool ok = true;
+  for (const auto& d : durations) {
+    auto c = profile.current.find(d.first);
+    if (c == profile.current.end()) {
+      std::fprintf(stderr, "%s: no current for \"%s\" in profile\n", name.c_str(), d.first.c_str());
+      ok = false;
+      continue;
+    }
+    mah += c->second * d.second / 3600.0;
+  }
+  double per_day = mah * 86400.0 / seconds;
+  double days = per_day > 0 ? profile.battery * profile.usable / per_day : 0;
+  std::printf("%-8s %-32s %10.2f %10.3f %10.2f %10.1f\n", variant.c_str(), name.c_str(), seconds / 3600.0,
+              mah * 3600.0 / seconds, per_day, days);
+  if (verbose) {
+    for (const auto& d : durations) {
+      auto c = profile.current.find(d.first);
+      double ma = c == profile.current.end() ? 0 : c->second;
+      std::printf("         %-24s %12.1f s %9.3f mA %10.3f mAh\n", d.first.c_str(), d.second, ma,
+                  ma * d.second / 3600.0);
+    }
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string profile_path = "energy/profile.txt";
+  std::vector<std::string> traces;
+  std::string stats_variant, stats_text;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc) profile_path = argv[++i];
+    else if (std::strcmp(argv[i], "-v") == 0) verbose = true;
+    else if (std::strcmp(argv[i], "--stats") == 0 && i + 2 < argc) {
+      stats_variant = argv[++i];
+      stats_text = argv[++i];
+    } else traces.push_back(argv[i]);
+  }
+  if (traces.empty() && stats_variant.empty()) {
+    std::fprintf(stderr, "usage: %s [-p profile] [-v] trace.txt ...\n"
+                         "       %s [-p profile] --stats <variant> \"SLEEP=.. AWAKE=.. GPRS=.. SMS=.. NOCOV=..\"\n",
+                 argv[0], argv[0]);
+    return 2;
+  }
+
+  Profile profile;
+  if (!load_profile(profile_path, profile)) return 2;
+
+  std::printf("battery %.0f mAh, %.0f%% usable\n", profile.battery, profile.usable * 100);
+  std::printf("%-8s %-32s %10s %10s %10s %10s\n", "variant", "trace", "hours", "avg mA", "mAh/day", "life days");
+  bool ok = true;
+  if (!stats_variant.empty()) {
+    auto v = profile.variants.find(stats_variant);
+    if (v == profile.variants.end()) {
+      std::fprintf(stderr, "no variant %s in profile\n", stats_variant.c_str());
+      return 2;
+    }
+    double seconds = 0;
+    Durations durations;
+    if (!stats_durations(stats_text, v->second, seconds, durations)) return 2;
+    ok = report("STATS", stats_variant, seconds, durations, profile, verbose) && ok;
+  }
+  for (const std::string& path : traces) {
+    std::string variant = "?";
+    double seconds = 0;
+    Durations durations;
+    if (!load_trace(path, profile, variant, seconds, durations)) {
+      ok = false;
+      continue;
+    }
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    ok = report(name, variant, seconds, durations, profile, verbose) && ok;
+  }
+  return ok ? 0 : 1;
+}
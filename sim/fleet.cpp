@@ -0,0 +1,287 @@
+// ---------------------------------------------------------------------------
+// fleet of trackers against emulated SIM800L modems in virtual time
+//   fleet_<variant> [-n trackers] [-t threads] [-d duration] [-c calls/day]
+//                   [-o outages/day] [-l outage length] [-f locfail%] [-s seed]
+//                   [-v] [profile.scn]
+// every tracker gets its own scenario : settings, latencies and failures of
+// the optional profile, calls from +48123456789 at random (Poisson, first
+// one after 5 minutes), coverage outages (set creg 0 / set creg 1, lengths
+// exponential around -l) and AT+CIPGSMLOC / AT+CLBS failures (set locfail).
+// Trackers run on a work stealing pool (pool.h), each worker thread on its
+// own linked copy of the firmware (fleet.h), so -t is at most the copies
+// linked. The result is the sum over the fleet : SIM800L hours per power
+// state, radio on time (SIM800L awake, not in sleep or radio off), radio
+// active time (search, ring, gprs, sms), message rates and RING to SMS
+// latency, the same for any -t. -v prints one line per tracker.
+// Exit code 1 when a tracker hung
+// ---------------------------------------------------------------------------
+#include <chrono>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fleet.h"
+#include "latency.h"
+#include "pool.h"
+#include "scenario.h"
+#include "sim800l.h"
+#include "world.h"
+
+namespace {
+
+constexpr const char* kCaller = "+48123456789";
+constexpr sim::vtime kDay = 24 * 3600 * sim::kSec;
+constexpr sim::vtime kWarmup = 5 * 60 * sim::kSec;   // registration and setup before the first call
+
+struct Options {
+  unsigned trackers = 100;
+  unsigned threads = 0;              // 0 : every linked copy
+  sim::vtime duration = kDay;
+  double calls = 4;                  // per tracker and day
+  double outages = 0;                // per tracker and day
+  sim::vtime outage = 20 * 60 * sim::kSec;
+  unsigned locfail = 0;              // percent of location queries failing
+  uint32_t seed = 1;
+  bool verbose = false;
+  std::string profile;
+};
+
+struct Result {
+  bool hang = false;
+  std::string why;
+  uint64_t calls = 0;
+  uint64_t answered = 0;
+  uint64_t missed = 0;
+  uint64_t sms = 0;
+  uint64_t nolocation = 0;          // NO LOCATION and LAST KNOWN answers
+  uint64_t locations = 0;           // AT+CIPGSMLOC and AT+CLBS queries
+  uint64_t outages = 0;
+  uint64_t mqtt = 0;
+  uint64_t udp = 0;
+  std::vector<sim::vtime> latencies;   // RING to SMS of delivered calls
+  std::map<std::string, sim::vtime> durations;
+};
+
+// 24h, 20m or 90s like in scenarios
+std::string format_duration(sim::vtime t) {
+  uint64_t s = t / sim::kSec;
+  if (s % 3600 == 0) return std::to_string(s / 3600) + "h";
+  if (s % 60 == 0) return std::to_string(s / 60) + "m";
+  return std::to_string(s) + "s";
+}
+
+// scenario of tracker i, the same for any number of threads
+sim::Scenario tracker_scenario(const Options& o, const sim::Scenario& profile, unsigned i) {
+  sim::Scenario s = profile;
+  s.path = "tracker " + std::to_string(i);
+  s.end = o.duration;
+  s.events.clear();
+  s.expectations.clear();
+  std::seed_seq seq{o.seed, static_cast<uint32_t>(i)};
+  std::mt19937 rng(seq);
+  s.seed = rng();
+  if (o.locfail > 0) s.settings.emplace_back("locfail", std::to_string(o.locfail));
+
+  // calls and outages come in exponential gaps, the rate per day scaled to microseconds
+  if (o.calls > 0) {
+    std::exponential_distribution<double> gap(o.calls / kDay);
+    for (double t = kWarmup + gap(rng); t < o.duration; t += gap(rng))
+      s.events.push_back({static_cast<sim::vtime>(t), "call", kCaller, ""});
+  }
+  if (o.outages > 0) {
+    std::exponential_distribution<double> gap(o.outages / kDay);
+    std::exponential_distribution<double> length(1.0 / o.outage);
+    for (double t = gap(rng); t < o.duration;) {
+      double back = t + length(rng);
+      s.events.push_back({static_cast<sim::vtime>(t), "set", "creg", "0"});
+      if (back < o.duration) s.events.push_back({static_cast<sim::vtime>(back), "set", "creg", "1"});
+      t = back + gap(rng);
+    }
+  }
+  return s;
+}
+
+// one tracker on the firmware copy of this worker, 'state' is the copy's static variables after load
+void run_tracker(const sim::Scenario& scenario, const sim::Firmware& fw, const std::vector<uint8_t>& state,
+                 Result& r) {
+  sim::World world(scenario);
+  sim::Sim800l modem(world);
+  world.durations = &r.durations;
+  world.after_event = [&modem] { modem.trace_power(); };
+  std::memcpy(fw.state, state.data(), fw.state_size);
+  std::jmp_buf stop;
+  sim::hal_attach(&world, &modem, &stop, &fw);
+  world.set_mcu_asleep(false);
+  modem.start();
+  modem.trace_power();
+  if (setjmp(stop) == 0) {
+    fw.main();
+    world.finish(sim::Finish::kEnd, "firmware main() returned");
+  }
+  // sleeping MCU with nothing more to happen stays in its states until the end
+  world.close_durations(world.finished() == sim::Finish::kIdle ? scenario.end : world.now());
+
+  r.hang = world.finished() == sim::Finish::kHang;
+  if (world.finished() != sim::Finish::kEnd && world.finished() != sim::Finish::kIdle) r.why = world.finish_reason();
+  for (const auto& e : scenario.events) {
+    if (e.kind == "call") r.calls++;
+    if (e.kind == "set" && e.text == "0") r.outages++;
+  }
+  r.answered = modem.answered_calls();
+  r.missed = modem.missed_calls();
+  r.sms = modem.sent_sms().size();
+  for (const auto& sms : modem.sent_sms())
+    if (sms.text.find("NO LOCATION") != std::string::npos || sms.text.find("LAST KNOWN") != std::string::npos)
+      r.nolocation++;
+  for (const auto& c : modem.commands())
+    if (c.line.compare(0, 12, "AT+CIPGSMLOC") == 0 || c.line.compare(0, 7, "AT+CLBS") == 0) r.locations++;
+  r.mqtt = modem.broker().publishes().size();
+  r.udp = modem.receiver().reports().size();
+  for (const auto& c : sim::measure_latency(scenario, modem))
+    if (c.delivered) r.latencies.push_back(c.total);
+}
+
+bool parse_count(const char* text, double& value) {
+  char* end;
+  value = std::strtod(text, &end);
+  return *end == 0 && value >= 0;
+}
+
+void usage(const char* self) {
+  std::fprintf(stderr,
+               "usage: %s [-n trackers] [-t threads] [-d duration] [-c calls/day] [-o outages/day]\n"
+               "       [-l outage length] [-f locfail%%] [-s seed] [-v] [profile.scn]\n",
+               self);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool value = i + 1 < argc;
+    double n;
+    if (a == "-n" && value && parse_count(argv[i + 1], n) && n >= 1) o.trackers = static_cast<unsigned>(n), i++;
+    else if (a == "-t" && value && parse_count(argv[i + 1], n) && n >= 1) o.threads = static_cast<unsigned>(n), i++;
+    else if (a == "-d" && value && sim::parse_duration(argv[i + 1], o.duration)) i++;
+    else if (a == "-c" && value && parse_count(argv[i + 1], o.calls)) i++;
+    else if (a == "-o" && value && parse_count(argv[i + 1], o.outages)) i++;
+    else if (a == "-l" && value && sim::parse_duration(argv[i + 1], o.outage) && o.outage > 0) i++;
+    else if (a == "-f" && value && parse_count(argv[i + 1], n) && n <= 100) o.locfail = static_cast<unsigned>(n), i++;
+    else if (a == "-s" && value && parse_count(argv[i + 1], n)) o.seed = static_cast<uint32_t>(n), i++;
+    else if (a == "-v") o.verbose = true;
+    else if (a[0] != '-' && o.profile.empty()) o.profile = a;
+    else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  sim::Scenario profile;
+  std::string error;
+  if (!o.profile.empty() && !profile.load(o.profile, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+
+  // copies linked into this binary and the state of each after load, restored before every tracker
+  unsigned slots = 0;
+  while (slots < sim::kFleetSlots && sim::kFleetFirmware[slots].main != nullptr) slots++;
+  if (slots == 0) {
+    std::fprintf(stderr, "no firmware copy linked\n");
+    return 2;
+  }
+  if (o.threads == 0) o.threads = slots;
+  if (o.threads > slots) {
+    std::fprintf(stderr, "-t %u : only %u firmware copies linked (FLEET_SLOTS)\n", o.threads, slots);
+    return 2;
+  }
+  std::vector<std::vector<uint8_t>> loaded(slots);
+  for (unsigned k = 0; k < slots; k++)
+    loaded[k].assign(sim::kFleetFirmware[k].state, sim::kFleetFirmware[k].state + sim::kFleetFirmware[k].state_size);
+
+  std::vector<Result> results(o.trackers);
+  sim::Pool pool(o.threads);
+  auto started = std::chrono::steady_clock::now();
+  pool.run(o.trackers, [&](unsigned worker, unsigned i) {
+    run_tracker(tracker_scenario(o, profile, i), sim::kFleetFirmware[worker], loaded[worker], results[i]);
+  });
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  // sums in tracker order, independent of which worker ran what
+  Result total;
+  unsigned hangs = 0;
+  for (unsigned i = 0; i < o.trackers; i++) {
+    const Result& r = results[i];
+    if (o.verbose || !r.why.empty())
+      std::printf("tracker %u : calls %llu answered %llu missed %llu SMS %llu no location %llu outages %llu%s%s\n", i,
+                  static_cast<unsigned long long>(r.calls), static_cast<unsigned long long>(r.answered),
+                  static_cast<unsigned long long>(r.missed), static_cast<unsigned long long>(r.sms),
+                  static_cast<unsigned long long>(r.nolocation), static_cast<unsigned long long>(r.outages),
+                  r.why.empty() ? "" : " : ", r.why.c_str());
+    hangs += r.hang ? 1 : 0;
+    total.calls += r.calls;
+    total.answered += r.answered;
+    total.missed += r.missed;
+    total.sms += r.sms;
+    total.nolocation += r.nolocation;
+    total.locations += r.locations;
+    total.outages += r.outages;
+    total.mqtt += r.mqtt;
+    total.udp += r.udp;
+    total.latencies.insert(total.latencies.end(), r.latencies.begin(), r.latencies.end());
+    for (const auto& d : r.durations) total.durations[d.first] += d.second;
+  }
+
+  double days = static_cast<double>(o.trackers) * o.duration / kDay;
+  double hours = days * 24;
+  std::printf("fleet %s : %u trackers x %s, calls %.2f/day, outages %.2f/day of %s, locfail %u%%, seed %u%s%s\n",
+              sim::kVariant, o.trackers, format_duration(o.duration).c_str(), o.calls, o.outages,
+              format_duration(o.outage).c_str(), o.locfail, o.seed, o.profile.empty() ? "" : ", profile ",
+              o.profile.c_str());
+  std::printf("  SIM800L state    hours total   min/tracker-day\n");
+  sim::vtime radio_on = 0, radio_active = 0;
+  for (const auto& d : total.durations) {
+    if (d.first.compare(0, 8, "sim800l ") != 0) continue;
+    std::string state = d.first.substr(8);
+    double h = static_cast<double>(d.second) / (3600 * sim::kSec);
+    std::printf("  %-16s %11.2f %17.2f\n", state.c_str(), h, h * 60 / days);
+    if (state != "sleep" && state != "radiooff") radio_on += d.second;
+    if (state == "search" || state == "ring" || state == "gprs" || state == "sms") radio_active += d.second;
+  }
+  double on = static_cast<double>(radio_on) / (3600 * sim::kSec);
+  double active = static_cast<double>(radio_active) / (3600 * sim::kSec);
+  std::printf("  radio on         %11.2f %17.2f\n", on, on * 60 / days);
+  std::printf("  radio active     %11.2f %17.2f   search ring gprs sms\n", active, active * 60 / days);
+  auto mcu = total.durations.find("mcu active");
+  double awake = mcu == total.durations.end() ? 0 : static_cast<double>(mcu->second) / (3600 * sim::kSec);
+  std::printf("  MCU active       %11.2f %17.2f\n", awake, awake * 60 / days);
+  auto rate = [hours](uint64_t n) { return static_cast<double>(n) / hours; };
+  std::printf("  per tracker-hour : calls %.4f answered %.4f missed %.4f SMS %.4f no location %.4f location queries %.4f"
+              " MQTT %.4f UDP %.4f\n",
+              rate(total.calls), rate(total.answered), rate(total.missed), rate(total.sms), rate(total.nolocation),
+              rate(total.locations), rate(total.mqtt), rate(total.udp));
+  std::printf("  fleet per hour : calls %.1f SMS %.1f location queries %.1f MQTT %.1f UDP %.1f\n",
+              rate(total.calls) * o.trackers, rate(total.sms) * o.trackers, rate(total.locations) * o.trackers,
+              rate(total.mqtt) * o.trackers, rate(total.udp) * o.trackers);
+  std::printf("  totals : calls %llu answered %llu missed %llu SMS %llu no location %llu outages %llu hangs %u\n",
+              static_cast<unsigned long long>(total.calls), static_cast<unsigned long long>(total.answered),
+              static_cast<unsigned long long>(total.missed), static_cast<unsigned long long>(total.sms),
+              static_cast<unsigned long long>(total.nolocation), static_cast<unsigned long long>(total.outages), hangs);
+  if (!total.latencies.empty())
+    std::printf("  RING to SMS : %zu delivered, p50 %s s p95 %s s\n", total.latencies.size(),
+                sim::format_time(sim::percentile(total.latencies, 50)).c_str(),
+                sim::format_time(sim::percentile(total.latencies, 95)).c_str());
+  std::printf("run : %.2f s wall on %u threads, %.1f tracker-days/s\n", wall, o.threads, days / wall);
+  for (unsigned w = 0; w < o.threads; w++)
+    std::printf("  worker %u : %llu trackers, %llu stolen\n", w,
+                static_cast<unsigned long long>(pool.stats()[w].items),
+                static_cast<unsigned long long>(pool.stats()[w].steals));
+  return hangs > 0 ? 1 : 0;
+}
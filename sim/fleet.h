@@ -0,0 +1,18 @@
+// ---------------------------------------------------------------------------
+// firmware copies of the fleet build (fleet_slots.cpp) : the firmware keeps
+// its state in static variables like on the MCU, so every worker thread runs
+// its trackers one after another on its own copy, the copy's static
+// variables are put back to the state after load before each tracker
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include "hal_host.h"
+
+namespace sim {
+
+constexpr unsigned kFleetSlots = 32;
+
+// main is null for copies the Makefile did not link (FLEET_SLOTS)
+extern const Firmware kFleetFirmware[kFleetSlots];
+
+}  // namespace sim
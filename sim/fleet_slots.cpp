@@ -0,0 +1,37 @@
+// ---------------------------------------------------------------------------
+// copies of the firmware linked into the fleet build, see Makefile : copy n
+// is build/fleet_copy<n>.o with firmware_main renamed to fleet_main_<n>, the
+// interrupt handlers to fleet_<vector>_<n> and its sections to
+// fleet_state_<n> / fleet_eeprom_<n>, every other symbol local to the copy.
+// The references are weak, copies not linked stay null
+// ---------------------------------------------------------------------------
+#include "fleet.h"
+
+#define FLEET_SLOT(n)                                                                                \
+  extern "C" int fleet_main_##n(void) __attribute__((weak));                                         \
+  extern "C" void fleet_INT0_vect_##n(void) __attribute__((weak));                                   \
+  extern "C" void fleet_WDT_vect_##n(void) __attribute__((weak));                                    \
+  extern "C" void fleet_USART_RX_vect_##n(void) __attribute__((weak));                               \
+  extern "C" uint8_t __start_fleet_state_##n[] __attribute__((weak));                                \
+  extern "C" uint8_t __stop_fleet_state_##n[] __attribute__((weak));                                 \
+  extern "C" uint8_t __start_fleet_eeprom_##n[] __attribute__((weak));                               \
+  extern "C" uint8_t __stop_fleet_eeprom_##n[] __attribute__((weak));
+
+#define FLEET_FIRMWARE(n)                                                                            \
+  {fleet_main_##n, fleet_INT0_vect_##n, fleet_WDT_vect_##n, fleet_USART_RX_vect_##n,                 \
+   __start_fleet_state_##n, static_cast<size_t>(__stop_fleet_state_##n - __start_fleet_state_##n),   \
+   __start_fleet_eeprom_##n, static_cast<size_t>(__stop_fleet_eeprom_##n - __start_fleet_eeprom_##n)},
+
+#define FLEET_SLOTS(X)                                                                               \
+  X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) \
+  X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) \
+  X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) \
+  X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+
+namespace sim {
+
+FLEET_SLOTS(FLEET_SLOT)
+
+const Firmware kFleetFirmware[kFleetSlots] = {FLEET_SLOTS(FLEET_FIRMWARE)};
+
+}  // namespace sim
@@ -0,0 +1,36 @@
+/* ---------------------------------------------------------------------------
+ * hardware abstraction seam between tracker firmware and the PC
+ * when the firmware is compiled with -DHOST_BUILD the busy loops on UART
+ * registers and the ASM delay loops call these functions instead,
+ * they move virtual time of the SIM800L emulator forward
+ * ---------------------------------------------------------------------------
+ */
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hal_uart_tx(uint8_t c);          // send byte to SIM800L, takes 1 byte time at 9600 bps
+uint8_t hal_uart_rx(void);            // wait for byte from SIM800L like polling RXC flag
+uint8_t hal_uart_ready(void);         // RXC flag, byte from SIM800L waits to be read
+uint16_t hal_stack_free(void);        // stack high-water mark is not measured on PC
+void hal_idle(void);                  // busy loop waiting for an interrupt, until next event
+void hal_delay_us(uint32_t us);       // busy wait
+uint8_t hal_pind(void);               // PIND register, PD2 is RI/RING of SIM800L
+void hal_set_sleep_mode(uint8_t mode);
+void hal_sleep_cpu(void);             // sleep until INT0 (RI low) or watchdog interrupt
+uint8_t hal_flash_read(uint16_t address);   // emulated flash of ATMEGA328P (FEATURE_OTA)
+void hal_flash_erase(uint16_t address);
+void hal_flash_fill(uint16_t address, uint16_t data);
+void hal_flash_write(uint16_t address);
+void hal_reboot(void);                // watchdog reset : the bootloader runs, then the scenario ends
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
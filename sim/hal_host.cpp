@@ -0,0 +1,293 @@
+// ---------------------------------------------------------------------------
+// PC side of the hardware abstraction seam - AVR registers, UART, delays,
+// POWERDOWN sleep with INT0 and watchdog wakeup, EEPROM erased at start,
+// flash and SPM for the firmware update and the bootloader (FEATURE_OTA)
+// compiled once per firmware variant because register bits differ
+// between ATMEGA328P and ATTINY2313. In the fleet build (SIM_FLEET) every
+// worker thread runs one copy of the firmware at a time : the registers and
+// the state here are thread local and the firmware is the one attached
+// ---------------------------------------------------------------------------
+#include <avr/io.h>
+#include <avr/sleep.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../ota.h"
+#include "hal_host.h"
+#include "sim800l.h"
+#include "world.h"
+
+extern "C" {
+
+SIM_REGISTER volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+SIM_REGISTER volatile uint8_t UCSRA, UCSRB, UCSRC, UBRRH, UBRRL, UDR;
+SIM_REGISTER volatile uint8_t DDRB, PORTB, DDRD, PORTD;
+SIM_REGISTER volatile uint8_t EICRA, EIMSK, MCUCR, GIMSK;
+SIM_REGISTER volatile uint8_t WDTCSR, WDTCR, MCUSR, SMCR;
+SIM_REGISTER volatile uint8_t SPH, SPL, SREG;
+
+#ifndef SIM_FLEET
+// interrupt handlers defined by the firmware with ISR()
+void INT0_vect(void) __attribute__((weak));
+void WDT_vect(void) __attribute__((weak));
+void USART_RX_vect(void) __attribute__((weak));
+
+// EEMEM section boundaries provided by the linker
+extern uint8_t __start_eeprom[] __attribute__((weak));
+extern uint8_t __stop_eeprom[] __attribute__((weak));
+
+// bootloader boot.c, linked to the ATMEGA328P variants
+void boot_update(void) __attribute__((weak));
+
+// update record of the bootloader at the end of EEPROM
+ota_eeprom_t sim_ota_eeprom;
+#endif
+}
+
+namespace {
+
+thread_local sim::World* g_world = nullptr;
+thread_local sim::Sim800l* g_modem = nullptr;
+thread_local std::jmp_buf* g_stop = nullptr;
+thread_local const sim::Firmware* g_firmware = nullptr;
+thread_local uint8_t g_sleep_mode = 0;
+
+// leave the firmware when scenario has finished, no C++ objects live in these frames
+void stop_if_finished() {
+  if (g_world->finished() != sim::Finish::kRunning) std::longjmp(*g_stop, 1);
+}
+
+bool int0_enabled() {
+#if defined(__AVR_ATmega328P__)
+  return EIMSK & (1 << INT0);
+#else
+  return GIMSK & (1 << INT0);
+#endif
+}
+
+// watchdog interrupt period, 0 when watchdog interrupt is disabled
+sim::vtime wdt_period() {
+#if defined(__AVR_ATmega328P__)
+  uint8_t wdt = WDTCSR;
+#else
+  uint8_t wdt = WDTCR;
+#endif
+  if (!(wdt & (1 << WDIE))) return 0;
+  uint8_t prescaler = (wdt & 0x07) | ((wdt & (1 << WDP3)) ? 0x08 : 0);
+  return (16 * sim::kMsec) << prescaler;
+}
+
+#ifndef SIM_FLEET
+// flash of ATMEGA328P with the application of the scenario and SPM page buffer, the fleet runs
+// no variant with FEATURE_OTA
+constexpr size_t kFlashSize = 0x8000;
+uint8_t g_flash[kFlashSize];
+uint8_t g_page[OTA_PAGE];
+uint64_t g_flash_writes = 0;
+long g_erases = 0;
+long g_cut_after = 0;  // page erases of the bootloader until the power fails, 0 none
+std::jmp_buf g_cut;
+#endif
+
+bool rx_interrupt_enabled() {
+#if defined(__AVR_ATmega328P__)
+  return UCSR0B & (1 << RXCIE0);
+#else
+  return UCSRB & (1 << RXCIE);
+#endif
+}
+
+}  // namespace
+
+namespace sim {
+
+const char* const kVariant = SIM_VARIANT;
+
+void hal_attach(World* world, Sim800l* modem, std::jmp_buf* stop, const Firmware* firmware) {
+  g_world = world;
+  g_modem = modem;
+  g_stop = stop;
+  g_firmware = firmware;
+  g_sleep_mode = 0;
+  world->on_rx = [] {
+    if (rx_interrupt_enabled() && g_firmware->usart_rx != nullptr) g_firmware->usart_rx();
+  };
+  // registers are cleared at reset, EEPROM is erased like a new chip
+  UCSR0A = UCSR0B = UCSR0C = UBRR0H = UBRR0L = UDR0 = 0;
+  UCSRA = UCSRB = UCSRC = UBRRH = UBRRL = UDR = 0;
+  DDRB = PORTB = DDRD = PORTD = 0;
+  EICRA = EIMSK = MCUCR = GIMSK = 0;
+  WDTCSR = WDTCR = MCUSR = SMCR = 0;
+  if (firmware->eeprom != nullptr) std::memset(firmware->eeprom, 0xFF, firmware->eeprom_size);
+#ifndef SIM_FLEET
+  std::memset(&sim_ota_eeprom, 0xFF, sizeof(sim_ota_eeprom));
+  std::memset(g_flash, 0xFF, sizeof(g_flash));
+  std::memset(g_page, 0xFF, sizeof(g_page));
+  const std::vector<uint8_t>& app = world->scenario().flash;
+  std::memcpy(g_flash, app.data(), std::min(app.size(), sizeof(g_flash)));
+  g_flash_writes = 0;
+#endif
+}
+
+#ifndef SIM_FLEET
+void hal_attach(World* world, Sim800l* modem, std::jmp_buf* stop) {
+  static const Firmware firmware = {
+      firmware_main, INT0_vect, WDT_vect, USART_RX_vect, nullptr, 0, __start_eeprom,
+      __start_eeprom != nullptr ? static_cast<size_t>(__stop_eeprom - __start_eeprom) : 0};
+  hal_attach(world, modem, stop, &firmware);
+}
+
+const uint8_t* flash_memory() { return g_flash; }
+
+uint64_t flash_writes() { return g_flash_writes; }
+
+uint8_t ota_result() { return sim_ota_eeprom.result; }
+#endif
+
+}  // namespace sim
+
+extern "C" {
+
+void hal_uart_tx(uint8_t c) {
+  g_world->advance_to(g_world->now() + sim::kByteTime);
+  stop_if_finished();
+  g_modem->receive(c);
+}
+
+uint8_t hal_uart_rx(void) {
+  for (;;) {
+    if (g_world->rx_available()) return g_world->rx_pop();
+    sim::vtime t;
+    if (!g_world->next_activity(t))
+      g_world->finish(sim::Finish::kHang, "firmware waits for UART but SIM800L has nothing more to send");
+    else
+      g_world->advance_to(t);
+    stop_if_finished();
+  }
+}
+
+uint8_t hal_uart_ready(void) { return g_world->rx_available() ? 1 : 0; }
+
+// stack of the PC is not the AVR stack, whole RAM is reported free, real value is checked by bench/
+uint16_t hal_stack_free(void) { return RAMEND; }
+
+void hal_idle(void) {
+  sim::vtime t;
+  if (!g_world->next_activity(t))
+    g_world->finish(sim::Finish::kHang, "firmware waits for interrupt but SIM800L has nothing more to send");
+  else
+    g_world->advance_to(t);
+  stop_if_finished();
+}
+
+void hal_delay_us(uint32_t us) {
+  g_world->advance_to(g_world->now() + us);
+  stop_if_finished();
+}
+
+uint8_t hal_pind(void) { return g_modem->ri_low() ? static_cast<uint8_t>(~(1 << PD2)) : 0xFF; }
+
+void hal_set_sleep_mode(uint8_t mode) { g_sleep_mode = mode; }
+
+#ifndef SIM_FLEET
+uint8_t hal_flash_read(uint16_t address) { return g_flash[address % kFlashSize]; }
+
+// a power cut of the scenario leaves the page erased
+void hal_flash_erase(uint16_t address) {
+  std::memset(g_flash + address % kFlashSize / OTA_PAGE * OTA_PAGE, 0xFF, OTA_PAGE);
+  if (g_cut_after != 0 && ++g_erases == g_cut_after) std::longjmp(g_cut, 1);
+}
+
+void hal_flash_fill(uint16_t address, uint16_t data) {
+  g_page[address % OTA_PAGE & ~1] = static_cast<uint8_t>(data);
+  g_page[address % OTA_PAGE | 1] = static_cast<uint8_t>(data >> 8);
+}
+
+// programming only clears bits, the page buffer is erased after the write
+void hal_flash_write(uint16_t address) {
+  uint8_t* page = g_flash + address % kFlashSize / OTA_PAGE * OTA_PAGE;
+  for (size_t i = 0; i < OTA_PAGE; i++) page[i] &= g_page[i];
+  std::memset(g_page, 0xFF, sizeof(g_page));
+  g_flash_writes++;
+}
+
+// the watchdog reset after a downloaded update starts the bootloader, the power cut of the
+// scenario stops it and it runs again from the start at the next power on - the application
+// would start again, the scenario ends here
+void hal_reboot(void) {
+  if (boot_update != nullptr) {
+    g_cut_after = g_world->scenario().powercut;
+    g_erases = 0;
+    if (setjmp(g_cut) != 0) {
+      g_cut_after = 0;
+      g_world->log("MCU", "power cut in the bootloader, power on again");
+    }
+    boot_update();
+    g_cut_after = 0;
+  }
+  g_world->finish(sim::Finish::kEnd, "watchdog reset, bootloader update result " +
+                                         std::to_string(sim_ota_eeprom.result));
+  std::longjmp(*g_stop, 1);
+}
+#endif
+
+void hal_sleep_cpu(void) {
+  sim::vtime wdt = wdt_period();
+  sim::vtime wdt_due = g_world->now() + wdt;
+  // UART receiver has no clock in POWERDOWN, bytes sent now are lost
+  g_world->set_mcu_asleep(g_sleep_mode == SLEEP_MODE_PWR_DOWN);
+  for (;;) {
+    if (int0_enabled() && g_modem->ri_low()) {
+      g_world->set_mcu_asleep(false);
+      if (g_firmware->int0 != nullptr) g_firmware->int0();
+      return;
+    }
+    sim::vtime t;
+    bool any = g_world->next_activity(t);
+    if (wdt != 0 && (!any || wdt_due <= t)) {
+      g_world->advance_to(wdt_due);
+      g_world->set_mcu_asleep(false);
+      stop_if_finished();
+      if (g_firmware->wdt != nullptr) g_firmware->wdt();
+      return;
+    }
+    if (!any) g_world->finish(sim::Finish::kIdle, "MCU sleeps and nothing more will happen");
+    else g_world->advance_to(t);
+    stop_if_finished();
+  }
+}
+
+// avr-libc number conversion extensions used by the firmware
+char* ultoa(unsigned long value, char* s, int radix) {
+  char digits[34];
+  int n = 0;
+  do {
+    unsigned long d = value % static_cast<unsigned long>(radix);
+    digits[n++] = static_cast<char>(d < 10 ? '0' + d : 'a' + d - 10);
+    value /= static_cast<unsigned long>(radix);
+  } while (value != 0);
+  for (int i = 0; i < n; i++) s[i] = digits[n - 1 - i];
+  s[n] = 0;
+  return s;
+}
+
+char* ltoa(long value, char* s, int radix) {
+  if (value < 0 && radix == 10) {
+    s[0] = '-';
+    ultoa(static_cast<unsigned long>(-value), s + 1, radix);
+    return s;
+  }
+  return ultoa(static_cast<unsigned long>(value), s, radix);
+}
+
+char* utoa(unsigned int value, char* s, int radix) { return ultoa(value, s, radix); }
+
+char* itoa(int value, char* s, int radix) { return ltoa(value, s, radix); }
+
+}  // extern "C"
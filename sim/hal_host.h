@@ -0,0 +1,45 @@
+// ---------------------------------------------------------------------------
+// connects the firmware seam functions of hal.h to the emulated world
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+
+namespace sim {
+
+class World;
+class Sim800l;
+
+// name of firmware variant linked into this binary (main, mainb, main3, main3b)
+extern const char* const kVariant;
+
+// one linked copy of the firmware : entry, interrupt handlers (null when the firmware
+// has none), its static variables and EEMEM variables
+struct Firmware {
+  int (*main)(void);
+  void (*int0)(void);
+  void (*wdt)(void);
+  void (*usart_rx)(void);
+  uint8_t* state;
+  size_t state_size;
+  uint8_t* eeprom;
+  size_t eeprom_size;
+};
+
+// must be called before firmware_main(), longjmp to 'stop' ends the run
+void hal_attach(World* world, Sim800l* modem, std::jmp_buf* stop);
+// the same for a copy of the firmware in the fleet build, on the thread that runs it
+void hal_attach(World* world, Sim800l* modem, std::jmp_buf* stop, const Firmware* firmware);
+
+// emulated flash of ATMEGA328P, page writes of the firmware and the bootloader, result of the
+// last update in the EEPROM record of the bootloader (FEATURE_OTA, see ../ota.h)
+const uint8_t* flash_memory();
+uint64_t flash_writes();
+uint8_t ota_result();
+
+}  // namespace sim
+
+// tracker main() renamed by -Dmain=firmware_main in the native build
+extern "C" int firmware_main(void);
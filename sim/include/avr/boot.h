@@ -0,0 +1,14 @@
+/* host replacement of avr-libc <avr/boot.h> - SPM of the bootloader goes to
+ * the emulated flash and page buffer of hal_host.cpp, it is never busy */
+#ifndef SIM_AVR_BOOT_H
+#define SIM_AVR_BOOT_H
+
+#include "hal.h"
+
+#define boot_page_erase(address)      hal_flash_erase(address)
+#define boot_page_fill(address, data) hal_flash_fill((address), (data))
+#define boot_page_write(address)      hal_flash_write(address)
+#define boot_rww_enable()             ((void)0)
+#define boot_spm_busy_wait()          ((void)0)
+
+#endif
@@ -0,0 +1,19 @@
+/* host replacement of avr-libc <avr/eeprom.h> - EEMEM variables live in a
+ * separate section which is erased to 0xFF at start like a new chip */
+#ifndef SIM_AVR_EEPROM_H
+#define SIM_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define EEMEM __attribute__((section("eeprom")))
+
+#define eeprom_read_block(dst, src, n)   memcpy((dst), (src), (n))
+#define eeprom_update_block(src, dst, n) memcpy((dst), (src), (n))
+#define eeprom_write_block(src, dst, n)  memcpy((dst), (src), (n))
+#define eeprom_read_byte(addr)           (*(const uint8_t *)(addr))
+#define eeprom_update_byte(addr, value)  (*(uint8_t *)(addr) = (value))
+#define eeprom_read_word(addr)           (*(const uint16_t *)(addr))
+#define eeprom_update_word(addr, value)  (*(uint16_t *)(addr) = (value))
+
+#endif
@@ -0,0 +1,15 @@
+/* host replacement of avr-libc <avr/interrupt.h> - ISR bodies become plain
+ * functions called by the emulator when the MCU wakes up from sleep_cpu() */
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+#ifdef __cplusplus
+#define ISR(vector) extern "C" void vector(void)
+#else
+#define ISR(vector) void vector(void)
+#endif
+
+#define cli() ((void)0)
+#define sei() ((void)0)
+
+#endif
@@ -0,0 +1,92 @@
+/* ---------------------------------------------------------------------------
+ * host replacement of avr-libc <avr/io.h> for native build against the
+ * SIM800L emulator - registers are plain variables defined in hal_host.cpp,
+ * PIND is read from emulated RI/RING line of SIM800L
+ * target is selected the same way as avr-gcc -mmcu does it
+ * in the fleet build (SIM_FLEET) every worker thread runs its own MCU, so the
+ * registers are thread local
+ * ---------------------------------------------------------------------------
+ */
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+#include "hal.h"
+
+#ifdef SIM_FLEET
+#define SIM_REGISTER __thread
+#else
+#define SIM_REGISTER
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern SIM_REGISTER volatile uint8_t UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+extern SIM_REGISTER volatile uint8_t UCSRA, UCSRB, UCSRC, UBRRH, UBRRL, UDR;
+extern SIM_REGISTER volatile uint8_t DDRB, PORTB, DDRD, PORTD;
+extern SIM_REGISTER volatile uint8_t EICRA, EIMSK, MCUCR, GIMSK;
+extern SIM_REGISTER volatile uint8_t WDTCSR, WDTCR, MCUSR, SMCR;
+extern SIM_REGISTER volatile uint8_t SPH, SPL, SREG;
+
+#ifdef __cplusplus
+}
+#endif
+
+#define PIND (hal_pind())
+
+#define _BV(bit) (1 << (bit))
+
+#define PD2     2
+#define DDD2    2
+#define PORTD2  2
+
+#define WDP0    0
+#define WDP1    1
+#define WDP2    2
+#define WDE     3
+#define WDCE    4
+#define WDP3    5
+#define WDIE    6
+#define WDRF    3
+
+#if defined(__AVR_ATmega328P__)
+
+#define RXC0    7
+#define UDRE0   5
+#define U2X0    1
+#define RXCIE0  7
+#define RXEN0   4
+#define TXEN0   3
+#define UCSZ01  2
+#define UCSZ00  1
+#define ISC01   1
+#define ISC00   0
+#define INT0    0
+#define RAMSTART 0x100
+#define RAMEND   0x8FF
+
+#elif defined(__AVR_ATtiny2313__)
+
+#define RXC     7
+#define UDRE    5
+#define U2X     1
+#define RXCIE   7
+#define RXEN    4
+#define TXEN    3
+#define USBS    3
+#define UCSZ1   2
+#define UCSZ0   1
+#define ISC01   1
+#define ISC00   0
+#define INT0    6
+#define WDTIE   WDIE
+#define RAMSTART 0x60
+#define RAMEND   0xDF
+
+#else
+#error "define __AVR_ATmega328P__ or __AVR_ATtiny2313__ for the native build"
+#endif
+
+#endif
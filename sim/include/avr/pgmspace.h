@@ -0,0 +1,26 @@
+/* host replacement of avr-libc <avr/pgmspace.h> - flash and RAM share one address space on PC */
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)   (*(void * const *)(addr))
+
+#define memcpy_P      memcpy
+#define memcmp_P      memcmp
+#define strlen_P      strlen
+#define strcpy_P      strcpy
+#define strncmp_P     strncmp
+#define strncasecmp_P strncasecmp
+#define strstr_P      strstr
+
+#endif
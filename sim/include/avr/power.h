@@ -0,0 +1,4 @@
+/* host replacement of avr-libc <avr/power.h> - nothing to switch off on PC */
+#ifndef SIM_AVR_POWER_H
+#define SIM_AVR_POWER_H
+#endif
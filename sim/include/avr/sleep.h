@@ -0,0 +1,16 @@
+/* host replacement of avr-libc <avr/sleep.h> - sleep_cpu() lets virtual time
+ * run until RI/RING goes low (INT0) or the watchdog interrupt is due */
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+
+#include "hal.h"
+
+#define SLEEP_MODE_IDLE     0
+#define SLEEP_MODE_PWR_DOWN 2
+
+#define set_sleep_mode(mode) hal_set_sleep_mode(mode)
+#define sleep_enable()       ((void)0)
+#define sleep_disable()      ((void)0)
+#define sleep_cpu()          hal_sleep_cpu()
+
+#endif
@@ -0,0 +1,10 @@
+/* host replacement of avr-libc <avr/wdt.h> */
+#ifndef SIM_AVR_WDT_H
+#define SIM_AVR_WDT_H
+
+#include <avr/io.h>
+
+#define wdt_reset()   ((void)0)
+#define wdt_disable() (WDTCSR = 0, WDTCR = 0)
+
+#endif
@@ -0,0 +1,10 @@
+/* host replacement of avr-libc <util/delay.h> */
+#ifndef SIM_UTIL_DELAY_H
+#define SIM_UTIL_DELAY_H
+
+#include "hal.h"
+
+#define _delay_ms(ms) hal_delay_us((uint32_t)((ms) * 1000UL))
+#define _delay_us(us) hal_delay_us((uint32_t)(us))
+
+#endif
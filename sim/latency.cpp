@@ -0,0 +1,109 @@
+// ---------------------------------------------------------------------------
+// RING to SMS latency per call and phase
+// ---------------------------------------------------------------------------
+#include "latency.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace sim {
+
+namespace {
+
+struct Phase {
+  const char* name;
+  const char* until;  // first command of the next phase, nullptr = SMS sent
+};
+const Phase kPhases[] = {
+    {"wakeup", "ATH"},
+    {"hangup", "AT+SAPBR=0"},
+    {"sapbrclose", "AT+SAPBR=3"},
+    {"provision", "AT+SAPBR=1"},
+    {"sapbropen", "AT+SAPBR=2"},
+    {"cbc", "AT+CIPGSMLOC"},
+    {"cipgsmloc", "AT+CMGS"},
+    {"sms", nullptr},
+};
+
+double seconds(vtime t) { return static_cast<double>(t) / kSec; }
+
+}  // namespace
+
+const std::vector<std::string>& latency_phases() {
+  static const std::vector<std::string> names = [] {
+    std::vector<std::string> n;
+    for (const Phase& p : kPhases) n.push_back(p.name);
+    return n;
+  }();
+  return names;
+}
+
+std::vector<CallLatency> measure_latency(const Scenario& scenario, const Sim800l& modem) {
+  std::vector<vtime> calls;
+  std::vector<std::string> callers;
+  for (const Event& e : scenario.events) {
+    if (e.kind != "call" || e.at >= scenario.end) continue;
+    calls.push_back(e.at);
+    callers.push_back(e.arg);
+  }
+
+  std::vector<CallLatency> result;
+  for (size_t i = 0; i < calls.size(); i++) {
+    CallLatency c;
+    c.call = calls[i];
+    vtime next = i + 1 < calls.size() ? calls[i + 1] : scenario.end;
+    vtime sent = 0;
+    for (const auto& sms : modem.sent_sms()) {
+      if (sms.at > c.call && sms.at <= next && sms.to == callers[i]) {
+        sent = sms.at;
+        c.delivered = true;
+        break;
+      }
+    }
+    if (c.delivered) {
+      c.total = sent - c.call;
+      vtime from = c.call;
+      for (const Phase& p : kPhases) {
+        vtime until = sent;
+        if (p.until != nullptr) {
+          until = from;
+          std::string prefix(p.until);
+          for (const auto& cmd : modem.commands()) {
+            if (cmd.at >= from && cmd.at <= sent && cmd.line.compare(0, prefix.size(), prefix) == 0) {
+              until = cmd.at;
+              break;
+            }
+          }
+        }
+        c.phases.push_back(until - from);
+        from = until;
+      }
+    }
+    result.push_back(c);
+  }
+  return result;
+}
+
+vtime percentile(std::vector<vtime> values, int p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  size_t rank = (values.size() * static_cast<size_t>(p) + 99) / 100;
+  return values[rank == 0 ? 0 : rank - 1];
+}
+
+void print_latency(const std::vector<CallLatency>& calls) {
+  size_t delivered = 0;
+  for (const CallLatency& c : calls) delivered += c.delivered;
+  std::printf("  RING to SMS latency : %zu calls, %zu answered by SMS\n", calls.size(), delivered);
+  std::printf("  %-12s %9s %9s %9s\n", "phase", "p50 [s]", "p95 [s]", "max [s]");
+  const auto& names = latency_phases();
+  for (size_t i = 0; i <= names.size(); i++) {
+    std::vector<vtime> v;
+    for (const CallLatency& c : calls)
+      if (c.delivered) v.push_back(i < names.size() ? c.phases[i] : c.total);
+    std::printf("  %-12s %9.2f %9.2f %9.2f\n", i < names.size() ? names[i].c_str() : "total",
+                seconds(percentile(v, 50)), seconds(percentile(v, 95)), seconds(percentile(v, 100)));
+  }
+}
+
+}  // namespace sim
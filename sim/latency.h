@@ -0,0 +1,37 @@
+// ---------------------------------------------------------------------------
+// RING to SMS latency of every call of a scenario, split into phases by the
+// first AT command of the next phase sent after the call :
+//   wakeup      RING until ATH (RI noticed, SIM800L woken up)
+//   hangup      ATH until AT+SAPBR=0
+//   sapbrclose  AT+SAPBR=0 until AT+SAPBR=3
+//   provision   AT+SAPBR=3 until AT+SAPBR=1
+//   sapbropen   AT+SAPBR=1 until AT+SAPBR=2 (bearer setup and fixed wait)
+//   cbc         AT+SAPBR=2 until AT+CIPGSMLOC (bearer check, battery)
+//   cipgsmloc   AT+CIPGSMLOC until AT+CMGS
+//   sms         AT+CMGS until SMS sent (+CMGS)
+// a phase whose command is not used by the variant takes 0 time
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+#include "sim800l.h"
+
+namespace sim {
+
+struct CallLatency {
+  vtime call = 0;
+  bool delivered = false;   // SMS to the caller sent before the next call
+  vtime total = 0;
+  std::vector<vtime> phases;
+};
+
+const std::vector<std::string>& latency_phases();
+std::vector<CallLatency> measure_latency(const Scenario& scenario, const Sim800l& modem);
+// nearest rank percentile, 0 for empty input
+vtime percentile(std::vector<vtime> values, int p);
+void print_latency(const std::vector<CallLatency>& calls);
+
+}  // namespace sim
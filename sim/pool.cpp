@@ -0,0 +1,59 @@
+// ---------------------------------------------------------------------------
+// work stealing thread pool of the fleet, see pool.h
+// ---------------------------------------------------------------------------
+#include "pool.h"
+
+#include <thread>
+
+namespace sim {
+
+Pool::Pool(unsigned workers) : stats_(workers) {
+  for (unsigned w = 0; w < workers; w++) queues_.push_back(std::make_unique<Queue>());
+}
+
+bool Pool::take(unsigned worker, unsigned& item) {
+  {
+    Queue& own = *queues_[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.items.empty()) {
+      item = own.items.back();
+      own.items.pop_back();
+      return true;
+    }
+  }
+  size_t n = queues_.size();
+  for (size_t i = 1; i < n; i++) {
+    Queue& victim = *queues_[(worker + i) % n];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.items.empty()) {
+      item = victim.items.front();
+      victim.items.pop_front();
+      stats_[worker].steals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Pool::run(unsigned items, const std::function<void(unsigned, unsigned)>& task) {
+  unsigned workers = static_cast<unsigned>(queues_.size());
+  for (unsigned w = 0; w < workers; w++) {
+    // worker w owns [begin, end), it starts with 'begin' from the back of its deque
+    unsigned begin = static_cast<unsigned>(static_cast<uint64_t>(items) * w / workers);
+    unsigned end = static_cast<unsigned>(static_cast<uint64_t>(items) * (w + 1) / workers);
+    for (unsigned i = end; i > begin; i--) queues_[w]->items.push_back(i - 1);
+  }
+  std::vector<std::thread> threads;
+  for (unsigned w = 0; w < workers; w++) {
+    threads.emplace_back([this, w, &task] {
+      unsigned item;
+      while (take(w, item)) {
+        task(w, item);
+        stats_[w].items++;
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+}
+
+}  // namespace sim
@@ -0,0 +1,45 @@
+// ---------------------------------------------------------------------------
+// work stealing thread pool of the fleet : items 0..n-1 are dealt to the
+// workers in contiguous blocks, a worker takes its own items from the back
+// of its deque and when it has none left steals from the front of the deque
+// of another worker, so trackers that take longer (more calls, outages) do
+// not leave the other cores idle. No item makes new ones, a worker ends
+// when every deque is empty
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sim {
+
+class Pool {
+ public:
+  struct Stats {
+    uint64_t items = 0;    // run by the worker
+    uint64_t steals = 0;   // of them taken from other workers
+  };
+
+  explicit Pool(unsigned workers);
+
+  // runs task(worker, item) for every item on the worker threads, returns when all are done
+  void run(unsigned items, const std::function<void(unsigned, unsigned)>& task);
+  const std::vector<Stats>& stats() const { return stats_; }
+
+ private:
+  struct alignas(64) Queue {
+    std::mutex lock;
+    std::deque<unsigned> items;
+  };
+
+  bool take(unsigned worker, unsigned& item);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<Stats> stats_;
+};
+
+}  // namespace sim
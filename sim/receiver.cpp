@@ -0,0 +1,30 @@
+// ---------------------------------------------------------------------------
+// UDP report receiver stand-in of the SIM800L model
+// ---------------------------------------------------------------------------
+#include "receiver.h"
+
+namespace sim {
+
+std::string Receiver::receive(const std::string& bytes, vtime now, vtime clock, bool ack) {
+  datagrams_++;
+  bytes_ += bytes.size();
+  telemetry::Report r;
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(bytes.data());
+  if (!telemetry::decode(p, bytes.size(), r)) {
+    bad_++;
+    return "";
+  }
+  if (seen_.insert({r.device, r.seq}).second) {
+    vtime at = static_cast<vtime>(r.time) * kSec;
+    reports_.push_back(Entry{now, r, clock > at ? clock - at : 0});
+  } else {
+    duplicates_++;
+  }
+  if (!ack || !(r.flags & telemetry::kFlagAck)) return "";
+  uint8_t a[telemetry::kAckSize];
+  size_t n = telemetry::encode_ack(r.device, r.seq, a);
+  acks_++;
+  return std::string(reinterpret_cast<const char*>(a), n);
+}
+
+}  // namespace sim
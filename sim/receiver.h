@@ -0,0 +1,52 @@
+// ---------------------------------------------------------------------------
+// UDP report receiver stand-in behind AT+CIPSTART="UDP" of the SIM800L model
+// decodes the datagrams the tracker sends by AT+CIPSEND with the report code
+// of the reference receiver (../telemetry/report.cpp), acknowledges them and
+// records every report once with its latency : arrival minus the time of the
+// position in it. Bytes on air count 28 bytes of IPv4/UDP header per datagram,
+// GPRS headers are not modelled
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "report.h"
+#include "scenario.h"
+
+namespace sim {
+
+class Receiver {
+ public:
+  struct Entry {
+    vtime at;                  // arrival of the first datagram of the report
+    telemetry::Report report;
+    vtime latency;
+  };
+
+  // datagram at 'now', 'clock' is the network time then in microseconds since 2000-01-01 UTC,
+  // returns the ack to send back, empty when there is none ('ack' false or no ack wanted)
+  std::string receive(const std::string& bytes, vtime now, vtime clock, bool ack);
+
+  const std::vector<Entry>& reports() const { return reports_; }
+  uint64_t datagrams() const { return datagrams_; }
+  uint64_t duplicates() const { return duplicates_; }
+  uint64_t bad() const { return bad_; }
+  uint64_t acks() const { return acks_; }
+  // bytes up with IPv4/UDP headers
+  uint64_t air_bytes() const { return bytes_ + datagrams_ * telemetry::kUdpIpHeader; }
+
+ private:
+  std::vector<Entry> reports_;
+  std::set<std::pair<uint32_t, uint16_t>> seen_;
+  uint64_t datagrams_ = 0;
+  uint64_t duplicates_ = 0;
+  uint64_t bad_ = 0;
+  uint64_t acks_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+}  // namespace sim
@@ -0,0 +1,211 @@
+// ---------------------------------------------------------------------------
+// native run of tracker firmware against SIM800L emulator
+//   sim_<variant> scenario.scn [--log] [--trace file] [--latency]
+// runs firmware main() in virtual time until the scenario ends, then checks
+// the expectations of the scenario, exit code 0 = pass, 1 = fail, 2 = error
+// --trace writes MCU and SIM800L power states for the energy model, see energy.cpp
+// --latency prints RING to SMS time of the calls split into phases, see latency.h
+// positions published to the MQTT broker stand-in are summed up in bytes and time, see broker.h,
+// UDP reports in bytes on air and latency, see receiver.h, a firmware update (FEATURE_OTA) by the
+// application in flash and the result of the bootloader
+// ---------------------------------------------------------------------------
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "../ota.h"
+#include "hal_host.h"
+#include "latency.h"
+#include "scenario.h"
+#include "sim800l.h"
+#include "world.h"
+
+namespace {
+
+bool check(const sim::Expectation& x, const sim::World& world, const sim::Sim800l& modem) {
+  if (x.kind == "sms") {
+    for (const auto& sms : modem.sent_sms())
+      if (sms.to == x.arg && sms.text.find(x.text) != std::string::npos) return true;
+    return false;
+  }
+  if (x.kind == "smscount") return static_cast<long>(modem.sent_sms().size()) == x.count;
+  if (x.kind == "command" || x.kind == "nocommand") {
+    long n = 0;
+    for (const auto& c : modem.commands())
+      if (c.line.compare(0, x.arg.size(), x.arg) == 0) n++;
+    return x.kind == "command" ? n >= x.count : n == 0;
+  }
+  if (x.kind == "nohang") return world.finished() != sim::Finish::kHang;
+  if (x.kind == "missedcalls") return static_cast<long>(modem.missed_calls()) == x.count;
+  if (x.kind == "offbytes") return static_cast<long>(modem.off_bytes()) == x.count;
+  if (x.kind == "stored") return static_cast<long>(modem.stored_sms()) == x.count;
+  if (x.kind == "latency") {
+    std::vector<sim::vtime> totals;
+    for (const auto& c : sim::measure_latency(world.scenario(), modem))
+      if (c.delivered) totals.push_back(c.total);
+    return !totals.empty() && sim::percentile(totals, static_cast<int>(x.count)) <= x.limit;
+  }
+  const auto& pubs = modem.broker().publishes();
+  if (x.kind == "mqttcount") return static_cast<long>(pubs.size()) >= x.count;
+  if (x.kind == "mqtt") {
+    for (const auto& p : pubs)
+      if (p.payload.find(x.text) != std::string::npos) return true;
+    return false;
+  }
+  if (x.kind == "mqttupdate") {
+    std::vector<sim::vtime> updates;
+    for (const auto& p : pubs) updates.push_back(p.update);
+    return !updates.empty() && sim::percentile(updates, static_cast<int>(x.count)) <= x.limit;
+  }
+  const auto& reports = modem.receiver().reports();
+  if (x.kind == "udpcount") return static_cast<long>(reports.size()) >= x.count;
+  if (x.kind == "udp") {
+    for (const auto& r : reports)
+      if (telemetry::format(r.report).find(x.text) != std::string::npos) return true;
+    return false;
+  }
+  if (x.kind == "udplatency") {
+    std::vector<sim::vtime> latencies;
+    for (const auto& r : reports) latencies.push_back(r.latency);
+    return !latencies.empty() && sim::percentile(latencies, static_cast<int>(x.count)) <= x.limit;
+  }
+  if (x.kind == "flash") {
+    // application area, erased beyond the image
+    const uint8_t* flash = sim::flash_memory();
+    for (size_t a = 0; a < OTA_STAGE; a++)
+      if (flash[a] != (a < x.image.size() ? x.image[a] : 0xFF)) return false;
+    return true;
+  }
+  if (x.kind == "otaresult") return sim::ota_result() == x.count;
+  return false;
+}
+
+// firmware runs until the HAL jumps out of it when the scenario has finished
+void run_firmware(sim::World& world, sim::Sim800l& modem) {
+  static std::jmp_buf stop;
+  sim::hal_attach(&world, &modem, &stop);
+  world.set_mcu_asleep(false);
+  modem.start();
+  modem.trace_power();
+  if (setjmp(stop) == 0) {
+    firmware_main();
+    world.finish(sim::Finish::kEnd, "firmware main() returned");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string path;
+  std::string trace;
+  bool log = false;
+  bool latency = false;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--log") == 0) log = true;
+    else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) trace = argv[++i];
+    else if (std::strcmp(argv[i], "--latency") == 0) latency = true;
+    else path = argv[i];
+  }
+  if (path.empty()) {
+    std::fprintf(stderr, "usage: %s scenario.scn [--log] [--trace file] [--latency]\n", argv[0]);
+    return 2;
+  }
+
+  sim::Scenario scenario;
+  std::string error;
+  if (!scenario.load(path, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+  if (!scenario.applies_to(sim::kVariant)) {
+    std::printf("SKIP %s (%s)\n", path.c_str(), sim::kVariant);
+    return 0;
+  }
+
+  sim::World world(scenario);
+  world.log_enabled = log;
+  sim::Sim800l modem(world);
+  if (!trace.empty()) {
+    world.trace_file = std::fopen(trace.c_str(), "w");
+    if (world.trace_file == nullptr) {
+      std::fprintf(stderr, "cannot write %s\n", trace.c_str());
+      return 2;
+    }
+    std::fprintf(world.trace_file, "# %s %s\n", sim::kVariant, path.c_str());
+    world.after_event = [&modem] { modem.trace_power(); };
+  }
+  run_firmware(world, modem);
+  if (world.trace_file != nullptr) {
+    // sleeping MCU with nothing more to happen stays in its states until the end
+    sim::vtime end = world.finished() == sim::Finish::kIdle ? scenario.end : world.now();
+    std::fprintf(world.trace_file, "%s end\n", sim::format_time(end).c_str());
+    std::fclose(world.trace_file);
+  }
+
+  std::printf("scenario %s variant %s\n", path.c_str(), sim::kVariant);
+  std::printf("  stopped at %ss : %s\n", sim::format_time(world.now()).c_str(), world.finish_reason().c_str());
+  std::printf("  commands %zu, SMS sent %zu, calls answered %llu, missed %llu, RX overruns %llu, lost in sleep %llu\n",
+              modem.commands().size(), modem.sent_sms().size(),
+              static_cast<unsigned long long>(modem.answered_calls()),
+              static_cast<unsigned long long>(modem.missed_calls()),
+              static_cast<unsigned long long>(world.overruns),
+              static_cast<unsigned long long>(world.lost_in_sleep));
+  for (const auto& sms : modem.sent_sms())
+    std::printf("  SMS %ss to %s : %s\n", sim::format_time(sms.at).c_str(), sms.to.c_str(),
+                sim::escape(sms.text).c_str());
+  if (latency) sim::print_latency(sim::measure_latency(scenario, modem));
+  const sim::Broker& broker = modem.broker();
+  if (broker.connects() > 0) {
+    // bytes and time of one live update, MQTT packets only
+    std::vector<sim::vtime> updates;
+    size_t bytes = 0;
+    for (const auto& p : broker.publishes()) {
+      updates.push_back(p.update);
+      bytes += p.bytes;
+    }
+    size_t n = broker.publishes().size();
+    std::printf("  MQTT connects %llu, publishes %zu, pings %llu, disconnects %llu, bad %llu, %llu bytes sent\n",
+                static_cast<unsigned long long>(broker.connects()), n,
+                static_cast<unsigned long long>(broker.pings()),
+                static_cast<unsigned long long>(broker.disconnects()),
+                static_cast<unsigned long long>(broker.bad()),
+                static_cast<unsigned long long>(broker.bytes()));
+    if (n > 0)
+      std::printf("  MQTT update %.1f bytes, p50 %s s p95 %s s, last %s : %s\n", static_cast<double>(bytes) / n,
+                  sim::format_time(sim::percentile(updates, 50)).c_str(),
+                  sim::format_time(sim::percentile(updates, 95)).c_str(),
+                  broker.publishes().back().topic.c_str(), broker.publishes().back().payload.c_str());
+  }
+  const sim::Receiver& receiver = modem.receiver();
+  if (receiver.datagrams() > 0) {
+    std::vector<sim::vtime> latencies;
+    for (const auto& r : receiver.reports()) latencies.push_back(r.latency);
+    size_t n = receiver.reports().size();
+    std::printf("  UDP reports %zu, datagrams %llu, duplicates %llu, bad %llu, acks %llu, %llu bytes on air with IP/UDP\n",
+                n, static_cast<unsigned long long>(receiver.datagrams()),
+                static_cast<unsigned long long>(receiver.duplicates()),
+                static_cast<unsigned long long>(receiver.bad()),
+                static_cast<unsigned long long>(receiver.acks()),
+                static_cast<unsigned long long>(receiver.air_bytes()));
+    if (n > 0)
+      std::printf("  UDP report %.1f bytes on air, latency p50 %s s p95 %s s, last %s\n",
+                  static_cast<double>(receiver.air_bytes()) / n,
+                  sim::format_time(sim::percentile(latencies, 50)).c_str(),
+                  sim::format_time(sim::percentile(latencies, 95)).c_str(),
+                  telemetry::format(receiver.reports().back().report).c_str());
+  }
+
+  if (sim::flash_writes() > 0)
+    std::printf("  flash pages written %llu, update result %u\n",
+                static_cast<unsigned long long>(sim::flash_writes()), sim::ota_result());
+
+  bool pass = true;
+  for (const auto& x : scenario.expectations) {
+    bool ok = check(x, world, modem);
+    pass = pass && ok;
+    std::printf("  %s %s\n", ok ? "ok  " : "FAIL", x.source.c_str());
+  }
+  std::printf("%s %s (%s)\n", pass ? "PASS" : "FAIL", path.c_str(), sim::kVariant);
+  return pass ? 0 : 1;
+}
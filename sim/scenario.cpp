@@ -0,0 +1,280 @@
+// ---------------------------------------------------------------------------
+// scenario script parser for SIM800L emulator
+// ---------------------------------------------------------------------------
+#include "scenario.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace sim {
+
+namespace {
+
+std::string trim(const std::string& s) {
+  size_t b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) return "";
+  size_t e = s.find_last_not_of(" \t\r\n");
+  return s.substr(b, e - b + 1);
+}
+
+// split off first word, rest of line stays in 'rest'
+std::string word(std::string& rest) {
+  rest = trim(rest);
+  size_t e = rest.find_first_of(" \t");
+  std::string w = rest.substr(0, e);
+  rest = e == std::string::npos ? "" : trim(rest.substr(e));
+  return w;
+}
+
+// rest of line as text, surrounding quotes removed and \r \n \" \\ \xNN unescaped
+std::string text_arg(const std::string& rest) {
+  std::string t = trim(rest);
+  if (t.size() >= 2 && t.front() == '"' && t.back() == '"') t = t.substr(1, t.size() - 2);
+  return unescape(t);
+}
+
+}  // namespace
+
+bool parse_duration(const std::string& text, vtime& value) {
+  char* end = nullptr;
+  double number = std::strtod(text.c_str(), &end);
+  if (end == text.c_str() || number < 0) return false;
+  std::string unit(end);
+  double scale;
+  if (unit.empty() || unit == "s") scale = 1e6;
+  else if (unit == "ms") scale = 1e3;
+  else if (unit == "us") scale = 1;
+  else if (unit == "m") scale = 60e6;
+  else if (unit == "h") scale = 3600e6;
+  else if (unit == "d") scale = 86400e6;
+  else return false;
+  value = static_cast<vtime>(number * scale + 0.5);
+  return true;
+}
+
+bool load_hex(const std::string& file, std::vector<uint8_t>& image, std::string& error) {
+  std::ifstream in(file);
+  if (!in) {
+    error = file + ": cannot open";
+    return false;
+  }
+  image.clear();
+  std::string line;
+  while (std::getline(in, line)) {
+    line = trim(line);
+    if (line.empty()) continue;
+    std::vector<uint8_t> record;
+    for (size_t i = 1; i + 1 < line.size(); i += 2)
+      record.push_back(static_cast<uint8_t>(std::strtoul(line.substr(i, 2).c_str(), nullptr, 16)));
+    uint8_t sum = 0;
+    for (uint8_t b : record) sum += b;
+    if (line[0] != ':' || record.size() < 5 || record.size() != record[0] + 5u || sum != 0) {
+      error = file + ": bad Intel HEX record " + line;
+      return false;
+    }
+    if (record[3] == 1) break;
+    if (record[3] != 0) continue;  // segment and start records, the images are below 64K
+    size_t address = (record[1] << 8) | record[2];
+    if (image.size() < address + record[0]) image.resize(address + record[0], 0xFF);
+    std::copy(record.begin() + 4, record.end() - 1, image.begin() + address);
+  }
+  return true;
+}
+
+std::string format_time(vtime t) {
+  char text[32];
+  std::snprintf(text, sizeof(text), "%llu.%06llu", static_cast<unsigned long long>(t / kSec),
+                static_cast<unsigned long long>(t % kSec));
+  return text;
+}
+
+std::string unescape(const std::string& text) {
+  std::string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != '\\' || i + 1 == text.size()) {
+      out += text[i];
+      continue;
+    }
+    char c = text[++i];
+    switch (c) {
+      case 'r': out += '\r'; break;
+      case 'n': out += '\n'; break;
+      case 'x':
+        if (i + 2 < text.size()) {
+          out += static_cast<char>(std::strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+          i += 2;
+        }
+        break;
+      default: out += c; break;
+    }
+  }
+  return out;
+}
+
+std::string escape(const std::string& text) {
+  std::string out;
+  for (unsigned char c : text) {
+    if (c == '\r') out += "\\r";
+    else if (c == '\n') out += "\\n";
+    else if (c < 0x20 || c >= 0x7f) {
+      char hex[8];
+      std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+      out += hex;
+    } else out += static_cast<char>(c);
+  }
+  return out;
+}
+
+bool Scenario::applies_to(const std::string& variant) const {
+  return variants.empty() || std::find(variants.begin(), variants.end(), variant) != variants.end();
+}
+
+bool Scenario::load(const std::string& file, std::string& error) {
+  std::ifstream in(file);
+  if (!in) {
+    error = file + ": cannot open";
+    return false;
+  }
+  path = file;
+  std::string line;
+  int number = 0;
+  auto fail = [&](const std::string& what) {
+    error = file + ":" + std::to_string(number) + ": " + what;
+    return false;
+  };
+  std::vector<Event> repeated;  // "every" events, e.at holds the period
+  while (std::getline(in, line)) {
+    number++;
+    std::string rest = trim(line);
+    if (rest.empty() || rest[0] == '#') continue;
+    std::string source = rest;
+    std::string directive = word(rest);
+    if (directive == "variants") {
+      while (!rest.empty()) variants.push_back(word(rest));
+    } else if (directive == "seed") {
+      seed = static_cast<uint32_t>(std::strtoul(word(rest).c_str(), nullptr, 10));
+    } else if (directive == "end") {
+      if (!parse_duration(word(rest), end)) return fail("bad duration");
+    } else if (directive == "set") {
+      std::string key = word(rest);
+      settings.emplace_back(key, text_arg(rest));
+    } else if (directive == "flash") {
+      std::string hex_error;
+      if (!load_hex(text_arg(rest), flash, hex_error)) return fail(hex_error);
+    } else if (directive == "powercut") {
+      powercut = std::strtol(word(rest).c_str(), nullptr, 10);
+    } else if (directive == "latency") {
+      std::string prefix = word(rest);
+      Latency l;
+      if (!parse_duration(word(rest), l.base)) return fail("bad latency");
+      std::string jitter = word(rest);
+      if (!jitter.empty() && !parse_duration(jitter, l.jitter)) return fail("bad jitter");
+      latencies.emplace_back(prefix, l);
+    } else if (directive == "fail") {
+      Failure f;
+      f.prefix = word(rest);
+      f.count = std::strtol(word(rest).c_str(), nullptr, 10);
+      f.response = text_arg(rest);
+      failures.push_back(f);
+    } else if (directive == "at" || directive == "every") {
+      Event e;
+      if (!parse_duration(word(rest), e.at)) return fail("bad event time");
+      if (directive == "every" && e.at == 0) return fail("period must not be 0");
+      e.kind = word(rest);
+      if (e.kind == "call" || e.kind == "sms" || e.kind == "set") {
+        e.arg = word(rest);
+        e.text = text_arg(rest);
+      } else if (e.kind == "urc" || e.kind == "powerdown") {
+        e.text = text_arg(rest);
+      } else if (e.kind != "restart") {
+        return fail("unknown event " + e.kind);
+      }
+      (directive == "at" ? events : repeated).push_back(e);
+    } else if (directive == "expect") {
+      Expectation x;
+      x.source = source;
+      x.kind = word(rest);
+      if (x.kind == "sms") {
+        x.arg = word(rest);
+        if (x.arg == "count") {
+          x.kind = "smscount";
+          x.count = std::strtol(word(rest).c_str(), nullptr, 10);
+        } else {
+          if (word(rest) != "contains") return fail("expect sms <number> contains <text>");
+          x.text = text_arg(rest);
+        }
+      } else if (x.kind == "command" || x.kind == "nocommand") {
+        x.arg = word(rest);
+        std::string count = word(rest);
+        if (!count.empty()) x.count = std::strtol(count.c_str(), nullptr, 10);
+      } else if (x.kind == "missedcalls" || x.kind == "stored" || x.kind == "offbytes") {
+        x.count = std::strtol(word(rest).c_str(), nullptr, 10);
+      } else if (x.kind == "latency") {
+        std::string p = word(rest);
+        if (p.size() < 2 || p[0] != 'p') return fail("expect latency p<percentile> <time>");
+        x.count = std::strtol(p.c_str() + 1, nullptr, 10);
+        if (x.count < 1 || x.count > 100 || !parse_duration(word(rest), x.limit))
+          return fail("expect latency p<percentile> <time>");
+      } else if (x.kind == "mqtt") {
+        std::string what = word(rest);
+        if (what == "count") {
+          x.kind = "mqttcount";
+          x.count = std::strtol(word(rest).c_str(), nullptr, 10);
+        } else if (what == "contains") {
+          x.text = text_arg(rest);
+        } else if (what == "update") {
+          x.kind = "mqttupdate";
+          std::string p = word(rest);
+          if (p.size() < 2 || p[0] != 'p') return fail("expect mqtt update p<percentile> <time>");
+          x.count = std::strtol(p.c_str() + 1, nullptr, 10);
+          if (x.count < 1 || x.count > 100 || !parse_duration(word(rest), x.limit))
+            return fail("expect mqtt update p<percentile> <time>");
+        } else {
+          return fail("expect mqtt count <n> | contains <text> | update p<percentile> <time>");
+        }
+      } else if (x.kind == "udp") {
+        std::string what = word(rest);
+        if (what == "count") {
+          x.kind = "udpcount";
+          x.count = std::strtol(word(rest).c_str(), nullptr, 10);
+        } else if (what == "contains") {
+          x.text = text_arg(rest);
+        } else if (what == "latency") {
+          x.kind = "udplatency";
+          std::string p = word(rest);
+          if (p.size() < 2 || p[0] != 'p') return fail("expect udp latency p<percentile> <time>");
+          x.count = std::strtol(p.c_str() + 1, nullptr, 10);
+          if (x.count < 1 || x.count > 100 || !parse_duration(word(rest), x.limit))
+            return fail("expect udp latency p<percentile> <time>");
+        } else {
+          return fail("expect udp count <n> | contains <text> | latency p<percentile> <time>");
+        }
+      } else if (x.kind == "flash") {
+        std::string hex_error;
+        if (!load_hex(text_arg(rest), x.image, hex_error)) return fail(hex_error);
+      } else if (x.kind == "otaresult") {
+        x.count = std::strtol(word(rest).c_str(), nullptr, 10);
+      } else if (x.kind != "nohang") {
+        return fail("unknown expectation " + x.kind);
+      }
+      expectations.push_back(x);
+    } else {
+      return fail("unknown directive " + directive);
+    }
+  }
+  for (const Event& r : repeated) {
+    for (vtime t = r.at; t < end; t += r.at) {
+      Event e = r;
+      e.at = t;
+      events.push_back(e);
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event& a, const Event& b) { return a.at < b.at; });
+  return true;
+}
+
+}  // namespace sim
@@ -0,0 +1,94 @@
+// ---------------------------------------------------------------------------
+// scenario script for SIM800L emulator
+// one directive per line, '#' starts a comment, times like 250ms 10s 30m 2h
+//
+//   variants main mainb        firmware variants the scenario applies to
+//   seed 7                     random seed for latency jitter
+//   end 2h                     stop virtual time here
+//   set creg 1                 initial modem state (see Sim800l::set)
+//   latency AT+SAPBR=1 3s 1s   response latency of commands with prefix, +-jitter
+//   fail AT+CIPGSMLOC 2 +CIPGSMLOC: 601\r\n\r\nOK   answer next 2 commands with text
+//   at 10m call +48123456789   timed event : call, sms, urc, restart, set, powerdown [URC text]
+//                              (SIM800L off and silent until restart)
+//   every 6h call +48123456789 event repeated at 6h, 12h, ... until end
+//   expect sms +48123456789 contains LATITUDE=
+//   expect sms count 1 | expect command AT+CNETLIGHT=0 | expect nocommand ATH
+//   expect nohang | expect missedcalls 0 | expect stored 0   SMS left in SIM800L memory
+//   expect offbytes 0          bytes the MCU sent while SIM800L was off after powerdown
+//   expect latency p95 60s     RING to SMS time of the calls, see latency.h
+//   expect mqtt count 30 | expect mqtt contains 50.064651   positions the broker stand-in got (at least)
+//   expect mqtt update p95 6s  time of a live update from its first AT command to SEND OK
+//   expect udp count 6 | expect udp contains seq=3   reports the UDP receiver stand-in got (at least)
+//   expect udp latency p95 20s  arrival of a UDP report minus the time of its position
+//   flash build/ota/fw1.hex    application in the emulated flash (FEATURE_OTA), erased without it
+//   powercut 4                 power fails right after the 4th page erase of the bootloader
+//   expect flash build/ota/fw2.hex | expect otaresult 0   application and update result after the reboot
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sim {
+
+using vtime = uint64_t;  // virtual time in microseconds since power on
+
+constexpr vtime kMsec = 1000ULL;
+constexpr vtime kSec = 1000000ULL;
+
+struct Latency {
+  vtime base = 0;
+  vtime jitter = 0;
+};
+
+struct Failure {
+  std::string prefix;
+  long count = 0;
+  std::string response;
+};
+
+struct Event {
+  vtime at = 0;
+  std::string kind;   // call, sms, urc, restart, set, powerdown
+  std::string arg;    // phone number or setting name
+  std::string text;   // SMS text, URC text, setting value, call duration
+};
+
+struct Expectation {
+  std::string kind;   // sms, smscount, command, nocommand, nohang, missedcalls, stored, offbytes, latency,
+                      // mqttcount, mqtt, mqttupdate, udpcount, udp, udplatency, flash, otaresult
+  std::string arg;
+  std::string text;
+  std::vector<uint8_t> image;  // flash
+  long count = 1;     // also percentile of latency
+  vtime limit = 0;
+  std::string source;
+};
+
+struct Scenario {
+  std::string path;
+  std::vector<std::string> variants;
+  uint32_t seed = 1;
+  vtime end = 24 * 3600 * kSec;
+  std::vector<std::pair<std::string, std::string>> settings;
+  std::vector<std::pair<std::string, Latency>> latencies;
+  std::vector<Failure> failures;
+  std::vector<Event> events;
+  std::vector<Expectation> expectations;
+  std::vector<uint8_t> flash;  // application in flash from address 0
+  long powercut = 0;           // page erases of the bootloader before the power fails, 0 never
+
+  bool load(const std::string& file, std::string& error);
+  bool applies_to(const std::string& variant) const;
+};
+
+// Intel HEX file to bytes from address 0, gaps are 0xFF like erased flash
+bool load_hex(const std::string& file, std::vector<uint8_t>& image, std::string& error);
+bool parse_duration(const std::string& text, vtime& value);
+std::string format_time(vtime t);
+std::string unescape(const std::string& text);
+std::string escape(const std::string& text);
+
+}  // namespace sim
@@ -0,0 +1,862 @@
+// ---------------------------------------------------------------------------
+// behavioural model of SIM800L for the AT commands used by the tracker
+// ---------------------------------------------------------------------------
+#include "sim800l.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace sim {
+
+namespace {
+
+// typical answer times of SIM800L measured on the bench, scenario may override
+struct DefaultLatency {
+  const char* prefix;
+  vtime latency;
+};
+const DefaultLatency kDefaultLatency[] = {
+    {"AT+SAPBR=1", 2500 * kMsec},  // GPRS attach and PDP activation
+    {"AT+SAPBR=0", 800 * kMsec},
+    {"AT+CIPGSMLOC", 4500 * kMsec},  // round trip to location server
+    {"AT+CLBS", 4500 * kMsec},
+    {"AT+CIICR", 1000 * kMsec},      // PDP context of the TCP/IP stack
+    {"AT+CIPSTART=\"UDP\"", 200 * kMsec},  // no handshake, CONNECT OK when the socket is set up
+    {"AT+CIPSTART", 1500 * kMsec},   // to CONNECT OK, TCP handshake over GPRS
+    {"AT+CIPSEND", 300 * kMsec},     // from the last data byte to SEND OK
+    {"AT+CIPSHUT", 200 * kMsec},
+    {"AT+HTTPINIT", 100 * kMsec},
+    {"AT+CMGS", 3000 * kMsec},       // from CTRL-Z to +CMGS
+    {"AT+CFUN", 300 * kMsec},
+    {"AT+CPIN=", 500 * kMsec},
+    {"AT+CMGDA", 300 * kMsec},
+    {"AT&W", 200 * kMsec},
+    {"ATH", 100 * kMsec},
+    {"", 20 * kMsec},
+};
+
+const std::pair<const char*, const char*> kDefaultSettings[] = {
+    {"creg", "1"},           // network registration status when radio is on : 1 home, 5 roaming, 0 none
+    {"pin", "ready"},        // ready or locked
+    {"pincode", "1111"},
+    {"battery", "4100"},     // mV
+    {"location", "19.945490,50.064651"},
+    {"clbs", "none"},        // AT+CLBS=4 of newer firmware : none (ERROR like older firmware) or ok
+    {"accuracy", "550"},     // accuracy radius [m] in the AT+CLBS answer
+    {"locfail", "0"},        // % of CIPGSMLOC / CLBS queries over an open bearer that fail at random
+    {"locerror", "601"},     // +CIPGSMLOC: result code of those failures, AT+CLBS answers 3 (location failed)
+    {"cell", "260,1,2900,7412"},  // serving cell MCC,MNC,LAC,CI for AT+CENG, not in the sample cell database
+    {"neighbours", ""},      // neighbour cells MCC,MNC,LAC,CI;... for AT+CENG, at most 6
+    {"geoserver", "200"},    // HTTP status of the geoserver, body is the location like CIPGSMLOC
+    {"httpdelay", "1500ms"}, // from AT+HTTPACTION to +HTTPACTION: URC
+    {"httpfile", ""},        // file served at URLs other than the geoserver (firmware update), 404 without it
+    {"broker", "ok"},        // MQTT broker stand-in at AT+CIPSTART : ok, down (CONNECT FAIL) or refuse (CONNACK 5)
+    {"brokerrtt", "400ms"},  // from SEND OK to the answer of the broker
+    {"receiver", "ok"},      // UDP report receiver stand-in : ok, noack (reports come, no ack) or down (datagrams lost)
+    {"receiverrtt", "400ms"},  // from SEND OK to the ack of the receiver
+    {"gnss", "none"},        // SIM808 GNSS receiver : none (SIM800L answers ERROR), fix or nofix
+    {"gnssttff", "30s"},     // time to first fix after AT+CGNSPWR=1, cold start
+    {"gnsshot", "2s"},       // time to first fix of a hot start, ephemeris of the last fix is valid
+    {"gnsswarm", "4h"},      // how long after the last fix the receiver starts hot
+    {"gnsslocation", "50.061470,19.938120"},  // latitude,longtitude of the GNSS fix
+    {"gnssspeed", "12.60"},  // km/h
+    {"datetime", "2019/01/01,12:00:00"},  // UTC at power on, runs with virtual time
+    {"timezone", "+0"},      // quarter hours of local time in AT+CCLK? and *PSUTTZ
+    {"rtc", "set"},          // SIM800L clock has the time at power on, unset = 2004/01/01 until NITZ
+    {"clts", "0"},           // AT+CLTS=1 kept by SIM800L from an earlier boot
+    {"nitz", "1"},           // network sends its time at registration (AT+CLTS=1), 0 = it does not
+    {"bearer", "ok"},        // ok or fail
+    {"echo", "0"},           // echo saved in SIM800L profile by AT&W
+    {"regdelay", "5s"},      // time to register after radio on
+    {"sleepidle", "5s"},     // UART idle time before sleep in AT+CSCLK=2
+    {"bootmsg", "1"},        // RDY, Call Ready, SMS Ready after power on
+};
+
+std::string upper(const std::string& s) {
+  std::string u(s);
+  for (char& c : u) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+  return u;
+}
+
+bool starts_with(const std::string& s, const std::string& prefix) {
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// text between first pair of quotes
+std::string quoted(const std::string& s) {
+  size_t b = s.find('"');
+  if (b == std::string::npos) return "";
+  size_t e = s.find('"', b + 1);
+  return s.substr(b + 1, e == std::string::npos ? std::string::npos : e - b - 1);
+}
+
+// whole file as bytes, false when there is none
+bool read_file(const std::string& path, std::string& content) {
+  if (path.empty()) return false;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+// days since 1970-01-01 of civil date
+long days_from_civil(long y, long m, long d) {
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+void civil_from_days(long z, long& y, long& m, long& d) {
+  z += 719468;
+  long era = (z >= 0 ? z : z - 146096) / 146097;
+  long doe = z - era * 146097;
+  long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp + (mp < 10 ? 3 : -9);
+  y = yoe + era * 400 + (m <= 2);
+}
+
+// seconds since 2000-01-01 as yyyy/MM/dd,hh:mm:ss
+std::string civil_text(long long t) {
+  long y = 2000, mo = 1, d = 1;
+  t += days_from_civil(2000, 1, 1) * 86400LL;
+  civil_from_days(static_cast<long>(t / 86400), y, mo, d);
+  long sec = static_cast<long>(t % 86400);
+  char text[64];
+  std::snprintf(text, sizeof(text), "%04ld/%02ld/%02ld,%02ld:%02ld:%02ld", y, mo, d, sec / 3600,
+                sec / 60 % 60, sec % 60);
+  return text;
+}
+
+}  // namespace
+
+Sim800l::Sim800l(World& world) : world_(world) {
+  for (const auto& s : kDefaultSettings) settings_[s.first] = s.second;
+  for (const auto& s : world_.scenario().settings) settings_[s.first] = s.second;
+}
+
+void Sim800l::set(const std::string& key, const std::string& value) {
+  settings_[key] = value;
+  if (key == "echo") echo_ = saved_echo_ = value == "1";
+  if (key == "pin") pin_ready_ = value == "ready";
+  if (key == "broker" && value == "down" && broker_.connected()) tcp_close("CLOSED");
+}
+
+// TCP connection to the broker gone, URC tells the MCU when it was not asked
+void Sim800l::tcp_close(const std::string& urc_text) {
+  broker_.close();
+  udp_ = false;
+  cipsend_left_ = 0;
+  if (!urc_text.empty()) urc(urc_text, 0);
+}
+
+void Sim800l::start() {
+  echo_ = saved_echo_ = settings_["echo"] == "1";
+  pin_ready_ = settings_["pin"] == "ready";
+  clts_ = settings_["clts"] == "1";
+  rtc_set_ = settings_["rtc"] != "unset";
+  vtime regdelay = 0;
+  parse_duration(settings_["regdelay"], regdelay);
+  register_at(regdelay);
+  failures_ = world_.scenario().failures;
+
+  if (settings_["bootmsg"] == "1") {
+    world_.at(2 * kSec, [this] { urc("RDY", 0); });
+    world_.at(3 * kSec, [this] { urc("+CFUN: 1", 0); });
+    world_.at(4 * kSec, [this] { urc(pin_ready_ ? "+CPIN: READY" : "+CPIN: SIM PIN", 0); });
+    world_.at(6 * kSec, [this] { urc("Call Ready", 0); });
+    world_.at(7 * kSec, [this] { urc("SMS Ready", 0); });
+  }
+
+  for (const Event& e : world_.scenario().events) {
+    world_.at(e.at, [this, e] {
+      if (e.kind == "call") {
+        vtime duration = 30 * kSec;
+        if (!e.text.empty()) parse_duration(e.text, duration);
+        incoming_call(e.arg, duration);
+      } else if (e.kind == "sms") {
+        incoming_sms(e.arg, e.text);
+      } else if (e.kind == "urc") {
+        urc(e.text, cfgri_ ? 120 * kMsec : 0);
+      } else if (e.kind == "restart") {
+        restart();
+      } else if (e.kind == "powerdown") {
+        power_down(e.text.empty() ? "NORMAL POWER DOWN" : e.text);
+      } else if (e.kind == "set") {
+        world_.log("EVENT", "set " + e.arg + " " + e.text);
+        set(e.arg, e.text);
+      }
+    });
+  }
+}
+
+bool Sim800l::ri_low() const { return call_.active || world_.now() < ri_low_until_; }
+
+vtime Sim800l::sleep_idle() const {
+  vtime idle = 0;
+  auto it = settings_.find("sleepidle");
+  if (it != settings_.end()) parse_duration(it->second, idle);
+  return idle;
+}
+
+bool Sim800l::asleep() const {
+  vtime idle = sleep_idle();
+  vtime now = world_.now();
+  return csclk_ == 2 && !call_.active && now >= last_uart_ + idle && now >= world_.modem_tx_idle_at() + idle;
+}
+
+// UART used at time t, when tracing wake up at the end of idle time to trace the sleep
+void Sim800l::uart_activity(vtime t) {
+  last_uart_ = t;
+  if (world_.tracing() && csclk_ == 2) world_.at(t + sleep_idle(), [] {});
+}
+
+std::string Sim800l::power_state() const {
+  if (!powered_) return "sleep";  // the energy model has no state below sleep
+  if (world_.now() < sms_tx_until_) return "sms";
+  if (call_.active) return "ring";
+  if (bearer_ != Bearer::kClosed || ip_context_) return "gprs";
+  if (!radio_on_) return asleep() ? "sleep" : "radiooff";
+  if (asleep()) return "sleep";
+  uint8_t reg = registration();
+  return reg == 1 || reg == 5 ? "idle" : "search";
+}
+
+// network registration completes at time t, when tracing an event marks the end of search
+void Sim800l::register_at(vtime t) {
+  registered_at_ = t;
+  if (world_.tracing()) world_.at(t, [] {});
+  if (clts_) world_.at(t, [this, t] { nitz(t); });
+}
+
+void Sim800l::trace_power() { world_.trace("sim800l", power_state()); }
+
+uint8_t Sim800l::registration() const {
+  if (!powered_ || !radio_on_ || !pin_ready_) return 0;
+  if (world_.now() < registered_at_) return 2;  // searching
+  return static_cast<uint8_t>(std::atoi(settings_.at("creg").c_str()));
+}
+
+vtime Sim800l::clock() const {
+  long y = 2019, mo = 1, d = 1, h = 12, mi = 0, s = 0;
+  std::sscanf(settings_.at("datetime").c_str(), "%ld/%ld/%ld,%ld:%ld:%ld", &y, &mo, &d, &h, &mi, &s);
+  long long t = (days_from_civil(y, mo, d) - days_from_civil(2000, 1, 1)) * 86400LL + h * 3600 + mi * 60 + s;
+  return static_cast<vtime>(t) * kSec + world_.now();
+}
+
+std::string Sim800l::datetime() const { return civil_text(static_cast<long long>(clock() / kSec)); }
+
+// AT+CCLK? : local time and its zone, or time since power on from 2004/01/01 while the clock
+// never had the network time
+std::string Sim800l::rtc() const {
+  long zone = std::atol(settings_.at("timezone").c_str());
+  long long t = static_cast<long long>(clock() / kSec) + zone * 900;
+  if (!rtc_set_) t = (days_from_civil(2004, 1, 1) - days_from_civil(2000, 1, 1)) * 86400LL + world_.now() / kSec;
+  char text[8];
+  std::snprintf(text, sizeof(text), "%+03ld", rtc_set_ ? zone : 0L);
+  return civil_text(t).substr(2) + text;
+}
+
+// network time at registration after AT+CLTS=1 : SIM800L clock is set and *PSUTTZ (UTC) tells the MCU
+void Sim800l::nitz(vtime t) {
+  uint8_t reg = registration();
+  if (t != registered_at_ || !clts_ || settings_["nitz"] != "1" || (reg != 1 && reg != 5)) return;
+  rtc_set_ = true;
+  long y = 2000, mo = 1, d = 1;
+  long long s = static_cast<long long>(clock() / kSec) + days_from_civil(2000, 1, 1) * 86400LL;
+  civil_from_days(static_cast<long>(s / 86400), y, mo, d);
+  long sec = static_cast<long>(s % 86400);
+  char text[80];
+  std::snprintf(text, sizeof(text), "*PSUTTZ: %ld,%ld,%ld,%ld,%ld,%ld,\"%+ld\",0", y, mo, d, sec / 3600, sec / 60 % 60,
+                sec % 60, std::atol(settings_["timezone"].c_str()));
+  urc(text, cfgri_ ? 120 * kMsec : 0);
+}
+
+vtime Sim800l::latency(const std::string& line) {
+  std::string u = upper(line);
+  const Latency* best = nullptr;
+  size_t best_len = 0;
+  for (const auto& l : world_.scenario().latencies) {
+    std::string p = upper(l.first);
+    if (starts_with(u, p) && (best == nullptr || p.size() > best_len)) {
+      best = &l.second;
+      best_len = p.size();
+    }
+  }
+  if (best == nullptr) {
+    for (const auto& d : kDefaultLatency) {
+      if (starts_with(u, d.prefix)) return d.latency;
+    }
+    return 0;
+  }
+  if (best->jitter == 0) return best->base;
+  std::uniform_int_distribution<long long> jitter(-static_cast<long long>(best->jitter),
+                                                  static_cast<long long>(best->jitter));
+  long long value = static_cast<long long>(best->base) + jitter(world_.rng());
+  return value < 0 ? 0 : static_cast<vtime>(value);
+}
+
+void Sim800l::reply(vtime delay, const std::string& text) {
+  world_.at(world_.now() + delay, [this, text] {
+    world_.log("SIM<", text);
+    uart_activity(world_.modem_send(world_.now(), "\r\n" + text + "\r\n"));
+  });
+}
+
+void Sim800l::urc(const std::string& text, vtime ri_pulse) {
+  if (ri_pulse > 0) ri_low_until_ = std::max(ri_low_until_, world_.now() + ri_pulse);
+  world_.log("URC<", text);
+  uart_activity(world_.modem_send(world_.now() + 5 * kMsec, "\r\n" + text + "\r\n"));
+}
+
+void Sim800l::receive(uint8_t c) {
+  receive_byte(c);
+  trace_power();
+}
+
+void Sim800l::receive_byte(uint8_t c) {
+  vtime now = world_.now();
+  if (!powered_) {
+    off_bytes_++;
+    world_.log("SIM", "off, byte lost");
+    return;
+  }
+  if (asleep()) {
+    // first character only wakes the module up in AT+CSCLK=2
+    uart_activity(now);
+    world_.log("SIM", "woken up from sleep, byte lost");
+    return;
+  }
+  uart_activity(now);
+
+  if (cipsend_left_ > 0 && now >= cipsend_from_ && udp_) {
+    // datagram of AT+CIPSEND=<length>, SEND OK when all came, it reaches the receiver unless it is down
+    cipsend_data_ += static_cast<char>(c);
+    if (--cipsend_left_ > 0) return;
+    world_.log("MCU>", "UDP " + escape(cipsend_data_));
+    vtime d = latency("AT+CIPSEND"), rtt = 0;
+    parse_duration(settings_["receiverrtt"], rtt);
+    reply(d, "SEND OK");
+    if (settings_["receiver"] == "down") return;
+    std::string answer = receiver_.receive(cipsend_data_, now + d + rtt / 2, clock() + d + rtt / 2,
+                                           settings_["receiver"] == "ok");
+    if (!answer.empty()) {
+      world_.at(now + d + rtt, [this, answer] {
+        if (!udp_) return;
+        world_.log("SIM<", "UDP " + escape(answer));
+        std::string head = ciphead_ ? "\r\n+IPD," + std::to_string(answer.size()) + ":" : "\r\n";
+        uart_activity(world_.modem_send(world_.now(), head + answer));
+      });
+    }
+    return;
+  }
+
+  if (cipsend_left_ > 0 && now >= cipsend_from_) {
+    // data of AT+CIPSEND=<length>, SEND OK when all came and the broker answers after its round trip
+    cipsend_data_ += static_cast<char>(c);
+    if (--cipsend_left_ > 0) return;
+    world_.log("MCU>", "TCP " + escape(cipsend_data_));
+    vtime d = latency("AT+CIPSEND"), rtt = 0;
+    parse_duration(settings_["brokerrtt"], rtt);
+    std::string answer = broker_.receive(cipsend_data_, settings_["broker"] == "refuse");
+    world_.at(now + d, [this] { broker_.sent(world_.now()); });
+    reply(d, "SEND OK");
+    if (!answer.empty()) {
+      world_.at(now + d + rtt, [this, answer] {
+        if (!broker_.connected()) return;
+        world_.log("SIM<", "TCP " + escape(answer));
+        std::string head = ciphead_ ? "\r\n+IPD," + std::to_string(answer.size()) + ":" : "\r\n";
+        uart_activity(world_.modem_send(world_.now(), head + answer));
+      });
+    }
+    return;
+  }
+
+  if (sms_text_mode_) {
+    if (c == 0x1A) {
+      sms_text_mode_ = false;
+      std::string text = sms_text_;
+      text.erase(0, text.find_first_not_of("\r\n"));
+      std::string to = sms_to_;
+      world_.log("MCU>", "SMS to " + to + " : " + text);
+      uint8_t reg = registration();
+      vtime d = latency("AT+CMGS");
+      if (reg == 1 || reg == 5) {
+        sms_tx_until_ = now + d;
+        world_.at(now + d, [this, to, text] { sent_sms_.push_back(Sms{world_.now(), to, text}); });
+        reply(d, "+CMGS: " + std::to_string(sent_sms_.size() + 1));
+        ok(d);
+      } else {
+        reply(d, "+CMS ERROR: 500");
+      }
+    } else if (c == 0x1B) {
+      sms_text_mode_ = false;
+      ok(0);
+    } else {
+      sms_text_ += static_cast<char>(c);
+    }
+    return;
+  }
+
+  if (echo_) world_.modem_send(now, std::string(1, static_cast<char>(c)));
+  if (c == '\r' || c == '\n') {
+    if (!line_.empty()) {
+      std::string line;
+      line.swap(line_);
+      handle(line);
+    }
+    return;
+  }
+  if (line_.size() < 556) line_ += static_cast<char>(c);
+}
+
+void Sim800l::handle(const std::string& line) {
+  vtime now = world_.now();
+  commands_.push_back(Command{now, line});
+  world_.log("MCU>", line);
+  std::string u = upper(line);
+  vtime d = latency(line);
+  broker_.command(now);
+
+  for (Failure& f : failures_) {
+    if (f.count > 0 && starts_with(u, upper(f.prefix))) {
+      f.count--;
+      reply(d, f.response);
+      return;
+    }
+  }
+
+  if (!starts_with(u, "AT")) {
+    error(d);
+  } else if (u == "AT") {
+    ok(d);
+  } else if (u == "ATE0" || u == "ATE1") {
+    echo_ = u == "ATE1";
+    ok(d);
+  } else if (u == "AT&W") {
+    saved_echo_ = echo_;
+    ok(d);
+  } else if (u == "ATH") {
+    if (call_.active) {
+      call_.active = false;
+      answered_calls_++;
+    }
+    ok(d);
+  } else if (starts_with(u, "AT+CFGRI=")) {
+    cfgri_ = u.substr(9) != "0";
+    ok(d);
+  } else if (starts_with(u, "AT+CLTS=")) {
+    clts_ = u.substr(8) == "1";
+    ok(d);
+  } else if (starts_with(u, "AT+CLIP=")) {
+    clip_ = u.substr(8) != "0";
+    ok(d);
+  } else if (starts_with(u, "AT+CSCLK=")) {
+    csclk_ = std::atoi(u.c_str() + 9);
+    ok(d);
+  } else if (starts_with(u, "AT+IPR=") || starts_with(u, "AT+CREG=") || starts_with(u, "AT+CMGF=") ||
+             starts_with(u, "AT+CNETLIGHT=")) {
+    ok(d);
+  } else if (u == "AT+CREG?") {
+    reply(d, "+CREG: 0," + std::to_string(registration()));
+    ok(d);
+  } else if (u == "AT+CPIN?") {
+    reply(d, pin_ready_ ? "+CPIN: READY" : "+CPIN: SIM PIN");
+    ok(d);
+  } else if (starts_with(u, "AT+CPIN=")) {
+    if (!pin_ready_ && quoted(line) == settings_["pincode"]) {
+      pin_ready_ = true;
+      vtime regdelay = 0;
+      parse_duration(settings_["regdelay"], regdelay);
+      register_at(now + regdelay);
+      ok(d);
+    } else {
+      reply(d, "+CME ERROR: 16");
+    }
+  } else if (starts_with(u, "AT+CFUN=")) {
+    int fun = std::atoi(u.c_str() + 8);
+    if (fun == 1 && !radio_on_) {
+      vtime regdelay = 0;
+      parse_duration(settings_["regdelay"], regdelay);
+      register_at(now + d + regdelay);
+    }
+    radio_on_ = fun == 1;
+    if (!radio_on_) {
+      bearer_ = Bearer::kClosed;
+      ip_context_ = false;
+      tcp_close("");
+      call_.active = false;
+    }
+    ok(d);
+  } else if (starts_with(u, "AT+CMGDA=")) {
+    // "DEL READ" erases messages read by AT+CMGR, "DEL ALL" and the other types everything
+    if (u.find("DEL READ") != std::string::npos) {
+      for (auto it = storage_.begin(); it != storage_.end();)
+        it = it->second.read ? storage_.erase(it) : std::next(it);
+    } else {
+      storage_.clear();
+    }
+    ok(d);
+  } else if (starts_with(u, "AT+CMGD=")) {
+    storage_.erase(std::atoi(u.c_str() + 8));
+    ok(d);
+  } else if (starts_with(u, "AT+CMGR=")) {
+    auto it = storage_.find(std::atoi(u.c_str() + 8));
+    if (it != storage_.end()) {
+      std::string status = it->second.read ? "REC READ" : "REC UNREAD";
+      it->second.read = true;
+      std::string date = datetime().substr(2);
+      reply(d, "+CMGR: \"" + status + "\",\"" + it->second.from + "\",\"\",\"" + date + "+04\"\r\n" +
+                   it->second.text);
+    }
+    ok(d);
+  } else if (starts_with(u, "AT+CMGS=")) {
+    sms_to_ = quoted(line);
+    sms_text_.clear();
+    sms_text_mode_ = true;
+    uart_activity(world_.modem_send(now + 20 * kMsec, "\r\n> "));
+  } else if (starts_with(u, "AT+SAPBR=3,")) {
+    ok(d);
+  } else if (starts_with(u, "AT+SAPBR=1,")) {
+    uint8_t reg = registration();
+    if (bearer_ != Bearer::kClosed || (reg != 1 && reg != 5) || settings_["bearer"] != "ok") {
+      error(d);
+    } else {
+      bearer_ = Bearer::kConnecting;
+      world_.at(now + d, [this] {
+        if (bearer_ == Bearer::kConnecting) bearer_ = Bearer::kConnected;
+      });
+      ok(d);
+    }
+  } else if (starts_with(u, "AT+SAPBR=2,")) {
+    if (bearer_ == Bearer::kConnected) reply(d, "+SAPBR: 1,1,\"10.64.3.17\"");
+    else if (bearer_ == Bearer::kConnecting) reply(d, "+SAPBR: 1,0,\"0.0.0.0\"");
+    else reply(d, "+SAPBR: 1,3,\"0.0.0.0\"");
+    ok(d);
+  } else if (starts_with(u, "AT+SAPBR=0,")) {
+    if (bearer_ == Bearer::kClosed) {
+      error(d);
+    } else {
+      bearer_ = Bearer::kClosed;
+      ok(d);
+    }
+  } else if (starts_with(u, "AT+CIPGSMLOC=")) {
+    if (bearer_ == Bearer::kConnected && location_fails()) {
+      reply(d, "+CIPGSMLOC: " + settings_["locerror"]);
+    } else if (bearer_ == Bearer::kConnected) {
+      std::string dt = datetime();
+      reply(d, "+CIPGSMLOC: 0," + settings_["location"] + "," + dt);
+    } else {
+      reply(d, "+CIPGSMLOC: 601");
+    }
+    ok(d);
+  } else if (starts_with(u, "AT+CLBS=4,")) {
+    if (settings_["clbs"] != "ok") {
+      error(20 * kMsec);  // unknown command, no round trip
+      return;
+    }
+    if (bearer_ == Bearer::kConnected && location_fails()) {
+      reply(d, "+CLBS: 3");
+    } else if (bearer_ == Bearer::kConnected) {
+      // yy/mm/dd,hh:mm:ss
+      reply(d, "+CLBS: 0," + settings_["location"] + "," + settings_["accuracy"] + "," + datetime().substr(2));
+    } else {
+      reply(d, "+CLBS: 4");
+    }
+    ok(d);
+  } else if (u == "AT+CIPSHUT") {
+    ip_context_ = false;
+    tcp_close("");
+    reply(d, "SHUT OK");
+  } else if (starts_with(u, "AT+CSTT=") || starts_with(u, "AT+CIPHEAD=")) {
+    if (starts_with(u, "AT+CIPHEAD=")) ciphead_ = u.substr(11) != "0";
+    ok(d);
+  } else if (u == "AT+CIICR") {
+    uint8_t reg = registration();
+    if (ip_context_ || (reg != 1 && reg != 5) || settings_["bearer"] != "ok") {
+      error(d);
+    } else {
+      ip_context_ = true;
+      ok(d);
+    }
+  } else if (u == "AT+CIFSR") {
+    if (ip_context_) reply(d, "10.64.3.18");
+    else error(d);
+  } else if (starts_with(u, "AT+CIPSTART=")) {
+    if (!ip_context_ || broker_.connected() || udp_) {
+      error(20 * kMsec);
+      return;
+    }
+    ok(20 * kMsec);
+    if (starts_with(u, "AT+CIPSTART=\"UDP\"")) {
+      // connectionless, the datagrams are lost later when the receiver is down
+      udp_ = true;
+      reply(d, "CONNECT OK");
+    } else if (settings_["broker"] == "down") {
+      reply(d, "CONNECT FAIL");
+    } else {
+      world_.at(now + d, [this] { broker_.open(); });
+      reply(d, "CONNECT OK");
+    }
+  } else if (starts_with(u, "AT+CIPSEND=")) {
+    size_t n = std::strtoul(u.c_str() + 11, nullptr, 10);
+    // SIM800L takes at most 1460 bytes in one AT+CIPSEND (AT+CIPSEND? in single connection mode)
+    if ((!broker_.connected() && !udp_) || n == 0 || n > 1460) {
+      error(20 * kMsec);
+    } else {
+      cipsend_left_ = n;
+      cipsend_data_.clear();
+      cipsend_from_ = world_.modem_send(now + 20 * kMsec, "\r\n> ");
+      uart_activity(cipsend_from_);
+    }
+  } else if (starts_with(u, "AT+CENG=")) {
+    ceng_ = std::atoi(u.c_str() + 8);
+    ok(d);
+  } else if (u == "AT+CENG?") {
+    // mode line, then serving cell in mode 1 format, cellid and lac in hex, zeros when not registered
+    std::string r = "+CENG: " + std::to_string(ceng_) + ",0";
+    if (ceng_ != 0) {
+      unsigned mcc = 0, mnc = 0, lac = 0, ci = 0;
+      uint8_t reg = registration();
+      if (reg == 1 || reg == 5) std::sscanf(settings_["cell"].c_str(), "%u,%u,%u,%u", &mcc, &mnc, &lac, &ci);
+      char cell[96];
+      std::snprintf(cell, sizeof(cell), "+CENG: 0,\"0518,40,00,%03u,%02u,26,%04x,05,05,%04x,255\"", mcc, mnc, ci, lac);
+      r += "\r\n\r\n" + std::string(cell);
+      // neighbours in mode 1 format, empty slots like the module shows them
+      std::string list = reg == 1 || reg == 5 ? settings_["neighbours"] : "";
+      for (int n = 1; n <= 6; n++) {
+        mcc = mnc = lac = 0;
+        ci = 0xFFFF;
+        size_t end = list.find(';');
+        if (!list.empty()) std::sscanf(list.c_str(), "%u,%u,%u,%u", &mcc, &mnc, &lac, &ci);
+        list = end == std::string::npos ? "" : list.substr(end + 1);
+        std::snprintf(cell, sizeof(cell), "+CENG: %d,\"%04d,%02d,%02d,%04x,%03u,%02u,%04x\"", n, mcc ? 520 + n : 0,
+                      mcc ? 40 - 3 * n : 0, mcc ? 20 + n : 0, ci, mcc, mnc, lac);
+        r += "\r\n\r\n" + std::string(cell);
+      }
+    }
+    reply(d, r);
+    ok(d);
+  } else if (u == "AT+HTTPINIT") {
+    if (http_) {
+      error(d);
+    } else {
+      http_ = true;
+      http_url_.clear();
+      ok(d);
+    }
+  } else if (starts_with(u, "AT+HTTPPARA=")) {
+    if (!http_) {
+      error(d);
+    } else {
+      if (starts_with(u, "AT+HTTPPARA=\"URL\",")) http_url_ = quoted(line.substr(18));
+      ok(d);
+    }
+  } else if (u == "AT+HTTPACTION=0") {
+    // GET over the bearer, status comes as URC when the geoserver answered
+    if (!http_) {
+      error(d);
+    } else {
+      ok(d);
+      vtime delay = 0;
+      parse_duration(settings_["httpdelay"], delay);
+      world_.at(now + d + delay, [this] {
+        std::string status = settings_["geoserver"];
+        bool geoserver = http_url_.find("/loc?c=") != std::string::npos;
+        std::string file;
+        if (!geoserver) status = read_file(settings_["httpfile"], file) ? "200" : "404";
+        if (bearer_ != Bearer::kConnected) status = "601";
+        if (status != "200") http_body_ = "404";
+        else http_body_ = geoserver ? "0," + settings_["location"] + "," + datetime() : file;
+        // the geoserver answer ends with CRLF
+        urc("+HTTPACTION: 0," + status + "," + std::to_string(http_body_.size() + (geoserver ? 2 : 0)), 0);
+      });
+    }
+  } else if (starts_with(u, "AT+HTTPREAD=")) {
+    // <start>,<size> of the answer, the firmware update reads it a flash page at a time
+    unsigned long start = 0, size = 0;
+    if (!http_ || std::sscanf(u.c_str() + 12, "%lu,%lu", &start, &size) != 2 || start >= http_body_.size()) {
+      error(d);
+    } else {
+      std::string part = http_body_.substr(start, size);
+      reply(d, "+HTTPREAD: " + std::to_string(part.size()) + "\r\n" + part);
+      ok(d);
+    }
+  } else if (u == "AT+HTTPREAD") {
+    if (!http_ || http_body_.empty()) {
+      error(d);
+    } else {
+      reply(d, "+HTTPREAD: " + std::to_string(http_body_.size() + 2) + "\r\n" + http_body_);
+      ok(d);
+    }
+  } else if (u == "AT+HTTPTERM") {
+    if (http_) ok(d);
+    else error(d);
+    http_ = false;
+    http_body_.clear();
+  } else if (starts_with(u, "AT+CGNSPWR=")) {
+    if (settings_["gnss"] == "none") {
+      error(d);
+    } else {
+      bool on = std::atoi(u.c_str() + 11) == 1;
+      if (on && !gnss_on_) {
+        // ephemeris kept in the backup domain while the receiver is off gives a hot start
+        vtime warm = 0;
+        gnss_on_at_ = now;
+        parse_duration(settings_["gnsswarm"], warm);
+        parse_duration(settings_[gnss_fixed_ && now - gnss_fixed_at_ < warm ? "gnsshot" : "gnssttff"], gnss_ttff_);
+        world_.log("EVENT", "GNSS on, " + std::string(gnss_ttff_ < gnss_ttff_cold() ? "hot" : "cold") + " start");
+      } else if (!on && gnss_on_) {
+        if (gnss_has_fix(now)) {
+          gnss_fixed_ = true;
+          gnss_fixed_at_ = now;
+        }
+        world_.log("EVENT", "GNSS off after " + format_time(now - gnss_on_at_) + " s");
+      }
+      gnss_on_ = on;
+      ok(d);
+    }
+  } else if (u == "AT+CGNSINF") {
+    // run,fix,utc,lat,lon,alt,speed,course,mode,,hdop,pdop,vdop,,in view,used,,,cn0,,
+    if (settings_["gnss"] == "none") {
+      error(d);
+      return;
+    }
+    std::string utc = datetime();
+    utc.erase(std::remove_if(utc.begin(), utc.end(), [](char c) { return !std::isdigit(static_cast<unsigned char>(c)); }),
+              utc.end());
+    utc += ".000";
+    if (!gnss_on_) {
+      reply(d, "+CGNSINF: 0,,,,,,,,,,,,,,,,,,,,");
+    } else if (gnss_has_fix(now)) {
+      reply(d, "+CGNSINF: 1,1," + utc + "," + settings_["gnsslocation"] + ",231.5," + settings_["gnssspeed"] +
+                   ",145.3,1,,0.9,1.2,0.8,,11,8,,,39,,");
+    } else {
+      reply(d, "+CGNSINF: 1,0," + utc + ",,,,0.00,0.0,0,,,,,,7,0,,,,,");
+    }
+    ok(d);
+  } else if (u == "AT+CCLK?") {
+    reply(d, "+CCLK: \"" + rtc() + "\"");
+    ok(d);
+  } else if (u == "AT+CBC") {
+    int mv = std::atoi(settings_["battery"].c_str());
+    int percent = std::max(0, std::min(100, (mv - 3500) / 7));
+    reply(d, "+CBC: 0," + std::to_string(percent) + "," + std::to_string(mv));
+    ok(d);
+  } else {
+    error(d);
+  }
+}
+
+bool Sim800l::location_fails() {
+  int percent = std::atoi(settings_["locfail"].c_str());
+  if (percent <= 0) return false;
+  std::uniform_int_distribution<int> roll(0, 99);
+  return roll(world_.rng()) < percent;
+}
+
+bool Sim800l::gnss_has_fix(vtime t) {
+  return gnss_on_ && settings_["gnss"] == "fix" && t - gnss_on_at_ >= gnss_ttff_;
+}
+
+vtime Sim800l::gnss_ttff_cold() {
+  vtime ttff = 0;
+  parse_duration(settings_["gnssttff"], ttff);
+  return ttff;
+}
+
+void Sim800l::incoming_call(const std::string& number, vtime duration) {
+  uint8_t reg = registration();
+  if (call_.active || (reg != 1 && reg != 5)) {
+    missed_calls_++;
+    world_.log("EVENT", "call from " + number + " not delivered");
+    return;
+  }
+  world_.log("EVENT", "call from " + number);
+  call_.active = true;
+  call_.number = number;
+  call_.until = world_.now() + duration;
+  call_.id++;
+  ring();
+}
+
+void Sim800l::ring() {
+  if (!call_.active) return;
+  if (world_.now() >= call_.until) {
+    // caller gave up before the tracker hung up
+    call_.active = false;
+    missed_calls_++;
+    urc("NO CARRIER", 0);
+    return;
+  }
+  urc("RING", 0);
+  if (clip_) urc("+CLIP: \"" + call_.number + "\",145,\"\",0,\"\",0", 0);
+  uint64_t id = call_.id;
+  world_.at(world_.now() + 3 * kSec, [this, id] {
+    if (call_.id == id) ring();
+  });
+}
+
+void Sim800l::incoming_sms(const std::string& number, const std::string& text) {
+  uint8_t reg = registration();
+  if (reg != 1 && reg != 5) {
+    // network keeps the SMS and delivers it after registration
+    world_.at(world_.now() + 10 * kSec, [this, number, text] { incoming_sms(number, text); });
+    return;
+  }
+  int index = 1;
+  while (storage_.count(index)) index++;
+  storage_[index] = Stored{number, text, false};
+  world_.log("EVENT", "SMS from " + number + " : " + text);
+  urc("+CMTI: \"SM\"," + std::to_string(index), 120 * kMsec);
+}
+
+// POWER DOWN URC, then SIM800L is off : bytes from the MCU are lost until restart
+void Sim800l::power_down(const std::string& text) {
+  urc(text, cfgri_ ? 120 * kMsec : 0);
+  powered_ = false;
+  call_.active = false;
+  tcp_close("");
+}
+
+void Sim800l::restart() {
+  world_.log("EVENT", "SIM800L restart");
+  powered_ = true;
+  echo_ = saved_echo_;
+  clip_ = false;
+  csclk_ = 0;
+  ceng_ = 0;
+  gnss_on_ = false;
+  gnss_fixed_ = false;      // backup domain is not powered through a restart
+  http_ = false;
+  http_body_.clear();
+  radio_on_ = true;
+  pin_ready_ = settings_["pin"] == "ready";
+  vtime regdelay = 0;
+  parse_duration(settings_["regdelay"], regdelay);
+  register_at(world_.now() + regdelay);
+  bearer_ = Bearer::kClosed;
+  ip_context_ = false;
+  ciphead_ = false;
+  tcp_close("");
+  call_.active = false;
+  line_.clear();
+  sms_text_mode_ = false;
+  vtime now = world_.now();
+  world_.at(now + 2 * kSec, [this] { urc("RDY", cfgri_ ? 120 * kMsec : 0); });
+  world_.at(now + 3 * kSec, [this] { urc("+CFUN: 1", 0); });
+  world_.at(now + 4 * kSec, [this] { urc(pin_ready_ ? "+CPIN: READY" : "+CPIN: SIM PIN", 0); });
+  world_.at(now + 6 * kSec, [this] { urc("Call Ready", cfgri_ ? 120 * kMsec : 0); });
+  world_.at(now + 7 * kSec, [this] { urc("SMS Ready", 0); });
+}
+
+}  // namespace sim
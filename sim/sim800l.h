@@ -0,0 +1,155 @@
+// ---------------------------------------------------------------------------
+// behavioural model of SIM800L for the AT commands used by the tracker
+// responses are sent in verbose mode "\r\n<text>\r\n" after a latency
+// taken from the scenario (longest matching prefix) or from defaults,
+// failures from the scenario replace the answer of matching commands
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "broker.h"
+#include "receiver.h"
+#include "scenario.h"
+#include "world.h"
+
+namespace sim {
+
+class Sim800l {
+ public:
+  struct Sms {
+    vtime at;
+    std::string to;
+    std::string text;
+  };
+  struct Command {
+    vtime at;
+    std::string line;
+  };
+
+  explicit Sim800l(World& world);
+
+  // schedule scenario events and power on
+  void start();
+  // byte received on SIM800L RXD from the MCU
+  void receive(uint8_t c);
+  // RI/RING output, low during incoming call and for 120 ms after URC
+  bool ri_low() const;
+
+  // modem state that scenario can change : creg, pin, pincode, battery,
+  // location, locfail, cell, datetime, timezone, nitz, bearer, echo, regdelay, broker (down closes the
+  // connection), receiver
+  void set(const std::string& key, const std::string& value);
+
+  // power state for the energy model : sleep, idle, search, radiooff, ring, gprs, sms
+  std::string power_state() const;
+  void trace_power();
+
+  const std::vector<Sms>& sent_sms() const { return sent_sms_; }
+  const std::vector<Command>& commands() const { return commands_; }
+  uint64_t missed_calls() const { return missed_calls_; }
+  uint64_t off_bytes() const { return off_bytes_; }
+  size_t stored_sms() const { return storage_.size(); }
+  uint64_t answered_calls() const { return answered_calls_; }
+  const Broker& broker() const { return broker_; }
+  const Receiver& receiver() const { return receiver_; }
+
+ private:
+  enum class Bearer { kClosed, kConnecting, kConnected };
+
+  void handle(const std::string& line);
+  vtime latency(const std::string& line);
+  void reply(vtime delay, const std::string& text);  // "\r\n<text>\r\n" lines
+  void ok(vtime delay) { reply(delay, "OK"); }
+  void error(vtime delay) { reply(delay, "ERROR"); }
+  void urc(const std::string& text, vtime ri_pulse);
+  bool asleep() const;
+  vtime sleep_idle() const;
+  void uart_activity(vtime t);
+  void register_at(vtime t);
+  void receive_byte(uint8_t c);
+  uint8_t registration() const;
+  std::string datetime() const;
+  std::string rtc() const;      // AT+CCLK? answer
+  void nitz(vtime t);
+  vtime clock() const;          // network time in microseconds since 2000-01-01 UTC
+  bool location_fails();        // random failure of a location query, setting locfail
+  bool gnss_has_fix(vtime t);
+  vtime gnss_ttff_cold();
+
+  void incoming_call(const std::string& number, vtime duration);
+  void ring();
+  void incoming_sms(const std::string& number, const std::string& text);
+  void restart();
+  void power_down(const std::string& text);
+  void tcp_close(const std::string& urc_text);
+
+  World& world_;
+
+  // settings
+  std::map<std::string, std::string> settings_;
+
+  // state
+  bool echo_ = false;
+  bool saved_echo_ = false;
+  bool clip_ = false;
+  bool cfgri_ = false;
+  bool clts_ = false;           // AT+CLTS=1, network time at registration
+  bool rtc_set_ = true;         // SIM800L clock has the time, else it runs from 2004/01/01
+  int csclk_ = 0;
+  int ceng_ = 0;                // engineering mode of AT+CENG
+  bool gnss_on_ = false;        // SIM808 GNSS receiver powered by AT+CGNSPWR=1
+  vtime gnss_on_at_ = 0;
+  vtime gnss_ttff_ = 0;         // of this power on, hot or cold start
+  bool gnss_fixed_ = false;     // the receiver had a fix when it was switched off
+  vtime gnss_fixed_at_ = 0;
+  bool http_ = false;           // AT+HTTPINIT done
+  std::string http_url_;
+  std::string http_body_;       // answer of the last AT+HTTPACTION for AT+HTTPREAD
+  bool radio_on_ = true;
+  bool powered_ = true;         // off after POWER DOWN until restart
+  uint64_t off_bytes_ = 0;      // received while off
+  bool pin_ready_ = true;
+  vtime registered_at_ = 0;
+  Bearer bearer_ = Bearer::kClosed;
+  vtime last_uart_ = 0;
+  vtime ri_low_until_ = 0;
+  vtime sms_tx_until_ = 0;
+  std::string line_;
+  bool sms_text_mode_ = false;
+  std::string sms_to_;
+  std::string sms_text_;
+  bool ip_context_ = false;     // AT+CIICR done, AT+CIPSHUT closes it
+  bool ciphead_ = false;        // +IPD,<length>: in front of received data
+  size_t cipsend_left_ = 0;     // bytes of AT+CIPSEND still to come, raw data mode while nonzero
+  std::string cipsend_data_;
+  vtime cipsend_from_ = 0;      // '>' prompt, bytes before it are not data
+  Broker broker_;               // at the other end of AT+CIPSTART="TCP"
+  bool udp_ = false;            // AT+CIPSTART="UDP" done, AT+CIPSEND data goes to receiver_
+  Receiver receiver_;
+
+  struct Call {
+    bool active = false;
+    std::string number;
+    vtime until = 0;
+    uint64_t id = 0;
+  } call_;
+
+  struct Stored {
+    std::string from;
+    std::string text;
+    bool read = false;
+  };
+  std::map<int, Stored> storage_;
+
+  std::vector<Failure> failures_;
+  std::vector<Sms> sent_sms_;
+  std::vector<Command> commands_;
+  uint64_t missed_calls_ = 0;
+  uint64_t answered_calls_ = 0;
+};
+
+}  // namespace sim
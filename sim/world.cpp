@@ -0,0 +1,123 @@
+// ---------------------------------------------------------------------------
+// virtual time, event queue and the UART wire between MCU and SIM800L
+// ---------------------------------------------------------------------------
+#include "world.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace sim {
+
+World::World(const Scenario& scenario) : scenario_(scenario), rng_(scenario.seed) {}
+
+void World::at(vtime t, std::function<void()> fn) {
+  events_.push(Pending{std::max(t, now_), seq_++, std::move(fn)});
+}
+
+vtime World::modem_send(vtime t, const std::string& bytes) {
+  vtime start = std::max(std::max(t, now_), tx_busy_until_);
+  for (size_t i = 0; i < bytes.size(); i++)
+    wire_.emplace_back(start + (i + 1) * kByteTime, static_cast<uint8_t>(bytes[i]));
+  tx_busy_until_ = start + bytes.size() * kByteTime;
+  return tx_busy_until_;
+}
+
+bool World::next_activity(vtime& t) const {
+  bool any = false;
+  if (!events_.empty()) {
+    t = events_.top().t;
+    any = true;
+  }
+  if (!wire_.empty() && (!any || wire_.front().first < t)) {
+    t = wire_.front().first;
+    any = true;
+  }
+  return any;
+}
+
+void World::advance_to(vtime t) {
+  if (finish_ != Finish::kRunning) return;
+  if (t > scenario_.end) t = scenario_.end;
+  for (;;) {
+    bool event_due = !events_.empty() && events_.top().t <= t;
+    bool byte_due = !wire_.empty() && wire_.front().first <= t;
+    if (!event_due && !byte_due) break;
+    if (byte_due && (!event_due || wire_.front().first <= events_.top().t)) {
+      now_ = std::max(now_, wire_.front().first);
+      uint8_t c = wire_.front().second;
+      wire_.pop_front();
+      deliver(c);
+    } else {
+      Pending p = events_.top();
+      events_.pop();
+      now_ = std::max(now_, p.t);
+      p.fn();
+      if (after_event) after_event();
+    }
+  }
+  now_ = std::max(now_, t);
+  if (now_ >= scenario_.end) finish(Finish::kEnd, "scenario end");
+}
+
+void World::deliver(uint8_t c) {
+  if (mcu_asleep_) {
+    lost_in_sleep++;
+    return;
+  }
+  if (rx_fifo_.size() < 2) {
+    rx_fifo_.push_back(c);
+    if (on_rx) on_rx();
+  } else {
+    if (shift_full_) overruns++;
+    shift_ = c;
+    shift_full_ = true;
+  }
+}
+
+uint8_t World::rx_pop() {
+  uint8_t c = rx_fifo_.front();
+  rx_fifo_.pop_front();
+  if (shift_full_) {
+    rx_fifo_.push_back(shift_);
+    shift_full_ = false;
+  }
+  return c;
+}
+
+void World::set_mcu_asleep(bool asleep) {
+  mcu_asleep_ = asleep;
+  trace("mcu", asleep ? "sleep" : "active");
+}
+
+void World::finish(Finish reason, const std::string& why) {
+  if (finish_ != Finish::kRunning) return;
+  finish_ = reason;
+  finish_why_ = why;
+}
+
+void World::log(const char* who, const std::string& text) {
+  if (log_enabled) std::printf("[%14s] %-6s %s\n", format_time(now_).c_str(), who, escape(text).c_str());
+}
+
+void World::trace(const std::string& component, const std::string& state) {
+  if (!tracing()) return;
+  std::string& last = traced_[component];
+  if (last == state) return;
+  vtime& since = traced_at_[component];
+  if (durations != nullptr && !last.empty()) (*durations)[component + " " + last] += now_ - since;
+  since = now_;
+  last = state;
+  if (trace_file != nullptr)
+    std::fprintf(trace_file, "%s %s %s\n", format_time(now_).c_str(), component.c_str(), state.c_str());
+}
+
+void World::close_durations(vtime end) {
+  if (durations == nullptr) return;
+  for (const auto& t : traced_) {
+    vtime since = traced_at_[t.first];
+    if (!t.second.empty() && end > since) (*durations)[t.first + " " + t.second] += end - since;
+    traced_at_[t.first] = end;
+  }
+}
+
+}  // namespace sim
@@ -0,0 +1,106 @@
+// ---------------------------------------------------------------------------
+// virtual time, event queue and the UART wire between MCU and SIM800L
+// the MCU receiver is modelled like AVR USART : 2 byte FIFO plus shift
+// register, bytes arriving while it is full overwrite the shift register
+// (data overrun) and bytes arriving in POWERDOWN are lost
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+
+namespace sim {
+
+constexpr vtime kByteTime = 1042;  // one 8N1 byte at 9600 bps
+
+enum class Finish { kRunning, kEnd, kHang, kIdle };
+
+class World {
+ public:
+  explicit World(const Scenario& scenario);
+
+  vtime now() const { return now_; }
+  const Scenario& scenario() const { return scenario_; }
+  std::mt19937& rng() { return rng_; }
+
+  // schedule callback at virtual time t (never in the past)
+  void at(vtime t, std::function<void()> fn);
+
+  // SIM800L TX line : queue bytes starting not earlier than t, returns time of last byte
+  vtime modem_send(vtime t, const std::string& bytes);
+  vtime modem_tx_idle_at() const { return tx_busy_until_; }
+
+  // earliest pending event or byte on the wire
+  bool next_activity(vtime& t) const;
+  // run events and deliver bytes up to t, stops at scenario end
+  void advance_to(vtime t);
+
+  // MCU USART receiver
+  bool rx_available() const { return !rx_fifo_.empty(); }
+  uint8_t rx_pop();
+  void set_mcu_asleep(bool asleep);
+  bool mcu_asleep() const { return mcu_asleep_; }
+
+  void finish(Finish reason, const std::string& why);
+  Finish finished() const { return finish_; }
+  const std::string& finish_reason() const { return finish_why_; }
+
+  // counters for the report
+  uint64_t overruns = 0;
+  uint64_t lost_in_sleep = 0;
+
+  // log of UART traffic and events when enabled by --log
+  bool log_enabled = false;
+  void log(const char* who, const std::string& text);
+
+  // power state trace "<time> <component> <state>" for the energy model,
+  // written on every change when trace_file is set (--trace)
+  std::FILE* trace_file = nullptr;
+  // the same states summed up in memory when set : "<component> <state>" -> time in it
+  std::map<std::string, vtime>* durations = nullptr;
+  bool tracing() const { return trace_file != nullptr || durations != nullptr; }
+  void trace(const std::string& component, const std::string& state);
+  // the states last traced last until 'end'
+  void close_durations(vtime end);
+  // called after every scheduled event, lets the modem trace its state
+  std::function<void()> after_event;
+  // called when a byte has entered the USART FIFO, runs the receive interrupt
+  std::function<void()> on_rx;
+
+ private:
+  struct Pending {
+    vtime t;
+    uint64_t seq;
+    std::function<void()> fn;
+    bool operator>(const Pending& o) const { return t != o.t ? t > o.t : seq > o.seq; }
+  };
+
+  void deliver(uint8_t c);
+
+  const Scenario& scenario_;
+  std::mt19937 rng_;
+  vtime now_ = 0;
+  uint64_t seq_ = 0;
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> events_;
+  std::deque<std::pair<vtime, uint8_t>> wire_;
+  vtime tx_busy_until_ = 0;
+  std::deque<uint8_t> rx_fifo_;
+  bool shift_full_ = false;
+  uint8_t shift_ = 0;
+  bool mcu_asleep_ = false;
+  Finish finish_ = Finish::kRunning;
+  std::string finish_why_;
+  std::map<std::string, std::string> traced_;
+  std::map<std::string, vtime> traced_at_;
+};
+
+}  // namespace sim
@@ -0,0 +1,110 @@
+// AT command and SMS strings for uart_puts_P(), generated by tools/atstrings
+// from strings/main.txt - edit that file and run the compile script again
+// 101 strings 1385 bytes, compressed 1035 bytes with dictionary, 350 bytes of flash saved
+// bytes 0x80..0xFF stand for the ATDICT entry at offset (byte - 0x80)
+
+#define AT_DICT 1
+
+const char ATDICT[] PROGMEM = { "AT+C\000AT+SAPBR=\000\"internet\"\000\r\n\000AT+HTTPPARA=\"URL\",\"http://192.168.1.10:8080/\000AT+HTTP\000P\",\"192.168.1.10\",\0003,1,\"\000AT\000MGDA=\"DEL \000\n\r\000=1\000" };
+
+const char AT[] PROGMEM = { "\353\371" };
+const char SHOW_REGISTRATION[] PROGMEM = { "\200REG?\371" };   // check registration status
+const char DISREGURC[] PROGMEM = { "\200REG=0\371" };   // we disable realtime reporting of 2G network status
+const char SHOW_PIN[] PROGMEM = { "\200PIN?\371" };
+const char ECHO_OFF[] PROGMEM = { "\353E0\371" };
+const char ENTER_PIN[] PROGMEM = { "\200PIN=\"1111\"\371" };   // put PINCODE of your SIMCARD here if you have different than 1111...
+const char CFGRIPIN[] PROGMEM = { "\200FGRI\374\371" };
+const char HANGUP[] PROGMEM = { "\353H\371" };
+const char SMS1[] PROGMEM = { "\200MGF\374\232" };
+const char SMS2[] PROGMEM = { "\200MGS=\"" };
+const char DELSMS[] PROGMEM = { "\200\356ALL\"\232" };
+const char DELREAD[] PROGMEM = { "\200\356READ\"\232" };
+const char CRLF[] PROGMEM = { "\"\371" };
+const char CLIP[] PROGMEM = { "\200LIP\374\232" };
+const char FLIGHTON[] PROGMEM = { "\200FUN=4\232" };
+const char FLIGHTOFF[] PROGMEM = { "\200FUN\374\232" };
+const char SLEEPON[] PROGMEM = { "\200SCLK=2\232" };
+const char SLEEPOFF[] PROGMEM = { "\200SCLK=0\232" };
+const char SET9600[] PROGMEM = { "\353+IPR=9600\232" };
+const char SAVECNF[] PROGMEM = { "\353&W\232" };
+const char DISABLELED[] PROGMEM = { "\200NETLIGHT=0\232" };
+const char GOOGLELOC1[] PROGMEM = { "\232 http://maps.google.com/maps?q=" };
+const char GOOGLELOC2[] PROGMEM = { "," };
+const char GOOGLELOC3[] PROGMEM = { "\232" };
+const char LONG[] PROGMEM = { " UTC\n LONGTITUDE=" };
+const char LATT[] PROGMEM = { " L\353ITUDE=" };
+const char ACCTXT[] PROGMEM = { " ACCURACY[m]=" };
+const char BATT[] PROGMEM = { "\nB\353TERY[mV]=" };
+const char SAPBR1[] PROGMEM = { "\205\345CONTYPE\",\"GPRS\"\232" };
+const char SAPBR2[] PROGMEM = { "\205\345APN\",\217\232" };   // Put your mobile operator APN name here
+const char SAPBR3[] PROGMEM = { "\205\345USER\",\217\232" };   // Put your mobile operator APN username here
+const char SAPBR4[] PROGMEM = { "\205\345PWD\",\217\232" };   // Put your mobile operator APN password here
+const char SAPBROPEN[] PROGMEM = { "\2051,1\232" };   // open IP bearer
+const char SAPBRQUERY[] PROGMEM = { "\2052,1\232" };   // query IP bearer
+const char SAPBRCLOSE[] PROGMEM = { "\2050,1\232" };   // close bearer
+const char CHECKGPS[] PROGMEM = { "\200IPGSMLOC\374,1\232" };   // check GPS position of nearest GSM CELL via Google API
+const char CHECKLBS[] PROGMEM = { "\200LBS=4,1\232" };   // position with accuracy radius, newer SIM800L firmware (FEATURE_STATS)
+const char CHECKBATT[] PROGMEM = { "\200BC\232" };   // check battery voltage
+const char CENGON[] PROGMEM = { "\200ENG\374,0\232" };   // engineering mode, serving cell for the cell database
+const char CENGQUERY[] PROGMEM = { "\200ENG?\232" };
+const char CHECKCLOCK[] PROGMEM = { "\200CLK?\232" };   // SIM800L clock for SMS from the cell database
+const char CLTSON[] PROGMEM = { "\200LTS\374\232" };   // network time (NITZ) to SIM800L clock and *PSUTTZ URC (FEATURE_CLOCK)
+const char HTTPINIT[] PROGMEM = { "\312INIT\232" };   // HTTP GET to the geoserver (FEATURE_GEOSERVER) over the bearer
+const char HTTPCID[] PROGMEM = { "\312PARA=\"CID\",1\232" };
+const char HTTPURL[] PROGMEM = { "\235loc?c=" };   // Put address of your geoserver here
+const char HTTPGET[] PROGMEM = { "\312ACTION=0\232" };
+const char HTTPREAD[] PROGMEM = { "\312READ\232" };
+const char HTTPTERM[] PROGMEM = { "\312TERM\232" };
+const char OTAURL[] PROGMEM = { "\235fw/main.ota\"\232" };   // firmware update (FEATURE_OTA), put your server here
+const char HTTPREADAT[] PROGMEM = { "\312READ=" };   // <start>,<size> of the update download
+const char CIPSHUT[] PROGMEM = { "\200IPSHUT\232" };   // IP stack of MQTT broker and UDP receiver (FEATURE_MQTT, FEATURE_UDP)
+const char CSTT[] PROGMEM = { "\200STT=\217,\217,\217\232" };   // APN, username and password as in SAPBR2-4
+const char CIICR[] PROGMEM = { "\200IICR\232" };
+const char CIFSR[] PROGMEM = { "\200IFSR\232" };
+const char CIPHEAD[] PROGMEM = { "\200IPHEAD\374\232" };
+const char MQTTOPEN[] PROGMEM = { "\200IPSTART=\"TC\3221883\232" };   // Put address of your MQTT broker here
+const char UDPOPEN[] PROGMEM = { "\200IPSTART=\"UD\3225005\232" };   // Put address of your UDP report receiver here
+const char CIPSEND[] PROGMEM = { "\200IPSEND=" };
+const char GNSSON[] PROGMEM = { "\200GNSPWR\374\232" };   // SIM808 GNSS receiver on (FEATURE_GNSS)
+const char GNSSOFF[] PROGMEM = { "\200GNSPWR=0\232" };
+const char GNSSINF[] PROGMEM = { "\200GNSINF\232" };   // fix, time, position, speed, HDOP, satellites
+const char READSMS[] PROGMEM = { "\200MGR=" };   // read SMS of index from +CMTI
+const char DELONESMS[] PROGMEM = { "\200MGD=" };   // delete SMS of index from +CMTI
+const char EOL[] PROGMEM = { "\232" };
+const char STATSHDR[] PROGMEM = { "ST\353S[s]" };
+const char STATE0[] PROGMEM = { " SLEEP=" };
+const char STATE1[] PROGMEM = { " AWAKE=" };
+const char STATE2[] PROGMEM = { " GPRS=" };
+const char STATE3[] PROGMEM = { " SMS=" };
+const char STATE4[] PROGMEM = { " NOCOV=" };
+const char RINGS[] PROGMEM = { "\nRING=" };
+const char LOCFAIL[] PROGMEM = { " LOCFAIL=" };
+const char LOCERRS[] PROGMEM = { " LOCERR=" };   // network/timeout/reset/other errors of CIPGSMLOC
+const char SAPBRRETRY[] PROGMEM = { " SAPBRRETRY=" };
+const char STACKFREE[] PROGMEM = { "\nSTACKFREE=" };   // bytes of RAM the stack has never reached
+const char GNSSSTATS[] PROGMEM = { "\nGNSS ON=" };   // receiver on-time [s], fixes/windows, last/average TTFF (FEATURE_GNSS)
+const char GNSSFIXES[] PROGMEM = { " FIX=" };
+const char TTFFTXT[] PROGMEM = { " TTFF=" };
+const char WINDOWTXT[] PROGMEM = { " WIN=" };
+const char LIVESTATS[] PROGMEM = { "\nLIVE=" };   // live sessions, positions published, MQTT bytes (FEATURE_MQTT)
+const char PUBTXT[] PROGMEM = { " PUB=" };
+const char BYTESTXT[] PROGMEM = { " BYTES=" };
+const char UDPSTATS[] PROGMEM = { "\nUDP=" };   // reports sent, datagrams sent, reports acknowledged (FEATURE_UDP)
+const char DGRAMTXT[] PROGMEM = { " DGRAM=" };
+const char ACKTXT[] PROGMEM = { " ACK=" };
+const char CLOCKSTATS[] PROGMEM = { "\nCLOCK=" };   // software clock [s since 2000 UTC], syncs, watchdog drift [ppm] (FEATURE_CLOCK)
+const char SYNCTXT[] PROGMEM = { " SYNC=" };
+const char DRIFTTXT[] PROGMEM = { " DRIFT=" };
+const char LASTKNOWN[] PROGMEM = { "LAST KNOWN AGE[min]=" };   // location SMS of the last position when the query failed
+const char LOCERRTXT[] PROGMEM = { " ERROR=" };
+const char NOLOCTXT[] PROGMEM = { "NO LOC\353ION ERROR=" };
+const char STATUSHDR[] PROGMEM = { "ST\353US TRACK=" };   // answer to SMS commands
+const char INTERVALTXT[] PROGMEM = { " INTERVAL=" };
+const char BACKOFFTXT[] PROGMEM = { " BACKOFF=" };
+const char LIVETXT[] PROGMEM = { " LIVE=" };   // minutes/seconds of live mode (FEATURE_MQTT)
+const char FWTXT[] PROGMEM = { " FW=" };   // firmware version and result of the last update (FEATURE_OTA)
+const char OTATXT[] PROGMEM = { " OTA=" };
+const char SPEEDTXT[] PROGMEM = { "SPEED[km/h]=" };   // location SMS of GNSS fix
+const char HDOPTXT[] PROGMEM = { " HDOP=" };
+const char SATSTXT[] PROGMEM = { " S\353S=" };
+const char CTRLZ[] PROGMEM = { "\032" };   // CTRL Z ends SMS text
@@ -0,0 +1,36 @@
+// AT command and SMS strings for uart_puts_P(), generated by tools/atstrings
+// from strings/main3.txt - edit that file and run the compile script again
+// 30 strings 429 bytes, not compressed (-p)
+
+#define AT_DICT 0
+
+const char AT[] PROGMEM = { "AT\n\r" };   // wakeup from sleep mode
+const char SHOW_REGISTRATION[] PROGMEM = { "AT+CREG?\n\r" };
+const char SHOW_PIN[] PROGMEM = { "AT+CPIN?\n\r" };
+const char ECHO_OFF[] PROGMEM = { "ATE0\n\r" };
+const char ENTER_PIN[] PROGMEM = { "AT+CPIN=\"1111\"\n\r" };
+const char CFGRIPIN[] PROGMEM = { "AT+CFGRI=1\n\r" };
+const char HANGUP[] PROGMEM = { "ATH\n\r" };
+const char SMS1[] PROGMEM = { "AT+CMGF=1\r\n" };
+const char SMS2[] PROGMEM = { "AT+CMGS=\"" };   // for other networks if they show +XX in CLIP
+const char DELSMS[] PROGMEM = { "AT+CMGDA=\"DEL ALL\"\r\n" };
+const char CRLF[] PROGMEM = { "\"\n\r" };
+const char CLIP[] PROGMEM = { "AT+CLIP=1\r\n" };
+const char SLEEPON[] PROGMEM = { "AT+CSCLK=2\r\n" };
+const char SLEEPOFF[] PROGMEM = { "AT+CSCLK=0\r\n" };
+const char SET9600[] PROGMEM = { "AT+IPR=9600\r\n" };
+const char SAVECNF[] PROGMEM = { "AT&W\r\n" };
+const char GOOGLELOC1[] PROGMEM = { "\r\n http://maps.google.com/maps?q=" };
+const char GOOGLELOC2[] PROGMEM = { "," };
+const char GOOGLELOC3[] PROGMEM = { "\r\n" };
+const char LONG[] PROGMEM = { " UTC\n LONG=" };
+const char LATT[] PROGMEM = { " LATT=" };
+const char SAPBR1[] PROGMEM = { "AT+SAPBR=3,1,\"CONTYPE\",\"GPRS\"\r\n" };
+const char SAPBR2[] PROGMEM = { "AT+SAPBR=3,1,\"APN\",\"internet\"\r\n" };   // Put your mobile operator APN name here
+const char SAPBR3[] PROGMEM = { "AT+SAPBR=3,1,\"USER\",\"internet\"\r\n" };   // Put your mobile operator APN username here
+const char SAPBR4[] PROGMEM = { "AT+SAPBR=3,1,\"PWD\",\"internet\"\r\n" };   // Put your mobile operator APN password here
+const char SAPBROPEN[] PROGMEM = { "AT+SAPBR=1,1\r\n" };   // open IP bearer
+const char SAPBRQUERY[] PROGMEM = { "AT+SAPBR=2,1\r\n" };   // query IP bearer
+const char SAPBRCLOSE[] PROGMEM = { "AT+SAPBR=0,1\r\n" };   // close bearer
+const char CHECKGPS[] PROGMEM = { "AT+CIPGSMLOC=1,1\r\n" };   // check GPS position of nearest GSM CELL via Google API
+const char CTRLZ[] PROGMEM = { "\032" };   // CTRL Z ends SMS text
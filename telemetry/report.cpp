@@ -0,0 +1,109 @@
+// ---------------------------------------------------------------------------
+// UDP report of the tracker, encoding and decoding, see report.h
+// ---------------------------------------------------------------------------
+#include "report.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace telemetry {
+
+namespace {
+
+void put16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v >> 8);
+  p[1] = static_cast<uint8_t>(v);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+  put16(p, static_cast<uint16_t>(v >> 16));
+  put16(p + 2, static_cast<uint16_t>(v));
+}
+
+uint16_t get16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+uint32_t get32(const uint8_t* p) { return (static_cast<uint32_t>(get16(p)) << 16) | get16(p + 2); }
+
+}  // namespace
+
+uint16_t crc16(const uint8_t* p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  while (n--) {
+    crc ^= static_cast<uint16_t>(*p++) << 8;
+    for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+}
+
+size_t encode(const Report& r, uint8_t* out) {
+  out[0] = kReport;
+  out[1] = r.flags;
+  put32(out + 2, r.device);
+  put16(out + 6, r.seq);
+  put32(out + 8, static_cast<uint32_t>(r.lat));
+  put32(out + 12, static_cast<uint32_t>(r.lon));
+  put32(out + 16, r.time);
+  put16(out + 20, r.accuracy);
+  put16(out + 22, r.battery);
+  put16(out + 24, r.mcc);
+  put16(out + 26, r.mnc);
+  put16(out + 28, r.lac);
+  put16(out + 30, r.ci);
+  put16(out + 32, crc16(out, kReportSize - 2));
+  return kReportSize;
+}
+
+bool decode(const uint8_t* p, size_t n, Report& r) {
+  if (n != kReportSize || p[0] != kReport || get16(p + 32) != crc16(p, kReportSize - 2)) return false;
+  r.flags = p[1];
+  r.device = get32(p + 2);
+  r.seq = get16(p + 6);
+  r.lat = static_cast<int32_t>(get32(p + 8));
+  r.lon = static_cast<int32_t>(get32(p + 12));
+  r.time = get32(p + 16);
+  r.accuracy = get16(p + 20);
+  r.battery = get16(p + 22);
+  r.mcc = get16(p + 24);
+  r.mnc = get16(p + 26);
+  r.lac = get16(p + 28);
+  r.ci = get16(p + 30);
+  return true;
+}
+
+size_t encode_ack(uint32_t device, uint16_t seq, uint8_t* out) {
+  out[0] = kAck;
+  out[1] = 0;
+  put32(out + 2, device);
+  put16(out + 6, seq);
+  put16(out + 8, crc16(out, kAckSize - 2));
+  return kAckSize;
+}
+
+bool decode_ack(const uint8_t* p, size_t n, uint32_t& device, uint16_t& seq) {
+  if (n != kAckSize || p[0] != kAck || get16(p + 8) != crc16(p, kAckSize - 2)) return false;
+  device = get32(p + 2);
+  seq = get16(p + 6);
+  return true;
+}
+
+std::string datetime(uint32_t time) {
+  std::time_t t = static_cast<std::time_t>(kEpoch2000 + time);
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  char text[24];
+  std::strftime(text, sizeof(text), "%Y/%m/%d,%H:%M:%S", &tm);
+  return text;
+}
+
+std::string format(const Report& r) {
+  char text[200];
+  std::snprintf(text, sizeof(text), "device=%u seq=%u time=%s lat=%s%d.%06d lon=%s%d.%06d acc=%u batt=%u cell=%u,%u,%X,%X%s%s",
+                r.device, r.seq, datetime(r.time).c_str(), r.lat < 0 ? "-" : "", std::abs(r.lat / 1000000),
+                std::abs(r.lat % 1000000), r.lon < 0 ? "-" : "", std::abs(r.lon / 1000000), std::abs(r.lon % 1000000),
+                r.accuracy, r.battery, r.mcc, r.mnc, r.lac, r.ci, r.flags & kFlagStale ? " stale" : "",
+                r.flags & kFlagRetransmit ? " retransmit" : "");
+  return text;
+}
+
+}  // namespace telemetry
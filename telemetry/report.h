@@ -0,0 +1,70 @@
+// ---------------------------------------------------------------------------
+// UDP report of the tracker (FEATURE_UDP) and its ack, shared by the
+// reference receiver (udprx), the sender of test reports (udpsend) and the
+// receiver stand-in of the simulator
+//
+// report v1, 34 bytes, big endian :
+//    0 u8  type 0x01
+//    1 u8  flags : 1 ack wanted, 2 last known position (stale), 4 retransmit
+//    2 u32 device id (UDP_DEVICE)
+//    6 u16 sequence number, the same in retransmits of one report
+//    8 i32 latitude, millionths of degree
+//   12 i32 longtitude, millionths of degree
+//   16 u32 time of the position, seconds since 2000-01-01 00:00:00 UTC
+//   20 u16 accuracy radius [m], 0 when not known
+//   22 u16 battery [mV]
+//   24 u16 mcc, 26 u16 mnc, 28 u16 lac, 30 u16 cell id - serving cell, zeros
+//          when it was not known
+//   32 u16 CRC-16/CCITT-FALSE of bytes 0..31
+//
+// ack, 10 bytes : 0x81, flags 0, device u32, sequence u16, CRC of bytes 0..7
+// ---------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace telemetry {
+
+constexpr size_t kReportSize = 34;
+constexpr size_t kAckSize = 10;
+constexpr uint8_t kReport = 0x01;
+constexpr uint8_t kAck = 0x81;
+constexpr uint8_t kFlagAck = 1;
+constexpr uint8_t kFlagStale = 2;
+constexpr uint8_t kFlagRetransmit = 4;
+constexpr int64_t kEpoch2000 = 946684800;   // unix time of 2000-01-01 00:00:00 UTC
+constexpr size_t kUdpIpHeader = 28;          // IPv4 and UDP header of every datagram on air
+
+struct Report {
+  uint8_t flags = 0;
+  uint32_t device = 0;
+  uint16_t seq = 0;
+  int32_t lat = 0;       // millionths of degree
+  int32_t lon = 0;
+  uint32_t time = 0;     // seconds since 2000-01-01 UTC
+  uint16_t accuracy = 0;
+  uint16_t battery = 0;
+  uint16_t mcc = 0;
+  uint16_t mnc = 0;
+  uint16_t lac = 0;
+  uint16_t ci = 0;
+};
+
+uint16_t crc16(const uint8_t* p, size_t n);
+
+// kReportSize bytes to 'out', the CRC is computed
+size_t encode(const Report& r, uint8_t* out);
+// false when the size, type or CRC is wrong
+bool decode(const uint8_t* p, size_t n, Report& r);
+
+size_t encode_ack(uint32_t device, uint16_t seq, uint8_t* out);
+bool decode_ack(const uint8_t* p, size_t n, uint32_t& device, uint16_t& seq);
+
+// 2020/01/01,12:00:00 of the report time
+std::string datetime(uint32_t time);
+// one line : device, sequence, time, position, accuracy, battery, cell and flags
+std::string format(const Report& r);
+
+}  // namespace telemetry
@@ -0,0 +1,151 @@
+// ---------------------------------------------------------------------------
+// reference receiver of the UDP reports of the tracker (FEATURE_UDP)
+//   udprx [-p port] [-n] [-c reports] [-q]
+// every datagram is checked (size, type, CRC), a report with the ack flag is
+// acknowledged - retransmits too, their ack may have been the lost datagram -
+// and printed once per device and sequence number with its latency : arrival
+// here minus the time of the position in it, so it includes locating, the
+// GPRS attach and the retransmits. -n sends no acks, -c exits after that many
+// reports, -q prints only the summary. SIGINT / SIGTERM print the summary too :
+// reports, duplicates, bad datagrams, bytes of the reports with and without
+// the IPv4/UDP header of every datagram and the latency p50 / p95 / max
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "report.h"
+
+namespace {
+
+volatile sig_atomic_t stop = 0;
+
+void on_signal(int) { stop = 1; }
+
+struct Totals {
+  uint64_t datagrams = 0;
+  uint64_t reports = 0;       // unique device and sequence number
+  uint64_t duplicates = 0;    // retransmits of reports already taken
+  uint64_t bad = 0;
+  uint64_t acks = 0;
+  uint64_t bytes = 0;         // UDP payload of all datagrams received
+  uint64_t ack_bytes = 0;
+  std::vector<double> latency;
+};
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+void summary(const Totals& t) {
+  uint64_t air = t.bytes + t.datagrams * telemetry::kUdpIpHeader;
+  uint64_t ack_air = t.ack_bytes + t.acks * telemetry::kUdpIpHeader;
+  std::printf("udprx: %llu reports, %llu datagrams, %llu duplicates, %llu bad, %llu acks\n",
+              static_cast<unsigned long long>(t.reports), static_cast<unsigned long long>(t.datagrams),
+              static_cast<unsigned long long>(t.duplicates), static_cast<unsigned long long>(t.bad),
+              static_cast<unsigned long long>(t.acks));
+  std::printf("udprx: bytes up %llu payload, %llu with IP/UDP headers, %.1f per report; down %llu with headers\n",
+              static_cast<unsigned long long>(t.bytes), static_cast<unsigned long long>(air),
+              t.reports ? static_cast<double>(air) / t.reports : 0.0, static_cast<unsigned long long>(ack_air));
+  std::printf("udprx: latency p50 %.1f s p95 %.1f s max %.1f s\n", percentile(t.latency, 0.5),
+              percentile(t.latency, 0.95), t.latency.empty() ? 0.0 : *std::max_element(t.latency.begin(), t.latency.end()));
+  std::fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int port = 5005;
+  bool ack = true, quiet = false;
+  uint64_t count = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-p" && i + 1 < argc) port = std::atoi(argv[++i]);
+    else if (a == "-c" && i + 1 < argc) count = std::strtoull(argv[++i], nullptr, 10);
+    else if (a == "-n") ack = false;
+    else if (a == "-q") quiet = true;
+    else {
+      std::fprintf(stderr, "usage: %s [-p port] [-n] [-c reports] [-q]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    std::fprintf(stderr, "udprx: port %d: %s\n", port, std::strerror(errno));
+    return 2;
+  }
+  // no SA_RESTART, so recvfrom() returns at the signal and the summary is printed
+  struct sigaction sa {};
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+  std::printf("udprx: port %d, acks %s\n", port, ack ? "on" : "off");
+  std::fflush(stdout);
+
+  Totals t;
+  std::set<std::pair<uint32_t, uint16_t>> seen;
+  uint8_t buf[1500];
+  while (!stop && (count == 0 || t.reports < count)) {
+    sockaddr_in from{};
+    socklen_t len = sizeof(from);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&from), &len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      std::fprintf(stderr, "udprx: %s\n", std::strerror(errno));
+      return 1;
+    }
+    t.datagrams++;
+    t.bytes += static_cast<uint64_t>(n);
+    telemetry::Report r;
+    if (!telemetry::decode(buf, static_cast<size_t>(n), r)) {
+      t.bad++;
+      continue;
+    }
+    if (ack && (r.flags & telemetry::kFlagAck)) {
+      uint8_t a[telemetry::kAckSize];
+      size_t m = telemetry::encode_ack(r.device, r.seq, a);
+      if (sendto(fd, a, m, 0, reinterpret_cast<sockaddr*>(&from), len) == static_cast<ssize_t>(m)) {
+        t.acks++;
+        t.ack_bytes += m;
+      }
+    }
+    if (!seen.insert({r.device, r.seq}).second) {
+      t.duplicates++;
+      continue;
+    }
+    t.reports++;
+    double now = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    double latency = r.time ? now - static_cast<double>(telemetry::kEpoch2000 + r.time) : 0;
+    if (r.time) t.latency.push_back(latency);
+    if (!quiet) {
+      char ip[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &from.sin_addr, ip, sizeof(ip));
+      std::printf("%s %s bytes=%zd latency=%.1fs\n", ip, telemetry::format(r).c_str(), n, latency);
+      std::fflush(stdout);
+    }
+  }
+  close(fd);
+  summary(t);
+  return 0;
+}
@@ -0,0 +1,122 @@
+// ---------------------------------------------------------------------------
+// sender of test reports to udprx, the same ack and retransmit rules as the
+// firmware without a tracker
+//   udpsend [-h host] [-p port] [-n reports] [-d device] [-t tries] [-w ms] [-l loss%]
+// every report is sent with the ack flag and sent again (retransmit flag set)
+// when its ack does not come in -w ms, at most -t datagrams like UDP_TRIES.
+// -l drops that share of the datagrams before they leave, so retransmits
+// can be tried on localhost. Prints reports acknowledged, datagrams and the
+// round trip of the acks p50 / p95, exit code 1 when a report got no ack
+// ---------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "report.h"
+
+namespace {
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[static_cast<size_t>(p * (v.size() - 1) + 0.5)];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string host = "127.0.0.1";
+  int port = 5005, tries = 3, wait_ms = 500, loss = 0;
+  unsigned reports = 100;
+  uint32_t device = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-h" && i + 1 < argc) host = argv[++i];
+    else if (a == "-p" && i + 1 < argc) port = std::atoi(argv[++i]);
+    else if (a == "-n" && i + 1 < argc) reports = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (a == "-d" && i + 1 < argc) device = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    else if (a == "-t" && i + 1 < argc) tries = std::atoi(argv[++i]);
+    else if (a == "-w" && i + 1 < argc) wait_ms = std::atoi(argv[++i]);
+    else if (a == "-l" && i + 1 < argc) loss = std::atoi(argv[++i]);
+    else {
+      std::fprintf(stderr, "usage: %s [-h host] [-p port] [-n reports] [-d device] [-t tries] [-w ms] [-l loss%%]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (fd < 0 || inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+    std::fprintf(stderr, "udpsend: cannot reach %s:%d\n", host.c_str(), port);
+    return 2;
+  }
+
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<double> rtt;
+  unsigned acked = 0, datagrams = 0, dropped = 0;
+  for (unsigned i = 0; i < reports; i++) {
+    telemetry::Report r;
+    r.flags = telemetry::kFlagAck;
+    r.device = device;
+    r.seq = static_cast<uint16_t>(i + 1);
+    r.lat = 50064651 + static_cast<int32_t>(i) * 10;     // a walk east of Krakow
+    r.lon = 19945490 + static_cast<int32_t>(i) * 25;
+    r.accuracy = 550;
+    r.battery = 4100;
+    r.mcc = 260;
+    r.mnc = 1;
+    r.lac = 0x2A4B;
+    r.ci = 0x1F3C;
+    r.time = static_cast<uint32_t>(std::time(nullptr) - telemetry::kEpoch2000);
+    bool got = false;
+    for (int t = 0; t < tries && !got; t++) {
+      uint8_t d[telemetry::kReportSize];
+      telemetry::encode(r, d);
+      r.flags |= telemetry::kFlagRetransmit;
+      auto sent = std::chrono::steady_clock::now();
+      datagrams++;
+      if (percent(rng) < loss) dropped++;
+      else if (send(fd, d, sizeof(d), 0) < 0) continue;
+      // acks of earlier datagrams of this report count, acks of older reports are skipped
+      for (;;) {
+        int left = wait_ms - static_cast<int>(std::chrono::duration<double, std::milli>(
+                                                   std::chrono::steady_clock::now() - sent).count());
+        pollfd p{fd, POLLIN, 0};
+        if (left <= 0 || poll(&p, 1, left) <= 0) break;
+        uint8_t a[64];
+        ssize_t n = recv(fd, a, sizeof(a), 0);
+        uint32_t dev = 0;
+        uint16_t seq = 0;
+        if (n > 0 && telemetry::decode_ack(a, static_cast<size_t>(n), dev, seq) && dev == r.device && seq == r.seq) {
+          rtt.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sent).count());
+          got = true;
+          break;
+        }
+      }
+    }
+    if (got) acked++;
+  }
+  close(fd);
+  std::printf("udpsend: %u of %u reports acknowledged, %u datagrams (%u dropped here), %zu bytes on air with IP/UDP\n",
+              acked, reports, datagrams, dropped,
+              (datagrams - dropped) * (telemetry::kReportSize + telemetry::kUdpIpHeader));
+  std::printf("udpsend: ack round trip p50 %.3f ms p95 %.3f ms\n", percentile(rtt, 0.5), percentile(rtt, 0.95));
+  return acked == reports ? 0 : 1;
+}
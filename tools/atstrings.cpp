@@ -0,0 +1,241 @@
+// ---------------------------------------------------------------------------
+// AT string compressor for the tracker firmware
+//   atstrings strings/main.txt strings/main.h
+//   atstrings -p strings/main3.txt strings/main3.h   plain strings, no dictionary
+// reads lines  NAME "C string"  # comment  (escapes \r \n \t \" \\ \ooo)
+// and writes a header with the
+// strings as PROGMEM arrays for uart_puts_P(). Substrings shared by several
+// strings ("AT+SAPBR=", "\r\n", "\",\"internet\"" ...) are moved once to the
+// dictionary ATDICT, in the strings they are replaced by one byte 0x80+offset
+// of the entry in ATDICT. Entries end with 0 and have no tokens, so the
+// decompressor in uart_puts_P() is a loop in a loop. AT commands are plain
+// ASCII, bytes below 0x80 are sent as they are.
+// Prints bytes of flash saved on strings (decompressor code not included).
+// The header defines AT_DICT 1 when uart_puts_P() has to expand tokens, with
+// -p it is 0 : ATTINY2313 versions leave the decompressor out, on 2 kB of
+// flash its loop costs more than the strings save.
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kDictMax = 128;  // token is 0x80 + offset of the entry
+
+struct Entry {
+  std::string name;
+  std::string text;
+  std::string comment;
+  std::vector<int> code;  // characters 0..127, tokens 0x80..0xFF
+};
+
+bool parse_string(const std::string& line, size_t& pos, std::string& out) {
+  if (pos >= line.size() || line[pos] != '"') return false;
+  for (pos++; pos < line.size(); pos++) {
+    char c = line[pos];
+    if (c == '"') {
+      pos++;
+      return true;
+    }
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    if (++pos == line.size()) return false;
+    switch (line[pos]) {
+      case 'r': out += '\r'; break;
+      case 'n': out += '\n'; break;
+      case 't': out += '\t'; break;
+      case '"': out += '"'; break;
+      case '\\': out += '\\'; break;
+      case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': {
+        // octal like "\032" for CTRL-Z ending an SMS
+        int value = 0;
+        for (int digits = 0; digits < 3 && pos < line.size() && line[pos] >= '0' && line[pos] <= '7'; digits++)
+          value = value * 8 + (line[pos++] - '0');
+        pos--;
+        out += static_cast<char>(value);
+        break;
+      }
+      default: return false;
+    }
+  }
+  return false;
+}
+
+bool load(const std::string& path, std::vector<Entry>& entries) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::string line;
+  int number = 0;
+  while (std::getline(in, line)) {
+    number++;
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos || line[pos] == '#') continue;
+    Entry e;
+    size_t end = line.find_first_of(" \t", pos);
+    e.name = line.substr(pos, end - pos);
+    pos = line.find_first_not_of(" \t", end);
+    if (end == std::string::npos || pos == std::string::npos || !parse_string(line, pos, e.text)) {
+      std::fprintf(stderr, "%s:%d: expected NAME \"text\"\n", path.c_str(), number);
+      return false;
+    }
+    for (char c : e.text) {
+      if (static_cast<unsigned char>(c) >= 0x80 || c == 0) {
+        std::fprintf(stderr, "%s:%d: only 7 bit ASCII can be compressed\n", path.c_str(), number);
+        return false;
+      }
+    }
+    size_t hash = line.find('#', pos);
+    if (hash != std::string::npos) {
+      e.comment = line.substr(line.find_first_not_of(" \t", hash + 1));
+    }
+    for (char c : e.text) e.code.push_back(c);
+    entries.push_back(e);
+  }
+  return true;
+}
+
+// occurrences of plain text w in code, not overlapping and not crossing tokens
+int count(const std::vector<int>& code, const std::string& w) {
+  int n = 0;
+  for (size_t i = 0; i + w.size() <= code.size();) {
+    size_t k = 0;
+    while (k < w.size() && code[i + k] == w[k]) k++;
+    if (k == w.size()) {
+      n++;
+      i += w.size();
+    } else {
+      i++;
+    }
+  }
+  return n;
+}
+
+void replace(std::vector<int>& code, const std::string& w, int token) {
+  std::vector<int> out;
+  for (size_t i = 0; i < code.size();) {
+    size_t k = 0;
+    while (i + k < code.size() && k < w.size() && code[i + k] == w[k]) k++;
+    if (k == w.size()) {
+      out.push_back(token);
+      i += w.size();
+    } else {
+      out.push_back(code[i++]);
+    }
+  }
+  code.swap(out);
+}
+
+// greedy : take the substring saving most bytes until nothing saves more
+std::string compress(std::vector<Entry>& entries) {
+  std::string dict;
+  for (;;) {
+    std::map<std::string, int> candidates;
+    for (const Entry& e : entries) {
+      for (size_t i = 0; i < e.code.size(); i++) {
+        std::string w;
+        for (size_t j = i; j < e.code.size() && e.code[j] < 0x80; j++) {
+          w += static_cast<char>(e.code[j]);
+          if (w.size() >= 2) candidates[w] = 0;
+        }
+      }
+    }
+    std::string best;
+    long best_gain = 0;
+    for (const auto& c : candidates) {
+      const std::string& w = c.first;
+      if (dict.size() + w.size() + 1 > kDictMax) continue;
+      long n = 0;
+      for (const Entry& e : entries) n += count(e.code, w);
+      // every use saves size-1 bytes, the entry costs size+1
+      long gain = n * static_cast<long>(w.size() - 1) - static_cast<long>(w.size() + 1);
+      if (gain > best_gain) {
+        best = w;
+        best_gain = gain;
+      }
+    }
+    if (best.empty()) return dict;
+    int token = 0x80 + static_cast<int>(dict.size());
+    dict += best;
+    dict += '\0';
+    for (Entry& e : entries) replace(e.code, best, token);
+  }
+}
+
+std::string literal(const std::vector<int>& code) {
+  std::string s = "\"";
+  char octal[8];
+  for (int c : code) {
+    if (c == '\r') s += "\\r";
+    else if (c == '\n') s += "\\n";
+    else if (c == '"') s += "\\\"";
+    else if (c == '\\') s += "\\\\";
+    else if (c >= 0x20 && c < 0x7F) s += static_cast<char>(c);
+    else {
+      // octal escape has at most 3 digits, a digit after it stays a character
+      std::snprintf(octal, sizeof(octal), "\\%03o", c);
+      s += octal;
+    }
+  }
+  return s + "\"";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool plain = argc == 4 && std::string(argv[1]) == "-p";
+  if (argc != 3 && !plain) {
+    std::fprintf(stderr, "usage: %s [-p] strings.txt header.h\n", argv[0]);
+    return 2;
+  }
+  const char* txt = argv[argc - 2];
+  const char* header = argv[argc - 1];
+  std::vector<Entry> entries;
+  if (!load(txt, entries)) return 2;
+
+  size_t before = 0;
+  for (const Entry& e : entries) before += e.text.size() + 1;
+  std::string dict = plain ? "" : compress(entries);
+  size_t after = plain ? before : dict.size() + 1;
+  if (!plain)
+    for (const Entry& e : entries) after += e.code.size() + 1;
+
+  std::ostringstream h;
+  h << "// AT command and SMS strings for uart_puts_P(), generated by tools/atstrings\n"
+    << "// from " << txt << " - edit that file and run the compile script again\n";
+  if (plain) {
+    h << "// " << entries.size() << " strings " << before << " bytes, not compressed (-p)\n\n"
+      << "#define AT_DICT 0\n\n";
+  } else {
+    h << "// " << entries.size() << " strings " << before << " bytes, compressed " << after
+      << " bytes with dictionary, " << static_cast<long>(before) - static_cast<long>(after)
+      << " bytes of flash saved\n"
+      << "// bytes 0x80..0xFF stand for the ATDICT entry at offset (byte - 0x80)\n\n"
+      << "#define AT_DICT 1\n\n";
+    std::vector<int> dict_code(dict.begin(), dict.end());
+    h << "const char ATDICT[] PROGMEM = { " << literal(dict_code) << " };\n\n";
+  }
+  for (const Entry& e : entries) {
+    h << "const char " << e.name << "[] PROGMEM = { " << literal(e.code) << " };";
+    if (!e.comment.empty()) h << "   // " << e.comment;
+    h << "\n";
+  }
+
+  std::ofstream out(header);
+  out << h.str();
+  if (!out) {
+    std::fprintf(stderr, "%s: cannot write\n", header);
+    return 2;
+  }
+  std::printf("%s : %zu strings %zu bytes -> %zu bytes, %ld bytes of flash saved\n", txt, entries.size(),
+              before, after, static_cast<long>(before) - static_cast<long>(after));
+  return 0;
+}
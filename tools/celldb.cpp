@@ -0,0 +1,189 @@
+// ---------------------------------------------------------------------------
+// offline cell tower database for the tracker firmware
+//   celldb [-c mcc[,mnc]] [-b minlat,minlon,maxlat,maxlon] [-n cells] cells/cells.csv cells/cells.h
+// reads an OpenCellID style CSV export
+//   radio,mcc,net,area,cell,unit,lon,lat,range,samples,changeable,created,updated,averageSignal
+// keeps GSM cells (SIM800L is 2G only, AT+CENG gives 16 bit LAC and CI) of
+// the region selected by -c and -b, the -n cells with most samples when there
+// are too many for flash, and writes a header with two PROGMEM tables :
+//   CELLDB_NETWORK  MCC, MNC and index range of its cells
+//   CELLDB_CELL     LAC, CI, latitude and longtitude in millionths of degree
+// cells of each network sorted by LAC and CI for binary search on the MCU.
+// The same cell in the CSV twice (several exports joined) is kept once.
+// ---------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+constexpr size_t kCellBytes = 12;     // celldb_cell_t on AVR
+constexpr size_t kNetworkBytes = 8;   // celldb_network_t on AVR
+
+struct Cell {
+  unsigned mcc = 0, mnc = 0, lac = 0, ci = 0;
+  long lat = 0, lon = 0;              // millionths of degree
+  long samples = 0;
+
+  std::tuple<unsigned, unsigned, unsigned, unsigned> key() const { return std::make_tuple(mcc, mnc, lac, ci); }
+};
+
+struct Filter {
+  long mcc = -1, mnc = -1;
+  bool box = false;
+  double minlat = 0, minlon = 0, maxlat = 0, maxlon = 0;
+  size_t max_cells = 0;
+};
+
+std::vector<std::string> split(const std::string& line, char sep) {
+  std::vector<std::string> fields;
+  std::string field;
+  std::istringstream in(line);
+  while (std::getline(in, field, sep)) fields.push_back(field);
+  return fields;
+}
+
+bool number(const std::string& s, double& value) {
+  char* end = nullptr;
+  value = std::strtod(s.c_str(), &end);
+  return !s.empty() && end != s.c_str() && *end == '\0';
+}
+
+bool load_csv(const std::string& path, const Filter& f, std::map<std::tuple<unsigned, unsigned, unsigned, unsigned>, Cell>& cells,
+              long& skipped) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::string line;
+  long lineno = 0;
+  while (std::getline(in, line)) {
+    lineno++;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::vector<std::string> v = split(line, ',');
+    if (v.size() < 8 || v[0] == "radio") continue;   // header or empty line
+    double mcc, mnc, lac, ci, lon, lat, samples = 0;
+    if (!number(v[1], mcc) || !number(v[2], mnc) || !number(v[3], lac) || !number(v[4], ci) || !number(v[6], lon) ||
+        !number(v[7], lat)) {
+      std::fprintf(stderr, "%s:%ld: bad line\n", path.c_str(), lineno);
+      return false;
+    }
+    if (v.size() > 9) number(v[9], samples);
+    if (v[0] != "GSM" || ci > 65535 || lac > 65535 || mcc > 999 || mnc > 999) {
+      skipped++;
+      continue;
+    }
+    if ((f.mcc >= 0 && mcc != f.mcc) || (f.mnc >= 0 && mnc != f.mnc)) continue;
+    if (f.box && (lat < f.minlat || lat > f.maxlat || lon < f.minlon || lon > f.maxlon)) continue;
+    Cell c;
+    c.mcc = static_cast<unsigned>(mcc);
+    c.mnc = static_cast<unsigned>(mnc);
+    c.lac = static_cast<unsigned>(lac);
+    c.ci = static_cast<unsigned>(ci);
+    c.lat = std::lround(lat * 1e6);
+    c.lon = std::lround(lon * 1e6);
+    c.samples = static_cast<long>(samples);
+    auto it = cells.find(c.key());
+    if (it == cells.end() || it->second.samples < c.samples) cells[c.key()] = c;
+  }
+  return true;
+}
+
+bool write_header(const std::string& path, const std::string& csv, const std::vector<Cell>& cells) {
+  std::ofstream out(path);
+  if (!out) {
+    std::fprintf(stderr, "%s: cannot write\n", path.c_str());
+    return false;
+  }
+  // networks in the order of sorted cells
+  struct Network {
+    unsigned mcc, mnc;
+    size_t first, end;
+  };
+  std::vector<Network> networks;
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (networks.empty() || networks.back().mcc != cells[i].mcc || networks.back().mnc != cells[i].mnc)
+      networks.push_back({cells[i].mcc, cells[i].mnc, i, i});
+    networks.back().end = i + 1;
+  }
+  char text[160];
+  out << "// offline cell tower database for cellfix(), generated by tools/celldb\n";
+  out << "// from " << csv << " - build it for your region and run the compile script again\n";
+  std::snprintf(text, sizeof(text), "// %zu cells in %zu networks, %zu bytes of flash\n\n", cells.size(), networks.size(),
+                cells.size() * kCellBytes + networks.size() * kNetworkBytes);
+  out << text;
+  out << "const celldb_network_t CELLDB_NETWORK[] PROGMEM = {\n";
+  for (size_t i = 0; i < networks.size(); i++) {
+    std::snprintf(text, sizeof(text), "  { %u, %u, %zu, %zu }%s\n", networks[i].mcc, networks[i].mnc, networks[i].first,
+                  networks[i].end, i + 1 < networks.size() ? "," : "");
+    out << text;
+  }
+  out << "};\n\n";
+  out << "const celldb_cell_t CELLDB_CELL[] PROGMEM = {\n";
+  for (size_t i = 0; i < cells.size(); i++) {
+    std::snprintf(text, sizeof(text), "  { 0x%04X, 0x%04X, %ld, %ld }%s\n", cells[i].lac, cells[i].ci, cells[i].lat,
+                  cells[i].lon, i + 1 < cells.size() ? "," : "");
+    out << text;
+  }
+  out << "};\n";
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Filter f;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-c" && i + 1 < argc) {
+      std::vector<std::string> v = split(argv[++i], ',');
+      f.mcc = std::strtol(v[0].c_str(), nullptr, 10);
+      if (v.size() > 1) f.mnc = std::strtol(v[1].c_str(), nullptr, 10);
+    } else if (a == "-b" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%lf,%lf,%lf,%lf", &f.minlat, &f.minlon, &f.maxlat, &f.maxlon) != 4) {
+        std::fprintf(stderr, "-b minlat,minlon,maxlat,maxlon\n");
+        return 2;
+      }
+      f.box = true;
+    } else if (a == "-n" && i + 1 < argc) {
+      f.max_cells = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      files.push_back(a);
+    }
+  }
+  if (files.size() != 2) {
+    std::fprintf(stderr, "usage: %s [-c mcc[,mnc]] [-b minlat,minlon,maxlat,maxlon] [-n cells] cells.csv cells.h\n",
+                 argv[0]);
+    return 2;
+  }
+
+  std::map<std::tuple<unsigned, unsigned, unsigned, unsigned>, Cell> found;
+  long skipped = 0;
+  if (!load_csv(files[0], f, found, skipped)) return 2;
+
+  std::vector<Cell> cells;
+  for (const auto& c : found) cells.push_back(c.second);
+  size_t dropped = 0;
+  if (f.max_cells > 0 && cells.size() > f.max_cells) {
+    std::stable_sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a.samples > b.samples; });
+    dropped = cells.size() - f.max_cells;
+    cells.resize(f.max_cells);
+  }
+  std::sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) { return a.key() < b.key(); });
+
+  if (!write_header(files[1], files[0], cells)) return 2;
+  std::printf("%s : %zu cells, %zu bytes of flash", files[1].c_str(), cells.size(), cells.size() * kCellBytes);
+  if (dropped > 0) std::printf(", %zu cells with fewer samples dropped by -n", dropped);
+  if (skipped > 0) std::printf(", %ld cells other than GSM skipped", skipped);
+  std::printf("\n");
+  return 0;
+}
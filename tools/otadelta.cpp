@@ -0,0 +1,313 @@
+// ---------------------------------------------------------------------------
+// delta generator of the firmware update over GPRS (FEATURE_OTA)
+//   otadelta -k k0,k1,k2,k3 old.hex new.hex update.ota
+// makes the file the tracker downloads from OTAURL : header and delta of ../ota.h
+// that patch the application in flash (old.hex, the firmware the trackers
+// run) to new.hex in place, page by page. Pages are written from the first
+// changed to the last or the other way round, whichever gives the smaller
+// delta - an insertion moves code up, so writing from the top down keeps the
+// old code to copy from. Every page is coded greedily against the flash as
+// the bootloader sees it at that moment : copy with the shift of the last
+// copy when it matches, a new copy (3 bytes) when it is at least 3 bytes
+// longer, a literal otherwise. The delta is decoded again here like boot.c
+// does it before it is written. -k is the XTEA key of the MAC, OTA_KEY of the
+// bootloader, there is no default.
+// Prints bytes of the delta against the size of the new application.
+// ---------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../ota.h"
+
+namespace {
+
+constexpr int kStage = OTA_STAGE;
+constexpr int kPage = OTA_PAGE;
+constexpr int kMaxCopy = 64;         // n of a copy token
+constexpr int kMaxLiteral = 128;     // n of a literal token
+constexpr int kHashBits = 16;
+constexpr int kCandidates = 256;     // chain length searched for a new copy
+
+using Image = std::vector<uint8_t>;  // application area [0, OTA_STAGE), 0xFF where nothing is
+
+struct Delta {
+  std::vector<uint8_t> bytes;
+  bool descending = false;
+  size_t literal_bytes = 0;
+  size_t copies = 0;
+  size_t new_copies = 0;
+};
+
+// Intel HEX to the application area, false when it does not fit below the staging area
+bool load_hex(const std::string& path, Image& image, size_t& used) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  image.assign(kStage, 0xFF);
+  used = 0;
+  std::string line;
+  long lineno = 0;
+  while (std::getline(in, line)) {
+    lineno++;
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+    if (line.empty()) continue;
+    std::vector<uint8_t> record;
+    for (size_t i = 1; i + 1 < line.size(); i += 2)
+      record.push_back(static_cast<uint8_t>(std::strtoul(line.substr(i, 2).c_str(), nullptr, 16)));
+    uint8_t sum = 0;
+    for (uint8_t b : record) sum += b;
+    if (line[0] != ':' || record.size() < 5 || record.size() != record[0] + 5u || sum != 0) {
+      std::fprintf(stderr, "%s:%ld: bad record\n", path.c_str(), lineno);
+      return false;
+    }
+    if (record[3] == 1) break;
+    if (record[3] != 0) continue;
+    size_t address = (record[1] << 8) | record[2];
+    if (address + record[0] > static_cast<size_t>(kStage)) {
+      std::fprintf(stderr, "%s:%ld: above the staging area 0x%04X, link with OTA=1\n", path.c_str(), lineno, kStage);
+      return false;
+    }
+    std::copy(record.begin() + 4, record.end() - 1, image.begin() + address);
+    used = std::max(used, address + record[0]);
+  }
+  return true;
+}
+
+uint32_t crc32(const uint8_t* data, size_t n) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < n; i++) crc = ota_crc32(crc, data[i]);
+  return ~crc;
+}
+
+// bytes of 'want' from 'dst' found at 'src' of the flash, at most 'room'
+int match(const Image& flash, int src, const Image& want, int dst, int room) {
+  int n = 0;
+  while (n < room && src + n >= 0 && src + n < kStage && flash[src + n] == want[dst + n]) n++;
+  return n;
+}
+
+unsigned hash3(const uint8_t* p) { return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761U) >> (32 - kHashBits); }
+
+// hash chains of 3 byte strings of the flash as it is before one page is written
+class Index {
+ public:
+  explicit Index(const Image& flash) : head_(1 << kHashBits, -1), prev_(kStage, -1) {
+    for (int a = 0; a + 2 < kStage; a++) {
+      unsigned h = hash3(&flash[a]);
+      prev_[a] = head_[h];
+      head_[h] = a;
+    }
+  }
+
+  // longest copy of 'want' at 'dst', nearest source first
+  int find(const Image& flash, const Image& want, int dst, int room, int& src) const {
+    int best = 0;
+    int tries = kCandidates;
+    for (int a = head_[hash3(&want[dst])]; a >= 0 && tries-- > 0 && best < room; a = prev_[a]) {
+      int n = match(flash, a, want, dst, room);
+      if (n > best) {
+        best = n;
+        src = a;
+      }
+    }
+    return best;
+  }
+
+ private:
+  std::vector<int> head_;
+  std::vector<int> prev_;
+};
+
+Delta encode(const Image& old_image, const Image& new_image, int first, int last, bool descending) {
+  Delta d;
+  d.descending = descending;
+  Image flash = old_image;
+  int shift = 0;
+  for (int k = 0; k <= last - first; k++) {
+    int page = descending ? last - k : first + k;
+    Index index(flash);
+    std::vector<uint8_t> literal;
+    auto flush = [&] {
+      for (size_t i = 0; i < literal.size(); i += kMaxLiteral) {
+        size_t n = std::min(literal.size() - i, static_cast<size_t>(kMaxLiteral));
+        d.bytes.push_back(static_cast<uint8_t>(n - 1));
+        d.bytes.insert(d.bytes.end(), literal.begin() + i, literal.begin() + i + n);
+      }
+      d.literal_bytes += literal.size();
+      literal.clear();
+    };
+    for (int i = 0; i < kPage;) {
+      int dst = page * kPage + i;
+      int room = std::min(kPage - i, kMaxCopy);
+      int repeat = match(flash, dst + shift, new_image, dst, room);
+      int src = 0;
+      int fresh = room >= 3 ? index.find(flash, new_image, dst, room, src) : 0;
+      if (fresh >= 4 && fresh >= repeat + 3) {
+        flush();
+        d.bytes.push_back(static_cast<uint8_t>(0xC0 | (fresh - 1)));
+        d.bytes.push_back(static_cast<uint8_t>(src));
+        d.bytes.push_back(static_cast<uint8_t>(src >> 8));
+        shift = src - dst;
+        d.copies++;
+        d.new_copies++;
+        i += fresh;
+      } else if (repeat >= 2 || (repeat == 1 && literal.empty())) {
+        flush();
+        d.bytes.push_back(static_cast<uint8_t>(0x80 | (repeat - 1)));
+        d.copies++;
+        i += repeat;
+      } else {
+        literal.push_back(new_image[dst]);
+        i++;
+      }
+    }
+    flush();
+    std::copy(new_image.begin() + page * kPage, new_image.begin() + (page + 1) * kPage, flash.begin() + page * kPage);
+  }
+  return d;
+}
+
+// what boot.c does with the delta, uint16_t addresses like on the MCU
+Image apply(Image flash, const std::vector<uint8_t>& delta, int first, int last, bool descending) {
+  size_t offset = 0;
+  int16_t shift = 0;
+  uint8_t buf[kPage];
+  for (int k = 0; k <= last - first; k++) {
+    int page = descending ? last - k : first + k;
+    uint16_t dst = static_cast<uint16_t>(page * kPage);
+    int i = 0;
+    while (i < kPage) {
+      uint8_t t = delta.at(offset++);
+      int n = (t & 0x3F) + 1;
+      if (t < 0x80) {
+        for (n = t + 1; n > 0 && i < kPage; n--) buf[i++] = delta.at(offset++);
+        continue;
+      }
+      if (t >= 0xC0) {
+        uint16_t src = delta.at(offset) | (delta.at(offset + 1) << 8);
+        offset += 2;
+        shift = static_cast<int16_t>(src - (dst + i));
+      }
+      uint16_t src = static_cast<uint16_t>(dst + i + shift);
+      for (; n > 0 && i < kPage; n--) buf[i++] = src < kStage ? flash[src++] : 0xFF;
+    }
+    std::copy(buf, buf + kPage, flash.begin() + page * kPage);
+  }
+  return flash;
+}
+
+void xtea(uint32_t v[2], const uint32_t key[4]) {
+  uint32_t v0 = v[0], v1 = v[1], sum = 0;
+  for (int i = 0; i < 32; i++) {
+    v0 += (((v1 << 4) ^ (v1 >> 5)) + v1) ^ (sum + key[sum & 3]);
+    sum += 0x9E3779B9UL;
+    v1 += (((v0 << 4) ^ (v0 >> 5)) + v0) ^ (sum + key[(sum >> 11) & 3]);
+  }
+  v[0] = v0;
+  v[1] = v1;
+}
+
+// CBC-MAC of boot.c : blocks of 8 bytes little endian, zeros pad the last one
+void mac(const std::vector<uint8_t>& data, const uint32_t key[4], uint8_t out[8]) {
+  uint32_t v[2] = {0, 0};
+  for (size_t i = 0; i < data.size() || (i & 7); i++) {
+    uint8_t b = i < data.size() ? data[i] : 0;
+    v[(i & 7) / 4] ^= static_cast<uint32_t>(b) << (8 * (i & 3));
+    if ((i & 7) == 7) xtea(v, key);
+  }
+  for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(v[i / 4] >> (8 * (i & 3)));
+}
+
+void put32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[at + i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t key[4];
+  bool keyed = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-k" && i + 1 < argc) {
+      unsigned long k[4];
+      if (std::sscanf(argv[++i], "%li,%li,%li,%li", &k[0], &k[1], &k[2], &k[3]) != 4) {
+        std::fprintf(stderr, "-k k0,k1,k2,k3\n");
+        return 2;
+      }
+      for (int j = 0; j < 4; j++) key[j] = static_cast<uint32_t>(k[j]);
+      keyed = true;
+    } else {
+      files.push_back(a);
+    }
+  }
+  if (files.size() != 3 || !keyed) {
+    std::fprintf(stderr, "usage: %s -k k0,k1,k2,k3 old.hex new.hex update.ota\n", argv[0]);
+    return 2;
+  }
+
+  Image old_image, new_image;
+  size_t old_used, new_used;
+  if (!load_hex(files[0], old_image, old_used) || !load_hex(files[1], new_image, new_used)) return 2;
+  int first = -1, last = -1;
+  for (int page = 0; page < kStage / kPage; page++)
+    if (!std::equal(old_image.begin() + page * kPage, old_image.begin() + (page + 1) * kPage,
+                    new_image.begin() + page * kPage)) {
+      if (first < 0) first = page;
+      last = page;
+    }
+  if (first < 0) {
+    std::fprintf(stderr, "%s and %s are the same application\n", files[0].c_str(), files[1].c_str());
+    return 1;
+  }
+
+  Delta up = encode(old_image, new_image, first, last, false);
+  Delta down = encode(old_image, new_image, first, last, true);
+  const Delta& d = down.bytes.size() < up.bytes.size() ? down : up;
+  if (apply(old_image, d.bytes, first, last, d.descending) != new_image) {
+    std::fprintf(stderr, "delta does not decode to %s\n", files[1].c_str());
+    return 1;
+  }
+  if (d.bytes.size() > static_cast<size_t>(OTA_MAXDELTA)) {
+    std::fprintf(stderr, "delta of %zu bytes does not fit the staging area (%d bytes)\n", d.bytes.size(),
+                 OTA_MAXDELTA);
+    return 1;
+  }
+
+  std::vector<uint8_t> out(OTA_HEADER, 0);
+  out[0] = 'O';
+  out[1] = 'T';
+  out[2] = 'A';
+  out[3] = '1';
+  out[4] = static_cast<uint8_t>(d.bytes.size());
+  out[5] = static_cast<uint8_t>(d.bytes.size() >> 8);
+  out[6] = static_cast<uint8_t>(first);
+  out[7] = static_cast<uint8_t>(last);
+  out[8] = d.descending ? 1 : 0;
+  put32(out, 12, crc32(old_image.data(), kStage));
+  put32(out, 16, crc32(new_image.data(), kStage));
+  put32(out, 20, crc32(d.bytes.data(), d.bytes.size()));
+  std::vector<uint8_t> signed_part(out.begin(), out.begin() + OTA_HEADER - 8);
+  signed_part.insert(signed_part.end(), d.bytes.begin(), d.bytes.end());
+  mac(signed_part, key, &out[OTA_HEADER - 8]);
+  out.insert(out.end(), d.bytes.begin(), d.bytes.end());
+
+  std::ofstream file(files[2], std::ios::binary);
+  if (!file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+    std::fprintf(stderr, "%s: cannot write\n", files[2].c_str());
+    return 2;
+  }
+  std::printf("%s: pages %d-%d written %s, %zu + %d bytes against %zu bytes of %s (%.1f %%), "
+              "%zu literal bytes, %zu copies (%zu with address), %zu bytes the other way\n",
+              files[2].c_str(), first, last, d.descending ? "down" : "up", d.bytes.size(), OTA_HEADER, new_used,
+              files[1].c_str(), 100.0 * (d.bytes.size() + OTA_HEADER) / new_used, d.literal_bytes, d.copies,
+              d.new_copies, (d.descending ? up : down).bytes.size());
+  return 0;
+}
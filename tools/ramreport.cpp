@@ -0,0 +1,230 @@
+// ---------------------------------------------------------------------------
+// peak RAM report of the tracker firmware, static data plus worst stack
+//   avr-objdump -h -d main3.elf > main3.lst
+//   ramreport -m 128 main3.lst tracker.su atscript.su
+// static RAM is the size of .data .bss and .noinit sections. Stack is the
+// deepest call path from main() : frame of every function from the
+// -fstack-usage files (.su) plus 2 bytes of return address for each call,
+// taken from call / rcall instructions of the disassembly (jmp / rjmp to
+// other function is a tail call, no return address). Functions called only
+// through a pointer (AT_CALL hooks of the AT scripts) are taken as callees
+// of every function with icall. Recursion (AT_RUN of run_script) is
+// followed at most -r times (default 3). The deepest interrupt handler
+// __vector_N is added on top with the 2 bytes of PC pushed by interrupt.
+// Exits with 1 when static + stack does not fit the -m bytes of SRAM.
+// ---------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr long kReturnAddress = 2;  // PC pushed by call and by interrupt, 16 bit PC on both MCUs
+
+struct Function {
+  long frame = 0;
+  bool dynamic = false;  // alloca or variable length array, frame is a minimum
+  bool has_frame = false;
+  bool icall = false;
+  std::set<std::string> calls;       // return address pushed
+  std::set<std::string> tailcalls;   // jumps to other function
+};
+
+std::map<std::string, Function> functions;
+std::map<std::string, long> sections;
+int max_recursion = 3;
+
+bool load_listing(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::string line, current;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    // section header :   1 .bss          00000046  00800060  00800060  000005c2  2**0
+    std::string index, name, size;
+    if (words >> index >> name >> size && name[0] == '.' && index.find_first_not_of("0123456789") == std::string::npos &&
+        size.size() == 8) {
+      sections[name] = std::strtol(size.c_str(), nullptr, 16);
+      continue;
+    }
+    // start of function :  000000a6 <readline>:
+    size_t open = line.find(" <");
+    if (open != std::string::npos && line.size() > 2 && line.compare(line.size() - 2, 2, ">:") == 0 &&
+        line.find('\t') == std::string::npos) {
+      current = line.substr(open + 2, line.size() - open - 4);
+      functions[current];
+      continue;
+    }
+    if (current.empty() || line.find('\t') == std::string::npos) continue;
+    // instruction :  ac:	0e 94 53 00 	call	0xa6	; 0xa6 <readline>
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream tabs(line);
+    while (std::getline(tabs, field, '\t')) fields.push_back(field);
+    if (fields.size() < 3) continue;
+    std::string op = fields[2].substr(0, fields[2].find(' '));
+    if (op == "icall" || op == "eicall") {
+      functions[current].icall = true;
+      continue;
+    }
+    if (op != "call" && op != "rcall" && op != "jmp" && op != "rjmp") continue;
+    size_t lt = line.rfind('<'), gt = line.rfind('>');
+    if (lt == std::string::npos || gt == std::string::npos || gt < lt) continue;
+    std::string target = line.substr(lt + 1, gt - lt - 1);
+    // jump inside a function is a branch, only the entry of other function counts
+    if (target.find('+') != std::string::npos || target.find('-') != std::string::npos) continue;
+    if (op == "call" || op == "rcall") functions[current].calls.insert(target);
+    else if (target != current) functions[current].tailcalls.insert(target);
+  }
+  return true;
+}
+
+// tracker.c:410:9:readline	4	static
+bool load_su(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::fprintf(stderr, "%s: cannot open\n", path.c_str());
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos) continue;
+    std::string where = line.substr(0, tab);
+    std::string name = where.substr(where.rfind(':') + 1);
+    std::istringstream rest(line.substr(tab + 1));
+    long bytes = 0;
+    std::string kind;
+    rest >> bytes >> kind;
+    Function& f = functions[name];
+    f.frame = bytes;
+    f.dynamic = kind.find("dynamic") != std::string::npos && kind.find("bounded") == std::string::npos;
+    f.has_frame = true;
+  }
+  return true;
+}
+
+bool is_vector(const std::string& name) { return name.compare(0, 9, "__vector_") == 0; }
+
+// pointer targets : functions with a frame the disassembly never calls or jumps to
+std::set<std::string> indirect_targets() {
+  std::set<std::string> called;
+  for (const auto& f : functions) {
+    called.insert(f.second.calls.begin(), f.second.calls.end());
+    called.insert(f.second.tailcalls.begin(), f.second.tailcalls.end());
+  }
+  std::set<std::string> targets;
+  for (const auto& f : functions)
+    if (f.second.has_frame && !called.count(f.first) && f.first != "main" && !is_vector(f.first))
+      targets.insert(f.first);
+  return targets;
+}
+
+std::set<std::string> pointer_targets;
+std::map<std::string, int> on_path;
+
+// deepest stack below 'name' including its frame, path to it in 'path'
+long deepest(const std::string& name, std::vector<std::string>& path) {
+  path.assign(1, name);
+  auto it = functions.find(name);
+  if (it == functions.end()) return 0;
+  const Function& f = it->second;
+  if (on_path[name] >= max_recursion) return 0;
+  on_path[name]++;
+  long best = 0;
+  std::vector<std::string> best_path, sub;
+  auto consider = [&](const std::string& callee, long extra) {
+    long depth = extra + deepest(callee, sub);
+    if (depth > best) {
+      best = depth;
+      best_path = sub;
+    }
+  };
+  for (const std::string& c : f.calls) consider(c, kReturnAddress);
+  for (const std::string& c : f.tailcalls) consider(c, 0);
+  if (f.icall)
+    for (const std::string& c : pointer_targets) consider(c, kReturnAddress);
+  on_path[name]--;
+  path.insert(path.end(), best_path.begin(), best_path.end());
+  return f.frame + best;
+}
+
+std::string join(const std::vector<std::string>& path) {
+  std::string s;
+  for (const std::string& p : path) s += (s.empty() ? "" : " > ") + p;
+  return s;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long ram = 0;
+  std::vector<std::string> su;
+  std::string listing;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-m" && i + 1 < argc) ram = std::strtol(argv[++i], nullptr, 0);
+    else if (a == "-r" && i + 1 < argc) max_recursion = std::atoi(argv[++i]);
+    else if (listing.empty()) listing = a;
+    else su.push_back(a);
+  }
+  if (listing.empty() || su.empty() || max_recursion < 1) {
+    std::fprintf(stderr, "usage: %s [-m ramsize] [-r recursion] listing.lst file.su...\n", argv[0]);
+    return 2;
+  }
+  if (!load_listing(listing)) return 2;
+  for (const std::string& s : su)
+    if (!load_su(s)) return 2;
+  if (!functions.count("main")) {
+    std::fprintf(stderr, "%s: no <main> in disassembly, run avr-objdump -h -d\n", listing.c_str());
+    return 2;
+  }
+  pointer_targets = indirect_targets();
+
+  long data = sections[".data"], bss = sections[".bss"], noinit = sections[".noinit"];
+  long stat = data + bss + noinit;
+
+  std::vector<std::string> main_path, isr_path, path;
+  long main_stack = deepest("main", main_path);
+  long isr_stack = 0;
+  for (const auto& f : functions) {
+    if (!is_vector(f.first)) continue;
+    long depth = deepest(f.first, path);
+    if (depth > isr_stack) {
+      isr_stack = depth;
+      isr_path = path;
+    }
+  }
+  if (isr_stack > 0) isr_stack += kReturnAddress;
+  long total = stat + main_stack + isr_stack;
+
+  std::printf("%s :\n", listing.c_str());
+  std::printf("  static RAM   %5ld bytes  (.data %ld .bss %ld .noinit %ld)\n", stat, data, bss, noinit);
+  std::printf("  stack main   %5ld bytes  %s\n", main_stack, join(main_path).c_str());
+  if (isr_stack > 0) std::printf("  stack ISR    %5ld bytes  %s\n", isr_stack, join(isr_path).c_str());
+  if (!pointer_targets.empty()) {
+    std::vector<std::string> targets(pointer_targets.begin(), pointer_targets.end());
+    std::printf("  by pointer   %s\n", join(targets).c_str());
+  }
+  for (const auto& f : functions)
+    if (f.second.dynamic) std::printf("  warning      %s has dynamic stack, its frame is a minimum\n", f.first.c_str());
+  if (ram <= 0) {
+    std::printf("  peak RAM     %5ld bytes\n", total);
+    return 0;
+  }
+  if (total > ram) {
+    std::printf("  peak RAM     %5ld bytes of %ld, %ld bytes over\n", total, ram, total - ram);
+    std::fprintf(stderr, "%s: stack can overwrite static data\n", listing.c_str());
+    return 1;
+  }
+  std::printf("  peak RAM     %5ld bytes of %ld, %ld bytes free\n", total, ram, ram - total);
+  return 0;
+}
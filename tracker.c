@@ -0,0 +1,3802 @@
+/* ---------------------------------------------------------------------------
+ * GPS car tracker on ATMEGA328P or ATTINY2313 / ATTINY2313A + SIM800L module version 4.0
+ * by Adam Loboda - adam.loboda@wp.pl
+ * a) accuracy is nearest GSM cell around locator
+ * b) baudrate UART is 9600 as most stable using RC internal clock
+ * c) MCU clock was lowered to 1MHz (8 MHz div 8) for lower power consumption
+ *
+ * one source for every version of the tracker, the version is selected at compile time
+ * (build targets main, mainb, main3, main3b in Makefile) :
+ *
+ *   MCU               -mmcu=atmega328p or -mmcu=attiny2313, buffer sizes follow RAM of the MCU
+ *   sleep strategy    default : POWERDOWN of MCU until RING falling edge on INT0
+ *                     -DSLEEP_POLLED : MCU never sleeps, it polls RI/RING pin and checks
+ *                     2G coverage every 30 min (radio off for 30 min if no network)
+ *   features          -DFEATURE_STATS=1 energy statistics in EEPROM and STATS SMS reply, SMS commands
+ *                     (-DSMS_PIN="4321" required, LOC STATUS STATS INTERVAL BACKOFF TRACK, the ones that
+ *                     change settings only from the TRACK ON phone once there is one) with settings in EEPROM,
+ *                     main loop in C running PROGMEM scripts (atscript.h) - default and only possible
+ *                     on ATMEGA328P, without it the main loop calls plain C functions and the script
+ *                     interpreter is left out
+ *                     -DFEATURE_RXRING=1 UART receive by interrupt to RX_RING_SIZE bytes ring
+ *                     buffer, off by default - ATTINY2313 versions stay without the ISR to keep their
+ *                     flash and RAM small
+ *                     -DFEATURE_PREEMPT=1 a call cuts delays short and ends running scripts so
+ *                     it is answered at once, default on ATMEGA328P (see atscript.h)
+ *                     -DFEATURE_CELLDB=1 position of the serving cell (AT+CENG) from cell tower
+ *                     database in flash (cells/cells.h), GPRS and CIPGSMLOC only when the cell is
+ *                     not there - default with FEATURE_STATS
+ *                     -DFEATURE_GEOSERVER=1 serving and neighbour cells (AT+CENG) sent over the HTTP
+ *                     bearer to the self hosted geoserver/ instead of AT+CIPGSMLOC, server address
+ *                     in HTTPURL of strings/<target>.txt - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_GNSS=1 SIM808 : position from its GNSS receiver (AT+CGNSINF parsed
+ *                     by gnss.c), cell location only when there is no fix in the on-window, the
+ *                     receiver is off between windows and woken every GNSS_REFRESH minutes to
+ *                     keep its ephemeris warm - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_MQTT=1 live mode (SMS LIVE or a call after it) : positions published
+ *                     over one TCP connection (AT+CIPSTART) to an MQTT broker every few seconds
+ *                     until the session times out - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_UDP=1 SMS TRACK UDP : TRACK positions go as 34 byte binary UDP
+ *                     datagrams (AT+CIPSTART="UDP") to a report receiver (telemetry/udprx) instead
+ *                     of the SMS, acknowledged and sent again when the ack does not come - the SMS
+ *                     only when it never does - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_OTA=1 SMS UPDATE : firmware update over GPRS, a delta made by
+ *                     tools/otadelta is downloaded from OTAURL to spare flash and written by the
+ *                     bootloader boot.c (make OTA=1, see ota.h) - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_CLOCK=1 network time (NITZ, AT+CLTS=1) from the *PSUTTZ URC or
+ *                     AT+CCLK? keeps a software clock on watchdog ticks, corrected for their drift
+ *                     at each sync, for UDP reports and the STATS SMS without any GPRS round trip
+ *                     - ATMEGA328P with FEATURE_STATS only
+ *                     -DFEATURE_STACKMON=1 free RAM painted at boot, stack_free() gives bytes the
+ *                     stack has never reached (STATS SMS, simavr check in bench/) - default on
+ *                     ATMEGA328P only
+ *   buffers           -DBUFFER_SIZE= -DPHONE_SIZE= -DCOORD_SIZE= -DRX_RING_SIZE= to override
+ *
+ * code of features not selected is not compiled at all, so each version has only what it uses
+ *
+ * other considerations:
+ *
+ * please configure SIM800L to fixed 9600 first by AT+IPR=9600 command
+ * to ensure stability ans save config via AT&W command
+ * you may do it by connecting FTDI232 serial port converter to PC
+ * and using putty enter commands directly to SIM800L
+ *
+ * in every version INT0 pin of MCU (ATMEGA328P #4, ATTINY2313 #6)
+ * must be connected to RI/RING ping on SIM800L module
+ * RING low voltage state initiates interrupt INT0 and wakes up MCU
+ * or is seen by polling of PD2 in SLEEP_POLLED versions
+ *
+ * other connections to be made on ATMEGA328P :
+ * SIM800L RXD to ATMEGA328 TXD PIN #3,
+ * SIM800L TXD to ATMEGA328 RXD PIN #2
+ * ATMEGA328 VCC (PIN #7) to SIM800L VCC and +4.4V
+ * ATMEGA328 GND (PIN #8 and PIN #22) to SIM800L GND and 0V
+ * the rest is the same as on ATTINY2313 schematic
+ * ---------------------------------------------------------------------------
+ */
+
+// internal RC oscillator 8MHz with divison by 8 and U2X = 1, gives 0.2% error rate for 9600 bps UART speed
+// and lower current consumption
+// for 1MHz : -U lfuse:w:0x62:m on ATMEGA328P, -U lfuse:w:0x64:m -U hfuse:w:0xdf:m on ATTINY2313
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <string.h>
+#include <avr/power.h>
+#include <avr/eeprom.h>
+#include <stdlib.h>
+
+#ifdef HOST_BUILD
+#include "hal.h"     // native build on PC against SIM800L emulator, see sim/
+#endif
+
+#include "atscript.h"   // AT command sequences run as PROGMEM scripts
+#include "gnss.h"       // streaming NMEA / AT+CGNSINF parser of SIM808 versions
+#include "ota.h"        // firmware update over GPRS, flash layout shared with the bootloader boot.c
+
+
+// ----------------------------------------------------------------------------------------------
+// compile time configuration of MCU, buffers and features
+// ----------------------------------------------------------------------------------------------
+#if defined(__AVR_ATmega328P__)
+
+#define TRACKER_ATMEGA 1
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 80         // line read from SIM800L
+#endif
+#ifndef PHONE_SIZE
+#define PHONE_SIZE 20          // caller number from CLIP
+#endif
+#ifndef COORD_SIZE
+#define COORD_SIZE 20          // longtitude / latitude text
+#endif
+#ifndef FEATURE_STATS
+#define FEATURE_STATS 1
+#endif
+#ifndef FEATURE_RXRING
+#define FEATURE_RXRING 0       // 2 bytes of USART FIFO are enough for the C main loop
+#endif
+#ifndef FEATURE_STACKMON
+#define FEATURE_STACKMON 1
+#endif
+// INT0 configuration registers
+#define INT0_CONTROL EICRA
+#define INT0_MASK    EIMSK
+
+#else   // ATTINY2313 - 128 bytes of RAM, 2kB of flash
+
+#define TRACKER_ATMEGA 0
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 40
+#endif
+#ifndef PHONE_SIZE
+#define PHONE_SIZE 15
+#endif
+#ifndef COORD_SIZE
+#define COORD_SIZE 10
+#endif
+#ifndef FEATURE_STATS
+#define FEATURE_STATS 0
+#endif
+#ifndef FEATURE_RXRING
+#define FEATURE_RXRING 0       // the ISR and ring would grow flash and RAM, USART FIFO is enough as before
+#endif
+#ifndef FEATURE_STACKMON
+#define FEATURE_STACKMON 0     // no STATS SMS to report it, the painting loop costs flash of a full chip
+#endif
+#if FEATURE_STATS
+#error "energy statistics and SMS handling do not fit 2kB of ATTINY2313 flash"
+#endif
+// the only USART of ATTINY has registers without number
+#define UCSR0A UCSRA
+#define UCSR0B UCSRB
+#define UCSR0C UCSRC
+#define UBRR0H UBRRH
+#define UBRR0L UBRRL
+#define UDR0   UDR
+#define U2X0   U2X
+#define RXEN0  RXEN
+#define TXEN0  TXEN
+#define UCSZ00 UCSZ0
+#define UCSZ01 UCSZ1
+#define UDRE0  UDRE
+#define RXC0   RXC
+#define RXCIE0 RXCIE
+#define INT0_CONTROL MCUCR
+#define INT0_MASK    GIMSK
+
+#endif
+
+#ifndef FEATURE_CELLDB
+#define FEATURE_CELLDB FEATURE_STATS
+#endif
+#if FEATURE_CELLDB && !FEATURE_STATS
+#error "cell database lookup needs the main loop in C of FEATURE_STATS"
+#endif
+#ifndef FEATURE_GEOSERVER
+#define FEATURE_GEOSERVER 0
+#endif
+#if FEATURE_GEOSERVER && !FEATURE_STATS
+#error "geolocation server needs the main loop in C of FEATURE_STATS"
+#endif
+#define GEOCELLS 7             // serving and 6 neighbour cells of AT+CENG sent to the geoserver
+#ifndef FEATURE_GNSS
+#define FEATURE_GNSS 0
+#endif
+#if FEATURE_GNSS && !FEATURE_STATS
+#error "GNSS location source needs the main loop in C of FEATURE_STATS"
+#endif
+#ifndef GNSS_COLD
+#define GNSS_COLD 60           // seconds of on-window without warm ephemeris, then cell location
+#endif
+#ifndef GNSS_HDOP
+#define GNSS_HDOP 20           // 0.1 - fix with HDOP up to 2.0 switches the receiver off at once
+#endif
+#ifndef GNSS_REFRESH
+#define GNSS_REFRESH 90        // minutes between on-windows keeping the ephemeris warm, 0 = never
+#endif
+#define GNSS_WARM 7200         // seconds after a fix the receiver still starts hot
+#define GNSS_HOTMIN 6          // seconds, shortest on-window of a hot start
+#define GNSS_HISTORY 4         // TTFF of the last hot starts sizing the on-window
+#define GNSS_UERE 5            // [m] range error of the receiver, accuracy radius is HDOP times it
+#if FEATURE_GNSS && GNSS_REFRESH * 60 >= GNSS_WARM
+#error "GNSS_REFRESH must be shorter than the ephemeris stays warm"
+#endif
+
+#ifndef FEATURE_MQTT
+#define FEATURE_MQTT 0
+#endif
+#if FEATURE_MQTT && !FEATURE_STATS
+#error "MQTT live mode needs the main loop in C of FEATURE_STATS"
+#endif
+#ifndef MQTT_CLIENT
+#define MQTT_CLIENT "gpstracker"   // client identifier in MQTT CONNECT
+#endif
+#ifndef MQTT_TOPIC
+#define MQTT_TOPIC "gpstracker/pos" // topic of the positions, payload latitude,longtitude,accuracy,battery
+#endif
+#define MQTT_KEEPALIVE 120     // seconds in CONNECT, PINGREQ when nothing was published for half of it
+#define LIVE_INTERVAL 10       // seconds between positions in live mode until LIVE n s sets it
+#define LIVE_FAILS 3           // broker connections in a row that failed end the live session
+
+#ifndef FEATURE_UDP
+#define FEATURE_UDP 0
+#endif
+#if FEATURE_UDP && !FEATURE_STATS
+#error "UDP reports need the main loop in C of FEATURE_STATS"
+#endif
+#ifndef UDP_DEVICE
+#define UDP_DEVICE 1           // device id in the UDP report, unique among trackers of one receiver
+#endif
+#ifndef UDP_ACK
+#define UDP_ACK 1              // report asks the receiver for an ack, 0 = fire and forget
+#endif
+#define UDP_TRIES 3            // datagrams of one report at most when the ack does not come
+#define UDP_WAIT 5             // seconds for the ack of a datagram
+#define UDP_SIZE 34            // report datagram, layout in telemetry/report.h
+#define UDP_ACKSIZE 10
+#define TRACK_UDP 2            // cfg.track of TRACK UDP
+#define IP_WAIT 10             // seconds for the AT+CIPSEND prompt, SEND OK and the answer of the peer
+
+#ifndef FEATURE_OTA
+#define FEATURE_OTA 0
+#endif
+#if FEATURE_OTA && !FEATURE_STATS
+#error "firmware update needs the main loop in C of FEATURE_STATS"
+#endif
+#ifndef FW_VERSION
+#define FW_VERSION 1           // firmware version in the STATUS SMS, raise it in every update
+#endif
+#define OTA_WAIT 10            // seconds for the answer of every AT+HTTPREAD of the update download
+
+#define SUPPLY_MIN 3600        // mV of AT+CBC taken as recovered after a VOLTAGE WARNNING, SIM800L warns
+#define SUPPLY_MAX 4300        // below 3500 and above 4400
+#define SUPPLY_WAIT 60         // seconds between AT+CBC checks while the supply is not back
+#define SUPPLY_TRIES 10        // checks before the answer is given up
+
+#ifndef FEATURE_CLOCK
+#define FEATURE_CLOCK 0
+#endif
+#if FEATURE_CLOCK && !FEATURE_STATS
+#error "network time needs the main loop in C of FEATURE_STATS"
+#endif
+#ifndef CLOCK_SYNC
+#define CLOCK_SYNC 60          // minutes of uptime after which AT+CCLK? is asked again before sleep
+#endif
+#define CLOCK_SPAN 3600        // seconds of uptime at least between the syncs the drift is measured from
+#define CLOCK_YEAR 2019        // older network time is SIM800L clock that never had one (2004/01/01)
+#define CLOCK_ONE 32768        // clock_rate of watchdog seconds that are exactly seconds
+
+#define DATETIME_SIZE 20       // 2020/01/01,12:00:00 from CIPGSMLOC
+#define BATTERY_SIZE 6         // milivolts from CBC
+#ifndef RX_RING_SIZE
+#define RX_RING_SIZE 16        // power of 2
+#endif
+#define STACK_CANARY 0xC5      // free RAM is painted with it at boot, bench/avrbench looks for it too
+
+#define UART_NO_DATA 0x0100
+
+#define BAUD 9600
+// formula for 1MHz clock and U2X = 1 double UART speed
+#define MYUBBR ((F_CPU / (BAUD * 8L)) - 1)
+
+#if FEATURE_STATS
+// every SMS command starts with this PIN and a space : "4321 LOC" - no default, a PIN known to
+// everybody would let anyone track the car or change the settings
+#ifndef SMS_PIN
+#error "no SMS_PIN : make SMS_PIN=<your PIN> or -DSMS_PIN=\"<your PIN>\""
+#endif
+#define LOC_TIMEOUT 40         // seconds to wait for the answer of AT+CLBS / AT+CIPGSMLOC
+#define LOC_RETRIES 2          // queries repeated at once after network error or timeout
+#define LOC_ACCURACY 1000      // [m] accuracy radius of a position good enough for the location SMS
+#define LOC_DRIFT 1000         // [m/min] how far the tracker may go, added to the radius of the last position
+// result of the location query besides CIPGSMLOC codes (0 location, 404 not found, 408 timeout,
+// 601 network error, 602 no memory, 603 DNS error, 604 stack busy, 65535 other error)
+#define LOCERR_NOANSWER 1      // nothing within LOC_TIMEOUT
+#define LOCERR_RESET    2      // no result code - SIM800L restarted or answered something else
+#define LOCERR_NOBEARER 3      // GPRS bearer did not open
+#define LOCERR_ERROR    4      // ERROR - AT+CLBS is not known by older SIM800L firmware
+#endif
+
+
+
+// AT commands and SMS texts sent by uart_puts_P() are stored compressed, edit them
+// (APN, PIN code) in strings/<target>.txt, strings/<target>.h is generated by tools/atstrings
+#if TRACKER_ATMEGA && defined(SLEEP_POLLED)
+#include "strings/mainb.h"
+#elif TRACKER_ATMEGA
+#include "strings/main.h"
+#elif defined(SLEEP_POLLED)
+#include "strings/main3b.h"
+#else
+#include "strings/main3.h"
+#endif
+
+// responses of SIM800L compared by is_in_rx_buffer() in flash, not compressed
+const char ISOK[] PROGMEM = { "OK" };
+const char ISRING[] PROGMEM = { "RING" };
+const char ISREG1[] PROGMEM = { "+CREG: 0,1" };             // SIM registered in HPLMN
+const char ISREG2[] PROGMEM = { "+CREG: 0,5" };             // SIM registered in ROAMING NETWORK
+const char PIN_IS_READY[] PROGMEM = {"+CPIN: READY"};
+const char PIN_MUST_BE_ENTERED[] PROGMEM = {"+CPIN: SIM PIN"};
+const char SAPBRSUCC[] PROGMEM = {"+SAPBR: 1,1"};          // bearer was succesfull we are not checking IP assigned
+#if FEATURE_STATS
+const char ISCMTI[] PROGMEM = {"+CMTI"};                    // URC of incoming SMS
+const char ISRDY[] PROGMEM = {"RDY"};                       // first URC after SIM800L power on
+const char ISCALLREADY[] PROGMEM = {"Call Ready"};
+const char ISPOWERDOWN[] PROGMEM = {"POWER DOWN"};          // NORMAL / UNDER-VOLTAGE / OVER-VOLTAGE POWER DOWN
+const char ISVOLTWARN[] PROGMEM = {"VOLTAGE WARN"};         // UNDER-VOLTAGE WARNNING / OVER-VOLTAGE WARNNING
+const char ISCENG[] PROGMEM = {"+CENG: 0,\""};                // serving cell in engineering mode
+#if FEATURE_GEOSERVER
+const char ISCENGANY[] PROGMEM = {"+CENG: "};                 // serving or neighbour cell line
+const char ISHTTPREAD[] PROGMEM = {"+HTTPREAD:"};
+const char ISERROR[] PROGMEM = {"ERROR"};
+#endif
+#if FEATURE_GEOSERVER || FEATURE_OTA
+const char ISHTTP200[] PROGMEM = {"+HTTPACTION: 0,200"};     // geoserver located the cells, update is there
+const char ISHTTPACTION[] PROGMEM = {"+HTTPACTION:"};        // any other status, 404 cells not known
+#endif
+const char SMSPIN[] PROGMEM = {SMS_PIN};                    // first word of SMS commands
+const char CMDLOC[] PROGMEM = {"LOC"};                      // SMS commands, case is not checked
+const char CMDSTATUS[] PROGMEM = {"STATUS"};
+const char CMDSTATS[] PROGMEM = {"STATS"};                  // energy statistics
+const char CMDINTERVAL[] PROGMEM = {"INTERVAL"};
+const char CMDBACKOFF[] PROGMEM = {"BACKOFF"};
+const char CMDTRACK[] PROGMEM = {"TRACK"};
+const char ISON[] PROGMEM = {"ON"};
+#if FEATURE_MQTT || FEATURE_UDP
+const char ISCONNECTOK[] PROGMEM = {"CONNECT OK"};          // AT+CIPSTART connection is up
+const char ISSENDOK[] PROGMEM = {"SEND OK"};                // AT+CIPSEND data went out
+#endif
+#if FEATURE_UDP
+const char ISUDP[] PROGMEM = {"UDP"};                       // TRACK UDP
+#endif
+#if FEATURE_CLOCK
+const char ISCCLK[] PROGMEM = {"+CCLK:"};                   // SIM800L clock, local time and zone
+const char ISPSUTTZ[] PROGMEM = {"*PSUTTZ:"};               // URC of network time (NITZ), UTC and zone
+#endif
+#if FEATURE_OTA
+const char CMDUPDATE[] PROGMEM = {"UPDATE"};
+const char OTAMAGIC[] PROGMEM = {"OTA1"};                   // first bytes of the update header
+#endif
+#if FEATURE_MQTT
+const char CMDLIVE[] PROGMEM = {"LIVE"};
+const char MQTTCLIENT[] PROGMEM = {MQTT_CLIENT};
+const char MQTTTOPIC[] PROGMEM = {MQTT_TOPIC};
+// MQTT 3.1.1 CONNECT variable header : protocol name, level 4, clean session, keep alive
+const uint8_t MQTTCONNECT[] PROGMEM = { 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, MQTT_KEEPALIVE >> 8, MQTT_KEEPALIVE & 0xFF };
+#endif
+
+const char * const STATELABEL[] PROGMEM = { STATE0, STATE1, STATE2, STATE3, STATE4 };
+#endif
+
+
+// ----------------------------------------------------------------------------------------------
+// RAM arena - buffers of the two phases of the tracker share the same bytes
+//   DIALOGUE : AT command and response, 'response' line of readline() compared by AT_MATCH
+//   LOCATION : from AT+CBC until the location SMS is sent, 'loc' parsed by readbattery()
+//              and readcellgps() straight from UART - there is no readline() in this phase,
+//              ATTINY2313 versions send no battery voltage, 'loc' is not longer than 'response'
+// phonenumber is kept from RING (or SMS sender) until the SMS is sent so it is not overlaid
+// only data shared with interrupts is volatile
+// ----------------------------------------------------------------------------------------------
+static union {
+  uint8_t response[BUFFER_SIZE];
+  struct {
+    uint8_t datetime[DATETIME_SIZE];
+    uint8_t latitude[COORD_SIZE];
+    uint8_t longtitude[COORD_SIZE];
+#if FEATURE_STATS
+    uint8_t battery[BATTERY_SIZE];
+#endif
+  } loc;
+} arena;
+
+static uint8_t phonenumber[PHONE_SIZE];
+
+#if FEATURE_CELLDB
+// cell tower database in flash generated by tools/celldb, cells of each network sorted by LAC and CI
+typedef struct {
+  uint16_t mcc;
+  uint16_t mnc;
+  uint16_t first;           // index of the first cell of the network in CELLDB_CELL
+  uint16_t end;             // index after the last one
+} celldb_network_t;
+
+typedef struct {
+  uint16_t lac;
+  uint16_t ci;
+  int32_t lat;              // millionths of degree
+  int32_t lon;
+} celldb_cell_t;
+
+#include "cells/cells.h"
+#endif
+
+#if FEATURE_CELLDB || FEATURE_GEOSERVER || FEATURE_UDP
+// cell of an AT+CENG line, parsed by parsecell()
+typedef struct {
+  uint16_t mcc;
+  uint16_t mnc;
+  uint16_t lac;
+  uint16_t ci;
+  uint8_t rxl;              // RX level 0..63
+} cell_t;
+#endif
+
+#if FEATURE_GEOSERVER
+static cell_t geocells[GEOCELLS];   // cells of the last AT+CENG? for the geoserver query
+static uint8_t geocount;
+#endif
+
+#if FEATURE_GNSS
+static gnss_t gnss;                 // last fix of SIM808 GNSS receiver
+static uint8_t gnssfix;             // location SMS is from GNSS, speed and satellites are added
+static uint8_t gnss_warm;           // ephemeris of the last fix still gives a hot start
+static uint32_t gnss_lastfix;       // uptime() of the last on-window that ended with a fix
+static uint32_t gnss_onat;          // uptime() of AT+CGNSPWR=1 of the on-window
+static uint8_t gnss_window;         // seconds the on-window may last
+static uint8_t gnss_lastttff;       // seconds to the first fix of the on-window up to 255, 0 = no fix
+static uint8_t gnss_ttff[GNSS_HISTORY];   // of the last hot starts, 0 = none yet
+static uint8_t gnss_next;
+#endif
+
+#if FEATURE_PREEMPT
+// main loop marks where a call may cut delays and scripts short, see atscript.h
+#define PREEMPT(on) (at_armed = (on))
+#define CALL_WAITS  (at_ring)          // armed work was cut short, the main loop takes the call next
+#else
+#define PREEMPT(on) ((void)(on))
+#define CALL_WAITS  0
+#endif
+
+#if FEATURE_RXRING
+// bytes received by USART_RX interrupt, index of next free byte and of next byte to read
+static volatile uint8_t rx_ring[RX_RING_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+#endif
+
+#if FEATURE_STATS
+// ----------------------------------------------------------------------------------------------
+// energy accounting - number of seconds spent in each power state and event counters
+// multiply seconds by current drawn in each state to get mAh per day in the field
+// ----------------------------------------------------------------------------------------------
+#define STATE_SLEEP      0     // waiting for RING, SIM800L in sleepmode
+#define STATE_AWAKE      1     // SIM800L awake, AT commands and registration checks
+#define STATE_GPRS       2     // IP bearer open, CIPGSMLOC query
+#define STATE_SMS        3     // composing and sending SMS
+#define STATE_NOCOV      4     // no 2G coverage backoff, radio off in flightmode
+#define NBR_STATES       5
+
+#define STATS_MAGIC 0x5A17     // marks valid statistics in EEPROM
+
+struct energystats {
+  uint16_t magic;
+  uint32_t seconds[NBR_STATES];
+  uint16_t rings;                // incoming calls
+  uint16_t locfailures;          // location requests without position
+  uint16_t sapbrretries;         // repeated bearer open attempts
+  uint16_t locnet;               // CIPGSMLOC network errors 601, 603, 604
+  uint16_t loctimeout;           // CIPGSMLOC 408 or no answer
+  uint16_t locreset;             // no result code, SIM800L restarted
+  uint16_t locother;             // 404 location not found, 602, 65535
+#if FEATURE_GNSS
+  uint32_t gnssseconds;          // GNSS receiver on
+  uint16_t gnsswindows;          // on-windows, AT+CGNSPWR=1
+  uint16_t gnssfixes;            // on-windows with a fix
+  uint32_t gnssttff;             // sum of TTFF of the fixes, average is gnssttff / gnssfixes
+#endif
+#if FEATURE_MQTT
+  uint16_t livesessions;         // LIVE sessions started
+  uint16_t livepubs;             // positions published to the MQTT broker
+  uint32_t livebytes;            // MQTT bytes sent by AT+CIPSEND
+#endif
+#if FEATURE_UDP
+  uint16_t udpreports;           // TRACK positions reported by UDP
+  uint16_t udpsent;              // datagrams sent, retransmissions included
+  uint16_t udpacked;             // reports the receiver acknowledged
+#endif
+};
+
+static volatile struct energystats stats;
+static struct energystats EEMEM eestats;
+static uint8_t energy_state = STATE_AWAKE;
+#ifndef SLEEP_POLLED
+static volatile uint8_t ring_wakeup = 0;                          // set by INT0, not by watchdog wakeup
+#endif
+
+// ----------------------------------------------------------------------------------------------
+// settings changed by SMS commands, kept in EEPROM next to the statistics
+// ----------------------------------------------------------------------------------------------
+#if FEATURE_MQTT
+#define SETTINGS_MAGIC 0x5E7D  // marks valid settings in EEPROM, live mode ones included
+#else
+#define SETTINGS_MAGIC 0x5E7C  // marks valid settings in EEPROM
+#endif
+
+struct settings {
+  uint16_t magic;
+  uint8_t track;                 // 1 - location SMS to 'owner' every 'interval' minutes, TRACK_UDP - UDP report
+  uint16_t interval;             // minutes between TRACK location SMSes, 1..1440
+  uint8_t backoff;               // minutes of radio off when there is no 2G coverage, 1..255
+  uint8_t owner[PHONE_SIZE];     // phone number that sent TRACK ON, only it may change settings
+#if FEATURE_MQTT
+  uint8_t live;                  // minutes of live session after a call, 0 = off
+  uint8_t liveint;               // seconds between positions in live session, 5..255
+#endif
+};
+
+static struct settings cfg;
+static struct settings EEMEM eecfg;
+static volatile uint32_t track_seconds = 0;                       // since last TRACK location SMS
+static uint8_t modem_off;                                         // POWER DOWN came, nothing is sent until RDY
+static uint8_t supplywarn;                                        // VOLTAGE WARNNING came, no TX until AT+CBC is fine
+#if FEATURE_MQTT
+static uint16_t live_left;                                        // seconds of the live session to go
+static uint32_t live_sent;                                        // uptime() of the last MQTT packet
+static uint8_t live_stopped;                                      // call ended the session, not a new one
+#endif
+#if FEATURE_UDP
+static uint8_t udp_track;                                         // this position goes by UDP, not SMS
+static uint16_t udp_seq;                                          // sequence number of the last report
+static uint8_t udp_pkt[UDP_SIZE];                                 // report being sent, kept for retransmits
+#endif
+#if FEATURE_CLOCK
+static uint32_t clock_time;                                       // network time of the last sync, 0 = none yet
+static uint32_t clock_up;                                         // uptime() at the last sync
+static uint32_t clock_reftime, clock_refup;                       // sync the drift is measured from
+static uint16_t clock_rate = CLOCK_ONE;                           // real seconds per uptime() second
+static uint16_t clock_syncs;                                      // since reset
+#endif
+
+// ----------------------------------------------------------------------------------------------
+// last position sent, the answer with its age when the location query fails
+// ----------------------------------------------------------------------------------------------
+static struct {
+  uint8_t datetime[DATETIME_SIZE];          // empty when there was no position since power on
+  uint8_t latitude[COORD_SIZE];
+  uint8_t longtitude[COORD_SIZE];
+  uint32_t at;                              // uptime() when it was sent
+  uint16_t acc;                             // its accuracy radius [m], 0 when not known
+} lastloc;
+static uint16_t loccode;                    // result of the last location query, LOCERR_...
+static uint16_t locacc;                     // accuracy radius [m] of the position in 'loc', 0 when not known
+static uint8_t noclbs;                      // AT+CLBS answered ERROR, CIPGSMLOC is used since then
+static uint8_t locstale;                    // location SMS is of 'lastloc', its age is added
+#endif
+
+
+
+// ----------------------------------------------------------------------------------------------
+// init_uart
+// ----------------------------------------------------------------------------------------------
+void init_uart(void) {
+  // double speed by U2X flag = 1 to have 0.2% error rate on 9600 baud
+ UCSR0A = (1<<U2X0);
+  // set baud rate from PRESCALER
+ UBRR0H = (uint8_t)(MYUBBR>>8);
+ UBRR0L = (uint8_t)(MYUBBR);
+#if FEATURE_RXRING
+  // enable receive with interrupt and transmit
+ UCSR0B = (1<<RXEN0) | (1<<TXEN0) | (1<<RXCIE0);
+#else
+  // enable receive and transmit and NO INTERRUPT
+ UCSR0B = (1<<RXEN0) | (1<<TXEN0);
+#endif
+  // set frame format for SIM800L communication
+ UCSR0C = (1<<UCSZ00) | (1<<UCSZ01); // no parity, 1 stop bit, 8-bit data
+#if FEATURE_RXRING
+ sei();
+#endif
+}
+
+
+
+// ----------------------------------------------------------------------------------------------
+// send_uart
+// Sends a single char to UART without ISR
+// ----------------------------------------------------------------------------------------------
+void send_uart(uint8_t c) {
+#ifdef HOST_BUILD
+  hal_uart_tx(c);
+#else
+  // wait for empty data register
+  while (!(UCSR0A & (1<<UDRE0)));
+  // set data into data register
+  UDR0 = c;
+#endif
+}
+
+
+
+#if FEATURE_STACKMON
+#ifndef HOST_BUILD
+extern uint8_t _end;           // first byte after .bss and .noinit, set by the linker
+
+// ----------------------------------------------------------------------------------------------
+// paint RAM between static variables and RAMEND before main() starts, runs in .init3 after
+// the stack pointer is set and before .data / .bss are initialized, nothing is on the stack yet
+// ----------------------------------------------------------------------------------------------
+void stack_paint(void) __attribute__((naked, used, section(".init3")));
+void stack_paint(void)
+{
+  uint8_t *p = &_end;
+  while (p <= (uint8_t *)RAMEND) *p++ = STACK_CANARY;
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+// high-water mark of the stack : bytes above static variables never written since boot,
+// 0 means the stack has reached the buffers and they may be corrupted
+// ----------------------------------------------------------------------------------------------
+uint16_t stack_free(void)
+{
+#ifdef HOST_BUILD
+  return hal_stack_free();
+#else
+  const uint8_t *p = &_end;
+  while ((p <= (const uint8_t *)RAMEND) && (*p == STACK_CANARY)) p++;
+  return p - &_end;
+#endif
+}
+#endif
+
+#if FEATURE_RXRING
+// ----------------------------------------------------------------------------------------------
+// USART receive interrupt puts the byte to the ring buffer, when it is full the byte is lost
+// ----------------------------------------------------------------------------------------------
+ISR(USART_RX_vect)
+{
+  uint8_t c, next;
+#ifdef HOST_BUILD
+  c = hal_uart_rx();
+#else
+  c = UDR0;
+#endif
+  next = (rx_head + 1) & (RX_RING_SIZE - 1);
+  if (next != rx_tail)
+     { rx_ring[rx_head] = c;
+       rx_head = next;
+     };
+}
+
+// ----------------------------------------------------------------------------------------------
+// receive_uart
+// Receives a single char from the ring buffer, waits for the interrupt if it is empty
+// ----------------------------------------------------------------------------------------------
+uint8_t receive_uart() {
+  uint8_t c;
+  while (rx_head == rx_tail)
+#ifdef HOST_BUILD
+    hal_idle();
+#else
+    ;
+#endif
+  c = rx_ring[rx_tail];
+  rx_tail = (rx_tail + 1) & (RX_RING_SIZE - 1);
+  return c;
+}
+
+// drop what SIM800L sent before, the answer to a new command or the RING comes after it
+void rx_flush(void) {
+  rx_tail = rx_head;
+}
+
+#else
+// ----------------------------------------------------------------------------------------------
+// receive_uart
+// Receives a single char without ISR
+// ----------------------------------------------------------------------------------------------
+uint8_t receive_uart() {
+#ifdef HOST_BUILD
+  return hal_uart_rx();
+#else
+  while ( !(UCSR0A & (1<<RXC0)) )
+    ;
+  return UDR0;
+#endif
+}
+#endif
+
+// ----------------------------------------------------------------------------------------------
+// uart_ready
+// nonzero when a received char waits to be read, used by AT_READ timeout
+// ----------------------------------------------------------------------------------------------
+uint8_t uart_ready(void) {
+#if FEATURE_RXRING
+  return rx_head != rx_tail;
+#elif defined(HOST_BUILD)
+  return hal_uart_ready();
+#else
+  return UCSR0A & (1<<RXC0);
+#endif
+}
+
+
+// ----------------------------------------------------------------------------------------------
+// function to search RX buffer for response  SUB IN RX_BUFFER STR
+// SUB is read from PROGMEM in place, no RAM copy of it is needed
+// ----------------------------------------------------------------------------------------------
+uint8_t is_in_rx_buffer(const uint8_t *str, const char *sub) {
+   uint8_t i, j;
+    for(i=0; (i<BUFFER_SIZE) && str[i]; i++)
+    {
+       for(j=0; (i+j<BUFFER_SIZE) && str[i+j] && (str[i+j] == pgm_read_byte(sub+j)); j++)  // while the same chars
+            ;
+       if(pgm_read_byte(sub+j) == 0) return 1;  // full substring has been found
+    }
+     // substring not found
+    return 0;
+}
+
+
+
+// ----------------------------------------------------------------------------------------------
+// uart_puts
+// Sends a string.
+// ----------------------------------------------------------------------------------------------
+void uart_puts(const char *s) {
+  while (*s) {
+    send_uart(*s);
+    s++;
+  }
+}
+
+
+
+// ----------------------------------------------------------------------------------------------
+// uart_puts_P
+// Sends a PROGMEM string compressed by tools/atstrings, byte 0x80 + n is replaced by the
+// ATDICT entry at offset n, other bytes are sent as they are - strings of ATTINY2313 versions
+// are not compressed (AT_DICT 0 in strings/<version>.h), they have no ATDICT
+// ----------------------------------------------------------------------------------------------
+void uart_puts_P(const char *s) {
+  uint8_t c;
+#if AT_DICT
+  const char *d;
+#endif
+#if FEATURE_RXRING
+  rx_flush();
+#endif
+  while ((c = pgm_read_byte(s++)) != 0x00) {
+#if AT_DICT
+    if (c & 0x80) {
+      d = ATDICT + (c & 0x7F);
+      while ((c = pgm_read_byte(d++)) != 0x00) send_uart(c);
+    }
+    else
+#endif
+    send_uart(c);
+  }
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------
+// READLINE from serial port that starts with CRLF and ends with CRLF and put to 'response' buffer what read
+// ---------------------------------------------------------------------------------------------------------------
+uint8_t readline()
+{
+  uint8_t char1, i, wholeline, pos;
+
+  // wait for first CR-LF or exit after timeout i cycles not to overload the char buffer
+   i = 0;
+   wholeline = 0;
+   pos = 0;
+
+  //
+   do {
+      // read chars in pairs to find combination CR LF
+      char1 = receive_uart();
+      // if CR-LF combination detected start to copy the response
+      if   (  (char1 != 0x0a) && (char1 != 0x0d) && (pos < BUFFER_SIZE - 1) )
+         { arena.response[pos] = char1;
+           pos++;
+         };
+      if    (  char1 == 0x0a || char1 == 0x0d )
+         {
+           // if the line was received and this is only CR/LF ending :
+           if (pos > 0) // this is EoL
+               { wholeline = 1;  };
+          // just skip this CRLF character and wait for valuable one
+
+         };
+      // if buffer is empty exit from function there is nothing to read from
+      i++;
+      } while ( (wholeline == 0) && (i<BUFFER_SIZE) );
+   // end of string also when the line was cut by timeout
+   arena.response[pos] = 0;
+
+return (1);
+}
+
+
+// --------------------------------------------------------------------------------------------------------
+// READ CELL GPS from AT+CIPGSMLOC output and put output to 'lattitude' and 'longtitude' buffers
+// with FEATURE_STATS the result code before the first comma goes to 'loccode' - +CIPGSMLOC: 601
+// has no comma at all, and the answer is awaited LOC_TIMEOUT seconds at most - a call cuts it short
+// 'withacc' - answer of AT+CLBS=4 : +CLBS: 0,<long>,<lat>,<accuracy>,yy/mm/dd,hh:mm:ss
+// --------------------------------------------------------------------------------------------------------
+static uint8_t readloc(uint8_t withacc)
+{
+  uint8_t char1, i, pos;
+#if FEATURE_STATS
+  uint8_t digits = 0, first = 0;
+
+   loccode = 0;
+   locacc = 0;
+   if (!wait_rx(LOC_TIMEOUT))
+      { loccode = LOCERR_NOANSWER;
+        return(0);
+      };
+#endif
+
+  // i counter of received chars... not to get deadlock. 70 chars max as a safe fuse
+   i = 0;
+
+      // wait for first COMMA sign after +CIPGSMLOC: message
+      do {
+           char1 = receive_uart();
+           i++;
+#if FEATURE_STATS
+           if (char1 >= '0' && char1 <= '9')
+              { loccode = loccode * 10 + (char1 - '0');
+                digits = 1;
+              }
+           else if (char1 == '\r' || char1 == '\n')
+              { if (digits) break;                // line of the result code only
+                if (first == 'E')
+                   { loccode = LOCERR_ERROR;        // nothing follows ERROR
+                     return(0);
+                   };
+#if FEATURE_PREEMPT
+                if (first == 'R' && at_armed)
+                   { at_ring = 1;                   // RING of a call came before the answer
+                     return(0);
+                   };
+#endif
+                first = 0;
+                // LF left by the last answer read, the next line is awaited like the first one
+                if (!wait_rx(LOC_TIMEOUT))
+                   { loccode = LOCERR_NOANSWER;
+                     return(0);
+                   };
+              }
+           else if (char1 == ',' && !digits)
+              { // comma of a URC before the answer (+CMTI: "SM",1) - no result code, its line is skipped
+                do char1 = receive_uart(); while (char1 != '\n');
+                i = 0;
+                first = 0;
+                if (!wait_rx(LOC_TIMEOUT))
+                   { loccode = LOCERR_NOANSWER;
+                     return(0);
+                   };
+              }
+           else if (char1 != ',')
+              { loccode = 0;
+                digits = 0;
+                if (first == 0) first = char1;
+              };
+#endif
+         } while ( (char1 != ',') && (i<20));
+
+#if FEATURE_STATS
+      // +CLBS: codes like CIPGSMLOC ones - 3 location failed, 4 query timeout, others
+          if (withacc && char1 != ',' && digits)
+             loccode = loccode == 3 ? 404 : loccode == 4 ? 408 : 65535;
+      // error code, or no code within 20 chars - probably module restarted itself
+          if (char1 != ',' || loccode != 0)
+             { if (loccode < 400) loccode = LOCERR_RESET;
+               return(0);
+             };
+#else
+      // if 'i' fuse == 20 chars and no comma sign return with 0, probably module restarted itself
+          if (i == 20) return(0);
+#endif
+
+
+          // if COMMA detected start to copy the response - LONGTITUDE first
+      pos = 0;
+      do  {
+           char1 = receive_uart();
+           if (pos < COORD_SIZE) arena.loc.longtitude[pos++] = char1;
+           i++;
+         } while ( (char1 != ',') && (i<70) );
+           arena.loc.longtitude[pos-1] = 0;
+
+      // if COMMA detected start to copy the response - LATITUDE second
+      pos = 0;
+      do  {
+           char1 = receive_uart();
+          if (pos < COORD_SIZE) arena.loc.latitude[pos++] = char1;
+          i++;
+         } while ( (char1 != ',') && (i<70) );
+           // put end of string to latitude
+           arena.loc.latitude[pos-1] = 0;
+
+#if FEATURE_STATS
+      // accuracy radius in meters between latitude and date of AT+CLBS=4
+      if (withacc)
+        do  {
+             char1 = receive_uart();
+             if (char1 >= '0' && char1 <= '9' && locacc < 6500) locacc = locacc * 10 + (char1 - '0');
+             i++;
+           } while ( (char1 != ',') && (i<70) );
+#endif
+
+      // Now copy DATE & TIME UTC to datetime buffer and wait for CRLF to finish
+      pos = 0;
+        do  {
+           char1 = receive_uart();
+           if (pos < DATETIME_SIZE) arena.loc.datetime[pos++] = char1;
+           i++;
+         } while ( (char1 != '\r') && (char1 != '\n') && (i<70) );       // WAIT FOR CR LF
+           arena.loc.datetime[pos-1] = 0;
+           char1 = receive_uart();  // read last CR or LF and exit
+
+      // two digit year of AT+CLBS to 2020/01/01,12:00:00 like CIPGSMLOC
+      if (withacc && arena.loc.datetime[2] == '/')
+         {
+           memmove(arena.loc.datetime + 2, arena.loc.datetime, DATETIME_SIZE - 2);
+           arena.loc.datetime[0] = '2';
+           arena.loc.datetime[1] = '0';
+           arena.loc.datetime[DATETIME_SIZE - 1] = 0;
+         };
+
+return (1);
+}
+
+uint8_t readcellgps()
+{
+   return readloc(0);
+}
+
+#if FEATURE_STATS
+uint8_t readclbs()
+{
+   return readloc(1);
+}
+#endif
+
+// ----------------------------------------------------------------------------------------
+// read PHONE NUMBER from AT+CLIP output and copy it to buffer for SMS sending
+// ----------------------------------------------------------------------------------------
+uint8_t readphonenumber()
+{
+  uint8_t char1, i, pos;
+  // wait for first quotation
+   pos = 0;
+   i = 0;
+
+       // wait for "CLIP:" and space
+      do {
+           char1 = receive_uart();
+           i++;
+         } while ( (char1 != ':') && (i<80) );
+
+      // wait for first quotation sign, 'i' protection of buffer overload
+      do {
+           char1 = receive_uart();
+           i++;
+         } while ( (char1 != '\"') && (i<80)  );
+      // if quotation detected start to copy the response - phonenumber
+      do  {
+           char1 = receive_uart();
+           if (pos < PHONE_SIZE) phonenumber[pos++] = char1;
+           i++;
+         } while ( (char1 != '\"') && (i<80) );    // until end of quotation
+     // put NULL to end the string phonenumber
+           phonenumber[pos-1] = 0;
+     // wait for CRLF for new response to empty RX buffer
+           do {
+           char1 = receive_uart();
+           i++;
+           } while ( (char1 != 0x0a)  && (char1 != 0x0d) && (i<80)  );
+return (1);
+}
+
+#if FEATURE_STATS
+// ----------------------------------------------------------------------------------------
+// read BATTERY VOLTAGE in milivolts from AT+CBC output ( +CBC: 0,95,4100 ) to 'battery' buffer
+// ----------------------------------------------------------------------------------------
+uint8_t readbattery()
+{
+  uint8_t char1, i, commas;
+
+      // skip charging status and percent, wait for second COMMA sign
+      i = 0;
+      commas = 0;
+      do {
+           char1 = receive_uart();
+           if (char1 == ',') commas++;
+           i++;
+         } while ( (commas < 2) && (i<70) );
+      // copy voltage until CR or LF
+      i = 0;
+      do  {
+           char1 = receive_uart();
+           arena.loc.battery[i++] = char1;
+         } while ( (char1 != 0x0a) && (char1 != 0x0d) && (i < BATTERY_SIZE) );
+           arena.loc.battery[i-1] = 0;
+return (1);
+}
+#endif
+
+
+#if FEATURE_STATS
+// ----------------------------------------------------------------------------------------
+// read SENDER NUMBER from AT+CMGR output and copy it to buffer for SMS reply
+// +CMGR: "REC UNREAD","+48123456789","","20/01/01,12:00:00+04" then line with SMS text
+// ----------------------------------------------------------------------------------------
+uint8_t readsmssender()
+{
+  uint8_t char1, i, quotes, pos;
+
+   pos = 0;
+   i = 0;
+   quotes = 0;
+
+      // skip status of SMS and wait for opening quotation of sender number
+      do {
+           char1 = receive_uart();
+           if (char1 == '\"') quotes++;
+           i++;
+         } while ( (quotes < 3) && (i<80) );
+      // copy sender number until closing quotation
+      do  {
+           char1 = receive_uart();
+           if (pos < PHONE_SIZE) phonenumber[pos++] = char1;
+           i++;
+         } while ( (char1 != '\"') && (i<80) );
+           phonenumber[pos-1] = 0;
+     // wait for CRLF, SMS text follows in the next line
+           do {
+           char1 = receive_uart();
+           i++;
+           } while ( (char1 != 0x0a)  && (char1 != 0x0d) && (i<80)  );
+return (1);
+}
+#endif
+
+
+#if FEATURE_CELLDB
+// ----------------------------------------------------------------------------------------
+// read SIM800L clock from AT+CCLK output ( +CCLK: "20/01/01,12:00:00+04" ) to 'datetime' buffer
+// time zone is left out, location SMS from the cell database has no time of CIPGSMLOC
+// ----------------------------------------------------------------------------------------
+uint8_t readclock()
+{
+  uint8_t char1, i, pos;
+
+   i = 0;
+      // wait for opening quotation
+      do {
+           char1 = receive_uart();
+           i++;
+         } while ( (char1 != '\"') && (i<20) );
+      if (i == 20) return(0);
+      // copy date and time until time zone or closing quotation
+      pos = 0;
+      do  {
+           char1 = receive_uart();
+           if (pos < DATETIME_SIZE) arena.loc.datetime[pos++] = char1;
+           i++;
+         } while ( (char1 != '+') && (char1 != '-') && (char1 != '\"') && (i<40) );
+           arena.loc.datetime[pos-1] = 0;
+return (1);
+}
+#endif
+
+
+#if FEATURE_CELLDB || FEATURE_GNSS
+// millionths of degree from the cell database or GNSS to text like 50.064651 for the location SMS
+void coordtoa(int32_t v, uint8_t *s)
+{
+  char fraction[8];
+   if (v < 0)
+      { *s++ = '-';
+        v = -v;
+      };
+   ultoa(v / 1000000, (char *)s, 10);
+   s += strlen((char *)s);
+   *s++ = '.';
+   ultoa(v % 1000000 + 1000000, fraction, 10);      // 1 in front keeps leading zeros
+   strcpy((char *)s, fraction + 1);
+}
+#endif
+
+
+#if FEATURE_STATS
+// ----------------------------------------------------------------------------------------
+// seconds accounted to all power states - clock of position and ephemeris age and TTFF,
+// it goes on over restarts with the statistics in EEPROM
+// ----------------------------------------------------------------------------------------
+uint32_t uptime(void)
+{
+  uint32_t t = 0;
+  uint8_t i;
+
+   for (i = 0; i < NBR_STATES; i++) t += stats.seconds[i];
+return (t);
+}
+#endif
+
+
+#if FEATURE_GNSS
+// ----------------------------------------------------------------------------------------
+// AT+CGNSINF answer fed byte by byte to the GNSS parser as it comes, notes TTFF of the first
+// fix of the on-window, returns 1 when the fix has HDOP up to GNSS_HDOP and the receiver can
+// go off - gives up after 200 ms of silence
+// ----------------------------------------------------------------------------------------
+uint8_t readgnss()
+{
+  uint16_t idle;
+  uint32_t ttff;
+  uint8_t i;
+
+   i = 0;
+   do {
+        for (idle = 0; !uart_ready(); idle++)
+           {
+             if (idle == 4000) return(0);
+             _delay_us(50);
+           };
+        if (gnss_feed(&gnss, receive_uart())) break;
+      } while (++i < 200);
+   if (i == 200 || !gnss.fix.valid) return(0);
+   if (gnss_lastttff == 0)
+      { // 255 s at most, a fix within the first second is 1 - 0 is no fix
+        ttff = uptime() - gnss_onat;
+        gnss_lastttff = ttff > 255 ? 255 : ttff == 0 ? 1 : ttff;
+      };
+return (gnss.fix.hdop <= GNSS_HDOP);
+}
+
+// ----------------------------------------------------------------------------------------
+// GNSS fix to 'latitude', 'longtitude' and 'datetime' like from CIPGSMLOC
+// ----------------------------------------------------------------------------------------
+uint8_t gnssloc()
+{
+  uint8_t i, *s;
+  uint32_t date, time;
+
+   coordtoa(gnss.fix.lat, arena.loc.latitude);
+   coordtoa(gnss.fix.lon, arena.loc.longtitude);
+   // yyyymmdd hhmmss to 2020/01/01,12:00:00 from the end
+   date = gnss.fix.date;
+   time = gnss.fix.time;
+   s = arena.loc.datetime + 19;
+   *s = 0;
+   for (i = 19; i-- > 0;)
+      {
+        s--;
+        if (i == 16 || i == 13) *s = ':';
+        else if (i == 10) *s = ',';
+        else if (i == 7 || i == 4) *s = '/';
+        else if (i > 10) { *s = '0' + time % 10; time /= 10; }
+        else { *s = '0' + date % 10; date /= 10; };
+      };
+   gnssfix = 1;
+   locacc = gnss.fix.hdop == 255 ? 0 : ((uint16_t)gnss.fix.hdop * GNSS_UERE + 9) / 10;
+return (0);
+}
+#endif
+
+
+#if FEATURE_CELLDB || FEATURE_GEOSERVER || FEATURE_UDP
+// ----------------------------------------------------------------------------------------
+// cell of AT+CENG line in 'response' (engineering mode 1), cellid and lac in hex
+// +CENG: 0,"<arfcn>,<rxl>,<rxq>,<mcc>,<mnc>,<bsic>,<cellid>,<rla>,<txp>,<lac>,<TA>"   serving cell
+// +CENG: 1,"<arfcn>,<rxl>,<bsic>,<cellid>,<mcc>,<mnc>,<lac>"                          neighbours
+// returns 0 when the line is something else or the cell is empty (not registered, no neighbour)
+// ----------------------------------------------------------------------------------------
+uint8_t parsecell(cell_t *c)
+{
+  char *p;
+  uint8_t i, serving;
+  uint16_t f[10];
+
+   p = strchr((char *)arena.response, '\"');
+   if (p == NULL || p - (char *)arena.response < 2) return(0);
+   serving = (p[-2] == '0');
+   for (i = 0; i < (serving ? 10 : 7); i++)
+      {
+        f[i] = strtoul(p + 1, &p, (serving ? (i == 6 || i == 9) : (i == 3 || i == 6)) ? 16 : 10);
+        if (*p != ',' && *p != '\"') return(0);
+      };
+   c->rxl = f[1];
+   if (serving)
+      { c->mcc = f[3]; c->mnc = f[4]; c->ci = f[6]; c->lac = f[9]; }
+   else
+      { c->ci = f[3]; c->mcc = f[4]; c->mnc = f[5]; c->lac = f[6]; };
+return (c->mcc != 0 && c->ci != 0 && c->ci != 0xFFFF);
+}
+#endif
+
+
+#if FEATURE_CELLDB
+// ----------------------------------------------------------------------------------------
+// serving cell from AT+CENG line in 'response' looked up in the cell database by binary search,
+// position goes to 'latitude' and 'longtitude' buffers, returns 0 when the cell is not there
+// ----------------------------------------------------------------------------------------
+uint8_t cellfix()
+{
+  cell_t c;
+  uint8_t i;
+  uint16_t first, end, mid;
+  uint32_t key, cell;
+
+   locacc = 0;                                // radius of the cell is not in the database
+   if (!parsecell(&c)) return(0);
+   key = ((uint32_t)c.lac << 16) | c.ci;
+
+   for (i = 0; i < sizeof(CELLDB_NETWORK) / sizeof(CELLDB_NETWORK[0]); i++)
+      {
+        if (pgm_read_word(&CELLDB_NETWORK[i].mcc) != c.mcc || pgm_read_word(&CELLDB_NETWORK[i].mnc) != c.mnc) continue;
+        first = pgm_read_word(&CELLDB_NETWORK[i].first);
+        end = pgm_read_word(&CELLDB_NETWORK[i].end);
+        while (first < end)
+           {
+             mid = first + (end - first) / 2;
+             cell = ((uint32_t)pgm_read_word(&CELLDB_CELL[mid].lac) << 16) | pgm_read_word(&CELLDB_CELL[mid].ci);
+             if (cell == key)
+                { // coordinates overwrite 'response', the line is not needed any more
+                  coordtoa((int32_t)pgm_read_dword(&CELLDB_CELL[mid].lat), arena.loc.latitude);
+                  coordtoa((int32_t)pgm_read_dword(&CELLDB_CELL[mid].lon), arena.loc.longtitude);
+                  return(1);
+                };
+             if (cell < key) first = mid + 1;
+             else end = mid;
+           };
+        return(0);
+      };
+return (0);
+}
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// delay procedure ASM based because _delay_ms() is working bad for 1 MHz clock MCU
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if AT_TICK
+// one of the 100 ms slices of delay_sec() and wait_rx() - every 10th accounts a second to the current
+// power state and TRACK INTERVAL, with at_armed set by main loop RI/RING is sampled, URC pulses it
+// LOW for 120 ms but a call holds it LOW until answered : 3 LOW samples in a row in '*low' set
+// at_ring and return 1, the wait ends then
+uint8_t at_tick(uint8_t *low)
+{
+#if FEATURE_STATS
+  static uint8_t tenths = 0;
+
+   if (++tenths == 10)
+      { tenths = 0;
+        stats.seconds[energy_state]++;
+        track_seconds++;
+      };
+#endif
+#if FEATURE_PREEMPT
+   if (!at_armed) return 0;
+   if (PIND & (1 << PD2)) *low = 0;
+   else if (++*low == 3)
+      { at_ring = 1;
+        return 1;
+      };
+#else
+   (void)low;
+#endif
+   return 0;
+}
+#endif
+
+// delay partucular number of i seconds,  i < 255
+// with FEATURE_PREEMPT it goes in 100 ms slices of at_tick(), which counts them and with at_armed
+// set by main loop checks RI/RING, a call ends the delay with at_ring
+
+void delay_sec(uint8_t i)
+{
+#if FEATURE_PREEMPT
+uint8_t slice, low = 0;
+
+if (at_armed && at_ring) return;   // call is waiting, scripts are being left
+#endif
+
+while(i > 0)
+{
+#if FEATURE_PREEMPT
+for (slice = 0; slice < 10; slice++)
+{
+// Delay 100 000 cycles
+// 100ms at 1 MHz
+
+#ifdef HOST_BUILD
+hal_delay_us(100000UL);
+#else
+asm volatile (
+    "    ldi  r18, 130"	"\n"
+    "    ldi  r19, 222"	"\n"
+    "1:  dec  r19"	"\n"
+    "    brne 1b"	"\n"
+    "    dec  r18"	"\n"
+    "    brne 1b"	"\n"
+    "    nop"	"\n"
+    : : : "r18", "r19"             // slice and low may live in registers
+);
+#endif
+
+if (at_tick(&low)) return;
+};
+#else
+// Generated by delay loop calculator
+// at http://www.bretmulvey.com/avrdelay.html
+//
+// Delay 1 000 000 cycles
+// 1s at 1 MHz
+
+#ifdef HOST_BUILD
+hal_delay_us(1000000UL);
+#else
+asm volatile (
+    "    ldi  r18, 6"	"\n"
+    "    ldi  r19, 19"	"\n"
+    "    ldi  r20, 174"	"\n"
+    "1:  dec  r20"	"\n"
+    "    brne 1b"	"\n"
+    "    dec  r19"	"\n"
+    "    brne 1b"	"\n"
+    "    dec  r18"	"\n"
+    "    brne 1b"	"\n"
+    "    rjmp 1f"	"\n"
+    "1:"	"\n"
+);
+#endif
+#endif
+
+#if FEATURE_STATS && !FEATURE_PREEMPT
+stats.seconds[energy_state]++;  // account this second to current power state
+track_seconds++;
+#endif
+
+i--;  // decrease another second
+
+};    // repeat until i not zero
+
+}
+
+
+#if FEATURE_STATS && defined(SLEEP_POLLED)
+//
+// delay multiplication of 50 microseconds
+//
+
+void delay_50usec(uint32_t i)
+{
+while(i > 0)
+{
+// Generated by delay loop calculator
+// at http://www.bretmulvey.com/avrdelay.html
+// Delay 50 cycles
+// 50us at 1 MHz
+
+#ifdef HOST_BUILD
+hal_delay_us(50);
+#else
+asm volatile (
+    "    ldi  r18, 16"	"\n"
+    "1:  dec  r18"	"\n"
+    "    brne 1b"	"\n"
+    "    rjmp 1f"	"\n"
+    "1:"	"\n"
+);
+#endif
+
+
+
+i--;  // decrease another 50usec if needed
+
+};    // repeat until i not zero
+
+}
+#endif
+
+
+
+#if FEATURE_STATS
+// -------------------------------------------------------------------------------
+// energy statistics kept in EEPROM, loaded at startup and saved before each sleep
+// eeprom_update_block writes only changed bytes to save EEPROM endurance
+// -------------------------------------------------------------------------------
+void stats_load(void)
+{
+   eeprom_read_block((void *)&stats, &eestats, sizeof(stats));
+   if (stats.magic != STATS_MAGIC)
+      {
+       memset((void *)&stats, 0, sizeof(stats));
+       stats.magic = STATS_MAGIC;
+      };
+}
+
+void stats_save(void)
+{
+   eeprom_update_block((const void *)&stats, &eestats, sizeof(stats));
+}
+
+// settings of SMS commands, defaults when EEPROM was never written
+void settings_load(void)
+{
+   eeprom_read_block(&cfg, &eecfg, sizeof(cfg));
+   if (cfg.magic != SETTINGS_MAGIC)
+      {
+       memset(&cfg, 0, sizeof(cfg));
+       cfg.magic = SETTINGS_MAGIC;
+       cfg.interval = 60;
+       cfg.backoff = 30;
+#if FEATURE_MQTT
+       cfg.liveint = LIVE_INTERVAL;
+#endif
+      };
+}
+
+void settings_save(void)
+{
+   eeprom_update_block(&cfg, &eecfg, sizeof(cfg));
+}
+
+// TRACK ON and 'interval' minutes passed since the last location SMS, not while SIM800L is off
+uint8_t track_due(void)
+{
+   return cfg.track && !modem_off && track_seconds >= (uint32_t)cfg.interval * 60;
+}
+
+// send a decimal number over UART
+void uart_putnum(uint32_t n)
+{
+  char number[11];
+   ultoa(n, number, 10);
+   uart_puts(number);
+}
+
+#if FEATURE_GEOSERVER
+// lines of AT+CENG? until OK to 'geocells', returns the number of cells, 0 when none is usable
+uint8_t readcells(void)
+{
+  uint8_t i;
+
+   geocount = 0;
+   for (i = 0; i < GEOCELLS + 4; i++)          // mode line, cells, empty neighbours and OK
+      {
+        readline();
+        if (response_has_P(ISOK) || response_has_P(ISERROR)) break;
+        if (geocount < GEOCELLS && response_has_P(ISCENGANY) && parsecell(&geocells[geocount])) geocount++;
+      };
+return (geocount);
+}
+
+// 'geocells' as c= parameter of the geoserver URL : mcc,mnc,lac,ci,rxl;mcc,mnc,lac,ci,rxl...
+uint8_t putcells(void)
+{
+  uint8_t i;
+
+   for (i = 0; i < geocount; i++)
+      {
+        if (i > 0) send_uart(';');
+        uart_putnum(geocells[i].mcc);
+        send_uart(',');
+        uart_putnum(geocells[i].mnc);
+        send_uart(',');
+        uart_putnum(geocells[i].lac);
+        send_uart(',');
+        uart_putnum(geocells[i].ci);
+        send_uart(',');
+        uart_putnum(geocells[i].rxl);
+      };
+return (0);
+}
+#endif
+
+#if FEATURE_GNSS
+// number with one decimal place like 12.6
+void uart_putdec(uint16_t n)
+{
+   uart_putnum(n / 10);
+   send_uart('.');
+   send_uart('0' + n % 10);
+}
+
+// speed, HDOP and satellites of a GNSS fix in the location SMS, nothing for cell location
+uint8_t putgnss(void)
+{
+   if (gnssfix)
+      {
+        uart_puts_P(SPEEDTXT);
+        uart_putdec(gnss.fix.speed);
+        uart_puts_P(HDOPTXT);
+        if (gnss.fix.hdop != 255) uart_putdec(gnss.fix.hdop);
+        uart_puts_P(SATSTXT);
+        uart_putnum(gnss.fix.sats);
+        gnssfix = 0;
+      };
+return (0);
+}
+
+// AT+CGNSPWR=1 answered OK - on-window starts, twice the slowest of the last hot starts while
+// the ephemeris is warm, GNSS_COLD without it or when no hot start was measured yet
+uint8_t gnssstart(void)
+{
+  uint8_t i, slowest = 0;
+
+   gnss_init(&gnss);
+   gnss_onat = uptime();
+   gnss_lastttff = 0;
+   if (gnss_onat - gnss_lastfix >= GNSS_WARM) gnss_warm = 0;
+   for (i = 0; i < GNSS_HISTORY; i++)
+      if (gnss_ttff[i] > slowest) slowest = gnss_ttff[i];
+   gnss_window = GNSS_COLD;
+   if (gnss_warm && slowest > 0 && slowest < GNSS_COLD / 2)
+      gnss_window = slowest * 2 < GNSS_HOTMIN ? GNSS_HOTMIN : slowest * 2;
+   stats.gnsswindows++;
+return (0);
+}
+
+// on-window is not over yet
+uint8_t gnsswindow(void)
+{
+   return uptime() - gnss_onat < gnss_window;
+}
+
+// receiver is off - on-time and TTFF to statistics, the ephemeris is warm only after a fix,
+// returns 1 when there is a fix for the location SMS (HDOP may be above GNSS_HDOP)
+uint8_t gnssstop(void)
+{
+  uint32_t now = uptime();
+
+   stats.gnssseconds += now - gnss_onat;
+   if (gnss_lastttff == 0)
+      { gnss_warm = 0;
+        return (0);
+      };
+   stats.gnssfixes++;
+   stats.gnssttff += gnss_lastttff;
+   if (gnss_warm)
+      { gnss_ttff[gnss_next] = gnss_lastttff;
+        gnss_next = (gnss_next + 1) % GNSS_HISTORY;
+      };
+   gnss_warm = 1;
+   gnss_lastfix = now;
+return (gnss.fix.valid);
+}
+
+// ephemeris gets old - on-window now keeps the next start hot
+uint8_t gnss_due(void)
+{
+   return GNSS_REFRESH && gnss_warm && !modem_off && uptime() - gnss_lastfix >= GNSS_REFRESH * 60UL;
+}
+#else
+#define gnss_due() 0
+#endif
+
+// energy accounting of the no coverage backoff and bearer retries, called by scripts
+uint8_t enter_nocov(void)
+{
+   energy_state = STATE_NOCOV;
+   return 0;
+}
+
+uint8_t leave_nocov(void)
+{
+   energy_state = STATE_AWAKE;
+   stats_save();
+   return 0;
+}
+
+uint8_t count_sapbrretry(void)
+{
+   stats.sapbrretries++;
+   return 0;
+}
+
+// class of the failed location query to its counter, returns 1 when the query is worth
+// repeating at once : network error (601 network, 603 DNS, 604 stack busy) or timeout
+uint8_t locerror(void)
+{
+   switch (loccode)
+   {
+     case 601:
+     case 603:
+     case 604:
+       stats.locnet++;
+       return 1;
+     case 408:
+     case LOCERR_NOANSWER:
+       stats.loctimeout++;
+       return 1;
+     case LOCERR_RESET:
+       stats.locreset++;
+       return 0;
+   }
+   stats.locother++;
+   return 0;
+}
+
+#if FEATURE_GEOSERVER
+// HTTP status of the geoserver answer +HTTPACTION: 0,<status>,<length> to 'loccode' and its
+// counter, 404 - the geoserver does not know the cells, no +HTTPACTION: at all is a timeout
+uint8_t httpstatus(void)
+{
+  char *p = strchr((char *)arena.response, ',');
+
+   if (response_has_P(ISHTTPACTION) && p != NULL) loccode = atoi(p + 1);
+   locerror();
+   return 0;
+}
+#endif
+
+#if FEATURE_OTA
+// CRC-32 of the application area, what the update delta was made for
+static uint32_t otacrc(void)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  uint16_t a;
+   for (a = 0; a < OTA_STAGE; a++) crc = ota_crc32(crc, ota_flash_byte(a));
+   return ~crc;
+}
+
+// AT+HTTPREAD=<offset>,OTA_PAGE - +HTTPREAD: <n>, then n bytes of the update and OK, the bytes go
+// to the page buffer and the delta ones to 'crc' as they come - returns n, 0 when they did not come
+static uint8_t otaread(uint16_t offset, uint32_t *crc)
+{
+  uint8_t c = 0, i, lo = 0xFF;
+  uint16_t n = 0;
+   uart_puts_P(HTTPREADAT);
+   uart_putnum(offset);
+   send_uart(',');
+   uart_putnum(OTA_PAGE);
+   uart_puts_P(EOL);
+   for (i = 0; i < 40 && c != ':'; i++)
+      {
+        if (!wait_rx(OTA_WAIT)) return 0;
+        c = receive_uart();
+      };
+   while (c != '\n')                        // length up to the end of the line
+      {
+        if (!wait_rx(OTA_WAIT)) return 0;
+        c = receive_uart();
+        if (c >= '0' && c <= '9') n = n * 10 + (c - '0');
+      };
+   if (n == 0 || n > OTA_PAGE) return 0;
+   for (i = 0; i < n; i++)
+      {
+        if (!wait_rx(OTA_WAIT)) return 0;
+        c = receive_uart();
+        if (offset + i >= OTA_HEADER) *crc = ota_crc32(*crc, c);
+        if (i & 1) ota_spm(OTA_STAGE + offset + i - 1, OTA_SPM_FILL, lo | (c << 8));
+        else lo = c;
+      };
+   if (n & 1) ota_spm(OTA_STAGE + offset + n - 1, OTA_SPM_FILL, lo | 0xFF00);
+   if (!wait_rx(OTA_WAIT)) return 0;
+   readline();                                // OK
+   return n;
+}
+
+// update of +HTTPACTION: 0,200,<length> in 'response' to the staging area a page at a time, every
+// page is erased before it is asked for while SIM800L is silent and written after its OK - returns 1
+// when it is whole, has its CRC and was made for the application running, the error goes to the
+// result in EEPROM otherwise
+uint8_t otaload(void)
+{
+  char *p = strrchr((char *)arena.response, ',');
+  uint32_t crc = 0xFFFFFFFFUL;
+  long size = p != NULL ? atol(p + 1) : 0;
+  uint16_t at;
+  uint8_t i, n, result = OTA_ESIZE;
+  ota_header_t h;
+
+   if (size >= OTA_HEADER && size <= OTA_JOURNAL - OTA_STAGE)
+     {
+      result = OTA_EHTTP;
+      for (at = 0; at < size; at += OTA_PAGE)
+         {
+           n = size - at < OTA_PAGE ? size - at : OTA_PAGE;
+           ota_spm(OTA_STAGE + at, OTA_SPM_ERASE, 0);
+           if (otaread(at, &crc) != n) break;
+           ota_spm(OTA_STAGE + at, OTA_SPM_WRITE, 0);
+         };
+      if (at >= size)
+         {
+           for (i = 0; i < OTA_HEADER; i++) ((uint8_t *)&h)[i] = ota_flash_byte(OTA_STAGE + i);
+           result = OTA_ECRC;
+           if (memcmp_P(h.magic, OTAMAGIC, 4) == 0 && h.size == size - OTA_HEADER && ~crc == h.deltacrc)
+             { if (otacrc() == h.oldcrc) return 1;
+               result = OTA_EBASE;
+             };
+         };
+     };
+   eeprom_update_byte(&OTA_EEPROM->result, result);
+   return 0;
+}
+#endif
+
+// 1 when AT+CLBS is known not to work, LOCATE goes to CIPGSMLOC
+uint8_t cipgsmloc(void)
+{
+   return noclbs;
+}
+
+// AT+CLBS answered ERROR - older SIM800L firmware, CIPGSMLOC without accuracy from now on,
+// returns 1 to ask it at once
+uint8_t clbsmissing(void)
+{
+   if (loccode != LOCERR_ERROR || noclbs) return 0;
+   noclbs = 1;
+   return 1;
+}
+
+// accuracy radius [m] of 'lastloc' now, it grows LOC_DRIFT every minute since it was sent,
+// 0xFFFF when there is none or its accuracy is not known
+uint16_t lastacc(void)
+{
+  uint32_t r;
+
+   if (lastloc.datetime[0] == 0 || lastloc.acc == 0) return 0xFFFF;
+   r = lastloc.acc + (uptime() - lastloc.at) * LOC_DRIFT / 60;
+   return r > 0xFFFF ? 0xFFFF : r;
+}
+
+// age of 'lastloc' and why there is no new position in the location SMS, nothing for a new one
+// no error when the last position was still more accurate than a new one
+uint8_t putstale(void)
+{
+   if (locstale)
+      {
+        uart_puts_P(LASTKNOWN);
+        uart_putnum((uptime() - lastloc.at) / 60);
+        if (loccode != 0)
+           { uart_puts_P(LOCERRTXT);
+             uart_putnum(loccode);
+           };
+        uart_puts_P(EOL);
+        locstale = 0;
+      };
+   return 0;
+}
+
+// accuracy radius of the position when it is known
+uint8_t putacc(void)
+{
+   if (locacc != 0)
+      {
+        uart_puts_P(ACCTXT);
+        uart_putnum(locacc);
+      };
+   return 0;
+}
+
+#if FEATURE_MQTT || FEATURE_UDP
+// AT+CIPSEND=n and its '>' prompt, 1 when SIM800L waits for the n bytes
+uint8_t cipsend(uint16_t n)
+{
+  uint8_t c, i;
+
+   uart_puts_P(CIPSEND);
+   uart_putnum(n);
+   uart_puts_P(EOL);
+   for (i = 0; i < BUFFER_SIZE; i++)          // a URC may come first
+      {
+        if (!wait_rx(IP_WAIT)) return 0;
+        c = receive_uart();
+        if (c == '>') return wait_rx(1) && receive_uart() == ' ';   // "> " prompt
+        if (c == 'E')
+           { readline();                      // rest of ERROR - no connection
+             return 0;
+           };
+      };
+   return 0;
+}
+
+// data of the peer after SEND OK : +IPD,<length>:<data> (AT+CIPHEAD=1), its first 'size' bytes
+// go to 'buf' - returns the length, 0 when nothing came in 'sec' seconds
+uint8_t ipdanswer(uint8_t *buf, uint8_t size, uint8_t sec)
+{
+  uint8_t c = 0, i, n = 0;
+
+   for (i = 0; i < 40 && c != ':'; i++)
+      {
+        if (!wait_rx(sec)) return 0;
+        c = receive_uart();
+        if (c == ',') n = 0;
+        else if (c >= '0' && c <= '9') n = n * 10 + (c - '0');
+      };
+   if (c != ':') return 0;
+   for (i = 0; i < n; i++)
+      {
+        if (!wait_rx(sec)) return 0;
+        c = receive_uart();
+        if (i < size) buf[i] = c;
+      };
+   return n;
+}
+#endif
+
+#if FEATURE_MQTT
+// bytes of the fixed header : packet type and 'n' remaining length of 1 or 2 bytes (n below 16384)
+#define MQTTHEAD(n) ((n) < 128 ? 2 : 3)
+
+// fixed header, the remaining length in 7 bit groups from the lowest with bit 7 set when more follow
+void mqtthead(uint8_t type, uint16_t n)
+{
+   send_uart(type);
+   do
+      { send_uart(n < 128 ? n : (n & 0x7F) | 0x80);
+        n >>= 7;
+      } while (n);
+}
+
+// MQTT string from flash : 2 byte length and the text
+void mqttstring(const char *s, uint16_t n)
+{
+   send_uart(n >> 8);
+   send_uart(n);
+   while (n--) send_uart(pgm_read_byte(s++));
+}
+
+// packet of the broker, 1 when it is of 'type' and its return code (CONNACK) is 0
+uint8_t mqttanswer(uint8_t type)
+{
+  uint8_t p[4] = { 0, 0, 0, 0 };
+
+   return ipdanswer(p, sizeof(p), IP_WAIT) && p[0] == type && p[3] == 0;
+}
+
+// MQTT CONNECT with MQTT_CLIENT identifier, returns 1 when it went to SIM800L
+uint8_t mqttconnect(void)
+{
+  uint8_t i;
+  uint16_t n = strlen_P(MQTTCLIENT) + sizeof(MQTTCONNECT) + 2;
+
+   if (!cipsend(n + MQTTHEAD(n))) return 0;
+   mqtthead(0x10, n);
+   for (i = 0; i < sizeof(MQTTCONNECT); i++) send_uart(pgm_read_byte(&MQTTCONNECT[i]));
+   mqttstring(MQTTCLIENT, n - sizeof(MQTTCONNECT) - 2);
+   stats.livebytes += n + MQTTHEAD(n);
+   return 1;
+}
+
+uint8_t mqttconnack(void)
+{
+   return mqttanswer(0x20);
+}
+
+// position in 'loc' to MQTT_TOPIC as QoS 0 PUBLISH "latitude,longtitude,accuracy,battery"
+// straight from 'loc', returns 1 when it went to SIM800L
+uint8_t mqttpublish(void)
+{
+  char acc[6];
+  uint16_t t = strlen_P(MQTTTOPIC), n;
+
+   utoa(locacc, acc, 10);
+   n = 2 + t + strlen((char *)arena.loc.latitude) + strlen((char *)arena.loc.longtitude)
+       + strlen(acc) + strlen((char *)arena.loc.battery) + 3;
+   if (!cipsend(n + MQTTHEAD(n))) return 0;
+   mqtthead(0x30, n);
+   mqttstring(MQTTTOPIC, t);
+   uart_puts((char *)arena.loc.latitude);
+   send_uart(',');
+   uart_puts((char *)arena.loc.longtitude);
+   send_uart(',');
+   uart_puts(acc);
+   send_uart(',');
+   uart_puts((char *)arena.loc.battery);
+   stats.livebytes += n + MQTTHEAD(n);
+   return 1;
+}
+
+// PINGREQ keeps the connection when no position was published, returns 1 when it went out
+uint8_t mqttping(void)
+{
+   if (!cipsend(2)) return 0;
+   send_uart(0xC0);
+   send_uart(0);
+   stats.livebytes += 2;
+   return 1;
+}
+
+uint8_t mqttpingresp(void)
+{
+   return mqttanswer(0xD0);
+}
+
+uint8_t mqttdisconnect(void)
+{
+   if (cipsend(2))
+      { send_uart(0xE0);
+        send_uart(0);
+        stats.livebytes += 2;
+      };
+   return 0;
+}
+
+// call with LIVE on - live session after the location SMS, but a call that ended one gets the SMS only
+uint8_t livecall(void)
+{
+   live_left = live_stopped ? 0 : cfg.live * 60;
+   live_stopped = 0;
+   return 0;
+}
+#endif
+
+#if FEATURE_UDP
+// big endian fields of the UDP report
+void put16(uint8_t *p, uint16_t v)
+{
+   p[0] = v >> 8;
+   p[1] = v;
+}
+
+void put32(uint8_t *p, uint32_t v)
+{
+   put16(p, v >> 16);
+   put16(p + 2, v);
+}
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial 0xFFFF) closing the report and the ack
+uint16_t crc16(const uint8_t *p, uint8_t n)
+{
+  uint16_t crc = 0xFFFF;
+  uint8_t i;
+
+   while (n--)
+      {
+        crc ^= (uint16_t)*p++ << 8;
+        for (i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      };
+   return crc;
+}
+
+// decimal degrees of 'loc' to millionths of degree, digits after the 6th decimal place are cut
+int32_t degrees_e6(const char *s)
+{
+  uint32_t v = 0;
+  uint8_t neg = (*s == '-'), places = 7;       // decimal places still taken, 7 before the dot
+
+   for (s += neg; *s && places; s++)
+      {
+        if (*s == '.') places = 6;
+        else if (*s >= '0' && *s <= '9')
+           { v = v * 10 + (*s - '0');
+             if (places < 7) places--;
+           };
+      };
+   if (places == 7) places = 6;
+   while (places--) v *= 10;
+   return neg ? -(int32_t)v : (int32_t)v;
+}
+
+#endif
+
+#if FEATURE_UDP || FEATURE_CLOCK
+const uint16_t MONTHDAYS[] PROGMEM = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+// 'y' years after 2000, month 'm', day 'd' and 'secs' of that day UTC to seconds since
+// 2000/01/01,00:00:00, 0 when it is no date
+uint32_t date_secs(uint16_t y, uint8_t m, uint8_t d, uint32_t secs)
+{
+  uint16_t days;
+
+   if (y > 135 || m < 1 || m > 12) return 0;
+   days = y * 365 + (y + 3) / 4 + pgm_read_word(&MONTHDAYS[m - 1]) + d - 1;
+   if (m > 2 && y % 4 == 0) days++;
+   return days * 86400UL + secs;
+}
+
+// 'datetime' 2020/01/01,12:00:00 UTC to seconds since 2000/01/01,00:00:00, 0 when it is no date
+uint32_t datetime_secs(const char *s)
+{
+   if (strlen(s) < 19 || s[4] != '/') return 0;
+   return date_secs(atoi(s) - 2000, atoi(s + 5), atoi(s + 8),
+                    atoi(s + 11) * 3600UL + atoi(s + 14) * 60 + atoi(s + 17));
+}
+#endif
+
+#if FEATURE_CLOCK
+// -------------------------------------------------------------------------------
+// software clock : network time of the last sync plus uptime() since then, which counts 8 s
+// watchdog ticks up to 10 % off - clock_rate measured between syncs corrects them
+// -------------------------------------------------------------------------------
+
+// seconds since 2000/01/01,00:00:00 UTC, 0 before the first sync
+uint32_t clock_now(void)
+{
+  uint32_t e;
+
+   if (clock_time == 0) return 0;
+   e = uptime() - clock_up;
+   return clock_time + (e >> 15) * clock_rate + (((e & 0x7FFF) * clock_rate) >> 15);
+}
+
+// network time 't' : the clock starts again from it, the rate is measured when CLOCK_SPAN
+// seconds of uptime() passed since the reference sync - a jump of the network time or a
+// rate more than 25 % off only moves the reference
+void clock_sync(uint32_t t)
+{
+  uint32_t up = uptime(), real = t - clock_reftime, counted = up - clock_refup;
+
+   if (clock_reftime == 0 || t < clock_reftime || counted >= CLOCK_SPAN)
+      {
+        if (clock_reftime != 0 && t >= clock_reftime && real < counted + counted / 4 && real > counted - counted / 4)
+           { while (real >= 0x20000UL)         // real << 15 fits 32 bits
+                { real >>= 1;
+                  counted >>= 1;
+                };
+             clock_rate = (real << 15) / counted;
+           };
+        clock_reftime = t;
+        clock_refup = up;
+      };
+   clock_time = t;
+   clock_up = up;
+   clock_syncs++;
+}
+
+// network time in 'response' - +CCLK: "yy/MM/dd,hh:mm:ss+zz" local time and quarter hours of
+// its zone or *PSUTTZ: yyyy,M,d,h,m,s,"+zz",dst UTC - syncs the clock, 0 when it is no time
+uint8_t clockread(void)
+{
+  char *p = strchr((char *)arena.response, ':');
+  int16_t v[7];
+  uint8_t i;
+  uint32_t t;
+
+   if (p == NULL) return 0;
+   for (i = 0; i < 7; i++)
+      {
+        while (*p && (*p < '0' || *p > '9') && *p != '+' && *p != '-') p++;
+        if (*p == 0) return 0;
+        v[i] = atoi(p);
+        if (*p == '+' || *p == '-') p++;
+        while (*p >= '0' && *p <= '9') p++;
+      };
+   if (v[0] < 100) v[0] += 2000;               // AT+CCLK? year of 2 digits
+   if (v[0] < CLOCK_YEAR) return 0;
+   t = date_secs(v[0] - 2000, v[1], v[2], v[3] * 3600UL + v[4] * 60 + v[5]);
+   if (t == 0) return 0;
+   if (response_has_P(ISCCLK)) t -= v[6] * 900L;
+   clock_sync(t);
+   return 1;
+}
+
+// 1 when the last sync is less than CLOCK_SYNC minutes of uptime() old, AT+CCLK? is not asked
+uint8_t clock_fresh(void)
+{
+   return clock_time != 0 && uptime() - clock_up < CLOCK_SYNC * 60UL;
+}
+#endif
+
+#if FEATURE_UDP
+// position of 'loc' into 'udp_pkt' with the next sequence number, before the scripts of the
+// report overwrite 'loc' by their answers - the cell is added by UDPCELL
+void udppack(void)
+{
+  uint32_t t = datetime_secs((char *)arena.loc.datetime);
+
+#if FEATURE_CLOCK
+   if (t == 0) t = clock_now();                // cell database has no date of 4 digits
+#endif
+   memset(udp_pkt, 0, UDP_SIZE);
+   udp_pkt[0] = 0x01;                          // report v1
+   udp_pkt[1] = (UDP_ACK ? 1 : 0) | (locstale ? 2 : 0);
+   put32(udp_pkt + 2, UDP_DEVICE);
+   put16(udp_pkt + 6, ++udp_seq);
+   put32(udp_pkt + 8, degrees_e6((char *)arena.loc.latitude));
+   put32(udp_pkt + 12, degrees_e6((char *)arena.loc.longtitude));
+   put32(udp_pkt + 16, t);
+   put16(udp_pkt + 20, locacc);
+   put16(udp_pkt + 22, atoi((char *)arena.loc.battery));
+   locstale = 0;
+}
+
+// serving cell of the AT+CENG line in 'response' into the report
+uint8_t udpcell(void)
+{
+  cell_t c;
+
+   if (!parsecell(&c)) return 0;
+   put16(udp_pkt + 24, c.mcc);
+   put16(udp_pkt + 26, c.mnc);
+   put16(udp_pkt + 28, c.lac);
+   put16(udp_pkt + 30, c.ci);
+   return 1;
+}
+
+// report datagram with its CRC, the retransmit flag is set for the next one - 1 when it went to SIM800L
+uint8_t udpsend(void)
+{
+  uint8_t i;
+
+   put16(udp_pkt + UDP_SIZE - 2, crc16(udp_pkt, UDP_SIZE - 2));
+   if (!cipsend(UDP_SIZE)) return 0;
+   for (i = 0; i < UDP_SIZE; i++) send_uart(udp_pkt[i]);
+   udp_pkt[1] |= 4;
+   stats.udpsent++;
+   return 1;
+}
+
+// ack of the receiver : type 0x81, device and sequence number of the report, good CRC
+uint8_t udpack(void)
+{
+#if UDP_ACK
+  uint8_t a[UDP_ACKSIZE];
+
+   return ipdanswer(a, UDP_ACKSIZE, UDP_WAIT) == UDP_ACKSIZE && a[0] == 0x81
+          && memcmp(a + 2, udp_pkt + 2, 6) == 0
+          && (((uint16_t)a[8] << 8) | a[9]) == crc16(a, UDP_ACKSIZE - 2);
+#else
+   return 1;
+#endif
+}
+#endif
+
+// radio off for BACKOFF minutes when there is no 2G coverage - maybe in underground garage or something...
+uint8_t backoffwait(void)
+{
+  uint8_t i;
+   for (i = 0; i < cfg.backoff; i++)  delay_sec(60);
+   return 0;
+}
+#endif
+
+
+// -------------------------------------------------------------------------------
+// check if PROGMEM string is in the line read to 'response', used by AT_MATCH
+// -------------------------------------------------------------------------------
+uint8_t response_has_P(const char *s)
+{
+   return is_in_rx_buffer(arena.response, s);
+}
+
+
+#ifdef SLEEP_POLLED
+// -------------------------------------------------------------------------------
+// RI/RING pin of SIM800L is held LOW by SIM800L until call is answered / disconnected
+// -------------------------------------------------------------------------------
+uint8_t ringing(void)
+{
+  if (PIND & (1 << PD2))
+     {
+#if FEATURE_RXRING
+       // forget answers to the last commands so RING is the first line read
+       rx_flush();
+#endif
+       return 0;
+     };
+  return 1;
+}
+
+#else
+// -------------------------------------------------------------------------------
+// POWER SAVING mode handling to reduce the battery consumption
+// Required connection between SIM800L RI/RING pin and MCU INT0/PD2 pin
+// -------------------------------------------------------------------------------
+uint8_t sleepnow(void)
+{
+
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+#if FEATURE_RXRING
+    // RING will be the first line read after wakeup
+    rx_flush();
+#endif
+
+#if FEATURE_STATS
+    ring_wakeup = 0;
+
+    do {
+#endif
+    // stop interrupts for configuration period
+    cli();
+
+    // update again INT0 conditions
+    INT0_CONTROL &= ~((1 << ISC01) | (1 << ISC00));    // set INT0 to trigger on low level
+    INT0_MASK |= (1 << INT0);                          // Turns on INT0 (set bit)
+
+#if FEATURE_STATS
+    // watchdog in interrupt mode wakes up every 8 seconds only to count time spent in POWERDOWN
+    wdt_reset();
+    WDTCSR = (1 << WDCE) | (1 << WDE);
+    WDTCSR = (1 << WDIE) | (1 << WDP3) | (1 << WDP0);
+#endif
+
+    sleep_enable();
+
+    sei();                         //ensure interrupts enabled so we can wake up again
+
+    sleep_cpu();                   //go to sleep
+
+    // MCU sleeps here until INT0 or WDT interrupt
+
+    sleep_disable();               //wake up here
+
+#if FEATURE_STATS
+    } while (ring_wakeup == 0 && !track_due() && !gnss_due());    // watchdog wakeup - go back to sleep
+
+    wdt_disable();
+#endif
+
+    return 0;
+}
+
+// when interrupt from INT0 disable next interrupts from RING pin of SIM800L and go back to main code
+ISR(INT0_vect)
+{
+
+   INT0_MASK &= ~(1 << INT0);     // Turns off INT0 (clear bit)
+#if FEATURE_STATS
+   ring_wakeup = 1;
+#endif
+}
+
+#if FEATURE_STATS
+// watchdog interrupt every 8 seconds of POWERDOWN, accuracy of WDT oscillator is about 10%
+ISR(WDT_vect)
+{
+   stats.seconds[STATE_SLEEP] += 8;
+   track_seconds += 8;
+}
+#endif
+#endif
+
+
+#if FEATURE_STATS
+//////////////////////////////////////////
+// SIM800L dialogue scripts, see atscript.h
+//////////////////////////////////////////
+
+// wait for first OK while sending AT - autosensing speed on SIM800L, but we are working 9600 bps
+// SIM 800L can be set by AT+IPR=9600  to fix this speed
+// which I do recommend by connecting SIM800L to PC using putty and FTD232 cable
+const atstep_t CHECKAT[] PROGMEM = {
+  /* 0 */ AT_SEND(AT, 0),
+  /* 1 */ AT_READ(2),
+  /* 2 */ AT_WAIT(1),
+  /* 3 */ AT_MATCH(ISOK, 5),
+  /* 4 */ AT_GOTO(0),
+  /* 5 */ AT_SEND(ECHO_OFF, 1),
+  /* 6 */ AT_RETURN(1)
+};
+
+// wait for PIN CODE STATUS, send PIN to SIM card if required
+const atstep_t CHECKPIN[] PROGMEM = {
+  /* 0 */ AT_WAIT(2),
+  /* 1 */ AT_SEND(SHOW_PIN, 0),
+  /* 2 */ AT_READ(5),
+  /* 3 */ AT_MATCH(PIN_IS_READY, 9),
+  /* 4 */ AT_MATCH(PIN_MUST_BE_ENTERED, 6),
+  /* 5 */ AT_GOTO(0),
+  /* 6 */ AT_WAIT(1),
+  /* 7 */ AT_SEND(ENTER_PIN, 1),
+  /* 8 */ AT_GOTO(0),
+  /* 9 */ AT_RETURN(1)
+};
+
+// check if registered to the network, first 2 networks preferred from SIM list are OK
+// if not give 2 minutes to look for 2G coverage, then backoff, stop after 24 hours of searching
+const atstep_t CHECKREG[] PROGMEM = {
+  /* 0 */ AT_WAIT(1),
+  /* 1 */ AT_SEND(SHOW_REGISTRATION, 0),
+  /* 2 */ AT_READ(5),
+  /* 3 */ AT_MATCH(ISREG1, 22),
+  /* 4 */ AT_MATCH(ISREG2, 22),
+  /* 5 */ AT_WAIT(1),
+  /* 6 */ AT_SEND(FLIGHTOFF, 120),           // DISABLE airplane mode - just in case...
+  /* 7 */ AT_SEND(SHOW_REGISTRATION, 0),
+  /* 8 */ AT_READ(5),
+  /* 9 */ AT_MATCH(ISREG1, 22),
+  /* 10 */ AT_MATCH(ISREG2, 22),
+  /* 11 */ AT_WAIT(1),
+  /* 12 */ AT_SEND(FLIGHTON, 0),             // enable airplane mode - turn off radio
+  /* 13 */ AT_CALL(enter_nocov, AT_NEXT),
+  /* 14 */ AT_WAIT(1),
+  /* 15 */ AT_SEND(SLEEPON, 0),              // SLEEP MODE of SIM800L when no coverage
+  /* 16 */ AT_CALL(backoffwait, AT_NEXT),   // BACKOFF minutes, 30 unless changed by SMS
+  /* 17 */ AT_SEND(AT, 1),                   // first dummy AT command
+  /* 18 */ AT_SEND(SLEEPOFF, 0),
+  /* 19 */ AT_CALL(leave_nocov, AT_NEXT),
+  /* 20 */ AT_WAIT(1),
+  /* 21 */ AT_RETRY(48, 5),
+  /* 22 */ AT_RETURN(1)
+};
+
+
+// provision GPRS APNs and passwords - we are not checking if any error not to get deadlocks
+const atstep_t PROVISION[] PROGMEM = {
+  /* 0 */ AT_WAIT(1),
+  /* 1 */ AT_SEND(SAPBR1, 1),
+  /* 2 */ AT_SEND(SAPBR2, 1),
+  /* 3 */ AT_SEND(SAPBR3, 1),                // only if username password in APN is needed
+  /* 4 */ AT_SEND(SAPBR4, 1),
+  /* 5 */ AT_RETURN(1)
+};
+
+// SIM800L startup, fixed UART speed, RI pin for URC, no registration URC, settings saved -
+// the steps after 13 depend on the features, no label points at them
+const atstep_t BOOT[] PROGMEM = {
+  /* 0 */ AT_WAIT(10),                       // safe SIM800L startup and network registration
+  /* 1 */ AT_RUN(CHECKAT, AT_NEXT),
+  /* 2 */ AT_WAIT(2),
+  /* 3 */ AT_SEND(SET9600, 1),
+  /* 4 */ AT_SEND(CFGRIPIN, 1),
+  /* 5 */ AT_SEND(DISREGURC, 1),
+  /* 6 */ AT_SEND(SAVECNF, 3),
+  /* 7 */ AT_RUN(CHECKPIN, AT_NEXT),
+  /* 8 */ AT_WAIT(2),
+  /* 9 */ AT_SEND(FLIGHTOFF, 120),
+  /* 10 */ AT_RUN(CHECKREG, AT_NEXT),
+  /* 11 */ AT_RUN(PROVISION, AT_NEXT),
+  /* 12 */ AT_SEND(SMS1, 1),
+  /* 13 */ AT_SEND(DELSMS, 2),               // SMS commands from before power on are stale
+#if FEATURE_CELLDB || FEATURE_GEOSERVER || FEATURE_UDP
+          AT_SEND(CENGON, 1),               // engineering mode stays on, cells for CELLFIX, LOCATE and UDP reports
+#endif
+#if FEATURE_CLOCK
+          AT_SEND(CLTSON, 1),               // network time (NITZ) at every registration from now on
+#endif
+          AT_RETURN(1)
+};
+
+#if FEATURE_CLOCK
+// SIM800L clock to the software clock when it has the network time, returns 1 when it had
+const atstep_t CLOCKSYNC[] PROGMEM = {
+  /* 0 */ AT_SEND(CHECKCLOCK, 0),
+  /* 1 */ AT_READ(2),
+  /* 2 */ AT_MATCH(ISCCLK, 4),
+  /* 3 */ AT_RETURN(0),
+  /* 4 */ AT_CALL(clockread, 6),
+  /* 5 */ AT_RETURN(0),
+  /* 6 */ AT_RETURN(1)
+};
+#endif
+
+// delete SMSes already read but not SMS commands that came in meanwhile,
+// CLIP for caller number, LED off, clock sync when due, SIM800L sleep
+const atstep_t PRESLEEP[] PROGMEM = {
+  /* 0 */ AT_SEND(SMS1, 1),
+  /* 1 */ AT_SEND(DELREAD, 2),
+  /* 2 */ AT_SEND(CLIP, 1),
+  /* 3 */ AT_SEND(DISABLELED, 1),
+#if FEATURE_CLOCK
+  /* 4 */ AT_CALL(clock_fresh, 6),
+  /* 5 */ AT_RUN(CLOCKSYNC, AT_NEXT),
+  /* 6 */ AT_SEND(SLEEPON, 2),
+  /* 7 */ AT_RETURN(0)
+#else
+  /* 4 */ AT_SEND(SLEEPON, 2),
+  /* 5 */ AT_RETURN(0)
+#endif
+};
+
+// disable SLEEPMODE of SIM800L
+const atstep_t WAKEUP[] PROGMEM = {
+  /* 0 */ AT_SEND(AT, 1),
+  /* 1 */ AT_SEND(SLEEPOFF, 1),
+  /* 2 */ AT_RETURN(0)
+};
+
+// RING - disable SLEEPMODE, hangup a call and proceed with sending SMS
+const atstep_t ANSWER[] PROGMEM = {
+  /* 0 */ AT_RUN(WAKEUP, AT_NEXT),
+  /* 1 */ AT_SEND(HANGUP, 1),
+#if FEATURE_MQTT
+  /* 2 */ AT_CALL(livecall, AT_NEXT),
+  /* 3 */ AT_RETURN(0)
+#else
+  /* 2 */ AT_RETURN(0)
+#endif
+};
+
+#if FEATURE_PREEMPT
+// call pre-empted other work, RING and +CLIP come again every few seconds until answered
+const atstep_t RINGIN[] PROGMEM = {
+  /* 0 */ AT_READ(5),
+  /* 1 */ AT_MATCH(ISRING, 4),
+  /* 2 */ AT_RETRY(4, 0),                  // skip answers to the commands that were cut short
+  /* 3 */ AT_RETURN(0),
+  /* 4 */ AT_CALL(readphonenumber, AT_NEXT),
+  /* 5 */ AT_RETURN(1)
+};
+#endif
+
+// GPRS network attach and IP bearer, 3 attempts, returns 1 when bearer is open
+const atstep_t ATTACH[] PROGMEM = {
+  /* 0 */ AT_GOTO(2),
+  /* 1 */ AT_CALL(count_sapbrretry, AT_NEXT),
+  /* 2 */ AT_WAIT(1),
+  /* 3 */ AT_SEND(SAPBRCLOSE, 1),            // close the bearer first maybe there was an error or something
+  /* 4 */ AT_RUN(PROVISION, AT_NEXT),
+  /* 5 */ AT_WAIT(1),
+  /* 6 */ AT_SEND(SAPBROPEN, 10),
+  /* 7 */ AT_SEND(SAPBRQUERY, 0),            // query PDP context for IP address after several seconds
+  /* 8 */ AT_READ(10),
+  /* 9 */ AT_MATCH(SAPBRSUCC, 12),
+  /* 10 */ AT_RETRY(3, 1),
+  /* 11 */ AT_RETURN(0),
+  /* 12 */ AT_RETURN(1)
+};
+
+#if FEATURE_GEOSERVER
+// battery voltage and position of the cells around from the geoserver over the open bearer,
+// HTTP body is like +CIPGSMLOC: answer so readcellgps() parses it, returns 0 when no position
+const atstep_t LOCATE[] PROGMEM = {
+  /* 0 */ AT_WAIT(1),
+  /* 1 */ AT_SEND(CENGQUERY, 0),
+  /* 2 */ AT_CALL(readcells, 4),
+  /* 3 */ AT_RETURN(0),                      // no cell to ask for
+  /* 4 */ AT_SEND(HTTPINIT, 1),
+  /* 5 */ AT_SEND(HTTPCID, 1),
+  /* 6 */ AT_SEND(HTTPURL, 0),
+  /* 7 */ AT_CALL(putcells, AT_NEXT),
+  /* 8 */ AT_SEND(CRLF, 1),                  // closing quotation of the URL
+  /* 9 */ AT_SEND(HTTPGET, 0),
+  /* 10 */ AT_READ(30),                      // OK, then +HTTPACTION: 0,<status>,<length>
+  /* 11 */ AT_MATCH(ISHTTP200, 15),
+  /* 12 */ AT_MATCH(ISHTTPACTION, 27),
+  /* 13 */ AT_RETRY(4, 10),
+  /* 14 */ AT_GOTO(27),
+  /* 15 */ AT_SEND(CHECKBATT, 0),
+  /* 16 */ AT_CALL(readbattery, AT_NEXT),
+  /* 17 */ AT_WAIT(1),
+  /* 18 */ AT_SEND(HTTPREAD, 0),
+  /* 19 */ AT_READ(5),                       // +HTTPREAD: <length>, body line follows
+  /* 20 */ AT_MATCH(ISHTTPREAD, 23),
+  /* 21 */ AT_SEND(HTTPTERM, 1),
+  /* 22 */ AT_RETURN(0),
+  /* 23 */ AT_CALL(readcellgps, 25),
+  /* 24 */ AT_GOTO(21),
+  /* 25 */ AT_SEND(HTTPTERM, 1),
+  /* 26 */ AT_RETURN(1),
+  /* 27 */ AT_CALL(httpstatus, AT_NEXT),     // to 'loccode' like CIPGSMLOC codes
+  /* 28 */ AT_GOTO(21)
+};
+#else
+// battery voltage and GPS position of nearest GSM CELL via Google API, returns 0 when no position
+// AT+CLBS=4 gives accuracy radius too, older firmware answers it ERROR and CIPGSMLOC is used
+// network errors and timeouts are repeated at once LOC_RETRIES times, other errors are not
+const atstep_t LOCATE[] PROGMEM = {
+  /* 0 */ AT_WAIT(1),
+  /* 1 */ AT_SEND(CHECKBATT, 0),
+  /* 2 */ AT_CALL(readbattery, AT_NEXT),
+  /* 3 */ AT_WAIT(1),
+  /* 4 */ AT_CALL(cipgsmloc, 8),
+  /* 5 */ AT_SEND(CHECKLBS, 0),
+  /* 6 */ AT_CALL(readclbs, 15),
+  /* 7 */ AT_GOTO(10),
+  /* 8 */ AT_SEND(CHECKGPS, 0),
+  /* 9 */ AT_CALL(readcellgps, 15),
+  /* 10 */ AT_CALL(clbsmissing, 3),
+  /* 11 */ AT_CALL(locerror, 13),
+  /* 12 */ AT_RETURN(0),
+  /* 13 */ AT_RETRY(LOC_RETRIES + 1, 3),
+  /* 14 */ AT_RETURN(0),
+  /* 15 */ AT_RETURN(1)
+};
+#endif
+
+// start SMS in plain text format to 'phonenumber', interactive mode CTRL Z at the end
+const atstep_t SMSTO[] PROGMEM = {
+  /* 0 */ AT_SEND(SMS1, 1),
+  /* 1 */ AT_SEND(SMS2, 0),
+  /* 2 */ AT_PUTS(phonenumber, 0),
+  /* 3 */ AT_SEND(CRLF, 1),
+  /* 4 */ AT_RETURN(0)
+};
+
+// SMS with DATE, TIME, LONG, LATITUDE, battery voltage and link to GOOGLE MAPS
+const atstep_t LOCATIONSMS[] PROGMEM = {
+  /* 0 */ AT_RUN(SMSTO, AT_NEXT),
+  /* 1 */ AT_CALL(putstale, AT_NEXT),        // age of the last known position when the query failed
+  /* 2 */ AT_PUTS(arena.loc.datetime, 0),              // Date & Time info from AGPS cell info
+  /* 3 */ AT_SEND(LONG, 0),
+  /* 4 */ AT_PUTS(arena.loc.longtitude, 0),
+  /* 5 */ AT_SEND(LATT, 0),
+  /* 6 */ AT_PUTS(arena.loc.latitude, 0),
+  /* 7 */ AT_CALL(putacc, AT_NEXT),          // accuracy radius when known
+  /* 8 */ AT_SEND(BATT, 0),
+  /* 9 */ AT_PUTS(arena.loc.battery, 0),
+  /* 10 */ AT_SEND(GOOGLELOC1, 0),
+  /* 11 */ AT_PUTS(arena.loc.latitude, 0),
+  /* 12 */ AT_SEND(GOOGLELOC2, 0),
+  /* 13 */ AT_PUTS(arena.loc.longtitude, 0),
+  /* 14 */ AT_SEND(GOOGLELOC3, 1),
+#if FEATURE_GNSS
+  /* 15 */ AT_CALL(putgnss, AT_NEXT),        // speed, HDOP and satellites of GNSS fix
+  /* 16 */ AT_SEND(CTRLZ, 0),
+  /* 17 */ AT_RETURN(0)
+#else
+  /* 15 */ AT_SEND(CTRLZ, 0),                // end the SMS message
+  /* 16 */ AT_RETURN(0)
+#endif
+};
+
+#if FEATURE_CELLDB
+// serving cell from engineering mode looked up in the cell database, then battery voltage
+// and SIM800L clock for the location SMS, returns 0 at once when the cell is not in the database
+const atstep_t CELLFIX[] PROGMEM = {
+  /* 0 */ AT_SEND(CENGQUERY, 0),
+  /* 1 */ AT_READ(5),
+  /* 2 */ AT_MATCH(ISCENG, 6),
+  /* 3 */ AT_MATCH(ISOK, 5),                 // no serving cell line
+  /* 4 */ AT_RETRY(4, 1),                    // skip +CENG: 1,0 mode line
+  /* 5 */ AT_RETURN(0),
+  /* 6 */ AT_CALL(cellfix, 8),
+  /* 7 */ AT_RETURN(0),
+  /* 8 */ AT_WAIT(1),                        // neighbour cell lines and OK
+  /* 9 */ AT_SEND(CHECKBATT, 0),
+  /* 10 */ AT_CALL(readbattery, AT_NEXT),
+  /* 11 */ AT_SEND(CHECKCLOCK, 0),
+  /* 12 */ AT_CALL(readclock, AT_NEXT),
+  /* 13 */ AT_RETURN(1)
+};
+#endif
+
+#if FEATURE_GNSS
+// on-window of SIM808 GNSS receiver : AT+CGNSINF every second until a fix with HDOP up to
+// GNSS_HDOP or the end of the window sized by gnssstart(), then the receiver is off at once
+// returns 1 with a fix, 0 without it and at once on SIM800L
+const atstep_t GNSSWINDOW[] PROGMEM = {
+  /* 0 */ AT_SEND(GNSSON, 0),
+  /* 1 */ AT_READ(2),
+  /* 2 */ AT_MATCH(ISOK, 4),
+  /* 3 */ AT_RETURN(0),                      // ERROR - module has no GNSS receiver
+  /* 4 */ AT_CALL(gnssstart, AT_NEXT),
+  /* 5 */ AT_WAIT(1),
+  /* 6 */ AT_SEND(GNSSINF, 0),
+  /* 7 */ AT_CALL(readgnss, 9),
+  /* 8 */ AT_CALL(gnsswindow, 5),
+  /* 9 */ AT_SEND(GNSSOFF, 1),
+  /* 10 */ AT_CALL(gnssstop, 12),
+  /* 11 */ AT_RETURN(0),
+  /* 12 */ AT_RETURN(1)
+};
+
+// GNSS fix and battery voltage for the location SMS, returns 0 when the window had no fix
+const atstep_t GNSSFIX[] PROGMEM = {
+  /* 0 */ AT_RUN(GNSSWINDOW, 2),
+  /* 1 */ AT_RETURN(0),
+  /* 2 */ AT_CALL(gnssloc, AT_NEXT),
+  /* 3 */ AT_SEND(CHECKBATT, 0),
+  /* 4 */ AT_CALL(readbattery, AT_NEXT),
+  /* 5 */ AT_RETURN(1)
+};
+#endif
+
+#if FEATURE_CELLDB || FEATURE_GNSS
+// location sources tried in order before GPRS, each script fills 'loc' for LOCATIONSMS and
+// returns 1, or 0 to go on with the next one - CIPGSMLOC (or geoserver) over GPRS is the last
+const atstep_t * const LOCSOURCE[] PROGMEM = {
+#if FEATURE_GNSS
+  GNSSFIX,
+#endif
+#if FEATURE_CELLDB
+  CELLFIX,
+#endif
+};
+#endif
+
+// close the bearer when location was sent
+const atstep_t DETACH[] PROGMEM = {
+  /* 0 */ AT_WAIT(5),
+  /* 1 */ AT_SEND(SAPBRCLOSE, 0),
+  /* 2 */ AT_RETURN(0)
+};
+
+#if FEATURE_OTA
+// firmware update from OTAURL over the open bearer to the staging area, returns 1 when the
+// bootloader may write it
+const atstep_t OTAGET[] PROGMEM = {
+  /* 0 */ AT_SEND(HTTPINIT, 1),
+  /* 1 */ AT_SEND(HTTPCID, 1),
+  /* 2 */ AT_SEND(OTAURL, 1),
+  /* 3 */ AT_SEND(HTTPGET, 0),
+  /* 4 */ AT_READ(30),                       // OK, then +HTTPACTION: 0,<status>,<length>
+  /* 5 */ AT_MATCH(ISHTTP200, 9),
+  /* 6 */ AT_MATCH(ISHTTPACTION, 10),
+  /* 7 */ AT_RETRY(4, 4),
+  /* 8 */ AT_GOTO(10),
+  /* 9 */ AT_CALL(otaload, 12),
+  /* 10 */ AT_SEND(HTTPTERM, 1),
+  /* 11 */ AT_RETURN(0),
+  /* 12 */ AT_SEND(HTTPTERM, 1),
+  /* 13 */ AT_RETURN(1)
+};
+#endif
+
+#if FEATURE_MQTT || FEATURE_UDP
+// IP stack of SIM800L in its own GPRS context next to the SAPBR bearer, ready for AT+CIPSTART -
+// returns 1 when the context is up
+const atstep_t IPOPEN[] PROGMEM = {
+  /* 0 */ AT_SEND(CIPSHUT, 2),               // IP stack of an earlier connection closed
+  /* 1 */ AT_SEND(CSTT, 1),
+  /* 2 */ AT_SEND(CIICR, 0),
+  /* 3 */ AT_READ(30),
+  /* 4 */ AT_MATCH(ISOK, 6),
+  /* 5 */ AT_RETURN(0),
+  /* 6 */ AT_SEND(CIFSR, 1),                 // local IP address, CIPSTART needs it asked
+  /* 7 */ AT_SEND(CIPHEAD, 1),               // +IPD,<length>: in front of data from the peer
+  /* 8 */ AT_RETURN(1)
+};
+#endif
+
+#if FEATURE_MQTT
+// TCP connection to the MQTT broker (MQTTOPEN in strings/<target>.txt), then MQTT CONNECT -
+// returns 1 when the broker accepted it by CONNACK
+const atstep_t LIVEOPEN[] PROGMEM = {
+  /* 0 */ AT_RUN(IPOPEN, 2),
+  /* 1 */ AT_RETURN(0),
+  /* 2 */ AT_SEND(MQTTOPEN, 0),
+  /* 3 */ AT_READ(30),                       // OK, then CONNECT OK or CONNECT FAIL
+  /* 4 */ AT_MATCH(ISCONNECTOK, 7),
+  /* 5 */ AT_RETRY(2, 3),
+  /* 6 */ AT_RETURN(0),
+  /* 7 */ AT_CALL(mqttconnect, 9),
+  /* 8 */ AT_RETURN(0),
+  /* 9 */ AT_CALL(mqttconnack, 11),
+  /* 10 */ AT_RETURN(0),
+  /* 11 */ AT_RETURN(1)
+};
+
+// position in 'loc' to the broker, returns 1 when SIM800L sent it
+const atstep_t LIVEPUB[] PROGMEM = {
+  /* 0 */ AT_CALL(mqttpublish, 2),
+  /* 1 */ AT_RETURN(0),                      // no prompt - the connection is closed
+  /* 2 */ AT_READ(IP_WAIT),
+  /* 3 */ AT_MATCH(ISSENDOK, 6),
+  /* 4 */ AT_RETRY(2, 2),
+  /* 5 */ AT_RETURN(0),
+  /* 6 */ AT_RETURN(1)
+};
+
+// PINGREQ, returns 1 when PINGRESP came
+const atstep_t LIVEPING[] PROGMEM = {
+  /* 0 */ AT_CALL(mqttping, 2),
+  /* 1 */ AT_RETURN(0),
+  /* 2 */ AT_CALL(mqttpingresp, 4),
+  /* 3 */ AT_RETURN(0),
+  /* 4 */ AT_RETURN(1)
+};
+
+// MQTT DISCONNECT and the TCP connection closed, DETACH closes the bearer
+const atstep_t LIVECLOSE[] PROGMEM = {
+  /* 0 */ AT_CALL(mqttdisconnect, AT_NEXT),
+  /* 1 */ AT_WAIT(1),                        // SEND OK
+  /* 2 */ AT_SEND(CIPSHUT, 2),
+  /* 3 */ AT_RETURN(0)
+};
+#endif
+
+#if FEATURE_UDP
+// serving cell of AT+CENG into the report, it stays 0 when there is none
+const atstep_t UDPCELL[] PROGMEM = {
+  /* 0 */ AT_SEND(CENGQUERY, 0),
+  /* 1 */ AT_READ(5),
+  /* 2 */ AT_MATCH(ISCENG, 6),
+  /* 3 */ AT_MATCH(ISOK, 7),                 // no serving cell line
+  /* 4 */ AT_RETRY(4, 1),                    // skip +CENG: 1,0 mode line
+  /* 5 */ AT_RETURN(0),
+  /* 6 */ AT_CALL(udpcell, AT_NEXT),
+  /* 7 */ AT_WAIT(1),                        // neighbour cell lines and OK
+  /* 8 */ AT_RETURN(0)
+};
+
+// report in 'udp_pkt' to the receiver (UDPOPEN in strings/<target>.txt), the same datagram again
+// when its ack does not come in UDP_WAIT - returns 1 when it was acknowledged
+const atstep_t UDPREPORT[] PROGMEM = {
+  /* 0 */ AT_RUN(UDPCELL, AT_NEXT),
+  /* 1 */ AT_RUN(IPOPEN, 3),
+  /* 2 */ AT_RETURN(0),
+  /* 3 */ AT_SEND(UDPOPEN, 0),
+  /* 4 */ AT_READ(30),                       // OK, then CONNECT OK
+  /* 5 */ AT_MATCH(ISCONNECTOK, 8),
+  /* 6 */ AT_MATCH(ISOK, 4),
+  /* 7 */ AT_GOTO(13),                       // CONNECT FAIL or no answer
+  /* 8 */ AT_CALL(udpsend, 10),
+  /* 9 */ AT_GOTO(12),                       // no prompt
+  /* 10 */ AT_READ(IP_WAIT),                 // SEND OK, the ack comes after it
+  /* 11 */ AT_CALL(udpack, 15),
+  /* 12 */ AT_RETRY(UDP_TRIES, 8),
+  /* 13 */ AT_SEND(CIPSHUT, 2),
+  /* 14 */ AT_RETURN(0),
+  /* 15 */ AT_SEND(CIPSHUT, 2),
+  /* 16 */ AT_RETURN(1)
+};
+#endif
+
+#ifdef SLEEP_POLLED
+// periodic 2G coverage check while waiting for RING, SIM800L goes back to SLEEP MODE
+const atstep_t COVERAGE[] PROGMEM = {
+  /* 0 */ AT_SEND(AT, 1),
+  /* 1 */ AT_SEND(SLEEPOFF, 0),
+  /* 2 */ AT_RUN(CHECKREG, AT_NEXT),
+  /* 3 */ AT_WAIT(1),
+  /* 4 */ AT_SEND(SLEEPON, 2),
+  /* 5 */ AT_RETURN(0)
+};
+#endif
+
+#else   // !FEATURE_STATS
+
+// -------------------------------------------------------------------------------
+// without FEATURE_STATS (ATTINY2313) the dialogue with SIM800L is plain C like in the first
+// versions, the script interpreter and its step tables would not fit 2kB of flash next to it
+// -------------------------------------------------------------------------------
+
+// AT command or other PROGMEM string, then 'sec' seconds for SIM800L to answer or to do it
+void atsend(const char *s, uint8_t sec)
+{
+   uart_puts_P(s);
+   delay_sec(sec);
+}
+
+// line of SIM800L answer to 'response' when it begins within 'sec' seconds, 0 when nothing came
+uint8_t readanswer(uint8_t sec)
+{
+   return wait_rx(sec) ? readline() : 0;
+}
+
+// wait for first OK while sending AT - autosensing speed on SIM800L, but we are working 9600 bps
+// SIM 800L can be set by AT+IPR=9600  to fix this speed
+// which I do recommend by connecting SIM800L to PC using putty and FTD232 cable
+void checkat(void)
+{
+  uint8_t heard;
+   do {
+        uart_puts_P(AT);
+        heard = readanswer(2);
+        delay_sec(1);
+      } while (!heard || !response_has_P(ISOK));
+   atsend(ECHO_OFF, 1);
+}
+
+// wait for PIN CODE STATUS, send PIN to SIM card if required
+void checkpin(void)
+{
+   while (1)
+      {
+        delay_sec(2);
+        uart_puts_P(SHOW_PIN);
+        if (readanswer(5))
+           { if (response_has_P(PIN_IS_READY)) return;
+             if (response_has_P(PIN_MUST_BE_ENTERED))
+                { delay_sec(1);
+                  atsend(ENTER_PIN, 1);
+                };
+           };
+      };
+}
+
+// AT+CREG? answer - registered, first 2 networks preferred from SIM list are OK
+uint8_t registered(void)
+{
+   uart_puts_P(SHOW_REGISTRATION);
+   return readanswer(5) && (response_has_P(ISREG1) || response_has_P(ISREG2));
+}
+
+#ifdef SLEEP_POLLED
+// check if registered to the network after 1 minute of search, maybe on the move
+// if no network turn off RADIO for 30 minutes not to drain battery in underground garage
+void checkreg(void)
+{
+  uint8_t i;
+   while (1)
+      {
+        delay_sec(3);
+        atsend(FLIGHTOFF, 60);            // disable airplane mode - turn on radio
+        if (registered()) return;
+        atsend(FLIGHTON, 1);              // enable airplane mode - turn off radio
+        atsend(SLEEPON, 0);               // SLEEP MODE of SIM800L when no coverage
+        for (i = 0; i < 30; i++) delay_sec(60);
+        atsend(AT, 1);                    // wake up SIM800L and search for network again
+        atsend(SLEEPOFF, 1);
+      };
+}
+
+// wait for RI LOW, wake up SIM800L to see coverage status once per 30 minutes
+void waitring(void)
+{
+  uint8_t minute, sec;
+   while (1)
+      {
+        for (minute = 0; minute < 30; minute++)
+           for (sec = 0; sec < 60; sec++)
+              { if (ringing()) return;
+                delay_sec(1);
+              };
+        atsend(AT, 1);
+        atsend(SLEEPOFF, 0);
+        checkreg();
+        delay_sec(1);
+        atsend(SLEEPON, 2);
+      };
+}
+
+#else
+// check if registered to the network after 3 minutes of search
+void checkreg(void)
+{
+   do delay_sec(180);
+   while (!registered());
+}
+#endif
+
+// check pin status, registration status and provision APN settings - we are not checking if
+// any error not to get deadlocks, then CLIP for the phone number of a call and no open bearer
+void modemsetup(void)
+{
+   checkpin();
+   checkreg();
+   delay_sec(1);
+   atsend(SAPBR1, 1);
+   atsend(SAPBR2, 1);
+   atsend(SAPBR3, 1);                     // only if username password in APN is needed
+   atsend(SAPBR4, 1);
+   atsend(CLIP, 2);                       // phone number of incoming voice call, needed for SMS sending
+   atsend(SAPBRCLOSE, 2);                 // close the bearer just in case it was open
+}
+
+#endif   // FEATURE_STATS
+
+
+#if FEATURE_STATS
+// -------------------------------------------------------------------------------
+// send SMS with time spent in each state and event counters to 'phonenumber'
+// -------------------------------------------------------------------------------
+void sendstats(void)
+{
+  uint8_t i;
+   run_script(SMSTO);                   // to phone number of SMS sender
+   uart_puts_P(STATSHDR);
+   for (i = 0; i < NBR_STATES; i++)
+     {
+      uart_puts_P((const char *)pgm_read_ptr(&STATELABEL[i]));
+      uart_putnum(stats.seconds[i]);
+     };
+   uart_puts_P(RINGS);
+   uart_putnum(stats.rings);
+   uart_puts_P(LOCFAIL);
+   uart_putnum(stats.locfailures);
+   uart_puts_P(LOCERRS);              // network/timeout/reset/other
+   uart_putnum(stats.locnet);
+   send_uart('/');
+   uart_putnum(stats.loctimeout);
+   send_uart('/');
+   uart_putnum(stats.locreset);
+   send_uart('/');
+   uart_putnum(stats.locother);
+   uart_puts_P(SAPBRRETRY);
+   uart_putnum(stats.sapbrretries);
+#if FEATURE_STACKMON
+   uart_puts_P(STACKFREE);
+   uart_putnum(stack_free());
+#endif
+#if FEATURE_GNSS
+   uart_puts_P(GNSSSTATS);
+   uart_putnum(stats.gnssseconds);
+   uart_puts_P(GNSSFIXES);
+   uart_putnum(stats.gnssfixes);
+   send_uart('/');
+   uart_putnum(stats.gnsswindows);
+   uart_puts_P(TTFFTXT);
+   uart_putnum(gnss_lastttff);
+   send_uart('/');
+   uart_putnum(stats.gnssfixes ? stats.gnssttff / stats.gnssfixes : 0);
+   uart_puts_P(WINDOWTXT);
+   uart_putnum(gnss_window);
+#endif
+#if FEATURE_MQTT
+   uart_puts_P(LIVESTATS);
+   uart_putnum(stats.livesessions);
+   uart_puts_P(PUBTXT);
+   uart_putnum(stats.livepubs);
+   uart_puts_P(BYTESTXT);
+   uart_putnum(stats.livebytes);
+#endif
+#if FEATURE_UDP
+   uart_puts_P(UDPSTATS);
+   uart_putnum(stats.udpreports);
+   uart_puts_P(DGRAMTXT);
+   uart_putnum(stats.udpsent);
+   uart_puts_P(ACKTXT);
+   uart_putnum(stats.udpacked);
+#endif
+#if FEATURE_CLOCK
+   uart_puts_P(CLOCKSTATS);
+   uart_putnum(clock_now());
+   uart_puts_P(SYNCTXT);
+   uart_putnum(clock_syncs);
+   uart_puts_P(DRIFTTXT);           // of watchdog seconds, +30 ppm steps
+   if (clock_rate < CLOCK_ONE) send_uart('-');
+   uart_putnum((uint32_t)(clock_rate < CLOCK_ONE ? CLOCK_ONE - clock_rate : clock_rate - CLOCK_ONE) * 15625 / 512);
+#endif
+   delay_sec(1);
+   uart_puts_P(CTRLZ);
+   delay_sec(5);
+}
+
+// -------------------------------------------------------------------------------
+// 1 when GPRS and SMS may send : no VOLTAGE WARNNING came or AT+CBC is back within SUPPLY_MIN..
+// SUPPLY_MAX, checked every SUPPLY_WAIT seconds up to SUPPLY_TRIES times - a TX burst of 2 A on a
+// weak supply would power SIM800L down or reset the MCU
+// -------------------------------------------------------------------------------
+uint8_t supply_ok(void)
+{
+  uint8_t i;
+  uint16_t mv;
+   for (i = 0; supplywarn && i < SUPPLY_TRIES; i++)
+     {
+      if (i) delay_sec(SUPPLY_WAIT);
+      uart_puts_P(CHECKBATT);
+      readbattery();
+      mv = atoi((char *)arena.loc.battery);
+      if (mv >= SUPPLY_MIN && mv <= SUPPLY_MAX) supplywarn = 0;
+     };
+   return !supplywarn;
+}
+
+// -------------------------------------------------------------------------------
+// send SMS with settings of SMS commands and battery voltage to 'phonenumber'
+// -------------------------------------------------------------------------------
+void sendstatus(void)
+{
+   uart_puts_P(CHECKBATT);
+   readbattery();
+   delay_sec(1);
+   run_script(SMSTO);                   // to phone number of SMS sender
+   uart_puts_P(STATUSHDR);
+   uart_putnum(cfg.track);
+   uart_puts_P(INTERVALTXT);
+   uart_putnum(cfg.interval);
+   uart_puts_P(BACKOFFTXT);
+   uart_putnum(cfg.backoff);
+#if FEATURE_MQTT
+   uart_puts_P(LIVETXT);
+   uart_putnum(cfg.live);
+   send_uart('/');
+   uart_putnum(cfg.liveint);
+#endif
+#if FEATURE_OTA
+   uart_puts_P(FWTXT);
+   uart_putnum(FW_VERSION);
+   uart_puts_P(OTATXT);
+   uart_putnum(eeprom_read_byte(&OTA_EEPROM->result));
+#endif
+   uart_puts_P(BATT);
+   uart_puts((char *)arena.loc.battery);
+   delay_sec(1);
+   uart_puts_P(CTRLZ);
+   delay_sec(5);
+}
+
+
+#if FEATURE_CELLDB || FEATURE_GNSS
+// -------------------------------------------------------------------------------
+// location sources before GPRS in order, 1 when one of them filled 'loc'
+// -------------------------------------------------------------------------------
+uint8_t locsource(void)
+{
+  uint8_t i;
+
+   for (i = 0; i < sizeof(LOCSOURCE) / sizeof(LOCSOURCE[0]); i++)
+      if (run_script((const atstep_t *)pgm_read_ptr(&LOCSOURCE[i])) == 1) return 1;
+   return 0;
+}
+#endif
+
+// -------------------------------------------------------------------------------
+// position in 'loc' becomes the last known one
+// -------------------------------------------------------------------------------
+void keeploc(void)
+{
+   memcpy(lastloc.datetime, arena.loc.datetime, DATETIME_SIZE);
+   memcpy(lastloc.latitude, arena.loc.latitude, COORD_SIZE);
+   memcpy(lastloc.longtitude, arena.loc.longtitude, COORD_SIZE);
+   lastloc.at = uptime();
+   lastloc.acc = locacc;
+}
+
+#if FEATURE_UDP
+// -------------------------------------------------------------------------------
+// TRACK UDP - position in 'loc' as a report to the receiver instead of the location SMS,
+// returns 1 when it was acknowledged (sent, with UDP_ACK 0)
+// -------------------------------------------------------------------------------
+uint8_t udpreport(void)
+{
+   udp_track = 0;
+   udppack();
+   stats.udpreports++;
+   energy_state = STATE_GPRS;
+   if (run_script(UDPREPORT) != 1) return 0;
+   stats.udpacked++;
+   return 1;
+}
+#endif
+
+// -------------------------------------------------------------------------------
+// location query failed or the last known position is still more accurate - location SMS of
+// it with its age and 'loccode', only the error and battery voltage when there was none since power on
+// -------------------------------------------------------------------------------
+void sendlastknown(void)
+{
+   uart_puts_P(CHECKBATT);
+   readbattery();
+   delay_sec(1);
+   energy_state = STATE_SMS;
+   if (lastloc.datetime[0] == 0)
+     {
+      run_script(SMSTO);
+      uart_puts_P(NOLOCTXT);
+      uart_putnum(loccode);
+      uart_puts_P(BATT);
+      uart_puts((char *)arena.loc.battery);
+      delay_sec(1);
+      uart_puts_P(CTRLZ);
+      delay_sec(5);
+      return;
+     };
+   memcpy(arena.loc.datetime, lastloc.datetime, DATETIME_SIZE);
+   memcpy(arena.loc.latitude, lastloc.latitude, COORD_SIZE);
+   memcpy(arena.loc.longtitude, lastloc.longtitude, COORD_SIZE);
+   locacc = lastloc.acc;
+   locstale = 1;
+#if FEATURE_UDP
+   if (udp_track)
+     { if (!udpreport()) sendlastknown();   // no ack - the location SMS after all
+       return;
+     };
+#endif
+   run_script(LOCATIONSMS);
+}
+
+// -------------------------------------------------------------------------------
+// position in 'loc' to 'phonenumber' in the location SMS, it is kept as the last known one
+// - a position coarser than LOC_ACCURACY only when the last known one is not closer still
+// -------------------------------------------------------------------------------
+void sendlocation(void)
+{
+   if (locacc > LOC_ACCURACY && lastacc() < locacc)
+     {
+      loccode = 0;
+      sendlastknown();
+      return;
+     };
+   keeploc();
+#if FEATURE_UDP
+   if (udp_track)
+     { if (!udpreport()) sendlastknown();   // no ack - the SMS of it as the last known one
+       return;
+     };
+#endif
+   delay_sec(1);
+   energy_state = STATE_SMS;
+   run_script(LOCATIONSMS);
+}
+
+
+// -------------------------------------------------------------------------------
+// SMS command handlers, 'arg' is the SMS text after the command word
+// they return URC_LOCATE when location SMS goes to the sender, settings are answered with STATUS
+// -------------------------------------------------------------------------------
+#define URC_PRESLEEP 1         // SIM800L was woken up and needs PRESLEEP again
+#define URC_LOCATE   2         // location SMS to 'phonenumber'
+#define URC_UPDATE   4         // firmware update is in the staging area, reset to the bootloader
+
+uint8_t cmd_loc(const char *arg)
+{
+   (void)arg;                          // handlers of SMSCMDS take the text after the command word
+   return URC_LOCATE;
+}
+
+uint8_t cmd_status(const char *arg)
+{
+   (void)arg;
+   sendstatus();
+   return 0;
+}
+
+uint8_t cmd_stats(const char *arg)
+{
+   (void)arg;
+   sendstats();
+   return 0;
+}
+
+// INTERVAL n - minutes between TRACK location SMSes
+uint8_t cmd_interval(const char *arg)
+{
+  int n = atoi(arg);
+   if (n >= 1 && n <= 1440)
+     { cfg.interval = n;
+       settings_save();
+     };
+   sendstatus();
+   return 0;
+}
+
+// BACKOFF n - minutes of radio off when there is no 2G coverage
+uint8_t cmd_backoff(const char *arg)
+{
+  int n = atoi(arg);
+   if (n >= 1 && n <= 255)
+     { cfg.backoff = n;
+       settings_save();
+     };
+   sendstatus();
+   return 0;
+}
+
+// TRACK ON / TRACK OFF - periodic location SMS to the phone that sent TRACK ON, TRACK UDP - UDP reports
+// instead of the SMSes
+uint8_t cmd_track(const char *arg)
+{
+   while (*arg == ' ') arg++;
+   cfg.track = (strncasecmp_P(arg, ISON, 2) == 0);
+#if FEATURE_UDP
+   if (strncasecmp_P(arg, ISUDP, 3) == 0) cfg.track = TRACK_UDP;
+#endif
+   if (cfg.track) memcpy(cfg.owner, phonenumber, PHONE_SIZE);
+   track_seconds = 0;
+   settings_save();
+   sendstatus();
+   return 0;
+}
+
+#if FEATURE_MQTT
+// LIVE n [s] - live session of n minutes now and after every call, a position to the MQTT broker
+// s seconds (5..255) after the previous one, it starts with the location SMS - LIVE 0 ends it and calls
+// get the SMS only
+uint8_t cmd_live(const char *arg)
+{
+  char *next;
+  long n = strtol(arg, &next, 10), sec = strtol(next, NULL, 10);
+   if (n >= 0 && n <= 255)
+     { cfg.live = n;
+       if (sec >= 5 && sec <= 255) cfg.liveint = sec;
+       settings_save();
+     };
+   live_left = cfg.live * 60;
+   if (live_left) return URC_LOCATE;
+   sendstatus();
+   return 0;
+}
+#endif
+
+#if FEATURE_OTA
+// UPDATE - firmware update from OTAURL, the tracker resets to the bootloader when it is downloaded,
+// STATUS with the error of the download when it is not
+uint8_t cmd_update(const char *arg)
+{
+  uint8_t loaded;
+   (void)arg;
+   energy_state = STATE_GPRS;
+   eeprom_update_byte(&OTA_EEPROM->result, OTA_EHTTP);
+   loaded = 0;
+   PREEMPT(1);                          // a call cuts the download short, UPDATE again after it
+   if (run_script(ATTACH) == 1) loaded = run_script(OTAGET) == 1;
+   PREEMPT(0);
+   run_script(DETACH);
+   energy_state = STATE_AWAKE;
+   if (loaded) return URC_UPDATE;
+   if (!CALL_WAITS) sendstatus();      // the call goes first
+   return 0;
+}
+
+// downloaded update goes to the bootloader by a watchdog reset, statistics are saved first
+void otareboot(void)
+{
+   eeprom_update_byte(&OTA_EEPROM->state, OTA_PENDING);
+   stats_save();
+#ifdef HOST_BUILD
+   hal_reboot();
+#else
+   cli();
+   wdt_enable(WDTO_15MS);
+   for (;;) ;
+#endif
+}
+#endif
+
+typedef uint8_t (*cmdhandler_t)(const char *arg);
+
+#define CMD_ANY   0          // PIN is enough
+#define CMD_OWNER 1          // changes the tracker : PIN and, once TRACK ON set it, the owner's number
+
+typedef struct {
+  const char *name;         // PROGMEM command word
+  cmdhandler_t handler;
+  uint8_t who;              // CMD_ANY or CMD_OWNER
+} smscmd_t;
+
+const smscmd_t SMSCMDS[] PROGMEM = {
+  { CMDLOC, cmd_loc, CMD_ANY },
+  { CMDSTATS, cmd_stats, CMD_ANY },
+  { CMDSTATUS, cmd_status, CMD_ANY },
+  { CMDINTERVAL, cmd_interval, CMD_OWNER },
+  { CMDBACKOFF, cmd_backoff, CMD_OWNER },
+  { CMDTRACK, cmd_track, CMD_OWNER },
+#if FEATURE_MQTT
+  { CMDLIVE, cmd_live, CMD_OWNER },
+#endif
+#if FEATURE_OTA
+  { CMDUPDATE, cmd_update, CMD_OWNER },
+#endif
+};
+
+// -------------------------------------------------------------------------------
+// SMS text "<SMS_PIN> COMMAND [argument]" from 'phonenumber' - run the command, SMS without the
+// PIN is ignored, and so is a CMD_OWNER command from another number than 'cfg.owner' when it is set
+// -------------------------------------------------------------------------------
+uint8_t smscommand(const char *text)
+{
+  uint8_t i, n;
+  const char *name;
+   n = strlen_P(SMSPIN);
+   if (strncmp_P(text, SMSPIN, n) != 0 || text[n] != ' ') return 0;
+   text += n + 1;
+   for (i = 0; i < sizeof(SMSCMDS) / sizeof(SMSCMDS[0]); i++)
+     {
+      name = (const char *)pgm_read_ptr(&SMSCMDS[i].name);
+      n = strlen_P(name);
+      if (strncasecmp_P(text, name, n) != 0) continue;
+      if (pgm_read_byte(&SMSCMDS[i].who) == CMD_OWNER && cfg.owner[0]
+          && strncmp((char *)cfg.owner, (char *)phonenumber, PHONE_SIZE) != 0) return 0;
+      return ((cmdhandler_t)pgm_read_ptr(&SMSCMDS[i].handler))(text + n);
+     };
+   return 0;
+}
+
+// -------------------------------------------------------------------------------
+// handle +CMTI URC which is in 'response' buffer - read the SMS and run the SMS command
+// in it, then delete just this SMS
+// -------------------------------------------------------------------------------
+uint8_t handlesms(void)
+{
+  char *index;
+  char smsindex[4];
+  uint8_t result = 0;
+   // SMS index is after comma : +CMTI: "SM",1 - keep it, SMS text is read to 'response'
+   index = strchr((char *)arena.response, ',');
+   if (index == NULL) return 0;
+   strncpy(smsindex, index + 1, sizeof(smsindex) - 1);
+   smsindex[sizeof(smsindex) - 1] = 0;
+   if (!supply_ok()) return 0;            // the answer would be a TX burst, the SMS stays unread
+   uart_puts_P(SMS1);
+   delay_sec(1);
+   uart_puts_P(READSMS);
+   uart_puts(smsindex);
+   uart_puts_P(EOL);
+   readsmssender();
+   if (readline()>0) result = smscommand((const char *)arena.response);
+   uart_puts_P(DELONESMS);
+   uart_puts(smsindex);
+   uart_puts_P(EOL);
+   delay_sec(1);
+   return result;
+}
+
+
+// -------------------------------------------------------------------------------
+// URC handlers, they return URC_PRESLEEP when SIM800L was woken up and needs PRESLEEP again
+// -------------------------------------------------------------------------------
+
+// +CMTI - SMS may be a request for energy statistics or SMS command, the answer is not cut short by a call
+uint8_t urc_sms(void)
+{
+  uint8_t result;
+   run_script(WAKEUP);
+   PREEMPT(0);
+   result = handlesms();
+#if FEATURE_OTA
+   if (result & URC_UPDATE) otareboot();     // the SMS is deleted
+#endif
+   PREEMPT(1);
+   return URC_PRESLEEP | result;
+}
+
+// RDY, Call Ready - SIM800L restarted, wait until it answers and set it up again
+uint8_t urc_restart(void)
+{
+   modem_off = 0;
+   PREEMPT(0);
+   run_script(WAKEUP);          // sleep mode is off after restart, but the URC may be alone
+   run_script(BOOT);
+   PREEMPT(1);
+   return URC_PRESLEEP;
+}
+
+#if FEATURE_CLOCK
+// *PSUTTZ - network time (NITZ) after registration syncs the clock, SIM800L keeps sleeping
+uint8_t urc_clock(void)
+{
+   clockread();
+   delay_sec(1);                // end of RI pulse
+   return 0;
+}
+#endif
+
+// NORMAL / UNDER-VOLTAGE / OVER-VOLTAGE POWER DOWN - SIM800L is off and answers nothing, the tracker
+// sleeps without TRACK and coverage checks until SIM800L starts again by itself with RDY
+uint8_t urc_powerdown(void)
+{
+   modem_off = 1;
+   delay_sec(1);                // end of RI pulse
+   return 0;
+}
+
+// UNDER-VOLTAGE / OVER-VOLTAGE WARNNING - GPRS and SMS wait in supply_ok() until AT+CBC is fine
+// again, SIM800L keeps sleeping
+uint8_t urc_voltage(void)
+{
+   supplywarn = 1;
+   delay_sec(1);
+   return 0;
+}
+
+typedef uint8_t (*urchandler_t)(void);
+
+typedef struct {
+  const char *urc;          // PROGMEM string looked for in 'response'
+  urchandler_t handler;
+} urc_t;
+
+// first match wins
+const urc_t URCS[] PROGMEM = {
+  { ISCMTI, urc_sms },
+  { ISRDY, urc_restart },
+  { ISCALLREADY, urc_restart },
+  { ISPOWERDOWN, urc_powerdown },
+  { ISVOLTWARN, urc_voltage },
+#if FEATURE_CLOCK
+  { ISPSUTTZ, urc_clock }
+#endif
+};
+
+// -------------------------------------------------------------------------------
+// URC other than RING is in 'response' - run its handler, the others (NO CARRIER, SMS Ready,
+// +CREG...) need nothing : wait for the end of RI pulse and go back to sleep
+// -------------------------------------------------------------------------------
+uint8_t dispatchurc(void)
+{
+  uint8_t i;
+   for (i = 0; i < sizeof(URCS) / sizeof(URCS[0]); i++)
+      if (response_has_P((const char *)pgm_read_ptr(&URCS[i].urc)))
+         return ((urchandler_t)pgm_read_ptr(&URCS[i].handler))();
+   delay_sec(1);
+   return 0;
+}
+
+
+#if FEATURE_MQTT
+// -------------------------------------------------------------------------------
+// wait 'sec' seconds between live positions - URCs are handled meanwhile (SMS commands too,
+// LIVE 0 ends the session), returns 0 at RING : the session ends and the main loop takes the call
+// -------------------------------------------------------------------------------
+uint8_t livewait(uint8_t sec)
+{
+  uint8_t c;
+
+   while (sec > 0)
+     {
+      if (!wait_rx(1))                 // counted by at_tick() like in delay_sec(), TRACK INTERVAL too
+        { sec--;
+          continue;
+        };
+      // LF after the last answer read is skipped, the first char of a URC is kept
+      c = receive_uart();
+      if (c == '\r' || c == '\n') continue;
+      readline();
+      memmove(arena.response + 1, arena.response, BUFFER_SIZE - 1);
+      arena.response[0] = c;
+      if (response_has_P(ISRING))
+        {
+#if FEATURE_PREEMPT
+         at_ring = 1;
+#endif
+         live_stopped = 1;
+         return 0;
+        };
+      // LOC or LIVE n from SMS - the position published last with its age
+      if (dispatchurc() & URC_LOCATE)
+        { loccode = 0;
+          sendlastknown();
+        };
+      energy_state = STATE_GPRS;
+     };
+   return 1;
+}
+
+// -------------------------------------------------------------------------------
+// LIVE session : bearer and TCP connection to the MQTT broker stay open, a position is
+// published and 'cfg.liveint' seconds waited until 'live_left' runs out - a call or LIVE_FAILS
+// connections in a row that failed end it sooner, PINGREQ when there was no position
+// seconds are counted like the energy statistics, waits for SIM800L answers are in them too
+// -------------------------------------------------------------------------------
+void livesession(void)
+{
+  uint8_t fails = 0, up = 0;
+  uint32_t start, took;
+
+   energy_state = STATE_GPRS;
+   stats.livesessions++;
+   if (run_script(ATTACH))
+    while (live_left > 0)
+     {
+      start = uptime();
+      if (!up)
+        {
+         up = run_script(LIVEOPEN);
+         if (up)
+           { fails = 0;
+             live_sent = uptime();
+           }
+         else if (++fails == LIVE_FAILS) break;
+        };
+#if FEATURE_CELLDB || FEATURE_GNSS
+      if (up && (locsource() || run_script(LOCATE)))
+#else
+      if (up && run_script(LOCATE))
+#endif
+        {
+         keeploc();
+         if (run_script(LIVEPUB))
+           { stats.livepubs++;
+             live_sent = uptime();
+           }
+         else up = 0;                // connection is gone, again next time
+        }
+      else if (up && uptime() - live_sent >= MQTT_KEEPALIVE / 2)
+        {
+         if (run_script(LIVEPING)) live_sent = uptime();
+         else up = 0;
+        };
+      energy_state = STATE_GPRS;
+      if (!livewait(cfg.liveint)) break;
+      took = uptime() - start;
+      live_left = live_left > took ? live_left - took : 0;
+     };
+   run_script(LIVECLOSE);
+   run_script(DETACH);
+   live_left = 0;
+   energy_state = STATE_AWAKE;
+}
+#endif
+
+
+#ifdef SLEEP_POLLED
+// -------------------------------------------------------------------------------
+// while SIM800L is sleeping we will be probing SIM800L RI/RING pin status in 50 microseconds intervals
+// not to lose any serial port character on 9600 bps speed
+// The module SIM800L will be periodically woken up to see coverage status - once per 15-30 min
+// -------------------------------------------------------------------------------
+void waitring(void)
+{
+  uint32_t nbr50useconds = 0;
+  uint16_t sleepticks = 0;
+
+   while (!ringing() && !track_due())
+      {    // RING signal is HIGH
+           nbr50useconds++;           // increase number of 50useconds waited
+           delay_50usec(1UL);         // wait another 50usec
+           // account approximately every 20000 x 50usec as one second of waiting
+           if (++sleepticks == 20000)
+                { sleepticks = 0;
+                  stats.seconds[STATE_SLEEP]++;
+                  track_seconds++;
+                  if (gnss_due()) break;
+                };
+           // if something like 15min ~ 30min passed
+           // we need to check if there is need to turn off 2G for longer time
+           if (nbr50useconds == 18000000UL)
+                { // if specified amount of second passed 50usec x Y, we need to check 2G network coverage
+                  nbr50useconds = 0;
+                  if (!modem_off) run_script(COVERAGE);
+                };
+      };  // end of checking PIN D2 (INT0)
+}
+#endif
+#endif   // FEATURE_STATS
+
+
+
+
+// *********************************************************************************************************
+//
+//                                                    MAIN PROGRAM
+//
+// *********************************************************************************************************
+
+int main(void) {
+
+  // initialize 9600 baud 8N1 RS232
+  init_uart();
+
+  // Set PORTD2 / INT0 pin for input (this clears bit DDD2 in the DDR)
+  // to check SIM800L RI/RING pin status
+  DDRD &= ~(1 << PD2);            // switch on pin INT0 as input (PD2)
+  PORTD |= (1 << PD2);            // enable pull-up resistor
+
+#if FEATURE_STATS
+  uint8_t initialized, presleep = 1, located, tracking;
+
+  // load energy statistics and settings of SMS commands from EEPROM
+  stats_load();
+  settings_load();
+
+  // SIM800L startup, check pin status, registration status and provision APN settings
+  run_script(BOOT);
+
+  // neverending LOOP
+     while (1) {
+
+             do {
+
+                // WAIT FOR RING message - incoming voice call and send SMS or restart RADIO module if no signal
+                   initialized = 0;
+                   tracking = 0;
+                // until a call is taken it cuts short registration checks, coverage backoff and waits
+                   PREEMPT(1);
+
+                // empty SMS memory, enable CLIP and enter SLEEP MODE of SIM800L for power saving
+                // not needed when a URC did not wake SIM800L up, nor before a call that waits
+                   if (presleep && !CALL_WAITS) run_script(PRESLEEP);
+                   presleep = 1;
+
+               // save energy statistics before waiting for RING
+                   stats_save();
+
+#if FEATURE_PREEMPT
+                if (at_ring == 0)
+                {
+#endif
+#ifdef SLEEP_POLLED
+               // MCU does not sleep, RI/RING pin is polled and 2G coverage checked periodically
+                   waitring();
+#else
+               // enter SLEEP MODE on MCU for power saving, requires RING/RI SIM800L pin connected to INT0
+                   sleepnow(); // sleep function called here
+#endif
+
+                // TRACK ON - location SMS to its owner when INTERVAL passed, a call or URC on RI goes first
+                if (track_due() && (PIND & (1 << PD2)))
+                   { initialized = 1;
+                     tracking = 1;
+                     PREEMPT(0);
+                     track_seconds = 0;
+                     memcpy(phonenumber, cfg.owner, PHONE_SIZE);
+#if FEATURE_UDP
+                     udp_track = (cfg.track == TRACK_UDP);
+#endif
+                     run_script(WAKEUP);
+                   }
+#if FEATURE_GNSS
+                // short on-window of GNSS receiver keeps its ephemeris warm, a call or URC on RI goes first
+                else if (gnss_due() && (PIND & (1 << PD2)))
+                   { run_script(WAKEUP);
+                     run_script(GNSSWINDOW);
+                   }
+#endif
+
+               // THERE WAS RI / INT0 INTERRUPT AND SOMETHING WAS SEND OVER SERIAL WE NEED TO GET OFF SLEEPMODE AND READ SERIAL PORT
+                else if (readline()>0)
+                   {
+                    if (response_has_P(ISRING))
+                    { initialized = 1;
+                      PREEMPT(0);           // RI is LOW until the call is answered
+                      stats.rings++;
+                      readphonenumber();
+                      run_script(ANSWER);
+                      } // end of IF
+
+                     // some other URC than RING - its own handler, if any
+                     else
+                      { presleep = dispatchurc();
+                        if (presleep & URC_LOCATE)      // LOC SMS command, location SMS to its sender
+                           { initialized = 1;
+                             PREEMPT(0);
+                           };
+                      };
+
+                    }; // END of READLINE IF
+#if FEATURE_PREEMPT
+                };
+
+                // call came while the tracker was busy with something else, take its RING now
+                if (at_ring)
+                   { at_ring = 0;
+                     PREEMPT(0);
+                     energy_state = STATE_AWAKE;
+                     presleep = 1;
+                     if (run_script(RINGIN))
+                        { initialized = 1;
+                          stats.rings++;
+#if FEATURE_UDP
+                          udp_track = 0;          // the caller gets the location SMS, not the receiver
+#endif
+                          run_script(ANSWER);
+                        };
+                   };
+#endif
+
+                } while ( initialized == 0);    // end od DO-WHILE, go to beggining and enter SLEEPMODE again
+
+           // supply still low after a VOLTAGE WARNNING - no answer rather than a TX burst that resets
+           if (!supply_ok())
+              stats.locfailures++;
+           else
+           // last position still within LOC_ACCURACY - answered with it, no receiver and no GPRS
+           if (lastacc() <= LOC_ACCURACY)
+              {
+                loccode = 0;
+                sendlastknown();
+              }
+           else
+#if FEATURE_CELLDB || FEATURE_GNSS
+           // GNSS fix or serving cell in the cell database in flash - location SMS without GPRS
+           if (locsource())
+              sendlocation();
+           else
+#endif
+           {
+              // Create connection to GPRS network - 3 attempts if needed
+              energy_state = STATE_GPRS;
+              loccode = LOCERR_NOBEARER;
+              located = 0;
+
+              // TRACK location gives way to a call, the bearer and the query up to 40 s are cut short
+              PREEMPT(tracking);
+
+              // if GPRS was  succesfull the it is time send cell info to Google and query the GPS location
+              if (run_script(ATTACH) == 1)
+              {
+                  // parse GPS coordinates from the SIM808 answer to 'longtitude' & 'latitude' buffers
+                  loccode = LOCERR_NOANSWER;
+                  located = run_script(LOCATE) == 1;
+                  PREEMPT(0);
+                  if (located)
+                      {
+                        sendlocation();
+                        energy_state = STATE_GPRS;
+                      }; // End of LOCATE IF
+
+                 //and close the bearer
+                 run_script(DETACH);
+
+              } /// end of commands when GPRS is working
+              PREEMPT(0);
+
+              // the call is taken first, TRACK location comes again right after it
+              if (CALL_WAITS)
+                 track_seconds = (uint32_t)cfg.interval * 60;
+              else
+              // no position - the last known one with its age, the caller is not left without answer
+              if (!located)
+                 {
+                   stats.locfailures++;
+                   if (loccode == LOCERR_RESET)
+                      { // SIM800L restarted itself, allow 60 sec for its reboot
+                        energy_state = STATE_AWAKE;
+                        PREEMPT(1);            // next call may come during the wait
+                        delay_sec(55);
+                        PREEMPT(0);
+                      };
+                   sendlastknown();
+                 };
+           };
+#if FEATURE_UDP
+           udp_track = 0;                      // TRACK without any position since power on got the SMS
+#endif
+
+#if FEATURE_MQTT
+           // LIVE n or a call with LIVE on - positions to the MQTT broker until the session ends
+           if (live_left && !supplywarn) livesession();
+#endif
+
+        energy_state = STATE_AWAKE;
+
+        // now go to the beginning and enter sleepmode on SIM800L and MCU again for power saving
+        PREEMPT(1);
+        delay_sec(10);
+
+        // end of neverending loop
+        };
+
+#else
+  uint8_t attempt;
+
+  // SIM800L startup, fixed UART speed, RI pin for URC, settings saved
+  delay_sec(10);                          // safe SIM800L startup and network registration
+  checkat();
+  delay_sec(2);
+  atsend(SET9600, 2);                     // fix UART speed to 9600 bps to disable autosensing
+#ifdef SLEEP_POLLED
+  atsend(DISREGURC, 2);                   // disable reporting of registration status
+#else
+  atsend(CFGRIPIN, 2);                    // RI PIN activity for URC
+#endif
+  atsend(SAVECNF, 3);
+  modemsetup();
+
+  // neverending LOOP, wait for RING and send location SMS after each RING
+     while (1) {
+
+             // delete all SMSes to keep SIM800L memory empty, SLEEP MODE of SIM800L until incoming
+             // voice call or SMS
+                atsend(SMS1, 2);
+                atsend(DELSMS, 3);
+                atsend(SLEEPON, 2);
+#ifdef SLEEP_POLLED
+                waitring();               // poll RI/RING, coverage check every 30 minutes
+#else
+                sleepnow();               // POWERDOWN of MCU until RI / INT0
+#endif
+
+             // some other message than RING, check SIM800L again
+                readline();
+                if (!response_has_P(ISRING))
+                   { atsend(AT, 1);
+                     atsend(SLEEPOFF, 1);
+                     modemsetup();
+                     continue;
+                   };
+
+             // disable SLEEPMODE, hangup a call and proceed with SMS
+                readphonenumber();
+                atsend(AT, 1);
+                atsend(SLEEPOFF, 1);
+                atsend(HANGUP, 1);
+
+             // GPRS attach and IP bearer, 3 attempts
+                for (attempt = 0; attempt < 3; attempt++)
+                   {
+                     atsend(SAPBRCLOSE, 2);
+                     atsend(SAPBROPEN, 5);
+                     uart_puts_P(SAPBRQUERY);
+                     if (readanswer(10) && response_has_P(SAPBRSUCC)) break;
+                   };
+
+                if (attempt < 3)
+                   {
+                     delay_sec(1);
+                     uart_puts_P(CHECKGPS);      // GPS position of nearest GSM CELL via Google API
+                     readcellgps();
+                     delay_sec(1);
+                     atsend(SMS1, 1);            // SMS in plain text format, CTRL Z at the end
+                     uart_puts_P(SMS2);
+                     uart_puts((char *)phonenumber);
+                     atsend(CRLF, 1);
+                     uart_puts((char *)arena.loc.datetime);   // DATE & TIME from AGPS cell info
+                     uart_puts_P(LONG);
+                     uart_puts((char *)arena.loc.longtitude);
+                     uart_puts_P(LATT);
+                     uart_puts((char *)arena.loc.latitude);
+                     uart_puts_P(GOOGLELOC1);    // link to GOOGLE MAPS
+                     uart_puts((char *)arena.loc.latitude);
+                     uart_puts_P(GOOGLELOC2);
+                     uart_puts((char *)arena.loc.longtitude);
+                     atsend(GOOGLELOC3, 1);
+                     atsend(CTRLZ, 5);
+                     uart_puts_P(SAPBRCLOSE);
+                   };
+
+                delay_sec(10);
+
+        // end of neverending loop
+        };
+#endif
+
+    // end of MAIN code
+}